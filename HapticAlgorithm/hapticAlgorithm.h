@@ -0,0 +1,801 @@
+/************************ Haptic Control Library ***************************
+ *
+ * Description : Teleoperation control algorithms shared by HapticMaster,
+ * HapticSlaver and HapticMixture. Every algorithm is a policy class with
+ * the same set of hooks; the number of DoF is a template parameter so the
+ * per axis loops carry no runtime size. ControlPipeline holds one instance
+ * of every policy and forwards each hook to the active one with a single
+ * index comparison per policy, without virtual calls.
+ *
+ * Hooks (all optional, None_Policy provides empty defaults):
+ *   Initialize()                           reset when the policy gets selected
+ *   MasterCommandRevise(vel)               master, before the command is sent
+ *   MasterFeedbackRevise(vel, force)       master, after a force is received
+ *   SlaveCommandRevise(vel, force)         slave, after a command is received
+ *   SlaveFeedbackRevise(force)             slave, before the force is sent
+ *   SetSampleInterval(dt)                  measured loop interval, every policy
+ *
+ * The policy order in TeleoperationController matches AlgorithmType, so a
+ * received ATypeChange can be passed to Select() directly.
+ */
+
+#pragma once
+
+#include <cmath>
+#include <cstring>
+#include <atomic>
+#include <ostream>
+#include <tuple>
+#include <type_traits>
+#include <utility>
+
+#include "math/CVector3d.h"
+#include "system/CGlobals.h"
+#include "system/CThread.h"
+
+enum AlgorithmType { AT_None, AT_TDPA, AT_ISS, AT_MMT, AT_WAVE, AT_KEEP };
+
+
+/***************** SPSCRing ***********************/
+// lock-free ring for exactly one producer thread and one consumer thread,
+// Capacity has to be a power of two
+template<typename T, unsigned int Capacity>
+class SPSCRing {
+	static_assert((Capacity & (Capacity - 1)) == 0, "SPSCRing capacity has to be a power of two");
+public:
+	SPSCRing() : head(0), tail(0) {};
+
+	// producer side, false if the ring is full
+	bool Push(const T& value) {
+		unsigned int h = head.load(std::memory_order_relaxed);
+		if (h - tail.load(std::memory_order_acquire) == Capacity) return false;
+		buffer[h & (Capacity - 1)] = value;
+		head.store(h + 1, std::memory_order_release);
+		return true;
+	};
+
+	// consumer side, false if the ring is empty
+	bool Pop(T& value) {
+		unsigned int t = tail.load(std::memory_order_relaxed);
+		if (head.load(std::memory_order_acquire) == t) return false;
+		value = buffer[t & (Capacity - 1)];
+		tail.store(t + 1, std::memory_order_release);
+		return true;
+	};
+
+private:
+	T buffer[Capacity];
+	std::atomic<unsigned int> head;	// written by the producer only
+	char pad[64];					// keep head and tail on different cache lines
+	std::atomic<unsigned int> tail;	// written by the consumer only
+};
+
+
+/***************** VersionedValue *****************/
+// single writer sequence lock, the reader never waits: a read that overlaps a
+// write fails and is simply retried on the next tick. The value is stored as
+// atomic words so that an overlapping read is not a data race, which limits
+// T to trivially copyable types.
+template<typename T>
+class VersionedValue {
+	static_assert(std::is_trivially_copyable<T>::value, "VersionedValue payload has to be trivially copyable");
+public:
+	VersionedValue() : sequence(0) {
+		for (unsigned int i = 0; i < Words; i++) words[i].store(0, std::memory_order_relaxed);
+	};
+
+	void Publish(const T& v) {
+		unsigned int buffer[Words] = {};
+		memcpy(buffer, &v, sizeof(T));
+		unsigned int s = sequence.load(std::memory_order_relaxed);
+		sequence.store(s + 1, std::memory_order_relaxed);
+		std::atomic_thread_fence(std::memory_order_release);
+		for (unsigned int i = 0; i < Words; i++) words[i].store(buffer[i], std::memory_order_relaxed);
+		sequence.store(s + 2, std::memory_order_release);
+	};
+
+	// returns false while nothing is published or the writer is busy; version counts the publications
+	bool TryRead(T& v, unsigned int& version) const {
+		unsigned int s1 = sequence.load(std::memory_order_acquire);
+		if (s1 == 0 || (s1 & 1)) return false;
+		unsigned int buffer[Words];
+		for (unsigned int i = 0; i < Words; i++) buffer[i] = words[i].load(std::memory_order_relaxed);
+		std::atomic_thread_fence(std::memory_order_acquire);
+		if (sequence.load(std::memory_order_relaxed) != s1) return false;
+		memcpy(&v, buffer, sizeof(T));
+		version = s1 / 2;
+		return true;
+	};
+
+private:
+	static const unsigned int Words = (sizeof(T) + sizeof(unsigned int) - 1) / sizeof(unsigned int);
+	std::atomic<unsigned int> words[Words];
+	std::atomic<unsigned int> sequence;
+};
+
+
+/***************** None_Policy ********************/
+// transparent teleoperation, forwards all signals unchanged
+template<int DoF>
+class None_Policy {
+public:
+	void Initialize() {};
+	void MasterCommandRevise(double* vel) {};
+	void MasterFeedbackRevise(double* vel, double* force) {};
+	void SlaveCommandRevise(double* vel, double* force) {};
+	void SlaveFeedbackRevise(double* force) {};
+	void SetSampleInterval(double dt) {};
+};
+
+
+/***************** TDPA_Policy ********************/
+// time domain passivity approach, energy observer + passivity controller per axis.
+// Works for any DoF, e.g. 6 with the torques/angular velocities stacked after the
+// forces/linear velocities. The observers integrate with the measured loop interval.
+template<int DoF>
+class TDPA_Policy : public None_Policy<DoF> {
+public:
+	// observer state published once per revision, see TelemetryChannel
+	struct Telemetry
+	{
+		double dt;
+		double E_in[DoF], E_out[DoF], E_recv[DoF];
+		double alpha[DoF], beta[DoF];
+	};
+
+	double sample_interval = 0.001;   // measured loop interval, see SetSampleInterval
+	double E_in[DoF], E_out[DoF];
+	double E_in_last[DoF];
+	double E_trans[DoF], E_recv[DoF];
+	double alpha[DoF], beta[DoF];
+	SPSCRing<Telemetry, 1024>* TelemetryChannel = NULL;	// optional, filled by the haptic thread
+
+	TDPA_Policy() { Initialize(); };
+
+	void SetSampleInterval(double dt) { sample_interval = dt; };
+
+	// one tab separated line per sample: dt, E_in, E_out, E_recv, alpha, beta
+	static void WriteTelemetry(std::ostream& out, const Telemetry& t) {
+		out << t.dt;
+		const double* columns[5] = { t.E_in, t.E_out, t.E_recv, t.alpha, t.beta };
+		for (int c = 0; c < 5; c++) {
+			for (int i = 0; i < DoF; i++)
+				out << '\t' << columns[c][i];
+		}
+		out << '\n';
+	};
+
+	// branch free so the per axis loop vectorizes
+	void ComputeEnergy(const double* vel, const double* force)
+	{
+		for (int i = 0; i < DoF; i++) {
+			double power = vel[i] * (-1 * force[i]);
+			E_in[i] += sample_interval * 0.5 * (fabs(power) + power);
+			E_out[i] += sample_interval * 0.5 * (fabs(power) - power);
+		}
+	};
+
+	// master: passivity controller acts on the displayed force
+	void MasterFeedbackRevise(double* Vel, double* force) {
+		ComputeEnergy(Vel, force);
+		for (int i = 0; i < DoF; i++) {
+			double excess = E_out[i] - E_recv[i];
+			bool dissipate = excess > 0 && fabs(Vel[i]) > 0.001;
+			alpha[i] = dissipate ? excess / (sample_interval*Vel[i] * Vel[i]) : 0;
+			E_out[i] = dissipate ? E_recv[i] : E_out[i];
+
+			force[i] = force[i] - alpha[i] * Vel[i];
+		}
+		Publish();
+	};
+
+	// slave: passivity controller acts on the commanded velocity
+	void SlaveCommandRevise(double* Vel, double* force) {
+		ComputeEnergy(Vel, force);
+		for (int i = 0; i < DoF; i++) {
+			double excess = E_out[i] - E_recv[i];
+			bool dissipate = excess > 0 && fabs(force[i]) > 0.001;
+			beta[i] = dissipate ? excess / (sample_interval*force[i] * force[i]) : 0;
+			E_out[i] = dissipate ? E_recv[i] : E_out[i];
+
+			Vel[i] = Vel[i] - beta[i] * force[i];
+		}
+		Publish();
+	};
+
+	// input energy is only updated at the deadband transmission instants
+	void UpdateTransmitEnergy(bool transmit)
+	{
+		if (transmit) {
+			memcpy(E_trans, E_in, DoF * sizeof(double));
+			memcpy(E_in_last, E_in, DoF * sizeof(double));
+		}
+		else
+		{
+			memcpy(E_trans, E_in_last, DoF * sizeof(double));
+		}
+	};
+
+	void Initialize()
+	{
+		memset(E_in, 0, DoF * sizeof(double));
+		memset(E_out, 0, DoF * sizeof(double));
+		memset(E_in_last, 0, DoF * sizeof(double));
+		memset(E_trans, 0, DoF * sizeof(double));
+		memset(E_recv, 0, DoF * sizeof(double));
+		memset(alpha, 0, DoF * sizeof(double));
+		memset(beta, 0, DoF * sizeof(double));
+	};
+
+private:
+	void Publish() {
+		if (TelemetryChannel == NULL) return;
+		Telemetry t;
+		t.dt = sample_interval;
+		memcpy(t.E_in, E_in, DoF * sizeof(double));
+		memcpy(t.E_out, E_out, DoF * sizeof(double));
+		memcpy(t.E_recv, E_recv, DoF * sizeof(double));
+		memcpy(t.alpha, alpha, DoF * sizeof(double));
+		memcpy(t.beta, beta, DoF * sizeof(double));
+		TelemetryChannel->Push(t);	// dropped if the reader falls behind
+	};
+};
+
+
+/***************** ISS_Policy *********************/
+// input-to-state stable approach, master side only
+template<int DoF>
+class ISS_Policy : public None_Policy<DoF> {
+public:
+	double sample_interval = 0.001;   //1kHz
+	double mu_max = 10;
+	float stiff_factor = 0.5;
+	float mu_factor = 1.0;
+	double tau = 0.005;
+	double d_force[DoF];
+	double last_force[DoF];
+
+	ISS_Policy() { Initialize(); };
+
+	void SetSampleInterval(double dt) { sample_interval = dt; };
+
+	void MasterCommandRevise(double* vel) {
+		for (int i = 0; i < DoF; i++) {
+			vel[i] = vel[i] + d_force[i] / (mu_max*mu_factor);
+		}
+	};
+
+	void MasterFeedbackRevise(double* vel, double* force) {
+		for (int i = 0; i < DoF; i++) {
+			d_force[i] = (force[i] - last_force[i]) / sample_interval;  // get derivation of force respect to time
+			last_force[i] = force[i];
+			force[i] = force[i] + d_force[i] * tau;  // use "+" because MasterForce direction is opposite to f_e in the paper
+		}
+	};
+
+	void Initialize()
+	{
+		memset(d_force, 0, DoF * sizeof(double));
+		memset(last_force, 0, DoF * sizeof(double));
+	};
+};
+
+
+/***************** WaveReconstruction *************/
+// turns the received wave into the applied wave: the drift against the wave
+// integral sent by the other side is corrected and the wave is predicted over
+// the estimated delay. Both are paid from the wave energy that actually arrived,
+// so the channel stays passive whatever delay, jitter or deadband hold occurs.
+template<int DoF>
+class WaveReconstruction {
+public:
+	double received[DoF];	// last received wave (held between packets)
+	double integral[DoF];	// integral of the wave at the sender, from the same packet
+	double applied[DoF];	// reconstructed wave used by the wave transformation
+	double CorrectionTime = 0.02;	// s, time constant of the drift correction
+	double PredictionGain = 0;		// 0 disables the prediction, 1 predicts over the whole delay
+	double DelayEstimate = 0;		// s, smoothed one way delay
+	double ReserveLimit = 0.01;		// upper bound of the stored wave energy per axis
+
+	WaveReconstruction() { Initialize(); };
+
+	void Receive(const double* wave, const double* waveIntegral) {
+		memcpy(received, wave, DoF * sizeof(double));
+		memcpy(integral, waveIntegral, DoF * sizeof(double));
+	};
+
+	// delay from the packet timestamps, low pass filtered against the jitter
+	void UpdateDelay(double delay) { DelayEstimate += 0.01 * (delay - DelayEstimate); };
+
+	void Apply(double dt) {
+		for (int i = 0; i < DoF; i++) {
+			// the packet integral is as old as the packet, predict it over the delay with the held wave
+			double target = integral[i] + PredictionGain * DelayEstimate * received[i];
+			double corrected = received[i] + (target - used[i]) / CorrectionTime;
+
+			// energy reservoir: what arrives is 0.5*v^2*dt, the applied wave can not spend more
+			reserve[i] = fmin(reserve[i] + 0.5 * dt * received[i] * received[i], ReserveLimit);
+			double limit = sqrt(2 * reserve[i] / dt);
+			applied[i] = fmax(-limit, fmin(limit, corrected));
+			reserve[i] -= 0.5 * dt * applied[i] * applied[i];
+
+			used[i] += applied[i] * dt;
+		}
+	};
+
+	void Initialize() {
+		memset(received, 0, DoF * sizeof(double));
+		memset(integral, 0, DoF * sizeof(double));
+		memset(applied, 0, DoF * sizeof(double));
+		memset(used, 0, DoF * sizeof(double));
+		memset(reserve, 0, DoF * sizeof(double));
+	};
+
+private:
+	double used[DoF];		// integral of the applied wave
+	double reserve[DoF];	// received but not yet applied wave energy
+};
+
+
+/***************** WAVE_Policy ********************/
+// wave variable transformation, ul/vl on the master side and ur/vr on the slave side.
+// The wave integrals Ul/Ur are transmitted with the waves for the drift correction.
+template<int DoF>
+class WAVE_Policy : public None_Policy<DoF> {
+public:
+	// b=1.2 for Touch
+	double b = 8;	//damping factor
+	double scaleFactor = 1;
+	double sample_interval = 0.001;   // measured loop interval, see SetSampleInterval
+
+	double ul[DoF];	//sent signal OP
+	double ur[DoF];	//sent signal TOP
+	double Ul[DoF];	//integral of ul
+	double Ur[DoF];	//integral of ur
+	WaveReconstruction<DoF> vl;	//received signal OP
+	WaveReconstruction<DoF> vr;	//received signal TOP
+
+	WAVE_Policy() { Initialize(); };
+
+	void SetSampleInterval(double dt) { sample_interval = dt; };
+
+	// master: encode the velocity into the forward wave
+	void MasterCommandRevise(double* vel) {
+		vl.Apply(sample_interval);
+		for (int i = 0; i < DoF; i++) {
+			ul[i] = sqrt(2 * b)*vel[i] / scaleFactor + vl.applied[i];
+			Ul[i] += ul[i] * sample_interval;
+		}
+	};
+
+	// master: decode the force from the returning wave
+	void MasterFeedbackRevise(double* vel, double* force) {
+		for (int i = 0; i < DoF; i++) {
+			force[i] = -1 * (b*vel[i] / scaleFactor + sqrt(2 * b)*vl.applied[i]);
+		}
+	};
+
+	// slave: decode the velocity from the forward wave
+	void SlaveCommandRevise(double* vel, double* force) {
+		vr.Apply(sample_interval);
+		for (int i = 0; i < DoF; i++) {
+			vel[i] = -1 / b*(force[i] - sqrt(2 * b)*vr.applied[i]) * scaleFactor;
+		}
+	};
+
+	// slave: encode the force into the returning wave
+	void SlaveFeedbackRevise(double* force) {
+		for (int i = 0; i < DoF; i++) {
+			ur[i] = sqrt(2 / b)*force[i] - vr.applied[i];
+			Ur[i] += ur[i] * sample_interval;
+		}
+	};
+
+	void Initialize() {
+		memset(ul, 0, DoF * sizeof(double));
+		memset(ur, 0, DoF * sizeof(double));
+		memset(Ul, 0, DoF * sizeof(double));
+		memset(Ur, 0, DoF * sizeof(double));
+		vl.Initialize();
+		vr.Initialize();
+	};
+};
+
+
+/***************** RLSEstimator *******************/
+// recursive least squares with exponential forgetting for y = phi' * theta,
+// O(N^2) per sample and no matrix factorization
+template<int N>
+class RLSEstimator {
+public:
+	double Theta[N];	// current parameter estimate
+	double P[N][N];		// inverse correlation matrix, shrinks as the parameters get excited
+	double Lambda;		// forgetting factor, 1 keeps the whole history
+	double InitialCovariance;
+	int Samples;
+
+	RLSEstimator(double lambda = 0.995, double p0 = 1000) : Lambda(lambda), InitialCovariance(p0) { Initialize(); };
+
+	void Update(const double* phi, double y) {
+		double Pphi[N];
+		double denom = Lambda;
+		double err = y;
+		for (int i = 0; i < N; i++) {
+			Pphi[i] = 0;
+			for (int j = 0; j < N; j++)
+				Pphi[i] += P[i][j] * phi[j];
+			denom += phi[i] * Pphi[i];
+			err -= phi[i] * Theta[i];
+		}
+		for (int i = 0; i < N; i++) {
+			Theta[i] += Pphi[i] / denom * err;
+		}
+		for (int i = 0; i < N; i++) {
+			for (int j = 0; j < N; j++)
+				P[i][j] = (P[i][j] - Pphi[i] * Pphi[j] / denom) / Lambda;
+		}
+		Samples++;
+	};
+
+	// 0: parameter i is unknown (initial covariance), 1: its variance has vanished
+	double Confidence(int i) const {
+		double c = 1 - P[i][i] / InitialCovariance;
+		return c < 0 ? 0 : (c > 1 ? 1 : c);
+	};
+
+	void Initialize() {
+		for (int i = 0; i < N; i++) {
+			Theta[i] = 0;
+			for (int j = 0; j < N; j++)
+				P[i][j] = (i == j) ? InitialCovariance : 0;
+		}
+		Samples = 0;
+	};
+};
+
+
+/***************** MMT_Algorithm ******************/
+// model mediated teleoperation, the slave estimates the environment and the
+// master renders a local model; no revision of the exchanged signals
+class MMT_Algorithm : public None_Policy<3> {
+public:
+	/*
+	enviroment variable:
+	1. box position;
+	3. K used to calculate the force
+	*/
+	struct envPar
+	{
+		chai3d::cVector3d parPosition;
+		chai3d::cVector3d parStiffness;
+		double mass;//mass of cube
+		double FrictionF;//friction force of cube
+		bool Flag;//whether this parameters is used to update the master's enviroment
+	};
+	envPar MasterPar = { chai3d::cVector3d(0, 0, 0) ,chai3d::cVector3d(0, 0, 0),1,0 ,false };
+	envPar SlavePar = { chai3d::cVector3d(0, 0, 0) ,chai3d::cVector3d(0, 0, 0),1,0 ,true };
+	chai3d::cVector3d oldStiffness = chai3d::cVector3d(0, 0, 0);
+	chai3d::cVector3d oldPosition = chai3d::cVector3d(0, 0, 0);
+	double SlaveOldVelocity = 0;
+	double MasterOldVelocity = 0;
+	int MasterMoveDirection = 0;
+	static const int length = 100;
+	int index1 = 0;
+	bool full1 = false;
+	chai3d::cVector3d parStiffness[length];//store parameter K used to calculate the average K value.
+	chai3d::cVector3d StiffnessSum = chai3d::cVector3d(0, 0, 0);//running sum of parStiffness
+
+	// friction force = mass * a - FrictionF, theta = [mass, FrictionF], phi = [a, -1]
+	RLSEstimator<2> MassFriction;
+
+	/*
+	dead band parameter
+	*/
+	double db = 0.1;
+	// mass and friction are only compared once the estimator is this confident
+	double ConfidenceThreshold = 0.9;
+	double StiffnessConfidence = 0;	// fraction of the stiffness window that holds samples
+	double MassConfidence = 0;		// RLS confidence of the mass estimate
+	double FrictionConfidence = 0;	// RLS confidence of the friction estimate
+
+	void ForceRevise(double* force, chai3d::cVector3d goalPos, chai3d::cVector3d proxyPos) {
+		chai3d::cVector3d Temp = MasterPar.parStiffness;
+		Temp.mulElement(proxyPos - goalPos);
+		force[0] = Temp(0);
+		force[1] = Temp(1);
+		force[2] = Temp(2);
+	}
+
+	void Initialize() {
+		MasterPar = { chai3d::cVector3d(0, 0, 0) ,chai3d::cVector3d(0, 0, 0),1,0 ,false };
+		SlavePar = { chai3d::cVector3d(0, 0, 0) ,chai3d::cVector3d(0, 0, 0),1,0 ,true };
+		index1 = 0;
+		full1 = false;
+		oldStiffness = chai3d::cVector3d(0, 0, 0);
+		StiffnessSum = chai3d::cVector3d(0, 0, 0);
+		for (int i = 0; i < length; i++) {
+			parStiffness[i] = chai3d::cVector3d(0, 0, 0);
+		}
+		MassFriction.Initialize();
+		StiffnessConfidence = MassConfidence = FrictionConfidence = 0;
+	}
+
+	// dt is the interval to the previous sample, the velocity and acceleration of the object are differenced over it
+	void Input(chai3d::cVector3d PosGoal, chai3d::cVector3d PosProxy, chai3d::cVector3d force, int axis, chai3d::cVector3d position, bool contact, double dt) {
+		SlavePar.parPosition = position;
+		for (int i = 0; i < 3; i++) {
+			double deltaX = PosGoal(i) - PosProxy(i);
+			if (deltaX) {
+				oldStiffness(i) = fabs(force(i) / deltaX);
+			}
+		}
+
+		// windowed mean of the stiffness, the sum is rebuilt on every wrap to drop rounding drift
+		StiffnessSum += oldStiffness - parStiffness[index1];
+		parStiffness[index1] = oldStiffness;
+		index1 = (index1 + 1) % length;
+		if (index1 == 0) {
+			full1 = true;
+			StiffnessSum.zero();
+			for (int i = 0; i < length; i++) {
+				StiffnessSum += parStiffness[i];
+			}
+		}
+		SlavePar.parStiffness = StiffnessSum / (full1 ? length : index1);
+		StiffnessConfidence = full1 ? 1.0 : (double)index1 / length;
+
+
+		if (!(dt > 0)) return;
+		double v = (position(1) - oldPosition(1)) / dt;
+		oldPosition = position;
+		double a = (v - SlaveOldVelocity) / dt;
+		SlaveOldVelocity = v;
+		if (!(fabs(a)>0) || !(fabs(v)>0) || !contact)return;
+
+		double phi[2] = { a, -1 };
+		MassFriction.Update(phi, force(axis));
+
+		SlavePar.mass = MassFriction.Theta[0];
+		SlavePar.FrictionF = fabs(MassFriction.Theta[1]);
+		MassConfidence = MassFriction.Confidence(0);
+		FrictionConfidence = MassFriction.Confidence(1);
+	}
+
+	// copy a model identified elsewhere (see MMTIdentificationService), Flag is left untouched
+	void ApplyModel(const envPar& par, const double* confidence) {
+		SlavePar.parPosition = par.parPosition;
+		SlavePar.parStiffness = par.parStiffness;
+		SlavePar.mass = par.mass;
+		SlavePar.FrictionF = par.FrictionF;
+		StiffnessConfidence = confidence[0];
+		MassConfidence = confidence[1];
+		FrictionConfidence = confidence[2];
+	}
+
+	bool isTransmit() {
+		if (StiffnessConfidence < 1)return false;
+		for (int i = 0; i < 3; i++) {
+			// The threshold of  change rate is 10 percentage
+			if (fabs(MasterPar.parStiffness(i) - SlavePar.parStiffness(i)) / SlavePar.parStiffness(i) > db)
+				return true;
+			// The threshold of  position offset is 0.1 meters
+			if (fabs(MasterPar.parPosition(i) - SlavePar.parPosition(i))> 0.1)
+				return true;
+		}
+		if (MassConfidence < ConfidenceThreshold || FrictionConfidence < ConfidenceThreshold)
+			return false;
+
+		if (fabs(MasterPar.mass - SlavePar.mass) / SlavePar.mass > db)
+			return true;
+
+		if (fabs(MasterPar.FrictionF - SlavePar.FrictionF) / SlavePar.FrictionF > db)
+			return true;
+		return false;
+	}
+};
+
+
+/***************** ControlPipeline ****************/
+// holds one instance of every policy, the active one is chosen at runtime
+template<typename... Policies>
+class ControlPipeline {
+public:
+	ControlPipeline() : active(0) {};
+
+	// select the policy with the given index and reset it, out of range indices (AT_KEEP) keep the current one
+	void Select(int index) {
+		if (index < 0 || index >= (int)sizeof...(Policies)) return;
+		active = index;
+		Visit([](auto& policy) { policy.Initialize(); });
+	};
+
+	int Active() const { return active; };
+
+	void MasterCommandRevise(double* vel) {
+		Visit([=](auto& policy) { policy.MasterCommandRevise(vel); });
+	};
+
+	void MasterFeedbackRevise(double* vel, double* force) {
+		Visit([=](auto& policy) { policy.MasterFeedbackRevise(vel, force); });
+	};
+
+	void SlaveCommandRevise(double* vel, double* force) {
+		Visit([=](auto& policy) { policy.SlaveCommandRevise(vel, force); });
+	};
+
+	void SlaveFeedbackRevise(double* force) {
+		Visit([=](auto& policy) { policy.SlaveFeedbackRevise(force); });
+	};
+
+	// measured loop interval, passed to every policy so a switch does not start with a stale value
+	void SetSampleInterval(double dt) {
+		ForEach([=](auto& policy) { policy.SetSampleInterval(dt); });
+	};
+
+	template<int I>
+	typename std::tuple_element<I, std::tuple<Policies...> >::type& Get() { return std::get<I>(policies); };
+
+protected:
+	// calls f on the active policy, the call target is known at compile time for every index
+	template<typename F>
+	void Visit(F f) { VisitIndex(f, std::index_sequence_for<Policies...>()); };
+
+	// calls f on every policy
+	template<typename F>
+	void ForEach(F f) { ForEachIndex(f, std::index_sequence_for<Policies...>()); };
+
+private:
+	template<typename F, std::size_t... I>
+	void VisitIndex(F& f, std::index_sequence<I...>) {
+		int expand[] = { 0, ((int)I == active ? (f(std::get<I>(policies)), 0) : 0)... };
+		(void)expand;
+	};
+
+	template<typename F, std::size_t... I>
+	void ForEachIndex(F& f, std::index_sequence<I...>) {
+		int expand[] = { 0, (f(std::get<I>(policies)), 0)... };
+		(void)expand;
+	};
+
+	std::tuple<Policies...> policies;
+	int active;
+};
+
+
+/***************** TeleoperationController ********/
+// the pipeline used by the applications, policy order follows AlgorithmType
+template<int DoF>
+class TeleoperationController : public ControlPipeline<None_Policy<DoF>, TDPA_Policy<DoF>, ISS_Policy<DoF>, MMT_Algorithm, WAVE_Policy<DoF> > {
+public:
+	TDPA_Policy<DoF>& TDPA() { return this->template Get<AT_TDPA>(); };
+	ISS_Policy<DoF>& ISS() { return this->template Get<AT_ISS>(); };
+	MMT_Algorithm& MMT() { return this->template Get<AT_MMT>(); };
+	WAVE_Policy<DoF>& WAVE() { return this->template Get<AT_WAVE>(); };
+};
+
+
+/***************** MMTIdentificationService *******/
+// runs the MMT environment identification on its own thread, the haptic loop
+// only pushes contact samples and picks up the latest model, so its tick time
+// does not depend on the estimator
+class MMTIdentificationService {
+public:
+	struct ContactSample
+	{
+		chai3d::cVector3d PosGoal;
+		chai3d::cVector3d PosProxy;
+		chai3d::cVector3d force;
+		chai3d::cVector3d position;//object position
+		int axis;//axis of the friction force
+		bool contact;
+		double dt;//interval to the previous sample
+	};
+
+	// plain data so that it can be handed over through VersionedValue
+	struct Model
+	{
+		double position[3];//object position
+		double stiffness[3];
+		double mass;
+		double FrictionF;
+		double confidence[3];//stiffness, mass, friction
+	};
+
+	unsigned int Dropped = 0;	// samples lost because the ring was full (haptic thread)
+
+	MMTIdentificationService() : running(false), finished(true), resetRequested(false), lastVersion(0) {};
+	~MMTIdentificationService() { Stop(); };
+
+	void Start() {
+		if (running) return;
+		running = true;
+		finished = false;
+		thread.start(ThreadEntryPoint, chai3d::CTHREAD_PRIORITY_GRAPHICS, this);
+	};
+
+	void Stop() {
+		if (!running) return;
+		running = false;
+		while (!finished) { chai3d::cSleepMs(1); }
+	};
+
+	/*
+	haptic thread
+	*/
+	void Submit(chai3d::cVector3d PosGoal, chai3d::cVector3d PosProxy, chai3d::cVector3d force, int axis, chai3d::cVector3d position, bool contact, double dt) {
+		ContactSample sample = { PosGoal, PosProxy, force, position, axis, contact, dt };
+		if (!samples.Push(sample))
+			Dropped++;
+	};
+
+	// copies a newly published model into mmt, true if there was one
+	bool Fetch(MMT_Algorithm& mmt) {
+		Model m;
+		unsigned int version;
+		if (!model.TryRead(m, version) || version == lastVersion) return false;
+		lastVersion = version;
+		MMT_Algorithm::envPar par = mmt.SlavePar;
+		par.parPosition.set(m.position[0], m.position[1], m.position[2]);
+		par.parStiffness.set(m.stiffness[0], m.stiffness[1], m.stiffness[2]);
+		par.mass = m.mass;
+		par.FrictionF = m.FrictionF;
+		mmt.ApplyModel(par, m.confidence);
+		return true;
+	};
+
+	// restart the identification from scratch, e.g. when MMT gets selected
+	void Reset() { resetRequested = true; };
+
+	/*
+	identification thread
+	*/
+	// drains the ring into the estimator and publishes the result
+	void Process() {
+		if (resetRequested.exchange(false)) {
+			estimator.Initialize();
+			ContactSample sample;
+			while (samples.Pop(sample)) {};
+		}
+
+		ContactSample sample;
+		bool updated = false;
+		while (samples.Pop(sample)) {
+			estimator.Input(sample.PosGoal, sample.PosProxy, sample.force, sample.axis, sample.position, sample.contact, sample.dt);
+			updated = true;
+		}
+		if (!updated) return;
+
+		Model m;
+		for (int i = 0; i < 3; i++) {
+			m.position[i] = estimator.SlavePar.parPosition(i);
+			m.stiffness[i] = estimator.SlavePar.parStiffness(i);
+		}
+		m.mass = estimator.SlavePar.mass;
+		m.FrictionF = estimator.SlavePar.FrictionF;
+		m.confidence[0] = estimator.StiffnessConfidence;
+		m.confidence[1] = estimator.MassConfidence;
+		m.confidence[2] = estimator.FrictionConfidence;
+		model.Publish(m);
+	};
+
+	MMT_Algorithm& Estimator() { return estimator; };
+
+private:
+	static void ThreadEntryPoint(void* pThis) {
+		MMTIdentificationService* service = (MMTIdentificationService*)pThis;
+		while (service->running) {
+			service->Process();
+			chai3d::cSleepMs(1);
+		}
+		service->finished = true;
+	};
+
+	SPSCRing<ContactSample, 1024> samples;
+	VersionedValue<Model> model;
+	MMT_Algorithm estimator;	// owned by the identification thread
+	chai3d::cThread thread;
+	std::atomic<bool> running;
+	std::atomic<bool> finished;
+	std::atomic<bool> resetRequested;
+	unsigned int lastVersion;
+};
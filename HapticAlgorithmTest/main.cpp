@@ -0,0 +1,278 @@
+/************************ Haptic Control Library Test ***********************
+ *
+ * Description : checks every policy of hapticAlgorithm.h on fixed input
+ * sequences and measures the cost of one control tick through the
+ * TeleoperationController used by the applications.
+ *
+ * Usage : HapticAlgorithmTest [ticks]
+ *   ticks   number of ticks timed per policy, 0 skips the timing (default 1000000)
+ *
+ * Returns 0 if every check passes, 1 otherwise.
+ */
+
+#include <chrono>
+#include <cmath>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+
+#include "hapticAlgorithm.h"
+
+static int failures = 0;
+
+static void Check(bool condition, const char* name, double value) {
+	printf("  %-4s %-58s %g\n", condition ? "ok" : "FAIL", name, value);
+	if (!condition) failures++;
+}
+
+
+/***************** None_Policy ********************/
+// every hook leaves the signals untouched
+static void TestNone() {
+	printf("None\n");
+	None_Policy<3> policy;
+	double maxChange = 0;
+	for (int k = 0; k < 1000; k++) {
+		double vel[3] = { sin(0.01 * k), cos(0.02 * k), 0.5 };
+		double force[3] = { 2 * cos(0.01 * k), -1, sin(0.03 * k) };
+		double vel0[3], force0[3];
+		memcpy(vel0, vel, sizeof(vel));
+		memcpy(force0, force, sizeof(force));
+		policy.MasterCommandRevise(vel);
+		policy.MasterFeedbackRevise(vel, force);
+		policy.SlaveCommandRevise(vel, force);
+		policy.SlaveFeedbackRevise(force);
+		for (int i = 0; i < 3; i++) {
+			maxChange = fmax(maxChange, fabs(vel[i] - vel0[i]));
+			maxChange = fmax(maxChange, fabs(force[i] - force0[i]));
+		}
+	}
+	Check(maxChange == 0, "signals pass through unchanged", maxChange);
+}
+
+
+/***************** TDPA_Policy ********************/
+// an active environment (force in phase with the velocity) tries to push energy
+// into the port while nothing is received from the other side; the passivity
+// controller has to keep the energy actually delivered through the port at zero
+static void TestTDPA() {
+	printf("TDPA\n");
+	const double dt = 0.001;
+
+	for (int side = 0; side < 2; side++) {
+		TDPA_Policy<3> policy;
+		policy.SetSampleInterval(dt);
+		double delivered = 0, unrevised = 0, maxDelivered = 0;
+		for (int k = 0; k < 5000; k++) {
+			double vel[3], force[3];
+			for (int i = 0; i < 3; i++) {
+				vel[i] = 0.1 * sin(0.005 * k + i);
+				force[i] = 2 * vel[i];
+				unrevised += dt * vel[i] * force[i];
+			}
+			if (side == 0) policy.MasterFeedbackRevise(vel, force);
+			else policy.SlaveCommandRevise(vel, force);
+			for (int i = 0; i < 3; i++) {
+				delivered += dt * vel[i] * force[i];
+			}
+			maxDelivered = fmax(maxDelivered, delivered);
+		}
+		Check(unrevised > 1e-3, side == 0 ? "master: environment is active without TDPA" : "slave: environment is active without TDPA", unrevised);
+		Check(maxDelivered < 1e-6, side == 0 ? "master: delivered energy stays at zero" : "slave: delivered energy stays at zero", maxDelivered);
+	}
+
+	// a passive environment (damper) is left untouched
+	TDPA_Policy<3> policy;
+	policy.SetSampleInterval(dt);
+	double maxAlpha = 0;
+	for (int k = 0; k < 5000; k++) {
+		double vel[3], force[3];
+		for (int i = 0; i < 3; i++) {
+			vel[i] = 0.1 * sin(0.005 * k + i);
+			force[i] = -2 * vel[i];
+		}
+		policy.MasterFeedbackRevise(vel, force);
+		for (int i = 0; i < 3; i++) maxAlpha = fmax(maxAlpha, fabs(policy.alpha[i]));
+	}
+	Check(maxAlpha == 0, "passive environment is not damped", maxAlpha);
+}
+
+
+/***************** ISS_Policy *********************/
+// output against the closed form of the policy on a force ramp
+static void TestISS() {
+	printf("ISS\n");
+	const double dt = 0.002;
+	ISS_Policy<3> policy;
+	policy.SetSampleInterval(dt);
+	double maxError = 0;
+	for (int k = 1; k <= 100; k++) {
+		double vel[3] = { 0.1, 0, -0.1 };
+		double force[3] = { 0.01 * k, 1, -0.02 * k };
+		double slope[3] = { 0.01 / dt, k == 1 ? 1 / dt : 0, -0.02 / dt };
+		double expected[3];
+		for (int i = 0; i < 3; i++) expected[i] = force[i] + policy.tau * slope[i];
+		policy.MasterFeedbackRevise(vel, force);
+		for (int i = 0; i < 3; i++) maxError = fmax(maxError, fabs(force[i] - expected[i]));
+
+		double cmd[3] = { 0.1, 0, -0.1 };
+		policy.MasterCommandRevise(cmd);
+		for (int i = 0; i < 3; i++) {
+			double expectedCmd = vel[i] + slope[i] / (policy.mu_max * policy.mu_factor);
+			maxError = fmax(maxError, fabs(cmd[i] - expectedCmd));
+		}
+	}
+	Check(maxError < 1e-9, "force and command follow the force derivative", maxError);
+}
+
+
+/***************** WAVE_Policy ********************/
+// master and slave linked by a delayed, lossy wave channel. Each side can only
+// apply the wave energy that arrived, which is the passivity of the channel, and
+// a free space slave has to follow the master without drift
+static void TestWave() {
+	printf("WAVE\n");
+	const double dt = 0.001;
+	const int delay = 60;	// ticks
+	WAVE_Policy<1> master, slave;
+	master.SetSampleInterval(dt);
+	slave.SetSampleInterval(dt);
+
+	static double forward[delay][2], backward[delay][2];	// wave and its integral in flight
+	memset(forward, 0, sizeof(forward));
+	memset(backward, 0, sizeof(backward));
+
+	double sentForward = 0, appliedForward = 0, sentBackward = 0, appliedBackward = 0;
+	double xm = 0, xs = 0;
+	unsigned int lcg = 12345;
+	for (int k = 0; k < 20000; k++) {
+		// master follows a smooth motion for 15 s and then stops
+		double t = k * dt;
+		double vm = t < 15 ? 0.05 * sin(2 * t) + 0.03 * sin(5.3 * t) : 0;
+		xm += vm * dt;
+
+		// packets that arrive now, about a third of them is lost and the last one held
+		lcg = lcg * 1103515245 + 12345;
+		bool lost = ((lcg >> 16) % 3) == 0;
+		int slot = k % delay;
+		if (!lost) {
+			slave.vr.Receive(&forward[slot][0], &forward[slot][1]);
+			master.vl.Receive(&backward[slot][0], &backward[slot][1]);
+		}
+		slave.vr.UpdateDelay(delay * dt);
+		master.vl.UpdateDelay(delay * dt);
+
+		// master tick
+		double vel = vm, force = 0;
+		master.MasterCommandRevise(&vel);
+		master.MasterFeedbackRevise(&vel, &force);
+		forward[slot][0] = master.ul[0];
+		forward[slot][1] = master.Ul[0];
+		sentForward += 0.5 * dt * master.ul[0] * master.ul[0];
+		appliedBackward += 0.5 * dt * master.vl.applied[0] * master.vl.applied[0];
+
+		// slave tick, free space
+		double vs = 0, fs = 0;
+		slave.SlaveCommandRevise(&vs, &fs);
+		slave.SlaveFeedbackRevise(&fs);
+		xs += vs * dt;
+		backward[slot][0] = slave.ur[0];
+		backward[slot][1] = slave.Ur[0];
+		sentBackward += 0.5 * dt * slave.ur[0] * slave.ur[0];
+		appliedForward += 0.5 * dt * slave.vr.applied[0] * slave.vr.applied[0];
+	}
+	Check(appliedForward <= sentForward, "forward wave energy applied <= sent", appliedForward - sentForward);
+	Check(appliedBackward <= sentBackward, "backward wave energy applied <= sent", appliedBackward - sentBackward);
+	Check(fabs(xm - xs) < 0.001, "slave position drift after the motion (m)", fabs(xm - xs));
+}
+
+
+/***************** MMT_Algorithm ******************/
+// a box of known mass and friction pushed along y, identified from its motion
+static void TestMMT() {
+	printf("MMT\n");
+	for (int rate = 0; rate < 2; rate++) {
+		double dt = rate == 0 ? 0.001 : 0.002;
+		MMT_Algorithm mmt;
+		for (int k = 0; k < 3000; k++) {
+			double t = k * dt;
+			double a = 2.0 + 1.5 * sin(5 * t);
+			double y = t * t + 1.5 * (t / 5 - sin(5 * t) / 25);
+			chai3d::cVector3d position(0, y, 0);
+			chai3d::cVector3d force(0, 0.5 * a - 0.3, 0);
+			mmt.Input(chai3d::cVector3d(0, 0, 0), chai3d::cVector3d(0, 0, 0.001), force, 1, position, true, dt);
+		}
+		Check(fabs(mmt.SlavePar.mass - 0.5) < 0.01, rate == 0 ? "1 kHz: mass estimate (0.5 kg)" : "500 Hz: mass estimate (0.5 kg)", mmt.SlavePar.mass);
+		Check(fabs(mmt.SlavePar.FrictionF - 0.3) < 0.01, rate == 0 ? "1 kHz: friction estimate (0.3 N)" : "500 Hz: friction estimate (0.3 N)", mmt.SlavePar.FrictionF);
+	}
+}
+
+
+/***************** ControlPipeline ****************/
+// only the selected policy sees the signals, a selection resets it
+static void TestPipeline() {
+	printf("ControlPipeline\n");
+	TeleoperationController<3> controller;
+	controller.SetSampleInterval(0.002);
+	Check(controller.TDPA().sample_interval == 0.002 && controller.ISS().sample_interval == 0.002 &&
+		controller.WAVE().sample_interval == 0.002, "sample interval reaches every policy", 0.002);
+
+	Check(controller.Active() == AT_None, "None is active at start", controller.Active());
+	double vel[3] = { 0.1, 0.1, 0.1 }, force[3] = { 0.2, 0.2, 0.2 };
+	controller.MasterFeedbackRevise(vel, force);
+	Check(controller.TDPA().E_out[0] == 0 && controller.ISS().last_force[0] == 0, "inactive policies keep their state", 0);
+
+	controller.Select(AT_ISS);
+	controller.MasterFeedbackRevise(vel, force);
+	Check(controller.Active() == AT_ISS && controller.ISS().last_force[0] == 0.2, "selected policy receives the signals", controller.ISS().last_force[0]);
+
+	controller.Select(AT_KEEP);
+	Check(controller.Active() == AT_ISS, "AT_KEEP keeps the active policy", controller.Active());
+
+	controller.Select(AT_ISS);
+	Check(controller.ISS().last_force[0] == 0, "selection resets the policy", controller.ISS().last_force[0]);
+}
+
+
+/***************** tick cost **********************/
+// one master and one slave revision per tick, as in the applications
+static void Bench(int ticks) {
+	if (ticks <= 0) return;
+	printf("tick cost (%d ticks)\n", ticks);
+	const char* names[] = { "None", "TDPA", "ISS", "MMT", "WAVE" };
+	TeleoperationController<3> controller;
+	controller.SetSampleInterval(0.001);
+	double sink = 0;
+	for (int p = AT_None; p <= AT_WAVE; p++) {
+		controller.Select(p);
+		auto start = std::chrono::steady_clock::now();
+		for (int k = 0; k < ticks; k++) {
+			double vel[3] = { 0.01 * sin(0.001 * k), 0.02, -0.01 };
+			double force[3] = { 0.5, -0.2 * cos(0.002 * k), 0.1 };
+			controller.MasterCommandRevise(vel);
+			controller.MasterFeedbackRevise(vel, force);
+			controller.SlaveCommandRevise(vel, force);
+			controller.SlaveFeedbackRevise(force);
+			sink += vel[0] + force[1];
+		}
+		double seconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+		printf("  %-6s %8.1f ns/tick\n", names[p], 1e9 * seconds / ticks);
+	}
+	if (sink == 42) printf("\n");	// keeps the loops from being optimized away
+}
+
+
+int main(int argc, char* argv[]) {
+	int ticks = argc > 1 ? atoi(argv[1]) : 1000000;
+
+	TestNone();
+	TestTDPA();
+	TestISS();
+	TestWave();
+	TestMMT();
+	TestPipeline();
+	Bench(ticks);
+
+	printf(failures == 0 ? "all checks passed\n" : "%d check(s) FAILED\n", failures);
+	return failures == 0 ? 0 : 1;
+}
@@ -55,6 +55,7 @@
  * Version 20 February 2017
  */
 
+#pragma once
 
 #include <stdio.h>
 #include <stdlib.h>
@@ -62,6 +63,11 @@
 #include <math.h>
 #include <list>
 #include <queue>
+#include <string>
+#include <vector>
+
+#include "math/CMatrix3d.h"
+#include "math/CQuaternion.h"
 
 
 // structure holding a haptic sample including its timestamp
@@ -120,3 +126,127 @@ private:
 	double ProcNoiseVar[3]; // Q
 
 };
+
+
+// smallest-three quaternion compression: 2 bits for the index of the dropped (largest) component,
+// 20 bits for each of the three remaining components, packed into 64 bits instead of a 3x3 matrix
+unsigned long long CompressQuaternion(const chai3d::cQuaternion& q);
+chai3d::cQuaternion DecompressQuaternion(unsigned long long code);
+
+// Perceptual orientation data reduction class
+
+class OrientationDeadbandDataReduction{
+
+public:
+	  OrientationDeadbandDataReduction(double db); // initializes a deadband class for a 3 DoF orientation signal, db in degrees
+     ~OrientationDeadbandDataReduction(); // kills the deadband class
+
+
+	 double DeadbandParameter; // variable holding the geodesic angle threshold in radians
+
+	 void GetCurrentSample(const chai3d::cMatrix3d& Sample); // copies a new rotation sample for deadband computation
+	 void ApplyZOHDeadband(unsigned long long* updatedSample,bool* TransmitFlag); // performs the deadband data reduction, outputs the compressed sample to transmit
+
+
+private:
+
+	chai3d::cQuaternion CurrentSample; // variable holding the current orientation sample
+	chai3d::cQuaternion PreviousSample; // variable holding the previosly transmitted orientation sample
+	unsigned long long PreviousCode; // compressed form of the previously transmitted sample
+	double GeodesicAngle;
+
+
+};
+
+// Receiver side orientation reconstruction class
+
+class OrientationReconstruction{
+
+public:
+	OrientationReconstruction(int length); // initializes the reconstruction with a SLERP window of length samples
+	~OrientationReconstruction();
+
+	int SlerpLength; // number of samples used to blend towards a newly received orientation
+
+	void GetReceivedSample(unsigned long long code); // copies the recently received compressed orientation
+	void ApplySlerpReconstruction(chai3d::cMatrix3d& updatedSample); // outputs the reconstructed orientation
+
+private:
+
+	chai3d::cQuaternion StartSample; // orientation displayed when the last update was received
+	chai3d::cQuaternion TargetSample; // recently received orientation
+	chai3d::cQuaternion CurrentEstimation; // currently displayed orientation
+	unsigned long long LastCode;
+	int SlerpIndex;
+	bool Initialized;
+
+};
+
+// software video source replacing the rendered slave view in headless mode: moving colour bars
+// with the frame counter stored in the first pixel, so the receiver can detect lost or torn frames
+void FillVideoTestPattern(unsigned char* rgba, int width, int height, unsigned int frame);
+unsigned int ReadVideoTestPatternFrame(const unsigned char* rgba);
+
+// CPU time in seconds consumed by all threads of this process since it started
+double GetProcessCPUSeconds();
+
+// header at the start of a session file, followed by one block of Capacity doubles per column
+struct SessionFileHeader{
+	char Magic[8]; // "HAPTREC"
+	unsigned int Version;
+	unsigned int Columns;
+	unsigned long long Capacity; // rows allocated in the file
+	volatile unsigned long long Rows; // rows recorded so far
+	char Names[64][32]; // column names
+};
+
+// per-tick signals of a haptic loop recorded into a preallocated, memory-mapped columnar file.
+// Open() sizes, maps and prefaults the file; Set() and Commit() only write mapped memory, so the
+// haptic thread records without formatting, locks or system calls. Rows beyond the capacity are dropped.
+class SessionRecorder{
+
+public:
+
+	  SessionRecorder();
+     ~SessionRecorder();
+
+	bool Open(const char* fileName, const char* const* names, int columns, unsigned long long capacity); // creates the file
+	void Close(); // unmaps the file, the recorded rows stay readable
+	bool IsOpen() const { return Data != NULL; }
+
+	void Set(int column, double value) { Row[column] = value; } // sets a column of the current row
+	void Set(int column, const double* values, int count) { for (int i = 0; i < count; i++) Row[column + i] = values[i]; }
+	void Commit(); // stores the current row in the file
+
+	unsigned long long GetRows() const { return Header ? Header->Rows : 0; }
+	unsigned long long GetDropped() const { return Dropped; }
+
+	static bool Convert(const char* sessionName, const char* outputName); // converts to CSV, or to NumPy when the output ends with .npy
+
+private:
+
+	SessionFileHeader* Header;
+	double* Data; // column c of row r at Data[c * Capacity + r]
+	double Row[64];
+	unsigned long long Dropped;
+	size_t MappedSize;
+	void* FileHandle;
+	void* MappingHandle;
+
+};
+
+// one row of benchmark results, appended to a CSV file so that runs can be compared commit to commit
+class BenchmarkReport{
+
+public:
+
+	void Add(const std::string& name, double value); // adds a column holding a number
+	void Add(const std::string& name, const std::string& value); // adds a column holding a text
+	bool Append(const std::string& fileName) const; // appends the row, the header is written first if the file is empty
+
+private:
+
+	std::vector<std::string> Names;
+	std::vector<std::string> Values;
+
+};
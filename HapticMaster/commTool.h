@@ -12,10 +12,11 @@
 #include <queue>
 #include <mutex>
 #include <memory>
+#include <atomic>
 #include <condition_variable>
 #include <gsl/gsl_randist.h>
 #include <gsl/gsl_rng.h>
-enum AlgorithmType { AT_None, AT_TDPA, AT_ISS, AT_MMT, AT_WAVE, AT_KEEP };
+#include "hapticAlgorithm.h"
 
 struct hapticMessageM2S {
 	__int64 timestamp;
@@ -23,8 +24,8 @@ struct hapticMessageM2S {
 	// position, cVector3d contains 3 double values
 	double position[3];
 
-	// orientation, cMatrix3d contains 3 double values
-	double rotation[9];
+	// orientation, smallest-three compressed quaternion (see CompressQuaternion in HapticCommLib)
+	unsigned __int64 rotation;
 
 	// gripper position
 	double gripperAngle;
@@ -44,6 +45,8 @@ struct hapticMessageM2S {
 
 	double waveVariable[3];
 
+	double waveIntegral[3];// integral of the sent wave variable, used for drift correction
+
 	// user-switch status (button 0)
 	int button0, button1, button2, button3;
 
@@ -58,9 +61,20 @@ struct hapticMessageS2M {
 	double gripperForce;
 	double energy[3];
 	double waveVariable[3];
+	double waveIntegral[3];// integral of the sent wave variable, used for drift correction
 	double MMTParameters[9];
+	__int64 echoTimestamp;// timestamp of the command the force was computed for, gives the round-trip time
+	double position[3];// slave tool position, gives the position tracking error
 };
 
+// size of the RGBA video test pattern sent from the slave to the master in headless mode
+const int VideoWidth = 864;
+const int VideoHeight = 270;
+
+// messages the emulated packet loss of the Sender never drops: algorithm switches are sent only once
+inline bool IsReliableMessage(const hapticMessageM2S& msg) { return msg.ATypeChange != AlgorithmType::AT_KEEP; }
+inline bool IsReliableMessage(const hapticMessageS2M&) { return false; }
+
 template<typename T>
 class threadsafe_queue
 {
@@ -193,35 +207,54 @@ public:
 		const gsl_rng_type * T = gsl_rng_default;
 		r = gsl_rng_alloc (T);
 		gsl_rng_set(r, time(NULL));
+		LARGE_INTEGER frequency;
+		QueryPerformanceFrequency(&frequency);
+		ticksPerMs = frequency.QuadPart / 1000.0;
 	};
 	threadsafe_queue<T> *Q;
 	__int64 lastTime;
 	gsl_rng *r;
-	double gamma_alpha = 20, gamma_beta = 1;
+	double gamma_alpha = 20, gamma_beta = 1; // delay in ms of the dynamic delay model, mean gamma_alpha * gamma_beta
 	bool dynamicDelay = false;
+	double constantDelay = 20; // delay in ms when dynamicDelay is off
+	double lossRate = 0; // probability that a message is dropped instead of sent
+	std::atomic<unsigned int> sentCount{ 0 }; // messages sent since the start
+	std::atomic<unsigned int> droppedCount{ 0 }; // messages dropped by the emulated packet loss
 private:
+	double ticksPerMs;
+	double messageDelay = -1; // delay drawn for the message at the front of the queue, -1: not drawn yet
 	void ThreadEntryPoint() {
 		printf("Sender Thread\n");
 		while (true) {
 			__int64 currentTime;
 			QueryPerformanceCounter((LARGE_INTEGER *)&currentTime);
-			if (currentTime - lastTime < 1805)
+			if (currentTime - lastTime < 0.5 * ticksPerMs)
 				continue;
 			lastTime = currentTime;
 			
 			if (Q->empty())
 				continue;
 			
+			// each message is delayed by one draw of the delay model
+			if (messageDelay < 0)
+				messageDelay = dynamicDelay ? gsl_ran_gamma(r, gamma_alpha, gamma_beta) : constantDelay;
+
 			QueryPerformanceCounter((LARGE_INTEGER *)&currentTime);
-			if (currentTime - Q->front().timestamp < 3609 * (dynamicDelay ? (int)gsl_ran_gamma(r, gamma_alpha, gamma_beta): 20))
+			if (currentTime - Q->front().timestamp < messageDelay * ticksPerMs)
 				continue;
 
 			T temp;
 			if (Q->try_pop(temp)) {
+				messageDelay = -1;
+				if (lossRate > 0 && !IsReliableMessage(temp) && gsl_rng_uniform(r) < lossRate) {
+					droppedCount++;
+					continue;
+				}
 				//std::cout << "Sender helloworld" << sizeof(hapticMessageM2S) << std::endl;
 
 
 				send(s, (char *)&temp, sizeof(T), 0);
+				sentCount++;
 			}
 			//std::this_thread::sleep_for(std::chrono::microseconds(500));
 		}
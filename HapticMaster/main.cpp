@@ -49,6 +49,7 @@ POSSIBILITY OF SUCH DAMAGE.
 //------------------------------------------------------------------------------
 #include <GLFW/glfw3.h>
 #include <iomanip>
+#include <fstream>
 #include <Eigen/Core>
 #include <Eigen/Dense>  
 //------------------------------------------------------------------------------
@@ -64,6 +65,15 @@ using namespace Eigen;
 ConfigFile cfg("cfg/config.cfg"); // get the configuration file
 double VelocityDeadbandParameter = cfg.getValueOfKey<double>("VelocityDeadbandParameter"); //deadband parameter for velcity data reduction, 0.1 is the default value
 double PositionDeadbandParameter = cfg.getValueOfKey<double>("PositionDeadbandParameter"); //deadband parameter for position data reduction, 0.1 is the default value
+double OrientationDeadbandParameter = cfg.getValueOfKey<double>("OrientationDeadbandParameter"); //deadband angle in degrees for orientation data reduction
+double WaveCorrectionTime = cfg.getValueOfKey<double>("WaveCorrectionTime", 0.02); // time constant of the wave integral drift correction
+double WavePredictionGain = cfg.getValueOfKey<double>("WavePredictionGain", 0.0); // gain of the wave prediction over the estimated delay
+double WaveReserveLimit = cfg.getValueOfKey<double>("WaveReserveLimit", 0.01); // upper bound of the stored wave energy per axis
+double HapticRate = cfg.getValueOfKey<double>("HapticRate", 1000.0); // rate of the haptic loop in Hz
+int HapticCPU = cfg.getValueOfKey<int>("HapticCPU", -1); // CPU the haptic thread is bound to, -1: no binding
+double HapticSpinWindow = cfg.getValueOfKey<double>("HapticSpinWindow", 0.0002); // time spent spinning before each haptic tick deadline
+int MultirateRendering = cfg.getValueOfKey<int>("MultirateRendering", 0); // 0: device driven by the haptic loop, 1: device driven by a servo loop rendering local contacts
+double ServoRate = cfg.getValueOfKey<double>("ServoRate", 4000.0); // rate of the servo loop in Hz when MultirateRendering is enabled
 
 int FlagVelocityKalmanFilter = cfg.getValueOfKey<int>("FlagVelocityKalmanFilter"); // 0: Kalman filter disabled 1: Kalman filter enabled on velocity signal
 KalmanFilter VelocityKalmanFilter; // applies 3 DoF kalman filtering to remove noise from velocity signal																				   
@@ -72,13 +82,16 @@ KalmanFilter ForceKalmanFilter; // applies 3 DoF kalman filtering to remove nois
 
 DeadbandDataReduction* DBVelocity; // data reduction class for velocity samples
 DeadbandDataReduction* DBPosition; // data reduction class for position samples
+OrientationDeadbandDataReduction* DBOrientation; // data reduction class for orientation samples
 
 bool VelocityTransmitFlag = false; // true: deadband triger false: keep last recently transmitted sample (ZoH)
 bool PositionTransmitFlag = false; // true: deadband triger false: keep last recently transmitted sample (ZoH)
+bool OrientationTransmitFlag = false; // true: deadband triger false: keep last recently transmitted sample (ZoH)
 
 double MasterForce[3] = { 0.0, 0.0, 0.0 };
 double MasterVelocity[3] = { 0.0, 0.0, 0.0 }; // update 3 DoF master velocity sample (holds the signal before deadband)
 double MasterPosition[3] = { 0.0, 0.0, 0.0 }; // update 3 DoF master position sample (holds the signal before deadband)
+unsigned long long MasterOrientation = 0; // compressed master orientation sample (holds the signal after deadband)
 
 double MasterTorque[3] = { 0.0, 0.0, 0.0 };
 double MasterGripperForce = 0.0;
@@ -87,333 +100,89 @@ AlgorithmType ATypeChange = AlgorithmType::AT_None;
 Sender<hapticMessageM2S> *sender;
 threadsafe_queue<hapticMessageM2S> forwardQ;
 
-class MMT_ALGORITHM {
-public:
-	bool enable = false;
-	/*
-	enviroment variable:
-	1. box position;
-	3. K used to calculate the force
-	*/
-	static struct envPar
-	{
-		cVector3d parPosition;
-		cVector3d parStiffness;
-		double mass;//mass of cube
-		double FrictionF;//friction force of cube
-		bool Flag;//whether this parameters is used to update the master's enviroment
-	};
-	envPar MasterPar = { cVector3d(0, 0, 0) ,cVector3d(0, 0, 0),1,0 ,false };
-	envPar SlavePar = { cVector3d(0, 0, 0) ,cVector3d(0, 0, 0),1,0 ,true };
-	cVector3d oldStiffness = cVector3d(0, 0, 0);
-	cVector3d oldPosition = cVector3d(0, 0, 0);
-	double SlaveOldVelocity = 0;
-	double MasterOldVelocity = 0;
-	int MasterMoveDirection=0;
-	int length = 100;
-	int index1 = 0;
-	bool full1 = false;
-	int index2 = 0;
-	bool full2 = false;
-	cVector3d parStiffness[100];//store parameter K used to calculate the average K value.
-	MatrixXf acc = MatrixXf::Ones(100, 2);
-	MatrixXf frictionforce = MatrixXf::Zero(100, 1);
-	MatrixXf x_jacobiSvd;
-
-	/*
-	dead band parameter
-	*/
-	double db = 0.1;
-
-	void ForceRevise(double* force, cVector3d goalPos, cVector3d proxyPos) {
-		if (!enable)return;
-		cVector3d Temp = MasterPar.parStiffness;
-		Temp.mulElement(proxyPos - goalPos);
-		force[0] = Temp(0);
-		force[1] = Temp(1);
-		force[2] = Temp(2);
-	}
-
-	void Initialize() {
-		MasterPar = { cVector3d(0, 0, 0) ,cVector3d(0, 0, 0),0,0 ,false };
-		SlavePar = { cVector3d(0, 0, 0) ,cVector3d(0, 0, 0),0,0 ,true };
-		index1 = index2 = 0;
-		oldStiffness = cVector3d(0, 0, 0);
-		for (int i = 0; i < 100; i++) {
-			parStiffness[i] = cVector3d(0, 0, 0);
-		}
-	}
-
-	void Input(cVector3d PosGoal, cVector3d PosProxy, cVector3d force, int axis, cVector3d position, bool contact) {
-		SlavePar.parPosition = position;
-		for (int i = 0; i < 3; i++) {
-			double deltaX = PosGoal(i) - PosProxy(i);
-			if (deltaX) {
-				oldStiffness(i) = abs(force(i) / deltaX);
-			}
-		}
-
-		if (index1 < 100) {
-			parStiffness[index1] = oldStiffness;
-			index1 += 1;
-		}
-		else {
-			parStiffness[index1 % 100] = oldStiffness;
-			index1 = index1 % 100;
-			full1 = true;
-		}
-
-		cVector3d avg;
-		for (int i = 0; i < 100; i++) {
-			avg += parStiffness[i];
-		}
-		avg /= 100;
-		SlavePar.parStiffness = avg;
-
-
-		double v = sqrt(pow((position(0) - oldPosition(0)), 2) + pow((position(1) - oldPosition(1)), 2) + pow((position(2) - oldPosition(2)), 2)) / 0.001;
-		if (!(v>0.1) || !contact)return;
-		std::cout << v << " " << contact << MMT.MasterPar.mass << "solution" << MMT.MasterPar.FrictionF << std::endl;
-		oldPosition = position;
-		double a = (v - SlaveOldVelocity) / 0.001;
-		SlaveOldVelocity = v;
-		if (index2 < 100) {
-			acc(index2, 0) = a;
-			frictionforce(index2, 0) = abs(force(axis));
-			index2 += 1;
-		}
-		else {
-			parStiffness[index2 % 100] = oldStiffness;
-			acc(index2 % 100, 0) = a;
-			frictionforce(index2 % 100, 0) = abs(force(axis));
-			index2 = index2 % 100;
-			full2 = true;
-		}
+TeleoperationController<3> Controller; // TDPA, ISS, MMT and WAVE control algorithms, one of them is active
 
+int RecordSignals = cfg.getValueOfKey<int>("RecordSignals", 0); // 0: Turn off recording, 1: Turn on recording
+SPSCRing<TDPA_Policy<3>::Telemetry, 1024> TDPATelemetry; // TDPA observer samples from the haptic thread
+std::ofstream TDPATelemetryFile; // written by the graphics thread
 
-		x_jacobiSvd = acc.jacobiSvd(ComputeThinU | ComputeThinV).solve(frictionforce);
-
-		SlavePar.mass = x_jacobiSvd(0, 0);
-		SlavePar.FrictionF = x_jacobiSvd(1, 0);
-	}
-
-	bool isTransmit() {
-		if (!full1 || (!full1 && !full2))return false;
-		for (int i = 0; i < 3; i++) {
-			// The threshold of  change rate is 10 percentage
-			if (abs(MasterPar.parStiffness(i) - SlavePar.parStiffness(i)) / SlavePar.parStiffness(i) > db)
-				return true;
-			// The threshold of  position offset is 0.1 meters
-			if (abs(MasterPar.parPosition(i) - SlavePar.parPosition(i))> 0.5)
-				return true;
-		}
-		if (abs(MasterPar.mass - SlavePar.mass) / SlavePar.mass > db)
-			return true;
+//
+//------------------------------------------------------------------------------
+// GENERAL SETTINGS
+//------------------------------------------------------------------------------
 
-		if (abs(MasterPar.FrictionF - SlavePar.FrictionF) / SlavePar.FrictionF > db)
-			return true;
-		return false;
-	}
+// stereo Mode
+/*
+C_STEREO_DISABLED:            Stereo is disabled
+C_STEREO_ACTIVE:              Active stereo for OpenGL NVDIA QUADRO cards
+C_STEREO_PASSIVE_LEFT_RIGHT:  Passive stereo where L/R images are rendered next to each other
+C_STEREO_PASSIVE_TOP_BOTTOM:  Passive stereo where L/R images are rendered above each other
+*/
+cStereoMode stereoMode = C_STEREO_DISABLED;
 
+// fullscreen mode
+bool fullscreen = false;
 
-}MMT;
+// mirrored display
+bool mirroredDisplay = false;
 
+// headless mode: no window or OpenGL context, statistics are printed instead (also set by --headless)
+bool headless = cfg.getValueOfKey<int>("Headless", 0) != 0;
 
-class WAVE_ALGORITHM {
-public:
-	// b=1.2 for Touch
-	double b = 8;	//damping factor
-	bool waveOn = false;
-	double scaleFactor = 1;
-	KalmanFilter *KF = new KalmanFilter();
-	// WAVE algorithm variables
-	struct WaveV
-	{
+// time in seconds between two statistics lines in headless mode
+double HeadlessStatsPeriod = cfg.getValueOfKey<double>("HeadlessStatsPeriod", 1.0);
 
-		cVector3d ul;	//sent signal OP
-		cVector3d vl;	//received signal OP
-		cVector3d ur;	//sent signal TOP
-		cVector3d vr;	//received signal OP
-		cVector3d F;	//force at OP
-	};
-
-	WaveV WV = { cVector3d(0,0,0),cVector3d(0,0,0), cVector3d(0,0,0), cVector3d(0,0,0), cVector3d(0,0,0) };
-
-	void VelocityRevise(double* vel, WaveV* wave, double* force) {
-		if (waveOn) {
-			cVector3d temp = getVel_r(b, wave, cVector3d(force[0], force[1], force[2]));
-			vel[0] = temp.x() * scaleFactor;
-			vel[1] = temp.y() * scaleFactor;
-			vel[2] = temp.z() * scaleFactor;
-		}
-	}
+// run time in seconds in headless mode, 0: until the process is stopped
+double HeadlessDuration = cfg.getValueOfKey<double>("HeadlessDuration", 0.0);
 
-	void ForceRevise(double* vel, WaveV* wave, double* force) {
-		if (waveOn) {
-			cVector3d temp = getForce_l(b, wave, cVector3d(vel[0], vel[1], vel[2]) / scaleFactor);
-			force[0] = -1 * temp.x();
-			force[1] = -1 * temp.y();
-			force[2] = -1 * temp.z();
-		}
-	}
+// 1: the slave sends a software test pattern in headless mode, whose frame counters are checked here
+int VideoTestPattern = cfg.getValueOfKey<int>("VideoTestPattern", 1);
 
-	void getWave_l(double b, WaveV* wave, cVector3d vel)
-	{
-		if (waveOn) {
-			wave->ul = sqrt(2 * b)*vel / scaleFactor + wave->vl;
-			double ttemp[3] = { WV.ul.x(),WV.ul.y(),WV.ul.z() };
-			KF->ApplyKalmanFilter(ttemp);
-			WV.ul.x(KF->CurrentEstimation[0]);
-			WV.ul.y(KF->CurrentEstimation[1]);
-			WV.ul.z(KF->CurrentEstimation[2]);
-		}
-	}
+// 1: a virtual device replaying a trace or a motion profile replaces the haptic device
+int VirtualDevice = cfg.getValueOfKey<int>("VirtualDevice", 0);
 
-	void getWave_r(double b, WaveV* wave, cVector3d f)
-	{
-		wave->ur = (sqrt(2 / b)*f - wave->vr);
-	}
+// trace replayed by the virtual device, none: the motion profile is synthesized
+std::string VirtualDeviceTrace = cfg.getValueOfKey<std::string>("VirtualDeviceTrace", "none");
 
-	cVector3d getVel_r(double b, WaveV* wave, cVector3d f)
-	{
-		return -1 / b*(f - sqrt(2 * b)*wave->vr);
-	}
+// motion profile of the virtual device, 0: static, 1: sine, 2: circle, 3: square
+int VirtualDeviceMotion = cfg.getValueOfKey<int>("VirtualDeviceMotion", 1);
 
-	cVector3d getForce_l(double b, WaveV* wave, cVector3d vel)
-	{
-		return 1 * b*vel / scaleFactor + sqrt(2 * b)*wave->vl;
-	}
+// amplitude in meters and frequency in Hz of the motion profile
+double VirtualDeviceAmplitude = cfg.getValueOfKey<double>("VirtualDeviceAmplitude", 0.02);
+double VirtualDeviceFrequency = cfg.getValueOfKey<double>("VirtualDeviceFrequency", 0.5);
 
-	void Initialize() {
-		WV = { cVector3d(0,0,0),cVector3d(0,0,0), cVector3d(0,0,0), cVector3d(0,0,0), cVector3d(0,0,0) };
-		delete KF;
-		KF = new KalmanFilter();
-	}
-}WAVE;
-
-class TDPA_Algorithm {
-public:
-	double sample_interval = 0.001;   //1kHz
-	double E_in[3] = { 0,0,0 }, E_out[3] = { 0,0,0 };
-	double E_in_last[3] = { 0,0,0 };
-	double E_trans[3] = { 0,0,0 }, E_recv[3] = { 0,0,0 };
-	double alpha[3] = { 0,0,0 }, beta[3] = { 0,0,0 };
-	bool TDPAon = false;
-	void ComputeEnergy(double vel[3], double force[3])
-	{
-		for (int i = 0; i < 3; i++) {
-			// only for z direction
-			double power = vel[i] * (-1 * force[i]);
-			if (power >= 0) {
-				E_in[i] = E_in[i] + sample_interval*power;
-			}
-			else {
-				E_out[i] = E_out[i] - sample_interval*power;
-			}
-		}
+// time step of the virtual device per haptic tick in seconds, 0: the trace is replayed in real time
+double VirtualDeviceTimeStep = cfg.getValueOfKey<double>("VirtualDeviceTimeStep", 0.0);
 
-	};
-	// only used by master
-	void ForceRevise(double* Vel, double* force) {
-		ComputeEnergy(Vel, force);
-		for (int i = 0; i < 3; i++) {
-			if (E_out[i] > E_recv[i] && abs(Vel[i]) > 0.001)
-			{
-				alpha[i] = (E_out[i] - E_recv[i]) / (sample_interval*Vel[i] * Vel[i]);
-				E_out[i] = E_recv[i];
-			}
-			else
-				alpha[i] = 0;
+// file receiving the forces sent to the virtual device, none: forces are not recorded
+std::string VirtualDeviceForceLog = cfg.getValueOfKey<std::string>("VirtualDeviceForceLog", "none");
 
-			// 3. revise force and apply the revised force
-			if (TDPAon)
-				force[i] = force[i] - alpha[i] * Vel[i];
-		}
-	};
-	// only used by slavor
-	void VelocityRevise(double* Vel, double* force) {
-		ComputeEnergy(Vel, force);
-		for (int i = 0; i < 3; i++) {
-			if (E_out[i] > E_recv[i] && abs(force[i]) > 0.001)
-			{
-				beta[i] = (E_out[i] - E_recv[i]) / (sample_interval*force[i] * force[i]);
-				E_out[i] = E_recv[i];
-			}
-			else
-				beta[i] = 0;
+// file receiving the trajectory of the haptic device, none: the trajectory is not recorded
+std::string DeviceTraceRecord = cfg.getValueOfKey<std::string>("DeviceTraceRecord", "none");
 
-			// 3. revise slave vel 
-			if (TDPAon)
-				Vel[i] = Vel[i] - beta[i] * force[i];
-		}
-	};
+// length in seconds of the trajectory allocated at start, later samples are dropped
+double DeviceTraceRecordDuration = cfg.getValueOfKey<double>("DeviceTraceRecordDuration", 600.0);
 
-	void Initialize()
-	{
-		memset(E_in, 0, 3 * sizeof(double));
-		memset(E_out, 0, 3 * sizeof(double));
-		memset(E_in_last, 0, 3 * sizeof(double));
-		memset(E_trans, 0, 3 * sizeof(double));
-		memset(E_recv, 0, 3 * sizeof(double));
-		memset(alpha, 0, 3 * sizeof(double));
-		memset(beta, 0, 3 * sizeof(double));
-	};
-}TDPA;
-
-class ISS_Algorithm {
-public:
-	double mu_max = 10;
-	float stiff_factor = 0.5;
-	double d_force[3] = { 0,0,0 };
-	double tau = 0.005;
-	bool ISS_enabled = false;
-	double last_force[3] = { 0,0,0 };
-	float mu_factor = 1.0;
-
-	void VelocityRevise(double* vel) {
-		if (ISS_enabled) {
-			for (int i = 0; i < 3; i++) {
-				vel[i] = vel[i] + d_force[i] / (mu_max*mu_factor);
-			}
+// delay in ms added to the commands by the sender, mean of the gamma distribution when DynamicDelay is enabled
+double CommandDelay = cfg.getValueOfKey<double>("CommandDelay", 20.0);
 
-		}
-	};
-
-	void ForceRevise(double* force) {
-		if (ISS_enabled) {
-			for (int i = 0; i < 3; i++) {
-				d_force[i] = (force[i] - last_force[i]) / 0.001;  // get derivation of force respect to time 
-				last_force[i] = force[i];
-				force[i] = force[i] + d_force[i] * tau;  // use "+" because MasterForce direction is opposite to f_e in the paper
-			}
-		}
-	};
+// 0: constant delay, 1: gamma distributed delay (also toggled with D)
+int DynamicDelay = cfg.getValueOfKey<int>("DynamicDelay", 0);
 
-	void Initialize()
-	{
-		memset(last_force, 0, 3 * sizeof(double));
-	};
-}ISS;
+// probability that a command is dropped by the sender
+double PacketLossRate = cfg.getValueOfKey<double>("PacketLossRate", 0.0);
 
-//
-//------------------------------------------------------------------------------
-// GENERAL SETTINGS
-//------------------------------------------------------------------------------
+// control algorithm active from the start, 0: none, 1: TDPA, 2: ISS, 3: MMT, 4: WAVE
+int Algorithm = cfg.getValueOfKey<int>("Algorithm", 0);
 
-// stereo Mode
-/*
-C_STEREO_DISABLED:            Stereo is disabled
-C_STEREO_ACTIVE:              Active stereo for OpenGL NVDIA QUADRO cards
-C_STEREO_PASSIVE_LEFT_RIGHT:  Passive stereo where L/R images are rendered next to each other
-C_STEREO_PASSIVE_TOP_BOTTOM:  Passive stereo where L/R images are rendered above each other
-*/
-cStereoMode stereoMode = C_STEREO_DISABLED;
+// CSV file receiving a summary of the run at the end of a headless run, none: no summary
+std::string BenchmarkFile = cfg.getValueOfKey<std::string>("BenchmarkFile", "none");
 
-// fullscreen mode
-bool fullscreen = false;
+// file receiving the signals of every haptic tick, none: no session is recorded
+std::string RecordSession = cfg.getValueOfKey<std::string>("RecordSession", "none");
 
-// mirrored display
-bool mirroredDisplay = false;
+// length in seconds of the session file allocated at start, later ticks are dropped
+double RecordSessionDuration = cfg.getValueOfKey<double>("RecordSessionDuration", 600.0);
 
 
 //------------------------------------------------------------------------------
@@ -426,6 +195,18 @@ cHapticDeviceHandler* handler;
 // a pointer to the current haptic device
 cGenericHapticDevicePtr hapticDevice;
 
+// virtual device replacing the haptic device when VirtualDevice is enabled
+cTraceHapticDevicePtr virtualDevice;
+
+// trajectory of the haptic device recorded when DeviceTraceRecord is set
+cTraceHapticDevicePtr deviceTrace;
+
+// servo loop driving the haptic device when multirate rendering is enabled
+cMultirateHapticDevicePtr multirateDevice;
+
+// local contacts of the tool rendered by the servo loop
+cLocalContactModel contactModel;
+
 // a virtual tool representing the haptic device in the scene
 cToolCursor* tool;
 
@@ -438,8 +219,59 @@ bool simulationFinished = true;
 // a frequency counter to measure the simulation haptic rate
 cFrequencyCounter freqCounterHaptics;
 
-// haptic thread
-cThread* hapticsThread;
+// haptic thread, paced at HapticRate
+cRealtimeScheduler* hapticsThread;
+
+// phases of the haptic loop timed by the profiler
+enum HapticPhase { PHASE_TICK, PHASE_GLOBAL_POSITIONS, PHASE_READ_DEVICE, PHASE_COMMAND_REVISE, PHASE_SEND,
+	PHASE_RECEIVE, PHASE_FEEDBACK_REVISE, PHASE_INTERACTION_FORCES, PHASE_APPLY_DEVICE, PHASE_MMT_SIMULATION };
+
+// latency histograms of the haptic loop phases, written by the haptic thread
+cPhaseProfiler hapticsProfiler;
+
+// state of the haptic loop shown by the graphics thread
+struct HapticFrameState {
+	unsigned int tick = 0;                           // haptic tick at which the state was published
+	double delay = 0.0;                              // S2M delay in ms
+	cVector3d toolPosition = cVector3d(0, 0, 0);     // global position of the tool
+	cMatrix3d toolRotation = cIdentity3d();          // global orientation of the tool
+	cVector3d proxyPosition = cVector3d(0, 0, 0);    // global position of the proxy
+	cVector3d masterVelocity = cVector3d(0, 0, 0);   // device velocity sent to the slave
+	cVector3d masterForce = cVector3d(0, 0, 0);      // force rendered on the device
+	cVector3d objectPosition = cVector3d(0, 0, 0);   // position of the MMT box
+};
+
+// published by the haptic thread once per tick, read by the graphics thread without locking
+cStateSnapshot<HapticFrameState> hapticFrame;
+
+// totals of the haptic loop since the start, summarized at the end of a headless run
+struct BenchmarkTotals {
+	unsigned int received = 0;                       // feedback messages received
+	unsigned int feedbacks = 0;                      // feedback messages applied
+	double delaySum = 0.0;                           // sum of the S2M delays in ms
+	unsigned int rttCount = 0;                       // feedbacks carrying the timestamp of their command
+	double rttSum = 0.0;                             // sum of the round-trip times in ms
+	double rttMax = 0.0;                             // largest round-trip time in ms
+	unsigned int errorCount = 0;                     // ticks included in the tracking errors
+	double forceError2 = 0.0;                        // sum of the squared differences between rendered and slave forces
+	double positionError2 = 0.0;                     // sum of the squared differences between master and slave positions
+};
+
+// published by the haptic thread once per tick
+cStateSnapshot<BenchmarkTotals> benchmarkTotals;
+
+// columns of the session file, one row per haptic tick
+enum SessionColumn { SC_TIME, SC_DELAY, SC_POSITION, SC_SENT_POSITION = SC_POSITION + 3, SC_VELOCITY = SC_SENT_POSITION + 3,
+	SC_FORCE = SC_VELOCITY + 3, SC_ENERGY_TRANS = SC_FORCE + 3, SC_ENERGY_RECV = SC_ENERGY_TRANS + 3, SC_WAVE = SC_ENERGY_RECV + 3,
+	SC_POSITION_FLAG = SC_WAVE + 3, SC_VELOCITY_FLAG, SC_ORIENTATION_FLAG, SC_FEEDBACK, SC_ALGORITHM, SC_COUNT };
+const char* SessionColumnNames[SC_COUNT] = { "time", "delay",
+	"position_x", "position_y", "position_z", "sent_position_x", "sent_position_y", "sent_position_z",
+	"velocity_x", "velocity_y", "velocity_z", "force_x", "force_y", "force_z",
+	"energy_trans_x", "energy_trans_y", "energy_trans_z", "energy_recv_x", "energy_recv_y", "energy_recv_z",
+	"wave_x", "wave_y", "wave_z", "position_flag", "velocity_flag", "orientation_flag", "feedback", "algorithm" };
+
+// signals of the haptic loop, written by the haptic thread
+SessionRecorder session;
 
 WORD sockVersion;
 WSADATA data;
@@ -482,6 +314,9 @@ cFontPtr font;
 // a label to display the rate [Hz] at which the simulation is running
 cLabel* labelRates;
 
+// a label to display the latency of the haptic loop phases
+cLabel* labelProfile;
+
 // a flag for using damping (ON/OFF)
 bool useDamping = false;
 
@@ -582,6 +417,12 @@ void keyCallback(GLFWwindow* a_window, int a_key, int a_scancode, int a_action,
 // this function renders the scene
 void updateGraphics(void);
 
+// this function replaces updateGraphics in headless mode
+void updateHeadless(void);
+
+// this function appends the summary of a headless run to BenchmarkFile
+void writeBenchmark(double runTime);
+
 // this function contains the main haptics simulation loop
 void updateHaptics(void);
 
@@ -668,14 +509,30 @@ int main(int argc, char* argv[])
 	std::cout << "[T] - Enable TDPA algorithm" << std::endl;
 	std::cout << "[M] - Enable MMT algorithm" << std::endl;
 	std::cout << "[W] - Enable WAVE algorithm" << std::endl;
-	std::cout << "[D] - Switch between dynamic delay and constant delay(20ms)" << std::endl;
+	std::cout << "[D] - Switch between dynamic delay and constant delay (CommandDelay)" << std::endl;
+	std::cout << "[P] - Save haptic loop profile to HapticProfile.csv" << std::endl;
 	std::cout << std::endl << std::endl;
 
+	for (int i = 1; i < argc; i++) {
+		if (strcmp(argv[i], "--headless") == 0) headless = true;
+
+		// convert a recorded session and exit: --convert-session session.bin output.csv|output.npy
+		if ((strcmp(argv[i], "--convert-session") == 0) && (i + 2 < argc)) {
+			bool converted = SessionRecorder::Convert(argv[i + 1], argv[i + 2]);
+			std::cout << (converted ? "> Converted " : "error - failed to convert ") << argv[i + 1] << std::endl;
+			return converted ? 0 : 1;
+		}
+	}
+	if (headless) {
+		std::cout << "Running headless: no window, statistics every " << HeadlessStatsPeriod << " s" << std::endl << std::endl;
+	}
+
 	
 
 	// initialized deadband classes for force and velocity
 	DBVelocity = new DeadbandDataReduction(VelocityDeadbandParameter);
 	DBPosition = new DeadbandDataReduction(PositionDeadbandParameter);
+	DBOrientation = new OrientationDeadbandDataReduction(OrientationDeadbandParameter);
 
 
 	socketClientInit("127.0.0.1", 888, 887, sServer);
@@ -685,75 +542,77 @@ int main(int argc, char* argv[])
 	// OPENGL - WINDOW DISPLAY
 	//--------------------------------------------------------------------------
 
-	// initialize GLFW library
-	if (!glfwInit())
-	{
-		std::cout << "failed initialization" << std::endl;
-		cSleepMs(1000);
-		return 1;
-	}
+	if (!headless) {
+		// initialize GLFW library
+		if (!glfwInit())
+		{
+			std::cout << "failed initialization" << std::endl;
+			cSleepMs(1000);
+			return 1;
+		}
 
-	// set error callback
-	glfwSetErrorCallback(errorCallback);
-
-	// compute desired size of window
-	const GLFWvidmode* mode = glfwGetVideoMode(glfwGetPrimaryMonitor());
-	int w = 0.8 * mode->height;
-	int h = 0.5 * mode->height;
-	int x = 0.5 * (mode->width - w);
-	int y = 0.5 * (mode->height - h);
-
-	// set OpenGL version
-	glfwWindowHint(GLFW_CONTEXT_VERSION_MAJOR, 2);
-	glfwWindowHint(GLFW_CONTEXT_VERSION_MINOR, 1);
-	glfwWindowHint(GLFW_RESIZABLE, GLFW_FALSE);
-	// set active stereo mode
-	if (stereoMode == C_STEREO_ACTIVE)
-	{
-		glfwWindowHint(GLFW_STEREO, GL_TRUE);
-	}
-	else
-	{
-		glfwWindowHint(GLFW_STEREO, GL_FALSE);
-	}
+		// set error callback
+		glfwSetErrorCallback(errorCallback);
+
+		// compute desired size of window
+		const GLFWvidmode* mode = glfwGetVideoMode(glfwGetPrimaryMonitor());
+		int w = 0.8 * mode->height;
+		int h = 0.5 * mode->height;
+		int x = 0.5 * (mode->width - w);
+		int y = 0.5 * (mode->height - h);
+
+		// set OpenGL version
+		glfwWindowHint(GLFW_CONTEXT_VERSION_MAJOR, 2);
+		glfwWindowHint(GLFW_CONTEXT_VERSION_MINOR, 1);
+		glfwWindowHint(GLFW_RESIZABLE, GLFW_FALSE);
+		// set active stereo mode
+		if (stereoMode == C_STEREO_ACTIVE)
+		{
+			glfwWindowHint(GLFW_STEREO, GL_TRUE);
+		}
+		else
+		{
+			glfwWindowHint(GLFW_STEREO, GL_FALSE);
+		}
 
-	// create display context
-	window = glfwCreateWindow(w, h, "CHAI3D", NULL, NULL);
-	if (!window)
-	{
-		std::cout << "failed to create window" << std::endl;
-		cSleepMs(1000);
-		glfwTerminate();
-		return 1;
-	}
+		// create display context
+		window = glfwCreateWindow(w, h, "CHAI3D", NULL, NULL);
+		if (!window)
+		{
+			std::cout << "failed to create window" << std::endl;
+			cSleepMs(1000);
+			glfwTerminate();
+			return 1;
+		}
 
-	// get width and height of window
-	glfwGetWindowSize(window, &width, &height);
+		// get width and height of window
+		glfwGetWindowSize(window, &width, &height);
 
-	// set position of window
-	glfwSetWindowPos(window, x, y);
+		// set position of window
+		glfwSetWindowPos(window, x, y);
 
-	// set key callback
-	glfwSetKeyCallback(window, keyCallback);
+		// set key callback
+		glfwSetKeyCallback(window, keyCallback);
 
-	// set resize callback
-	glfwSetWindowSizeCallback(window, windowSizeCallback);
+		// set resize callback
+		glfwSetWindowSizeCallback(window, windowSizeCallback);
 
-	// set current display context
-	glfwMakeContextCurrent(window);
+		// set current display context
+		glfwMakeContextCurrent(window);
 
-	// sets the swap interval for the current display context
-	glfwSwapInterval(swapInterval);
+		// sets the swap interval for the current display context
+		glfwSwapInterval(swapInterval);
 
 #ifdef GLEW_VERSION
-	// initialize GLEW library
-	if (glewInit() != GLEW_OK)
-	{
-		std::cout << "failed to initialize GLEW library" << std::endl;
-		glfwTerminate();
-		return 1;
-	}
+		// initialize GLEW library
+		if (glewInit() != GLEW_OK)
+		{
+			std::cout << "failed to initialize GLEW library" << std::endl;
+			glfwTerminate();
+			return 1;
+		}
 #endif
+	}
 
 
 	//--------------------------------------------------------------------------
@@ -807,12 +666,14 @@ int main(int argc, char* argv[])
 	// set uniform concentration level of light 
 	light->setSpotExponent(0.0);
 
-	// enable this light source to generate shadows
-	light->setShadowMapEnabled(true);
+	if (!headless) {
+		// enable this light source to generate shadows
+		light->setShadowMapEnabled(true);
 
-	// set the resolution of the shadow map
-	light->m_shadowMap->setQualityLow();
-	//light->m_shadowMap->setQualityMedium();
+		// set the resolution of the shadow map
+		light->m_shadowMap->setQualityLow();
+		//light->m_shadowMap->setQualityMedium();
+	}
 
 	// set light cone half angle
 	light->setCutOffAngleDeg(45);
@@ -829,6 +690,21 @@ int main(int argc, char* argv[])
 	labelRates->m_fontColor.set(0, 0, 0);
 	camera->m_frontLayer->addChild(labelRates);
 
+	// create a label to display the latency of the haptic loop phases
+	labelProfile = new cLabel(font);
+	labelProfile->m_fontColor.set(0, 0, 0);
+	camera->m_frontLayer->addChild(labelProfile);
+	hapticsProfiler.setPhaseName(PHASE_TICK, "tick");
+	hapticsProfiler.setPhaseName(PHASE_GLOBAL_POSITIONS, "computeGlobalPositions");
+	hapticsProfiler.setPhaseName(PHASE_READ_DEVICE, "read device");
+	hapticsProfiler.setPhaseName(PHASE_COMMAND_REVISE, "command revise");
+	hapticsProfiler.setPhaseName(PHASE_SEND, "send");
+	hapticsProfiler.setPhaseName(PHASE_RECEIVE, "recv");
+	hapticsProfiler.setPhaseName(PHASE_FEEDBACK_REVISE, "feedback revise");
+	hapticsProfiler.setPhaseName(PHASE_INTERACTION_FORCES, "computeInteractionForces");
+	hapticsProfiler.setPhaseName(PHASE_APPLY_DEVICE, "apply to device");
+	hapticsProfiler.setPhaseName(PHASE_MMT_SIMULATION, "MMT simulation");
+
 
 	//--------------------------------------------------------------------------
 	// HAPTIC DEVICE
@@ -840,6 +716,33 @@ int main(int argc, char* argv[])
 	// get a handle to the first haptic device
 	handler->getDevice(hapticDevice, 0);
 
+	// replace the device by a trace or a motion profile for reproducible runs without an operator
+	if (VirtualDevice) {
+		virtualDevice = cTraceHapticDevice::create();
+		if (VirtualDeviceTrace != "none") {
+			if (!virtualDevice->loadTrace(VirtualDeviceTrace)) {
+				std::cout << "error - failed to load trace " << VirtualDeviceTrace << std::endl;
+			}
+		}
+		virtualDevice->setMotionProfile((cTraceMotionProfile)VirtualDeviceMotion, 
+			cVector3d(VirtualDeviceAmplitude, VirtualDeviceAmplitude, VirtualDeviceAmplitude), VirtualDeviceFrequency);
+		virtualDevice->setFixedTimeStep(VirtualDeviceTimeStep);
+		virtualDevice->setForceRecording(VirtualDeviceForceLog != "none");
+		hapticDevice = virtualDevice;
+	}
+
+	if (DeviceTraceRecord != "none") {
+		deviceTrace = cTraceHapticDevice::create();
+		deviceTrace->setTraceRecording(true, (unsigned int)(DeviceTraceRecordDuration * HapticRate));
+	}
+
+	// let a servo loop drive the device and render the local contacts between haptic ticks
+	if (MultirateRendering) {
+		multirateDevice = cMultirateHapticDevice::create(hapticDevice, ServoRate);
+		multirateDevice->getScheduler().setSpinWindow(HapticSpinWindow);
+		hapticDevice = multirateDevice;
+	}
+
 	// create a tool (cursor) and insert into the world
 	tool = new cToolCursor(world);
 	world->addChild(tool);
@@ -881,8 +784,19 @@ int main(int argc, char* argv[])
 	//std::cout << workspaceScaleFactor << " "<< hapticDeviceInfo.m_workspaceRadius << std::endl;	
 	world->setGravity(0.0, 0.0, -9.8);
 	//120 is maxStiffness
-	ISS.mu_max = maxStiffness * ISS.stiff_factor;
-	WAVE.scaleFactor = workspaceScaleFactor;
+	Controller.ISS().mu_max = maxStiffness * Controller.ISS().stiff_factor;
+	Controller.WAVE().scaleFactor = workspaceScaleFactor;
+	Controller.WAVE().vl.CorrectionTime = WaveCorrectionTime;
+	Controller.WAVE().vl.PredictionGain = WavePredictionGain;
+	Controller.WAVE().vl.ReserveLimit = WaveReserveLimit;
+	if (RecordSignals) {
+		TDPATelemetryFile.open("TDPATelemetry.txt");
+		Controller.TDPA().TelemetryChannel = &TDPATelemetry;
+	}
+
+	// select the configured algorithm, the slave follows with the first command
+	ATypeChange = (AlgorithmType)Algorithm;
+	Controller.Select(ATypeChange);
 	
 
 	//////////////////////////////////////////////////////////////////////////
@@ -987,25 +901,27 @@ int main(int argc, char* argv[])
 	// set friction values
 	ground->setSurfaceFriction(0.4);
 	// set material properties
-	bool fileload;
-	ground->m_texture = cTexture2d::create();
-	fileload = ground->m_texture->loadFromFile("resources/wood.jpg");
-	if (!fileload)
-	{
-		std::cout << "Error - Texture image failed to load correctly." << std::endl;
-		close();
-		return (-1);
-	}
+	if (!headless) {
+		bool fileload;
+		ground->m_texture = cTexture2d::create();
+		fileload = ground->m_texture->loadFromFile("resources/wood.jpg");
+		if (!fileload)
+		{
+			std::cout << "Error - Texture image failed to load correctly." << std::endl;
+			close();
+			return (-1);
+		}
 
-	// enable texture mapping
-	ground->setUseTexture(true);
-	ground->m_material->setWhite();
+		// enable texture mapping
+		ground->setUseTexture(true);
+		ground->m_material->setWhite();
 
-	// create normal map from texture data
-	cNormalMapPtr normalMap0 = cNormalMap::create();
-	normalMap0->createMap(ground->m_texture);
-	ground->m_normalMap = normalMap0;
-	world->setEnabled(false, true);
+		// create normal map from texture data
+		cNormalMapPtr normalMap0 = cNormalMap::create();
+		normalMap0->createMap(ground->m_texture);
+		ground->m_normalMap = normalMap0;
+	}
+	world->setEnabled(Algorithm == AlgorithmType::AT_MMT, true);
 
 	
 
@@ -1013,8 +929,16 @@ int main(int argc, char* argv[])
 	// create message sender used to control delay and send message
 	//--------------------------------------------------------------------------
 
+	// allocate the session file before the haptic loop starts writing to it
+	if (RecordSession != "none") {
+		if (!session.Open(RecordSession.c_str(), SessionColumnNames, SC_COUNT, (unsigned long long)(RecordSessionDuration * HapticRate)))
+			std::cout << "error - failed to create " << RecordSession << std::endl;
+	}
+
 	// create a thread which starts the main haptics rendering loop
-	hapticsThread = new cThread();
+	hapticsThread = new cRealtimeScheduler(HapticRate);
+	hapticsThread->setAffinity(HapticCPU);
+	hapticsThread->setSpinWindow(HapticSpinWindow);
 	hapticsThread->start(updateHaptics, CTHREAD_PRIORITY_HAPTICS);
 
 	// setup callback when application exits
@@ -1022,6 +946,10 @@ int main(int argc, char* argv[])
 	sender = new Sender<hapticMessageM2S>();
 	sender->Q = &forwardQ;
 	sender->s = sServer;
+	sender->constantDelay = CommandDelay;
+	sender->gamma_alpha = CommandDelay;
+	sender->dynamicDelay = DynamicDelay != 0;
+	sender->lossRate = PacketLossRate;
 	unsigned  uiThread1ID;
 	HANDLE hth1 = (HANDLE)_beginthreadex(NULL, // security
 		0,             // stack size
@@ -1030,6 +958,23 @@ int main(int argc, char* argv[])
 		0, // so we can later call ResumeThread()
 		&uiThread1ID);
 	//ResumeThread(hth1);
+	//--------------------------------------------------------------------------
+	// MAIN HEADLESS LOOP
+	//--------------------------------------------------------------------------
+
+	if (headless) {
+		cPrecisionClock runClock;
+		runClock.start();
+		while ((HeadlessDuration <= 0.0) || (runClock.getcurrentTimeSeconds() < HeadlessDuration)) {
+			updateHeadless();
+			freqCounterGraphics.signal(1);
+			cSleepMs(10);
+		}
+		if (BenchmarkFile != "none")
+			writeBenchmark(runClock.getcurrentTimeSeconds());
+		return 0;
+	}
+
 	//--------------------------------------------------------------------------
 	// MAIN GRAPHIC LOOP
 	//--------------------------------------------------------------------------
@@ -1149,64 +1094,44 @@ void keyCallback(GLFWwindow* a_window, int a_key, int a_scancode, int a_action,
 	else if (a_key == GLFW_KEY_M)
 	{
 		std::cout << "MMT enabled" << std::endl;
-		MMT.enable = true;
-		MMT.Initialize();
+		Controller.Select(AlgorithmType::AT_MMT);
 		world->setEnabled(true, true);
 		ATypeChange = AlgorithmType::AT_MMT;
-
-		WAVE.waveOn = false;
-		ISS.ISS_enabled = false;
-		TDPA.TDPAon = false;
 	}
 
 	else if (a_key == GLFW_KEY_I) {
 		std::cout << "ISS enabled" << std::endl;
-		ISS.ISS_enabled = true;
-		ISS.Initialize();
-		ATypeChange = AlgorithmType::AT_ISS;
-
-		WAVE.waveOn = false;
-		MMT.enable = false;
+		Controller.Select(AlgorithmType::AT_ISS);
 		world->setEnabled(false, true);
-		TDPA.TDPAon = false;
+		ATypeChange = AlgorithmType::AT_ISS;
 	}
 	else if (a_key == GLFW_KEY_T) {
 		std::cout << "TDPA enabled" << std::endl;
-		TDPA.TDPAon = true;
-		TDPA.Initialize();
-		ATypeChange = AlgorithmType::AT_TDPA;
-
-		WAVE.waveOn = false;
-		MMT.enable = false;
+		Controller.Select(AlgorithmType::AT_TDPA);
 		world->setEnabled(false, true);
-		ISS.ISS_enabled = false;
+		ATypeChange = AlgorithmType::AT_TDPA;
 	}
 	else if (a_key == GLFW_KEY_N) {
 		std::cout << "None enabled" << std::endl;
-
-		WAVE.waveOn = false;
-		MMT.enable = false;
+		Controller.Select(AlgorithmType::AT_None);
 		world->setEnabled(false, true);
 		ATypeChange = AlgorithmType::AT_None;
-		TDPA.TDPAon = false;
-		ISS.ISS_enabled = false;
 	}
 	else if (a_key == GLFW_KEY_W) {
 		std::cout << "WAVE enabled" << std::endl;
-		WAVE.waveOn = true;
-		WAVE.Initialize();
+		Controller.Select(AlgorithmType::AT_WAVE);
+		world->setEnabled(false, true);
 		ATypeChange = AlgorithmType::AT_WAVE;
-
-		MMT.enable = false;
-		world->setEnabled(false, true);		
-		TDPA.TDPAon = false;
-		ISS.ISS_enabled = false;
 	}
 	else if (a_key == GLFW_KEY_D) {
 		std::cout << "Dynamic Delay :"<< !sender->dynamicDelay << std::endl;
 
 		sender->dynamicDelay = !sender->dynamicDelay;
 	}
+	else if (a_key == GLFW_KEY_P) {
+		if (hapticsProfiler.saveCSV("HapticProfile.csv"))
+			std::cout << "> Saved haptic loop profile to HapticProfile.csv" << std::endl;
+	}
 }
 
 //------------------------------------------------------------------------------
@@ -1222,6 +1147,18 @@ void close(void)
 	// close haptic device
 	
 	tool->stop();
+
+	// the recorded rows stay in the session file
+	session.Close();
+
+	// save the forces sent to the virtual device and the recorded trajectory
+	if (virtualDevice && (VirtualDeviceForceLog != "none")) {
+		virtualDevice->saveForceLog(VirtualDeviceForceLog);
+	}
+	if (deviceTrace) {
+		deviceTrace->saveTrace(DeviceTraceRecord);
+	}
+
 	// delete resources
 	delete hapticsThread;
 	delete world;
@@ -1246,6 +1183,15 @@ void updateHaptics(void)
 	cPrecisionClock clock;
 	clock.reset();
 
+	// time base of the recorded trajectory and session
+	cPrecisionClock traceClock;
+	traceClock.start(true);
+
+	// totals of the run, published to the main thread after each tick
+	BenchmarkTotals totals;
+	cVector3d slaveForce(0, 0, 0); // force measured by the slave in the last feedback
+	cVector3d slavePosition(0, 0, 0); // slave tool position in the last feedback
+
 	// main haptic simulation loop
 	__int64 beginTime;
 	QueryPerformanceCounter((LARGE_INTEGER *)&beginTime);
@@ -1254,8 +1200,14 @@ void updateHaptics(void)
 	
 	while (simulationRunning)
 	{
+		// wait for the next tick of the haptic loop
+		hapticsThread->waitForNextTick();
+		C_PROFILE_SCOPE(hapticsProfiler, PHASE_TICK);
+		C_PROFILE_START(phaseTimer, hapticsProfiler);
+
 		// compute global reference frames for each object
 		world->computeGlobalPositions(true);
+		C_PROFILE_LAP(phaseTimer, PHASE_GLOBAL_POSITIONS);
 		/////////////////////////////////////////////////////////////////////
 		// READ HAPTIC DEVICE
 		/////////////////////////////////////////////////////////////////////
@@ -1302,6 +1254,17 @@ void updateHaptics(void)
 		button2 = tool->getUserSwitch(2);
 		button3 = tool->getUserSwitch(3);
 
+		// record the trajectory of the device in its own units, so that it can be replayed by a virtual device
+		if (deviceTrace) {
+			cTraceSample sample;
+			sample.m_time = traceClock.getcurrentTimeSeconds();
+			sample.m_position = position / tool->getWorkspaceScaleFactor();
+			sample.m_rotation.fromRotMat(rotation);
+			sample.m_gripperAngle = gripperAngle;
+			sample.m_userSwitches = allSwitches;
+			deviceTrace->recordSample(sample);
+		}
+
 		for (int i = 0; i < 3; i++) {
 			MasterVelocity[i] = linearVelocity(i);
 			MasterPosition[i] = position(i);
@@ -1324,23 +1287,19 @@ void updateHaptics(void)
 		if (PositionTransmitFlag == true) {
 		}
 
+		// Apply deadband on orientation
+		DBOrientation->GetCurrentSample(rotation);
+		DBOrientation->ApplyZOHDeadband(&MasterOrientation, &OrientationTransmitFlag);
+
 		// Apply deadband on velocity
 		DBVelocity->GetCurrentSample(MasterVelocity);
 		DBVelocity->ApplyZOHDeadband(MasterVelocity, &VelocityTransmitFlag);
+		C_PROFILE_LAP(phaseTimer, PHASE_READ_DEVICE);
 
-
-		ISS.VelocityRevise(MasterVelocity);
-		WAVE.getWave_l(WAVE.b, &WAVE.WV, cVector3d(MasterVelocity[0], MasterVelocity[1], MasterVelocity[2]));
-		double ul[3] = { WAVE.WV.ul.x(), WAVE.WV.ul.y(), WAVE.WV.ul.z() };
-
-		if (VelocityTransmitFlag == true) {
-			memcpy(TDPA.E_trans, TDPA.E_in, 3*sizeof(double));
-			memcpy(TDPA.E_in_last, TDPA.E_in, 3 * sizeof(double));
-		}
-		else
-		{
-			memcpy(TDPA.E_trans, TDPA.E_in_last, 3 * sizeof(double));
-		}
+		// revise the command with the active control algorithm (ISS velocity, WAVE forward wave)
+		Controller.MasterCommandRevise(MasterVelocity);
+		Controller.TDPA().UpdateTransmitEnergy(VelocityTransmitFlag);
+		C_PROFILE_LAP(phaseTimer, PHASE_COMMAND_REVISE);
 
 #pragma region create message and send it
 		/////////////////////////////////////////////////////////////////////
@@ -1352,10 +1311,8 @@ void updateHaptics(void)
 			msgM2S.position[i] = MasterPosition[i];//modified by TDPA 
 			msgM2S.linearVelocity[i] = MasterVelocity[i];//modified by TDPA 
 			msgM2S.angularVelocity[i] = angularVelocity(i);
-			msgM2S.rotation[i] = rotation.getCol0()(i);
-			msgM2S.rotation[i + 3] = rotation.getCol1()(i);
-			msgM2S.rotation[i + 6] = rotation.getCol2()(i);
 		}
+		msgM2S.rotation = MasterOrientation;
 		msgM2S.gripperAngle = gripperAngle;
 		msgM2S.gripperAngularVelocity = gripperAngularVelocity;
 		msgM2S.button0 = button0;
@@ -1363,8 +1320,9 @@ void updateHaptics(void)
 		msgM2S.button2 = button2;
 		msgM2S.button3 = button3;
 		msgM2S.userSwitches = allSwitches;
-		memcpy(msgM2S.energy, TDPA.E_trans, 3 * sizeof(double));//modified by TDPA 
-		memcpy(msgM2S.waveVariable, ul, 3 * sizeof(double));
+		memcpy(msgM2S.energy, Controller.TDPA().E_trans, 3 * sizeof(double));//modified by TDPA 
+		memcpy(msgM2S.waveVariable, Controller.WAVE().ul, 3 * sizeof(double));
+		memcpy(msgM2S.waveIntegral, Controller.WAVE().Ul, 3 * sizeof(double));
 
 		__int64 curtime;
 		QueryPerformanceCounter((LARGE_INTEGER *)&curtime);
@@ -1380,6 +1338,7 @@ void updateHaptics(void)
 		//send(sServer, (char *)&msgM2S, sizeof(hapticMessageM2S), 0);
 		forwardQ.push(msgM2S);
 		freqCounterHaptics.signal(1);
+		C_PROFILE_LAP(phaseTimer, PHASE_SEND);
 
 #pragma endregion
 
@@ -1393,18 +1352,17 @@ void updateHaptics(void)
 
 		int ret = recv(sServer, recData + unprocessedPtr, sizeof(recData) - unprocessedPtr, 0);
 		if (ret > 0) {
+			unprocessedPtr += ret;
+		}
+		unsigned int hapticMsgL = sizeof(hapticMessageS2M);
+		if (unprocessedPtr >= hapticMsgL) {
 			// we receive some char data and transform it to hapticMessageS2M.
 			// if receive more than one hapticMessageS2M, only save the last one.
-			unprocessedPtr += ret;
-
-			unsigned int hapticMsgL = sizeof(hapticMessageS2M);
-			unsigned int i = 0;
-			for (; i < unprocessedPtr / hapticMsgL - 1; i++) {
-				forceQ.push(*(hapticMessageS2M*)(recData + i* hapticMsgL));
-			}
+			unsigned int received = unprocessedPtr / hapticMsgL;
+			totals.received += received;
 			std::queue<hapticMessageS2M> empty;
 			forceQ.swap(empty);
-			forceQ.push(*(hapticMessageS2M*)(recData + i* hapticMsgL));
+			forceQ.push(*(hapticMessageS2M*)(recData + (received - 1) * hapticMsgL));
 			unsigned int processedPtr = (unprocessedPtr / hapticMsgL) * hapticMsgL;
 			unprocessedPtr %= hapticMsgL;
 
@@ -1412,8 +1370,10 @@ void updateHaptics(void)
 				recData[i] = recData[processedPtr + i];
 			}
 		}
+		C_PROFILE_LAP(phaseTimer, PHASE_RECEIVE);
 		
-		if (forceQ.size()) {
+		bool feedback = forceQ.size() > 0;
+		if (feedback) {
 			msgS2M = forceQ.front();
 			forceQ.pop();
 			
@@ -1424,7 +1384,8 @@ void updateHaptics(void)
 			memcpy(MasterForce, msgS2M.force, 3 * sizeof(double));
 			memcpy(MasterTorque, msgS2M.torque, 3 * sizeof(double));
 			MasterGripperForce = msgS2M.gripperForce;
-			memcpy(TDPA.E_recv, msgS2M.energy, 3 * sizeof(double));
+			memcpy(Controller.TDPA().E_recv, msgS2M.energy, 3 * sizeof(double));
+			MMT_Algorithm& MMT = Controller.MMT();
 			MMT.SlavePar.parPosition = cVector3d(msgS2M.MMTParameters[0], msgS2M.MMTParameters[1], msgS2M.MMTParameters[2]);
 			MMT.SlavePar.parStiffness = cVector3d(msgS2M.MMTParameters[3], msgS2M.MMTParameters[4], msgS2M.MMTParameters[5]);
 			MMT.SlavePar.mass = msgS2M.MMTParameters[6];
@@ -1432,9 +1393,8 @@ void updateHaptics(void)
 			
 			MMT.SlavePar.Flag = msgS2M.MMTParameters[8];
 			
-			double vl[3];
-			memcpy(vl, msgS2M.waveVariable, 3 * sizeof(double));
-			WAVE.WV.vl = cVector3d(vl[0], vl[1], vl[2]);
+			Controller.WAVE().vl.Receive(msgS2M.waveVariable, msgS2M.waveIntegral);
+			Controller.WAVE().vl.UpdateDelay(delay * 0.001);
 
 			
 
@@ -1445,14 +1405,26 @@ void updateHaptics(void)
 				MasterForce[2] = ForceKalmanFilter.CurrentEstimation[2];
 			}
 
-			TDPA.ForceRevise(MasterVelocity, MasterForce);
-			ISS.ForceRevise(MasterForce);
-			WAVE.ForceRevise(MasterVelocity, &WAVE.WV, MasterForce);
+			// revise the feedback with the active control algorithm (TDPA passivity controller, ISS, WAVE decoding)
+			Controller.MasterFeedbackRevise(MasterVelocity, MasterForce);
+
+			slaveForce.set(msgS2M.force[0], msgS2M.force[1], msgS2M.force[2]);
+			slavePosition.set(msgS2M.position[0], msgS2M.position[1], msgS2M.position[2]);
+			totals.feedbacks++;
+			totals.delaySum += delay;
+			if (msgS2M.echoTimestamp) {
+				double rtt = ((double)(curtime - msgS2M.echoTimestamp) / (double)cpuFreq.QuadPart) * 1000;
+				totals.rttCount++;
+				totals.rttSum += rtt;
+				totals.rttMax = cMax(totals.rttMax, rtt);
+			}
 			
 			
 			
 		}
+		C_PROFILE_LAP(phaseTimer, PHASE_FEEDBACK_REVISE);
 		
+		MMT_Algorithm& MMT = Controller.MMT();
 		if (MMT.SlavePar.Flag) {
 			//update master's enviroment
 			MMT.SlavePar.Flag = false;
@@ -1474,13 +1446,64 @@ void updateHaptics(void)
 		tool->computeInteractionForces();
 		//std::cout<< "hello" << tool->getHapticPoint(0)->getGlobalPosProxy() << std::endl;
 		cHapticPoint* p = tool->getHapticPoint(0);
-		MMT.ForceRevise(MasterForce, p->getLocalPosGoal(), p->getLocalPosProxy());
+		if (Controller.Active() == AlgorithmType::AT_MMT)
+			MMT.ForceRevise(MasterForce, p->getLocalPosGoal(), p->getLocalPosProxy());
+		// the local contacts only describe the rendered force when it comes from the local world
+		if (multirateDevice) {
+			if (Controller.Active() == AlgorithmType::AT_MMT)
+				contactModel.update(tool, 0);
+			else
+				contactModel.clear();
+			multirateDevice->setContactModel(contactModel);
+		}
+		C_PROFILE_LAP(phaseTimer, PHASE_INTERACTION_FORCES);
 		//std::cout << p->getLocalPosProxy() - p->getLocalPosGoal() << std::endl;
 		
 		tool->setDeviceLocalForce(cVector3d(MasterForce[0], MasterForce[1], MasterForce[2]));
 		tool->setDeviceLocalTorque(cVector3d(MasterTorque[0], MasterTorque[1], MasterTorque[2]));
 		tool->setGripperForce(MasterGripperForce);
 		tool->applyToDevice();
+		C_PROFILE_LAP(phaseTimer, PHASE_APPLY_DEVICE);
+
+		// transparency: rendered force against the force measured by the slave, master position against the slave
+		if (totals.feedbacks) {
+			totals.errorCount++;
+			totals.forceError2 += (cVector3d(MasterForce[0], MasterForce[1], MasterForce[2]) - slaveForce).lengthsq();
+			totals.positionError2 += (position - slavePosition).lengthsq();
+		}
+
+		// publish the state of this tick to the graphics thread
+		HapticFrameState& frame = hapticFrame.edit();
+		frame.tick = hapticsThread->getTickCount();
+		frame.delay = delay;
+		frame.toolPosition = tool->getDeviceGlobalPos();
+		frame.toolRotation = tool->getDeviceGlobalRot();
+		frame.proxyPosition = tool->getHapticPoint(0)->getGlobalPosProxy();
+		frame.masterVelocity.set(MasterVelocity[0], MasterVelocity[1], MasterVelocity[2]);
+		frame.masterForce.set(MasterForce[0], MasterForce[1], MasterForce[2]);
+		frame.objectPosition = bulletBox1->getLocalPos();
+		hapticFrame.publish();
+		benchmarkTotals.publish(totals);
+
+		// record the signals of this tick
+		if (session.IsOpen()) {
+			session.Set(SC_TIME, traceClock.getcurrentTimeSeconds());
+			session.Set(SC_DELAY, delay);
+			for (int i = 0; i < 3; i++)
+				session.Set(SC_POSITION + i, position(i));
+			session.Set(SC_SENT_POSITION, MasterPosition, 3);
+			session.Set(SC_VELOCITY, MasterVelocity, 3);
+			session.Set(SC_FORCE, MasterForce, 3);
+			session.Set(SC_ENERGY_TRANS, Controller.TDPA().E_trans, 3);
+			session.Set(SC_ENERGY_RECV, Controller.TDPA().E_recv, 3);
+			session.Set(SC_WAVE, Controller.WAVE().ul, 3);
+			session.Set(SC_POSITION_FLAG, PositionTransmitFlag);
+			session.Set(SC_VELOCITY_FLAG, VelocityTransmitFlag);
+			session.Set(SC_ORIENTATION_FLAG, OrientationTransmitFlag);
+			session.Set(SC_FEEDBACK, feedback);
+			session.Set(SC_ALGORITHM, Controller.Active());
+			session.Commit();
+		}
 		/////////////////////////////////////////////////////////////////////
 		// SIMULATION TIME    
 		/////////////////////////////////////////////////////////////////////
@@ -1489,16 +1512,19 @@ void updateHaptics(void)
 		clock.stop();
 
 		// read the time increment in seconds
-		double timeInterval = cClamp(clock.getcurrentTimeSeconds(), 0.0001, 0.001);
+		double timeInterval = cClamp(clock.getcurrentTimeSeconds(), 0.0001, cMax(0.001, 1.0 / HapticRate));
 
 		// restart the simulation clock
 		clock.reset();
 		clock.start();
 
+		// the energy observers integrate with the measured interval
+		Controller.SetSampleInterval(timeInterval);
+
 		/////////////////////////////////////////////////////////////////////
 		// DYNAMIC SIMULATION
 		/////////////////////////////////////////////////////////////////////
-		if (!MMT.enable)continue;
+		if (Controller.Active() != AlgorithmType::AT_MMT)continue;
 		cVector3d pos = bulletBox1->getLocalPos();
 		if (tool->getHapticPoint(0)->getNumCollisionEvents()) {
 			cBulletBox* bulletobject = dynamic_cast<cBulletBox*>(tool->getHapticPoint(0)->getCollisionEvent(0)->m_object->getOwner()->getOwner());
@@ -1539,6 +1565,7 @@ void updateHaptics(void)
 
 		
 		bulletBox1->setLocalPos(pos);
+		C_PROFILE_LAP(phaseTimer, PHASE_MMT_SIMULATION);
 #pragma endregion
 
 
@@ -1556,13 +1583,28 @@ void updateGraphics(void)
 	/////////////////////////////////////////////////////////////////////
 
 
+	// latest state published by the haptic thread
+	hapticFrame.update();
+	const HapticFrameState& frame = hapticFrame.get();
+
 	// update haptic and graphic rate data
 	labelRates->setText(cStr(freqCounterGraphics.getFrequency(), 0) + " Hz / " +
-		cStr(freqCounterHaptics.getFrequency(), 0) + " Hz    S2M delay" + cStr(delay, 3) + " ");
+		cStr(freqCounterHaptics.getFrequency(), 0) + " Hz    S2M delay" + cStr(frame.delay, 3) + " " +
+		"   overruns " + cStr(hapticsThread->getOverrunCount()) + "  jitter p99 " + cStr(1e6 * hapticsThread->getJitterPercentile(0.99), 0) + " us");
 
 	// update position of label
 	labelRates->setLocalPos((int)(0.5 * (width - labelRates->getWidth())), 15);
 
+	// update haptic loop phase latencies
+	labelProfile->setText(hapticsProfiler.getSummary());
+	labelProfile->setLocalPos(10, (int)(height - labelProfile->getHeight() - 10));
+
+	// write TDPA observer samples collected since the last frame
+	TDPA_Policy<3>::Telemetry telemetry;
+	while (TDPATelemetry.Pop(telemetry)) {
+		TDPA_Policy<3>::WriteTelemetry(TDPATelemetryFile, telemetry);
+	}
+
 
 	/////////////////////////////////////////////////////////////////////
 	// RENDER SCENE
@@ -1590,3 +1632,109 @@ void updateGraphics(void)
 	err = glGetError();
 	if (err != GL_NO_ERROR) std::cout << "Error:  %s\n" << gluErrorString(err);
 }
+
+//------------------------------------------------------------------------------
+
+// video frames received in headless mode, counted instead of displayed
+std::vector<unsigned char> headlessVideoFrame(4 * VideoWidth * VideoHeight);
+int headlessVideoBytes = 0; // bytes of the current frame received so far
+unsigned int headlessVideoFrames = 0; // complete frames since the last statistics line
+unsigned int headlessVideoLost = 0; // test pattern frames missing since the last statistics line
+long long headlessLastPattern = -1; // counter of the last test pattern frame
+double headlessRateSum = 0.0; // sum of the haptic rates of the statistics lines, for the benchmark summary
+double headlessRateSum2 = 0.0; // sum of their squares
+unsigned int headlessRateCount = 0;
+cPrecisionClock headlessStatsClock;
+
+void updateHeadless(void)
+{
+	// receive the video stream of the slave, so that it is not throttled by a full socket
+	int ret;
+	while ((ret = recv(sServer_Image, (char*)headlessVideoFrame.data() + headlessVideoBytes,
+		(int)headlessVideoFrame.size() - headlessVideoBytes, 0)) > 0) {
+		headlessVideoBytes += ret;
+		if (headlessVideoBytes < (int)headlessVideoFrame.size()) continue;
+
+		// a complete frame: frames lost between two test patterns show as a gap in their counters
+		if (VideoTestPattern) {
+			unsigned int pattern = ReadVideoTestPatternFrame(headlessVideoFrame.data());
+			if ((headlessLastPattern >= 0) && (pattern > headlessLastPattern + 1))
+				headlessVideoLost += pattern - (unsigned int)headlessLastPattern - 1;
+			headlessLastPattern = pattern;
+		}
+		headlessVideoFrames++;
+		headlessVideoBytes = 0;
+	}
+
+	// write TDPA observer samples collected since the last call
+	TDPA_Policy<3>::Telemetry telemetry;
+	while (TDPATelemetry.Pop(telemetry)) {
+		TDPA_Policy<3>::WriteTelemetry(TDPATelemetryFile, telemetry);
+	}
+
+	if (!headlessStatsClock.on()) headlessStatsClock.start(true);
+	double period = headlessStatsClock.getcurrentTimeSeconds();
+	if (period < HeadlessStatsPeriod) return;
+	headlessStatsClock.start(true);
+
+	// latest state published by the haptic thread
+	hapticFrame.update();
+	const HapticFrameState& frame = hapticFrame.get();
+
+	double rate = freqCounterHaptics.getFrequency();
+	headlessRateSum += rate;
+	headlessRateSum2 += rate * rate;
+	headlessRateCount++;
+
+	std::cout << "haptics " << cStr(rate, 0) << " Hz"
+		<< "  S2M delay " << cStr(frame.delay, 3) << " ms"
+		<< "  overruns " << hapticsThread->getOverrunCount()
+		<< "  jitter p99 " << cStr(1e6 * hapticsThread->getJitterPercentile(0.99), 0) << " us"
+		<< "  force " << cStr(frame.masterForce.length(), 3) << " N"
+		<< "  video " << cStr(headlessVideoFrames / period, 1) << " fps"
+		<< "  lost " << headlessVideoLost << std::endl;
+	headlessVideoFrames = 0;
+	headlessVideoLost = 0;
+}
+
+//------------------------------------------------------------------------------
+
+void writeBenchmark(double runTime)
+{
+	benchmarkTotals.update();
+	const BenchmarkTotals& totals = benchmarkTotals.get();
+
+	double rateMean = headlessRateCount ? headlessRateSum / headlessRateCount : 0.0;
+	double rateVariance = headlessRateCount ? headlessRateSum2 / headlessRateCount - rateMean * rateMean : 0.0;
+
+	// parameters of the run, then its results
+	BenchmarkReport report;
+	report.Add("process", "master");
+	report.Add("algorithm", Algorithm);
+	report.Add("delay", CommandDelay);
+	report.Add("dynamicDelay", DynamicDelay);
+	report.Add("lossRate", PacketLossRate);
+	report.Add("positionDeadband", PositionDeadbandParameter);
+	report.Add("velocityDeadband", VelocityDeadbandParameter);
+	report.Add("orientationDeadband", OrientationDeadbandParameter);
+	report.Add("virtualDevice", VirtualDevice);
+	report.Add("duration", runTime);
+	report.Add("hapticRate", rateMean);
+	report.Add("hapticRateStd", sqrt(cMax(0.0, rateVariance)));
+	report.Add("overruns", hapticsThread->getOverrunCount());
+	report.Add("jitterP99us", 1e6 * hapticsThread->getJitterPercentile(0.99));
+	report.Add("delayMeanMs", totals.feedbacks ? totals.delaySum / totals.feedbacks : 0.0);
+	report.Add("rttMeanMs", totals.rttCount ? totals.rttSum / totals.rttCount : 0.0);
+	report.Add("rttMaxMs", totals.rttMax);
+	report.Add("sentPerSecond", sender->sentCount / runTime);
+	report.Add("droppedPerSecond", sender->droppedCount / runTime);
+	report.Add("receivedPerSecond", totals.received / runTime);
+	report.Add("cpu", GetProcessCPUSeconds() / runTime);
+	report.Add("forceErrorRms", totals.errorCount ? sqrt(totals.forceError2 / totals.errorCount) : 0.0);
+	report.Add("positionErrorRms", totals.errorCount ? sqrt(totals.positionError2 / totals.errorCount) : 0.0);
+
+	if (report.Append(BenchmarkFile))
+		std::cout << "> Appended benchmark summary to " << BenchmarkFile << std::endl;
+	else
+		std::cout << "error - failed to write " << BenchmarkFile << std::endl;
+}
@@ -58,6 +58,21 @@
 
 #include "HapticCommLib.h"
 
+#include <fstream>
+#include <sstream>
+#include <time.h>
+#ifdef _WIN32
+#include <windows.h>
+#else
+#include <fcntl.h>
+#include <stdint.h>
+#include <sys/mman.h>
+#include <unistd.h>
+#endif
+
+// the columns of a session file start on a page boundary after the header
+static const size_t SessionDataOffset = 4096;
+
 /***************** DeadbandDataReduction ********************/
 /**
 *	This function initializes the haptic data reduction related parameters
@@ -194,4 +209,579 @@ void KalmanFilter::ApplyKalmanFilter(double* CurrentSample) {
 	
 	}
 
-}
\ No newline at end of file
+}
+
+
+/***************** CompressQuaternion ***********************/
+/**
+*	This function compresses a rotation quaternion with the
+*   smallest-three method. q and -q are the same rotation, so the
+*   largest component is made positive and dropped; the remaining
+*   three lie in [-1/sqrt(2), 1/sqrt(2)] and are quantized to 20 bits.
+*	@param needs the quaternion to compress
+* 	@date 18/10/2026
+*/
+unsigned long long CompressQuaternion(const chai3d::cQuaternion& q){
+
+	const double range = 1.0 / sqrt(2.0);
+	const unsigned long long steps = (1ULL << 20) - 1;
+
+	double c[4] = { q.w, q.x, q.y, q.z };
+	double norm = sqrt(c[0]*c[0] + c[1]*c[1] + c[2]*c[2] + c[3]*c[3]);
+	if (norm < 1e-12) {
+		// degenerate input, transmit the identity rotation
+		c[0] = 1.0; c[1] = 0.0; c[2] = 0.0; c[3] = 0.0;
+		norm = 1.0;
+	}
+
+	// find the largest component
+	unsigned int largest = 0;
+	for (unsigned int i = 1; i < 4; i++) {
+		if (fabs(c[i]) > fabs(c[largest])) largest = i;
+	}
+	double sign = (c[largest] < 0.0) ? -1.0 : 1.0;
+
+	unsigned long long code = (unsigned long long)largest << 60;
+	int shift = 40;
+	for (unsigned int i = 0; i < 4; i++) {
+		if (i == largest) continue;
+		double v = sign * c[i] / norm;
+		if (v > range) v = range;
+		if (v < -range) v = -range;
+		unsigned long long quantized = (unsigned long long)floor((v + range) / (2.0 * range) * steps + 0.5);
+		code |= quantized << shift;
+		shift -= 20;
+	}
+
+	return code;
+
+}
+
+/***************** DecompressQuaternion *********************/
+/**
+*	This function restores a unit quaternion from its
+*   smallest-three code. The dropped component is recovered
+*   from the unit norm constraint.
+*	@param needs the compressed quaternion
+* 	@date 18/10/2026
+*/
+chai3d::cQuaternion DecompressQuaternion(unsigned long long code){
+
+	const double range = 1.0 / sqrt(2.0);
+	const unsigned long long steps = (1ULL << 20) - 1;
+
+	unsigned int largest = (unsigned int)((code >> 60) & 0x3);
+	double c[4];
+	double sum = 0.0;
+	int shift = 40;
+	for (unsigned int i = 0; i < 4; i++) {
+		if (i == largest) continue;
+		unsigned long long quantized = (code >> shift) & steps;
+		c[i] = (double)quantized / steps * (2.0 * range) - range;
+		sum += c[i] * c[i];
+		shift -= 20;
+	}
+	c[largest] = sqrt(fmax(0.0, 1.0 - sum));
+
+	chai3d::cQuaternion q(c[0], c[1], c[2], c[3]);
+	q.normalize();
+	return q;
+
+}
+
+
+/***************** OrientationDeadbandDataReduction *********/
+/**
+*	This function initializes the orientation data reduction
+*   related parameters
+*	@param deadband angle in degrees
+* 	@date 18/10/2026
+*/
+OrientationDeadbandDataReduction::OrientationDeadbandDataReduction(double db) {
+
+	DeadbandParameter = db * chai3d::C_PI / 180.0;
+	// a zero quaternion is 180 degrees away from every rotation, so the first sample is always transmitted
+	PreviousSample.zero();
+	PreviousCode = 0;
+	GeodesicAngle = 0.0;
+
+}
+
+/***************** ~OrientationDeadbandDataReduction ********/
+/**
+*	This function cleans safely the orientation data reduction
+*   related parameters
+*	@param no need to give any input
+* 	@date 18/10/2026
+*/
+OrientationDeadbandDataReduction::~OrientationDeadbandDataReduction() {
+
+	printf("closing orientation deadband class\n");
+
+}
+
+/***************** GetCurrentSample *************************/
+/**
+*	This function gets the recently captured rotation matrix
+*   and converts it into a unit quaternion
+*	@param needs the current rotation matrix
+* 	@date 18/10/2026
+*/
+void OrientationDeadbandDataReduction::GetCurrentSample(const chai3d::cMatrix3d& Sample){
+
+	CurrentSample.fromRotMat(Sample);
+	CurrentSample.normalize();
+
+}
+
+/***************** ApplyZOHDeadband *************************/
+/**
+*	This function applies the perceptual deadband on the
+*   geodesic angle between the current and the recently
+*   transmitted orientation. If no-transmission is decided,
+*   the code of the recent transmitted sample is kept (ZOH).
+*	@param needs pointers for the compressed sample and transmission flag
+* 	@date 18/10/2026
+*/
+void OrientationDeadbandDataReduction::ApplyZOHDeadband(unsigned long long* updatedSample,bool* TransmitFlag){
+
+	// Compute the rotation angle between recently transmitted and current orientation
+	double d = fabs(CurrentSample.dot(PreviousSample));
+	if (d > 1.0) d = 1.0;
+	GeodesicAngle = 2.0 * acos(d);
+
+	// Check whether the angle is above the perceptual threshold
+	if (GeodesicAngle >= DeadbandParameter) {
+
+		// Transmit the current signal
+		*TransmitFlag = true;
+		PreviousSample = CurrentSample;
+		PreviousCode = CompressQuaternion(CurrentSample);
+
+	}else {
+
+		// Do not transmit the current signal
+		*TransmitFlag = false;
+
+	}
+
+	*updatedSample = PreviousCode;
+
+}
+
+
+/***************** OrientationReconstruction ****************/
+/**
+*	This function initializes the receiver side orientation
+*   reconstruction
+*	@param number of samples to blend towards a new orientation
+* 	@date 18/10/2026
+*/
+OrientationReconstruction::OrientationReconstruction(int length) {
+
+	SlerpLength = (length > 0) ? length : 1;
+	StartSample = chai3d::cQuaternion(1.0, 0.0, 0.0, 0.0);
+	TargetSample = StartSample;
+	CurrentEstimation = StartSample;
+	LastCode = 0;
+	SlerpIndex = 0;
+	Initialized = false;
+
+}
+
+OrientationReconstruction::~OrientationReconstruction() {
+
+
+
+
+}
+
+/***************** GetReceivedSample ************************/
+/**
+*	This function gets the recently received orientation code.
+*   A code different from the previous one means the sender
+*   deadband was triggered and a new SLERP segment is started.
+*	@param needs the compressed orientation
+* 	@date 18/10/2026
+*/
+void OrientationReconstruction::GetReceivedSample(unsigned long long code){
+
+	if (Initialized && code == LastCode) return;
+
+	LastCode = code;
+	TargetSample = DecompressQuaternion(code);
+
+	if (!Initialized) {
+		// nothing displayed yet, jump to the first received orientation
+		CurrentEstimation = TargetSample;
+		SlerpIndex = SlerpLength;
+		Initialized = true;
+	}
+	else {
+		StartSample = CurrentEstimation;
+		SlerpIndex = 0;
+	}
+
+}
+
+/***************** ApplySlerpReconstruction *****************/
+/**
+*	This function moves the displayed orientation along the
+*   shortest arc towards the recently received orientation,
+*   which avoids the torque and visual jumps of a pure ZOH.
+*	@param needs the rotation matrix to update
+* 	@date 18/10/2026
+*/
+void OrientationReconstruction::ApplySlerpReconstruction(chai3d::cMatrix3d& updatedSample){
+
+	if (SlerpIndex < SlerpLength) {
+		SlerpIndex++;
+		CurrentEstimation.slerp((double)SlerpIndex / SlerpLength, StartSample, TargetSample);
+		CurrentEstimation.normalize();
+	}
+	else {
+		CurrentEstimation = TargetSample;
+	}
+
+	CurrentEstimation.toRotMat(updatedSample);
+
+}
+
+/***************** FillVideoTestPattern *********************/
+/**
+*	This function draws a frame of the software test pattern:
+*   eight colour bars scrolling by one pixel per frame. The
+*   frame counter is stored in the RGBA bytes of the first pixel.
+*	@param needs the RGBA image, its size and the frame counter
+* 	@date 18/10/2026
+*/
+void FillVideoTestPattern(unsigned char* rgba, int width, int height, unsigned int frame){
+
+	static const unsigned char Bars[8][3] = { { 255, 255, 255 }, { 255, 255, 0 }, { 0, 255, 255 }, { 0, 255, 0 },
+		{ 255, 0, 255 }, { 255, 0, 0 }, { 0, 0, 255 }, { 0, 0, 0 } };
+
+	int barWidth = width / 8 > 0 ? width / 8 : 1;
+	for (int x = 0; x < width; x++) {
+		const unsigned char* color = Bars[((x + frame) / barWidth) % 8];
+		for (int y = 0; y < height; y++) {
+			unsigned char* pixel = rgba + 4 * (y * width + x);
+			pixel[0] = color[0];
+			pixel[1] = color[1];
+			pixel[2] = color[2];
+			pixel[3] = 255;
+		}
+	}
+
+	rgba[0] = (unsigned char)(frame & 0xFF);
+	rgba[1] = (unsigned char)((frame >> 8) & 0xFF);
+	rgba[2] = (unsigned char)((frame >> 16) & 0xFF);
+	rgba[3] = (unsigned char)((frame >> 24) & 0xFF);
+
+}
+
+/***************** ReadVideoTestPatternFrame ****************/
+/**
+*	This function returns the frame counter of a test pattern frame
+*	@param needs the RGBA image
+* 	@date 18/10/2026
+*/
+unsigned int ReadVideoTestPatternFrame(const unsigned char* rgba){
+
+	return (unsigned int)rgba[0] | ((unsigned int)rgba[1] << 8) | ((unsigned int)rgba[2] << 16) | ((unsigned int)rgba[3] << 24);
+
+}
+
+/***************** GetProcessCPUSeconds *********************/
+/**
+*	This function returns the CPU time consumed by the process,
+*   in user and kernel mode, summed over all of its threads
+* 	@date 18/10/2026
+*/
+double GetProcessCPUSeconds(){
+
+#ifdef _WIN32
+	FILETIME creationTime, exitTime, kernelTime, userTime;
+	if (!GetProcessTimes(GetCurrentProcess(), &creationTime, &exitTime, &kernelTime, &userTime))
+		return 0.0;
+	ULARGE_INTEGER kernel, user;
+	kernel.LowPart = kernelTime.dwLowDateTime;
+	kernel.HighPart = kernelTime.dwHighDateTime;
+	user.LowPart = userTime.dwLowDateTime;
+	user.HighPart = userTime.dwHighDateTime;
+	return (double)(kernel.QuadPart + user.QuadPart) * 1e-7; // 100 ns units
+#else
+	return (double)clock() / CLOCKS_PER_SEC;
+#endif
+
+}
+
+/***************** BenchmarkReport **************************/
+/**
+*	This function adds a numeric column to the row
+*	@param needs the column name and its value
+* 	@date 18/10/2026
+*/
+void BenchmarkReport::Add(const std::string& name, double value){
+
+	std::ostringstream text;
+	text.precision(9);
+	text << value;
+	Add(name, text.str());
+
+}
+
+/***************** BenchmarkReport **************************/
+/**
+*	This function adds a text column to the row
+*	@param needs the column name and its value
+* 	@date 18/10/2026
+*/
+void BenchmarkReport::Add(const std::string& name, const std::string& value){
+
+	Names.push_back(name);
+	Values.push_back(value);
+
+}
+
+/***************** BenchmarkReport **************************/
+/**
+*	This function appends the row to a CSV file. The header line
+*   is written when the file is new or empty, so successive runs
+*   accumulate in one table.
+*	@param needs the file name
+*   @return false if the file could not be written
+* 	@date 18/10/2026
+*/
+bool BenchmarkReport::Append(const std::string& fileName) const{
+
+	bool empty = true;
+	std::ifstream existing(fileName.c_str());
+	if (existing.is_open())
+		empty = (existing.peek() == std::ifstream::traits_type::eof());
+	existing.close();
+
+	std::ofstream file(fileName.c_str(), std::ios::app);
+	if (!file.is_open())
+		return false;
+
+	if (empty) {
+		for (size_t i = 0; i < Names.size(); i++)
+			file << (i ? "," : "") << Names[i];
+		file << std::endl;
+	}
+	for (size_t i = 0; i < Values.size(); i++)
+		file << (i ? "," : "") << Values[i];
+	file << std::endl;
+
+	return file.good();
+
+}
+
+/***************** SessionRecorder **************************/
+/**
+*	This function initializes a closed recorder
+* 	@date 18/10/2026
+*/
+SessionRecorder::SessionRecorder(){
+
+	Header = NULL;
+	Data = NULL;
+	Dropped = 0;
+	MappedSize = 0;
+	FileHandle = NULL;
+	MappingHandle = NULL;
+	memset(Row, 0, sizeof(Row));
+
+}
+
+SessionRecorder::~SessionRecorder(){
+
+	Close();
+
+}
+
+/***************** SessionRecorder **************************/
+/**
+*	This function creates the session file with room for capacity
+*   rows, maps it and touches every page, so that recording never
+*   waits for the file system or a page fault
+*	@param needs the file name, the column names and the number of rows
+*   @return false if the file could not be created
+* 	@date 18/10/2026
+*/
+bool SessionRecorder::Open(const char* fileName, const char* const* names, int columns, unsigned long long capacity){
+
+	Close();
+	if (columns <= 0 || columns > 64 || capacity == 0)
+		return false;
+
+	MappedSize = SessionDataOffset + (size_t)(columns * capacity * sizeof(double));
+	void* view = NULL;
+
+#ifdef _WIN32
+	HANDLE file = CreateFileA(fileName, GENERIC_READ | GENERIC_WRITE, FILE_SHARE_READ, NULL, CREATE_ALWAYS, FILE_ATTRIBUTE_NORMAL, NULL);
+	if (file == INVALID_HANDLE_VALUE)
+		return false;
+	HANDLE mapping = CreateFileMappingA(file, NULL, PAGE_READWRITE, (DWORD)((unsigned long long)MappedSize >> 32), (DWORD)(MappedSize & 0xFFFFFFFF), NULL);
+	if (mapping != NULL)
+		view = MapViewOfFile(mapping, FILE_MAP_ALL_ACCESS, 0, 0, MappedSize);
+	if (view == NULL) {
+		if (mapping != NULL) CloseHandle(mapping);
+		CloseHandle(file);
+		return false;
+	}
+	FileHandle = file;
+	MappingHandle = mapping;
+#else
+	int file = open(fileName, O_RDWR | O_CREAT | O_TRUNC, 0644);
+	if (file < 0)
+		return false;
+	if (ftruncate(file, (off_t)MappedSize) == 0)
+		view = mmap(NULL, MappedSize, PROT_READ | PROT_WRITE, MAP_SHARED, file, 0);
+	if (view == NULL || view == MAP_FAILED) {
+		close(file);
+		return false;
+	}
+	FileHandle = (void*)(intptr_t)file;
+#endif
+
+	// touching the whole mapping now moves the page faults out of the haptic loop
+	memset(view, 0, MappedSize);
+
+	Header = (SessionFileHeader*)view;
+	memcpy(Header->Magic, "HAPTREC", 8);
+	Header->Version = 1;
+	Header->Columns = columns;
+	Header->Capacity = capacity;
+	Header->Rows = 0;
+	for (int i = 0; i < columns; i++)
+		strncpy(Header->Names[i], names[i], sizeof(Header->Names[i]) - 1);
+
+	Data = (double*)((char*)view + SessionDataOffset);
+	Dropped = 0;
+	memset(Row, 0, sizeof(Row));
+	return true;
+
+}
+
+/***************** SessionRecorder **************************/
+/**
+*	This function unmaps and closes the session file
+* 	@date 18/10/2026
+*/
+void SessionRecorder::Close(){
+
+	if (Header == NULL)
+		return;
+
+#ifdef _WIN32
+	UnmapViewOfFile(Header);
+	CloseHandle((HANDLE)MappingHandle);
+	CloseHandle((HANDLE)FileHandle);
+#else
+	munmap(Header, MappedSize);
+	close((int)(intptr_t)FileHandle);
+#endif
+
+	Header = NULL;
+	Data = NULL;
+	FileHandle = NULL;
+	MappingHandle = NULL;
+
+}
+
+/***************** SessionRecorder **************************/
+/**
+*	This function copies the current row into its column slots
+*   and publishes it by incrementing the row count. Columns keep
+*   their value until they are set again.
+* 	@date 18/10/2026
+*/
+void SessionRecorder::Commit(){
+
+	if (Data == NULL)
+		return;
+
+	unsigned long long row = Header->Rows;
+	if (row >= Header->Capacity) {
+		Dropped++;
+		return;
+	}
+
+	unsigned long long capacity = Header->Capacity;
+	unsigned int columns = Header->Columns;
+	for (unsigned int i = 0; i < columns; i++)
+		Data[i * capacity + row] = Row[i];
+	Header->Rows = row + 1;
+
+}
+
+/***************** SessionRecorder **************************/
+/**
+*	This function converts a session file into a CSV file with
+*   one line per row, or into a NumPy .npy file holding a
+*   structured array with one named float64 field per column
+*	@param needs the session file name and the output file name
+*   @return false if the session could not be read or the output written
+* 	@date 18/10/2026
+*/
+bool SessionRecorder::Convert(const char* sessionName, const char* outputName){
+
+	std::ifstream session(sessionName, std::ios::binary);
+	SessionFileHeader header;
+	if (!session.read((char*)&header, sizeof(header)) || memcmp(header.Magic, "HAPTREC", 8) != 0 || header.Columns > 64)
+		return false;
+
+	unsigned long long rows = header.Rows;
+	std::vector<double> data((size_t)(header.Columns * rows));
+	for (unsigned int c = 0; c < header.Columns; c++) {
+		session.seekg(SessionDataOffset + c * header.Capacity * sizeof(double));
+		if (rows && !session.read((char*)&data[(size_t)(c * rows)], rows * sizeof(double)))
+			return false;
+	}
+
+	std::string output(outputName);
+	bool numpy = output.size() > 4 && output.compare(output.size() - 4, 4, ".npy") == 0;
+	std::ofstream file(outputName, numpy ? std::ios::binary : std::ios::out);
+	if (!file.is_open())
+		return false;
+
+	if (numpy) {
+		std::ostringstream dict;
+		dict << "{'descr': [";
+		for (unsigned int c = 0; c < header.Columns; c++)
+			dict << (c ? ", " : "") << "('" << header.Names[c] << "', '<f8')";
+		dict << "], 'fortran_order': False, 'shape': (" << rows << ",), }";
+
+		// version 1.0 header, padded with spaces so that the data starts on a multiple of 64 bytes
+		std::string text = dict.str();
+		size_t length = 10 + text.size() + 1;
+		text.append((64 - length % 64) % 64, ' ');
+		text.push_back('\n');
+		unsigned short headerLength = (unsigned short)text.size();
+		file.write("\x93NUMPY\x01\x00", 8);
+		file.write((const char*)&headerLength, 2);
+		file << text;
+
+		std::vector<double> record(header.Columns);
+		for (unsigned long long r = 0; r < rows; r++) {
+			for (unsigned int c = 0; c < header.Columns; c++)
+				record[c] = data[(size_t)(c * rows + r)];
+			file.write((const char*)record.data(), header.Columns * sizeof(double));
+		}
+	}
+	else {
+		for (unsigned int c = 0; c < header.Columns; c++)
+			file << (c ? "," : "") << header.Names[c];
+		file << "\n";
+		file.precision(9);
+		for (unsigned long long r = 0; r < rows; r++) {
+			for (unsigned int c = 0; c < header.Columns; c++)
+				file << (c ? "," : "") << data[(size_t)(c * rows + r)];
+			file << "\n";
+		}
+	}
+
+	return file.good();
+
+}
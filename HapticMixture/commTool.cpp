@@ -12,7 +12,7 @@
 #include <mutex>
 #include <memory>
 #include <condition_variable>
-enum AlgorithmType {AT_None, AT_TDPA, AT_ISS, AT_MMT, AT_KEEP };
+#include "hapticAlgorithm.h"
 
 struct hapticMessageM2S {
 	__int64 time;
@@ -20,8 +20,8 @@ struct hapticMessageM2S {
 	// position, cVector3d contains 3 double values
 	double position[3];
 
-	// orientation, cMatrix3d contains 3 double values
-	double rotation[9];
+	// orientation, smallest-three compressed quaternion (see CompressQuaternion in HapticCommLib)
+	unsigned __int64 rotation;
 
 	// gripper position
 	double gripperAngle;
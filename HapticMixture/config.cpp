@@ -64,6 +64,8 @@ void ConfigFile::extractContents(const std::string &line)
 
 	if (!keyExists(key))
 		contents.insert(std::pair<std::string, std::string>(key, value));
+	else if (replaceKeys)
+		contents[key] = value;
 	else
 		exitWithError("CFG: Can only have unique key names!\n");
 }
@@ -109,7 +111,17 @@ void ConfigFile::ExtractKeys()
 ConfigFile::ConfigFile(const std::string &fName)
 {
 	this->fName = fName;
+	replaceKeys = false;
 	ExtractKeys();
+
+	// the keys of the file named by HAPTIC_CONFIG replace those of fName,
+	// so that scripted runs only list the parameters they vary
+	const char* overrideName = getenv("HAPTIC_CONFIG");
+	if (overrideName != NULL && overrideName[0] != '\0') {
+		this->fName = overrideName;
+		replaceKeys = true;
+		ExtractKeys();
+	}
 }
 
 bool ConfigFile::keyExists(const std::string &key) const
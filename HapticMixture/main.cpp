@@ -63,6 +63,7 @@ ConfigFile cfg("cfg/config.cfg"); // get the configuration file
 namespace Master {
 	double VelocityDeadbandParameter = cfg.getValueOfKey<double>("VelocityDeadbandParameter"); //deadband parameter for velcity data reduction, 0.1 is the default value
 	double PositionDeadbandParameter = cfg.getValueOfKey<double>("PositionDeadbandParameter"); //deadband parameter for position data reduction, 0.1 is the default value
+	double OrientationDeadbandParameter = cfg.getValueOfKey<double>("OrientationDeadbandParameter"); //deadband angle in degrees for orientation data reduction
 
 	int FlagVelocityKalmanFilter = cfg.getValueOfKey<int>("FlagVelocityKalmanFilter"); // 0: Kalman filter disabled 1: Kalman filter enabled on velocity signal
 	KalmanFilter VelocityKalmanFilter; // applies 3 DoF kalman filtering to remove noise from velocity signal																				   
@@ -71,9 +72,12 @@ namespace Master {
 
 	DeadbandDataReduction* DBVelocity; // data reduction class for velocity samples
 	DeadbandDataReduction* DBPosition; // data reduction class for position samples
+	OrientationDeadbandDataReduction* DBOrientation; // data reduction class for orientation samples
 
 	bool VelocityTransmitFlag = false; // true: deadband triger false: keep last recently transmitted sample (ZoH)
 	bool PositionTransmitFlag = false; // true: deadband triger false: keep last recently transmitted sample (ZoH)
+	bool OrientationTransmitFlag = false; // true: deadband triger false: keep last recently transmitted sample (ZoH)
+	unsigned long long MasterOrientation = 0; // compressed master orientation sample (holds the signal after deadband)
 
 	double MasterForce[3] = { 0.0, 0.0, 0.0 };
 	double MasterVelocity[3] = { 0.0, 0.0, 0.0 }; // update 3 DoF master velocity sample (holds the signal before deadband)
@@ -81,8 +85,7 @@ namespace Master {
 
 	AlgorithmType ATypeChange = AlgorithmType::AT_None;
 
-	TDPA_Algorithm TDPA;
-	ISS_Algorithm ISS;
+	TeleoperationController<3> Controller; // master side control algorithms, one of them is active
 
 	SOCKET sServer;
 	double delay = 0;
@@ -97,9 +100,11 @@ namespace Slave {
 	double ForceDeadbandParameter = cfg.getValueOfKey<double>("ForceDeadbandParameter"); //deadband parameter for force data reduction, 0.1 is the default value
 
 	int ControlMode = cfg.getValueOfKey<int>("ControlMode"); // 0: position control, 1:velocity control
+	int OrientationSlerpLength = cfg.getValueOfKey<int>("OrientationSlerpLength", 10); // number of samples to blend towards a newly received orientation
 
 	DeadbandDataReduction* DBForce; // data reduction class for force samples
 	bool ForceTransmitFlag = false; // true: deadband triger false: keep last recently transmitted sample (ZoH)
+	OrientationReconstruction* RotReconstruction; // SLERP reconstruction of the deadband coded orientation
 
 	//------------------------------------------------------------------------------
 	// TDPA variable and function realted code
@@ -110,7 +115,7 @@ namespace Slave {
 	double MasterVelocity[3] = { 0.0, 0.0, 0.0 }; // update 3 DoF master velocity sample (holds the signal before deadband)
 	double MasterPosition[3] = { 0.0, 0.0, 0.0 }; // update 3 DoF master position sample (holds the signal before deadband)
 	double MasterForce[3] = { 0.0,0.0,0.0 };  // current 3 DoF force sample
-	TDPA_Algorithm TDPA;
+	TeleoperationController<3> Controller; // slave side control algorithms, follows the master selection
 
 	SOCKET sServer;
 	double delay = 0;
@@ -372,7 +377,9 @@ int main(int argc, char* argv[])
 	// initialized deadband classes for force and velocity
 	Master::DBVelocity = new DeadbandDataReduction(Master::VelocityDeadbandParameter);
 	Master::DBPosition = new DeadbandDataReduction(Master::PositionDeadbandParameter);
+	Master::DBOrientation = new OrientationDeadbandDataReduction(Master::OrientationDeadbandParameter);
 	Slave::DBForce = new DeadbandDataReduction(Slave::ForceDeadbandParameter);
+	Slave::RotReconstruction = new OrientationReconstruction(Slave::OrientationSlerpLength);
 
 	QueryPerformanceFrequency(&cpuFreq);
 	sockVersion = MAKEWORD(2, 2);
@@ -514,7 +521,8 @@ int main(int argc, char* argv[])
 	double maxStiffness = hapticDeviceInfo.m_maxLinearStiffness / workspaceScaleFactor;
 
 	//120 is maxStiffness
-	Master::ISS.mu_max = maxStiffness * Master::ISS.stiff_factor;
+	Master::Controller.ISS().mu_max = maxStiffness * Master::Controller.ISS().stiff_factor;
+	Master::Controller.ISS().mu_factor = 1.7;
 
 	world->setGravity(0.0, 0.0, -9.8);
 
@@ -856,24 +864,18 @@ void keyCallback(GLFWwindow* a_window, int a_key, int a_scancode, int a_action,
 
 	else if (a_key == GLFW_KEY_I) {
 		std::cout << "ISS enabled" << std::endl;
-		Master::ISS.ISS_enabled = true;
-		Master::ISS.Initialize();
+		Master::Controller.Select(AlgorithmType::AT_ISS);
 		Master::ATypeChange = AlgorithmType::AT_ISS;
-
-		Master::TDPA.TDPAon = false;
 	}
 	else if (a_key == GLFW_KEY_T) {
 		std::cout << "TDPA enabled" << std::endl;
-		Master::TDPA.TDPAon = true;
-		Master::TDPA.Initialize();
+		Master::Controller.Select(AlgorithmType::AT_TDPA);
 		Master::ATypeChange = AlgorithmType::AT_TDPA;
-
-		Master::ISS.ISS_enabled = false;
 	}
 	else if (a_key == GLFW_KEY_N) {
 		std::cout << "None enabled" << std::endl;
-		Master::TDPA.TDPAon = false;
-		Master::ISS.ISS_enabled = false;
+		Master::Controller.Select(AlgorithmType::AT_None);
+		Master::ATypeChange = AlgorithmType::AT_None;
 	}
 	else if (a_key = GLFW_KEY_R) {
 		world->setHapticEnabled(!world->getHapticEnabled());
@@ -982,20 +984,16 @@ inline void MasterUpdate() {
 	if (Master::PositionTransmitFlag == true) {
 	}
 
+	// Apply deadband on orientation
+	Master::DBOrientation->GetCurrentSample(rotation);
+	Master::DBOrientation->ApplyZOHDeadband(&Master::MasterOrientation, &Master::OrientationTransmitFlag);
+
 	// Apply deadband on velocity
 	Master::DBVelocity->GetCurrentSample(Master::MasterVelocity);
 	Master::DBVelocity->ApplyZOHDeadband(Master::MasterVelocity, &Master::VelocityTransmitFlag);
 
-	Master::ISS.VelocityRevise(Master::MasterVelocity);
-
-	if (Master::VelocityTransmitFlag == true) {
-		memcpy(Master::TDPA.E_trans, Master::TDPA.E_in, 3*sizeof(double));
-		memcpy(Master::TDPA.E_in_last, Master::TDPA.E_in, 3 * sizeof(double));
-	}
-	else
-	{
-		memcpy(Master::TDPA.E_trans, Master::TDPA.E_in_last, 3 * sizeof(double));
-	}
+	Master::Controller.MasterCommandRevise(Master::MasterVelocity);
+	Master::Controller.TDPA().UpdateTransmitEnergy(Master::VelocityTransmitFlag);
 
 #pragma region create message and send it
 	/////////////////////////////////////////////////////////////////////
@@ -1007,10 +1005,8 @@ inline void MasterUpdate() {
 		msgM2S.position[i] = Master::MasterVelocity[i];//modified by TDPA 
 		msgM2S.linearVelocity[i] = Master::MasterVelocity[i];//modified by TDPA 
 		msgM2S.angularVelocity[i] = angularVelocity(i);
-		msgM2S.rotation[i] = rotation.getCol0()(i);
-		msgM2S.rotation[i + 3] = rotation.getCol1()(i);
-		msgM2S.rotation[i + 6] = rotation.getCol2()(i);
 	}
+	msgM2S.rotation = Master::MasterOrientation;
 	msgM2S.gripperAngle = gripperAngle;
 	msgM2S.gripperAngularVelocity = gripperAngularVelocity;
 	msgM2S.button0 = button0;
@@ -1018,7 +1014,7 @@ inline void MasterUpdate() {
 	msgM2S.button2 = button2;
 	msgM2S.button3 = button3;
 	msgM2S.userSwitches = allSwitches;
-	memcpy(msgM2S.energy, Master::TDPA.E_trans, 3 * sizeof(double));//modified by TDPA 
+	memcpy(msgM2S.energy, Master::Controller.TDPA().E_trans, 3 * sizeof(double));//modified by TDPA 
 	__int64 curtime;
 	QueryPerformanceCounter((LARGE_INTEGER *)&curtime);
 	msgM2S.time = curtime;
@@ -1074,8 +1070,7 @@ inline void MasterUpdate() {
 		//get force and energy from Slave2Master message
 		memcpy(Master::MasterForce, msgS2M.force, 3 * sizeof(double));
 
-		memcpy(Master::TDPA.E_recv, msgS2M.energy, 3 * sizeof(double));
-		Master::TDPA.ForceRevise(Master::MasterVelocity, Master::MasterForce);
+		memcpy(Master::Controller.TDPA().E_recv, msgS2M.energy, 3 * sizeof(double));
 
 		//orce filter (use dot(f) and tau)
 		if (Master::FlagForceKalmanFilter)
@@ -1084,7 +1079,7 @@ inline void MasterUpdate() {
 			Master::MasterForce[2] = Master::ForceKalmanFilter.CurrentEstimation[2];
 		}
 
-		Master::ISS.ForceRevise(Master::MasterForce);
+		Master::Controller.MasterFeedbackRevise(Master::MasterVelocity, Master::MasterForce);
 
 		cVector3d force(Master::MasterForce[0], Master::MasterForce[1], Master::MasterForce[2] - Master::MasterVelocity[2] * 0.15);
 		cVector3d torque(msgS2M.torque[0], msgS2M.torque[1], msgS2M.torque[2]);
@@ -1143,10 +1138,9 @@ inline void SlaveUpdate() {
 		cVector3d position(msgM2S.position[0], msgM2S.position[1], msgM2S.position[2]);
 
 		// read orientation 
-		cVector3d col0(msgM2S.rotation[0], msgM2S.rotation[1], msgM2S.rotation[2]);
-		cVector3d col1(msgM2S.rotation[3], msgM2S.rotation[4], msgM2S.rotation[5]);
-		cVector3d col2(msgM2S.rotation[6], msgM2S.rotation[7], msgM2S.rotation[8]);
-		cMatrix3d rotation(col0, col1, col2);
+		cMatrix3d rotation;
+		Slave::RotReconstruction->GetReceivedSample(msgM2S.rotation);
+		Slave::RotReconstruction->ApplySlerpReconstruction(rotation);
 
 		// read gripper position
 		double gripperAngle = msgM2S.gripperAngle;
@@ -1169,29 +1163,11 @@ inline void SlaveUpdate() {
 		button2 = msgM2S.button2;
 		button3 = msgM2S.button3;
 
-		switch (msgM2S.ATypeChange) {
-		case AlgorithmType::AT_None:
-			Slave::TDPA.TDPAon = false;
-			break;
-		case AlgorithmType::AT_TDPA:
-			Slave::TDPA.TDPAon = true;
-			Slave::TDPA.Initialize();
-			break;
-		case AlgorithmType::AT_ISS:
-			Slave::TDPA.TDPAon = false;
-			break;
-		case AlgorithmType::AT_MMT:
-			Slave::TDPA.TDPAon = false;
-			break;
-		case AlgorithmType::AT_KEEP:
-			break;
-		}
-
-
+		Slave::Controller.Select(msgM2S.ATypeChange);
 
 		memcpy(Slave::MasterVelocity, msgM2S.linearVelocity, 3 * sizeof(double));
-		memcpy(Slave::TDPA.E_recv, msgM2S.energy, 3 * sizeof(double));
-		Slave::TDPA.VelocityRevise(Slave::MasterVelocity, Slave::SlaveForce);
+		memcpy(Slave::Controller.TDPA().E_recv, msgM2S.energy, 3 * sizeof(double));
+		Slave::Controller.SlaveCommandRevise(Slave::MasterVelocity, Slave::SlaveForce);
 
 		if (Slave::ControlMode == 1) { // if velocity control mode is selected
 								// Compute tool position using delayed velocity signal
@@ -1246,14 +1222,8 @@ inline void SlaveUpdate() {
 		Slave::DBForce->GetCurrentSample(Slave::MasterForce); // pass the current sample for DB data reduction
 		Slave::DBForce->ApplyZOHDeadband(Slave::MasterForce, &Slave::ForceTransmitFlag); // apply DB data reduction
 
-		if (Slave::ForceTransmitFlag == true) {
-			memcpy(Slave::TDPA.E_trans, Slave::TDPA.E_in, 3 * sizeof(double));
-			memcpy(Slave::TDPA.E_in_last, Slave::TDPA.E_in, 3 * sizeof(double));
-		}
-		else
-		{
-			memcpy(Slave::TDPA.E_trans, Slave::TDPA.E_in_last, 3 * sizeof(double));
-		}
+		Slave::Controller.SlaveFeedbackRevise(Slave::SlaveForce);
+		Slave::Controller.TDPA().UpdateTransmitEnergy(Slave::ForceTransmitFlag);
 
 		/////////////////////////////////////////////////////////////////////
 		// Send Forces
@@ -1264,7 +1234,7 @@ inline void SlaveUpdate() {
 			msgS2M.torque[i] = torque(i);
 		}
 		msgS2M.gripperForce = gripperForce;
-		memcpy(msgS2M.energy, Slave::TDPA.E_trans, 3 * sizeof(double));
+		memcpy(msgS2M.energy, Slave::Controller.TDPA().E_trans, 3 * sizeof(double));
 		QueryPerformanceCounter((LARGE_INTEGER *)&curtime);
 		msgS2M.time = curtime;
 		send(Slave::sServer, (char *)&msgS2M, sizeof(hapticMessageS2M), 0);
@@ -1284,6 +1254,10 @@ inline void SlaveUpdate() {
 	Slave::clock.reset();
 	Slave::clock.start();
 
+	// master and slave run in the same loop, their energy observers share the measured interval
+	Master::Controller.SetSampleInterval(timeInterval);
+	Slave::Controller.SetSampleInterval(timeInterval);
+
 	/////////////////////////////////////////////////////////////////////
 	// DYNAMIC SIMULATION
 	/////////////////////////////////////////////////////////////////////
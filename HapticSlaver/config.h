@@ -48,6 +48,7 @@ class ConfigFile{
 private:
 	std::map<std::string, std::string> contents;
 	std::string fName;
+	bool replaceKeys; // true while reading the override file: its keys replace those already read
 
 	void removeComment(std::string &line) const;
 	bool onlyWhitespace(const std::string &line) const;
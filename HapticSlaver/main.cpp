@@ -52,6 +52,7 @@ POSSIBILITY OF SUCH DAMAGE.
 //------------------------------------------------------------------------------
 #include <GLFW/glfw3.h>
 #include <iomanip>
+#include <fstream>
 #include<fstream>
 //------------------------------------------------------------------------------
 using namespace chai3d;
@@ -64,9 +65,20 @@ ConfigFile cfg("cfg/config.cfg"); // get the configuration file
 double ForceDeadbandParameter = cfg.getValueOfKey<double>("ForceDeadbandParameter"); //deadband parameter for force data reduction, 0.1 is the default value
 
 int ControlMode = cfg.getValueOfKey<int>("ControlMode"); // 0: position control, 1:velocity control
+int OrientationSlerpLength = cfg.getValueOfKey<int>("OrientationSlerpLength", 10); // number of samples to blend towards a newly received orientation
+double MMTForgettingFactor = cfg.getValueOfKey<double>("MMTForgettingFactor", 0.995); // forgetting factor of the MMT mass/friction estimator
+double WaveCorrectionTime = cfg.getValueOfKey<double>("WaveCorrectionTime", 0.02); // time constant of the wave integral drift correction
+double WavePredictionGain = cfg.getValueOfKey<double>("WavePredictionGain", 0.0); // gain of the wave prediction over the estimated delay
+double WaveReserveLimit = cfg.getValueOfKey<double>("WaveReserveLimit", 0.01); // upper bound of the stored wave energy per axis
+double HapticRate = cfg.getValueOfKey<double>("HapticRate", 1000.0); // rate of the haptic loop in Hz
+int HapticCPU = cfg.getValueOfKey<int>("HapticCPU", -1); // CPU the haptic thread is bound to, -1: no binding
+double HapticSpinWindow = cfg.getValueOfKey<double>("HapticSpinWindow", 0.0002); // time spent spinning before each haptic tick deadline
+double PhysicsRate = cfg.getValueOfKey<double>("PhysicsRate", 1000.0); // rate of the Bullet physics thread in Hz
+double PhysicsCouplingTime = cfg.getValueOfKey<double>("PhysicsCouplingTime", 0.005); // time constant of the virtual coupling to the physics thread
 
 DeadbandDataReduction* DBForce; // data reduction class for force samples
 bool ForceTransmitFlag = false; // true: deadband triger false: keep last recently transmitted sample (ZoH)
+OrientationReconstruction* RotReconstruction; // SLERP reconstruction of the deadband coded orientation
 
 //------------------------------------------------------------------------------
 // TDPA variable and function realted code
@@ -80,281 +92,12 @@ double MasterForce[3] = { 0.0,0.0,0.0 };  // current 3 DoF force sample
 
 
 
-class MMT_ALGORITHM {
-public:
-	bool enable = false;
-	/*
-	enviroment variable:
-	1. box position;
-	3. K used to calculate the force
-	*/
-	static struct envPar
-	{
-		cVector3d parPosition;
-		cVector3d parStiffness;
-		double mass;//mass of cube
-		double FrictionF;//friction force of cube
-		bool Flag;//whether this parameters is used to update the master's enviroment
-	};
-	envPar MasterPar = { cVector3d(0, 0, 0) ,cVector3d(0, 0, 0),0,0 ,false };
-	envPar SlavePar = { cVector3d(0, 0, 0) ,cVector3d(0, 0, 0),0,0 ,true };
-	cVector3d oldStiffness = cVector3d(0, 0, 0);
-	cVector3d oldPosition = cVector3d(0, 0, 0);
-	double SlaveOldVelocity = 0;
-	double MasterOldVelocity = 0;
-	int MasterMoveDirection = 0;
-	int length = 100;
-	int index1 = 0;
-	bool full1 = false;
-	int index2 = 0;
-	bool full2 = false;
-	cVector3d parStiffness[100];//store parameter K used to calculate the average K value.
-	MatrixXf acc = -1*MatrixXf::Ones(100, 2);
-	MatrixXf frictionforce = MatrixXf::Zero(100, 1);
-	MatrixXf x_jacobiSvd;
-
-	/*
-	dead band parameter
-	*/
-	double db = 0.1;
-
-	void ForceRevise(double* force, cVector3d goalPos, cVector3d proxyPos) {
-		if (!enable)return;
-		cVector3d Temp = MasterPar.parStiffness;
-		Temp.mulElement(proxyPos - goalPos);
-		force[0] = Temp(0);
-		force[1] = Temp(1);
-		force[2] = Temp(2);
-	}
-
-	void Initialize() {
-		MasterPar = { cVector3d(0, 0, 0) ,cVector3d(0, 0, 0),1,0 ,false };
-		SlavePar = { cVector3d(0, 0, 0) ,cVector3d(0, 0, 0),1,0 ,true };
-		index1 = index2 = 0;
-		oldStiffness = cVector3d(0, 0, 0);
-		for (int i = 0; i < 100; i++) {
-			parStiffness[i] = cVector3d(0, 0, 0);
-		}
-	}
-
-	void Input(cVector3d PosGoal, cVector3d PosProxy, cVector3d force, int axis, cVector3d position, bool contact) {
-		SlavePar.parPosition = position;
-		for (int i = 0; i < 3; i++) {
-			double deltaX = PosGoal(i) - PosProxy(i);
-			if (deltaX) {
-				oldStiffness(i) = abs(force(i) / deltaX);
-			}
-		}
-
-		if (index1 < 100) {
-			parStiffness[index1] = oldStiffness;
-			index1 += 1;
-		}
-		else {
-			parStiffness[index1 % 100] = oldStiffness;
-			index1 = index1 % 100;
-			full1 = true;
-		}
-
-		cVector3d avg;
-		for (int i = 0; i < 100; i++) {
-			avg += parStiffness[i];
-		}
-		avg /= 100;
-		SlavePar.parStiffness = avg;
-
-
-		double v = (position(1) - oldPosition(1) )/0.001;
-		oldPosition = position;		
-		double a = (v - SlaveOldVelocity) / 0.001;
-		SlaveOldVelocity = v;
-		if (!(abs(a)>0) || !(abs(v)>0) || !contact)return;
-		//std::cout << sqrt(pow((position(1) - oldPosition(1)), 2)) / 0.001 << " " << v << std::endl;
-		
-		
-		std::cout<< a << " "<< SlaveOldVelocity << " " << v << " " << position(1) << " " << oldPosition(1) <<  " " << (force(axis)) << " " << MMT.MasterPar.mass << "solution" << MMT.MasterPar.FrictionF << std::endl;
-		//std::cout << MMT.MasterPar.mass << " " << MMT.MasterPar.FrictionF << std::endl;
-		if (index2 < 100) {
-			acc(index2, 0) = a;
-			frictionforce(index2, 0) = (force(axis));
-			index2 += 1;
-		}
-		else {
-			parStiffness[index2 % 100] = oldStiffness;
-			acc(index2 % 100, 0) = a;
-			frictionforce(index2 % 100, 0) = (force(axis));
-			index2 = index2 % 100;
-			full2 = true;
-		}
-
-
-		x_jacobiSvd = acc.jacobiSvd(ComputeThinU | ComputeThinV).solve(frictionforce);
-
-		SlavePar.mass = x_jacobiSvd(0, 0);
-		SlavePar.FrictionF = abs(x_jacobiSvd(1, 0));
-	}
-
-	bool isTransmit() {
-		if (!full1 || (!full1&&!full2))return false;
-		for (int i = 0; i < 3; i++) {
-			// The threshold of  change rate is 10 percentage
-			if (abs(MasterPar.parStiffness(i) - SlavePar.parStiffness(i)) / SlavePar.parStiffness(i) > db)
-				return true;
-			// The threshold of  position offset is 0.1 meters
-			if (abs(MasterPar.parPosition(i) - SlavePar.parPosition(i))> 0.1)
-				return true;			
-		}
-		if (abs(MasterPar.mass - SlavePar.mass)/ SlavePar.mass > db)
-			return true;
-
-		if (abs(MasterPar.FrictionF - SlavePar.FrictionF)/ SlavePar.FrictionF > db)
-			return true;
-		return false;
-	}
-
+TeleoperationController<3> Controller; // TDPA, ISS, MMT and WAVE control algorithms, one of them is active
+MMTIdentificationService MMTIdentification; // MMT environment identification running on its own thread
 
-}MMT;
-
-class WAVE_ALGORITHM {
-public:
-	// b=1.2 for Touch
-	double b = 8;	//damping factor
-	bool waveOn = false;
-	double scaleFactor = 1;
-	KalmanFilter *KF = new KalmanFilter();
-	// WAVE algorithm variables
-	struct WaveV
-	{
-
-		cVector3d ul;	//sent signal OP
-		cVector3d vl;	//received signal OP
-		cVector3d ur;	//sent signal TOP
-		cVector3d vr;	//received signal OP
-		cVector3d F;	//force at OP
-	};
-
-	WaveV WV = { cVector3d(0,0,0),cVector3d(0,0,0), cVector3d(0,0,0), cVector3d(0,0,0), cVector3d(0,0,0) };
-
-	void VelocityRevise(double* vel, WaveV* wave, double* force) {
-		if (waveOn) {
-			cVector3d temp = getVel_r(b, wave, cVector3d(force[0], force[1], force[2]));
-			vel[0] = temp.x() * scaleFactor;
-			vel[1] = temp.y() * scaleFactor;
-			vel[2] = temp.z() * scaleFactor;
-		}
-	}
-
-	void ForceRevise(double* vel, WaveV* wave, double* force) {
-		if (waveOn) {
-			cVector3d temp = getForce_l(b, wave, cVector3d(vel[0], vel[1], vel[2]) / scaleFactor);
-			force[0] = -1 * temp.x();
-			force[1] = -1 * temp.y();
-			force[2] = -1 * temp.z();
-		}
-	}
-
-	void getWave_l(double b, WaveV* wave, cVector3d vel)
-	{
-		if (waveOn) {
-			wave->ul = sqrt(2 * b)*vel / scaleFactor + wave->vl;
-			double ttemp[3] = { WV.ul.x(),WV.ul.y(),WV.ul.z() };
-			KF->ApplyKalmanFilter(ttemp);
-			WV.ul.x(KF->CurrentEstimation[0]);
-			WV.ul.y(KF->CurrentEstimation[1]);
-			WV.ul.z(KF->CurrentEstimation[2]);
-		}
-	}
-
-	void getWave_r(double b, WaveV* wave, cVector3d f)
-	{
-		wave->ur = (sqrt(2 / b)*f - wave->vr);
-	}
-
-	cVector3d getVel_r(double b, WaveV* wave, cVector3d f)
-	{
-		return -1 / b*(f - sqrt(2 * b)*wave->vr);
-	}
-
-	cVector3d getForce_l(double b, WaveV* wave, cVector3d vel)
-	{
-		return 1 * b*vel / scaleFactor + sqrt(2 * b)*wave->vl;
-	}
-
-	void Initialize() {
-		WV = { cVector3d(0,0,0),cVector3d(0,0,0), cVector3d(0,0,0), cVector3d(0,0,0), cVector3d(0,0,0) };
-		delete KF;
-		KF = new KalmanFilter();
-	}
-}WAVE;
-
-class TDPA_Algorithm {
-public:
-	double sample_interval = 0.001;   //1kHz
-	double E_in[3] = { 0,0,0 }, E_out[3] = { 0,0,0 };
-	double E_in_last[3] = { 0,0,0 };
-	double E_trans[3] = { 0,0,0 }, E_recv[3] = { 0,0,0 };
-	double alpha[3] = { 0,0,0 }, beta[3] = { 0,0,0 };
-	bool TDPAon = false;
-	void ComputeEnergy(double vel[3], double force[3])
-	{
-		for (int i = 0; i < 3; i++) {
-			// only for z direction
-			double power = vel[i] * (-1 * force[i]);
-			if (power >= 0) {
-				E_in[i] = E_in[i] + sample_interval*power;
-			}
-			else {
-				E_out[i] = E_out[i] - sample_interval*power;
-			}
-		}
-
-	};
-	// only used by master
-	void ForceRevise(double* Vel, double* force) {
-		ComputeEnergy(Vel, force);
-		for (int i = 0; i < 3; i++) {
-			if (E_out[i] > E_recv[i] && abs(Vel[i]) > 0.001)
-			{
-				alpha[i] = (E_out[i] - E_recv[i]) / (sample_interval*Vel[i] * Vel[i]);
-				E_out[i] = E_recv[i];
-			}
-			else
-				alpha[i] = 0;
-
-			// 3. revise force and apply the revised force
-			if (TDPAon)
-				force[i] = force[i] - alpha[i] * Vel[i];
-		}
-	};
-	// only used by slavor
-	void VelocityRevise(double* Vel, double* force) {
-		ComputeEnergy(Vel, force);
-		for (int i = 0; i < 3; i++) {
-			if (E_out[i] > E_recv[i] && abs(force[i]) > 0.001)
-			{
-				beta[i] = (E_out[i] - E_recv[i]) / (sample_interval*force[i] * force[i]);
-				E_out[i] = E_recv[i];
-			}
-			else
-				beta[i] = 0;
-
-			// 3. revise slave vel 
-			if (TDPAon)
-				Vel[i] = Vel[i] - beta[i] * force[i];
-		}
-	};
-
-	void Initialize()
-	{
-		memset(E_in, 0, 3 * sizeof(double));
-		memset(E_out, 0, 3 * sizeof(double));
-		memset(E_in_last, 0, 3 * sizeof(double));
-		memset(E_trans, 0, 3 * sizeof(double));
-		memset(E_recv, 0, 3 * sizeof(double));
-		memset(alpha, 0, 3 * sizeof(double));
-		memset(beta, 0, 3 * sizeof(double));
-	};
-}TDPA;
+int RecordSignals = cfg.getValueOfKey<int>("RecordSignals", 0); // 0: Turn off recording, 1: Turn on recording
+SPSCRing<TDPA_Policy<3>::Telemetry, 1024> TDPATelemetry; // TDPA observer samples from the haptic thread
+std::ofstream TDPATelemetryFile; // written by the graphics thread
 
 KalmanFilter ForceKalmanFilter; // applies 3 DoF kalman filtering to remove noise from force signal
 //------------------------------------------------------------------------------
@@ -376,6 +119,39 @@ bool fullscreen = false;
 // mirrored display
 bool mirroredDisplay = false;
 
+// headless mode: no window or OpenGL context, statistics are printed instead (also set by --headless)
+bool headless = cfg.getValueOfKey<int>("Headless", 0) != 0;
+
+// time in seconds between two statistics lines in headless mode
+double HeadlessStatsPeriod = cfg.getValueOfKey<double>("HeadlessStatsPeriod", 1.0);
+
+// run time in seconds in headless mode, 0: until the process is stopped
+double HeadlessDuration = cfg.getValueOfKey<double>("HeadlessDuration", 0.0);
+
+// 1: send a software test pattern to the master in headless mode instead of no video
+int VideoTestPattern = cfg.getValueOfKey<int>("VideoTestPattern", 1);
+
+// frame rate of the test pattern
+double VideoTestPatternRate = cfg.getValueOfKey<double>("VideoTestPatternRate", 30.0);
+
+// delay in ms added to the force feedback by the sender, mean of the gamma distribution when DynamicDelay is enabled
+double ForceDelay = cfg.getValueOfKey<double>("ForceDelay", 20.0);
+
+// 0: constant delay, 1: gamma distributed delay (also toggled with D)
+int DynamicDelay = cfg.getValueOfKey<int>("DynamicDelay", 0);
+
+// probability that a feedback message is dropped by the sender
+double PacketLossRate = cfg.getValueOfKey<double>("PacketLossRate", 0.0);
+
+// CSV file receiving a summary of the run at the end of a headless run, none: no summary
+std::string BenchmarkFile = cfg.getValueOfKey<std::string>("BenchmarkFile", "none");
+
+// file receiving the signals of every haptic tick, none: no session is recorded
+std::string RecordSession = cfg.getValueOfKey<std::string>("RecordSession", "none");
+
+// length in seconds of the session file allocated at start, later ticks are dropped
+double RecordSessionDuration = cfg.getValueOfKey<double>("RecordSessionDuration", 600.0);
+
 //------------------------------------------------------------------------------
 // DECLARED VARIABLES
 //------------------------------------------------------------------------------
@@ -403,6 +179,9 @@ cFontPtr font, font_MMT;
 // a label to display the rate [Hz] at which the simulation is running
 cLabel* labelRates,* labelRates_MMT;
 
+// a label to display the latency of the haptic loop phases
+cLabel* labelProfile;
+
 // a virtual tool representing the haptic device in the scene
 cToolCursor* tool,* tool_MMT;
 
@@ -424,8 +203,57 @@ cFrequencyCounter freqCounterGraphics, freqCounterGraphics_MMT;
 // a frequency counter to measure the simulation haptic rate
 cFrequencyCounter freqCounterHaptics;
 
-// haptic thread
-cThread* hapticsThread;
+// haptic thread, paced at HapticRate
+cRealtimeScheduler* hapticsThread;
+
+// Bullet simulation of world, stepped at PhysicsRate on its own thread
+cBulletPhysicsThread* physicsThread;
+
+// phases of the haptic loop timed by the profiler
+enum HapticPhase { PHASE_GLOBAL_POSITIONS, PHASE_RECEIVE, PHASE_COMMAND_REVISE, PHASE_INTERACTION_FORCES, PHASE_FEEDBACK_REVISE,
+	PHASE_SEND, PHASE_ENVIRONMENT_UPDATE, PHASE_DYNAMICS, PHASE_MMT_INPUT };
+
+// latency histograms of the haptic loop phases, written by the haptic thread
+cPhaseProfiler hapticsProfiler;
+
+// state of the haptic loop shown by the graphics thread
+struct HapticFrameState {
+	unsigned int tick = 0;                           // haptic tick at which the state was published
+	double delay = 0.0;                              // M2S delay in ms
+	cVector3d toolPosition = cVector3d(0, 0, 0);     // global position of the tool
+	cMatrix3d toolRotation = cIdentity3d();          // global orientation of the tool
+	cVector3d proxyPosition = cVector3d(0, 0, 0);    // global position of the proxy
+	cVector3d masterVelocity = cVector3d(0, 0, 0);   // master velocity received from the master
+	cVector3d slaveForce = cVector3d(0, 0, 0);       // force fed back to the master
+	cVector3d objectPosition = cVector3d(0, 0, 0);   // position of the box identified by MMT
+};
+
+// published by the haptic thread once per tick, read by the graphics thread without locking
+cStateSnapshot<HapticFrameState> hapticFrame;
+
+// totals of the haptic loop since the start, summarized at the end of a headless run
+struct BenchmarkTotals {
+	unsigned int received = 0;                       // command messages received
+	unsigned int commands = 0;                       // command messages applied
+	double delaySum = 0.0;                           // sum of the M2S delays in ms
+	double delayMax = 0.0;                           // largest M2S delay in ms
+};
+
+// published by the haptic thread once per tick
+cStateSnapshot<BenchmarkTotals> benchmarkTotals;
+
+// columns of the session file, one row per haptic tick
+enum SessionColumn { SC_TIME, SC_DELAY, SC_POSITION, SC_VELOCITY = SC_POSITION + 3, SC_FORCE = SC_VELOCITY + 3,
+	SC_SLAVE_FORCE = SC_FORCE + 3, SC_ENERGY_TRANS = SC_SLAVE_FORCE + 3, SC_ENERGY_RECV = SC_ENERGY_TRANS + 3, SC_WAVE = SC_ENERGY_RECV + 3,
+	SC_FORCE_FLAG = SC_WAVE + 3, SC_COMMAND, SC_ALGORITHM, SC_COUNT };
+const char* SessionColumnNames[SC_COUNT] = { "time", "delay",
+	"position_x", "position_y", "position_z", "velocity_x", "velocity_y", "velocity_z",
+	"force_x", "force_y", "force_z", "slave_force_x", "slave_force_y", "slave_force_z",
+	"energy_trans_x", "energy_trans_y", "energy_trans_z", "energy_recv_x", "energy_recv_y", "energy_recv_z",
+	"wave_x", "wave_y", "wave_z", "force_flag", "command", "algorithm" };
+
+// signals of the haptic loop, written by the haptic thread
+SessionRecorder session;
 
 // a handle to window display context
 GLFWwindow* window = NULL;
@@ -447,6 +275,7 @@ SOCKET sClient_Image;
 
 LARGE_INTEGER cpuFreq;
 double delay;// M2S delay
+__int64 lastCommandTime = 0;// arrival of the previously processed command, gives the TDPA sample interval
 Sender<hapticMessageS2M> *sender;
 threadsafe_queue<hapticMessageS2M> backwardQ;
 
@@ -555,7 +384,7 @@ public:
 		// one record = UTC TimeStamp + EpisodeIndex + Score
 		time_t now;
 		time(&now);
-		OutFile << userName << "," << now << "," << EpisodeIndex << "," << score << std::endl;
+		OutFile << userName << "," << now << "," << EpisodeIndex << "," << score << "\n";
 	};
 
 	void EnvironmentUpdate() {
@@ -594,6 +423,12 @@ void keyCallback(GLFWwindow* a_window, int a_key, int a_scancode, int a_action,
 // this function renders the scene
 void updateGraphics(void);
 
+// this function replaces updateGraphics in headless mode
+void updateHeadless(void);
+
+// this function appends the summary of a headless run to BenchmarkFile
+void writeBenchmark(double runTime);
+
 // this function contains the main haptics simulation loop
 void updateHaptics(void);
 
@@ -734,13 +569,29 @@ int main(int argc, char* argv[])
 	std::cout << "Keyboard Options:" << std::endl << std::endl;
 	std::cout << "[X] - Stop Game" << std::endl;
 	std::cout << "[S] - Start a new episode" << std::endl;
+	std::cout << "[P] - Save haptic loop profile to HapticProfile.csv" << std::endl;
 	std::cout << "-----------------------------------" << std::endl << std::endl << std::endl;
 	std::cout << "Game score will store in a TXT document." << std::endl << std::endl << std::endl;
 	std::cout << "-----------------------------------" << std::endl << std::endl << std::endl;
 	std::cout << std::endl << std::endl;
 
+	for (int i = 1; i < argc; i++) {
+		if (strcmp(argv[i], "--headless") == 0) headless = true;
+
+		// convert a recorded session and exit: --convert-session session.bin output.csv|output.npy
+		if ((strcmp(argv[i], "--convert-session") == 0) && (i + 2 < argc)) {
+			bool converted = SessionRecorder::Convert(argv[i + 1], argv[i + 2]);
+			std::cout << (converted ? "> Converted " : "error - failed to convert ") << argv[i + 1] << std::endl;
+			return converted ? 0 : 1;
+		}
+	}
+	if (headless) {
+		std::cout << "Running headless: no window, statistics every " << HeadlessStatsPeriod << " s" << std::endl << std::endl;
+	}
+
 	// initialized deadband classes for force and velocity
 	DBForce = new DeadbandDataReduction(ForceDeadbandParameter);
+	RotReconstruction = new OrientationReconstruction(OrientationSlerpLength);
 
 	socketServerInit(888, sClient);
 	socketServerInit(889, sClient_Image);
@@ -748,75 +599,77 @@ int main(int argc, char* argv[])
 	// OPEN GL - WINDOW DISPLAY
 	//--------------------------------------------------------------------------
 
-	// initialize GLFW library
-	if (!glfwInit())
-	{
-		std::cout << "failed initialization" << std::endl;
-		cSleepMs(1000);
-		return 1;
-	}
+	if (!headless) {
+		// initialize GLFW library
+		if (!glfwInit())
+		{
+			std::cout << "failed initialization" << std::endl;
+			cSleepMs(1000);
+			return 1;
+		}
 
-	// set error callback
-	glfwSetErrorCallback(errorCallback);
-
-	// compute desired size of window
-	const GLFWvidmode* mode = glfwGetVideoMode(glfwGetPrimaryMonitor());
-	int w = 0.8 * mode->height;
-	int h = 0.5 * mode->height;
-	int x = 0.5 * (mode->width - w);
-	int y = 0.5 * (mode->height - h);
-
-	// set OpenGL version
-	glfwWindowHint(GLFW_CONTEXT_VERSION_MAJOR, 2);
-	glfwWindowHint(GLFW_CONTEXT_VERSION_MINOR, 1);
-	glfwWindowHint(GLFW_RESIZABLE, GLFW_FALSE);
-	// set active stereo mode
-	if (stereoMode == C_STEREO_ACTIVE)
-	{
-		glfwWindowHint(GLFW_STEREO, GL_TRUE);
-	}
-	else
-	{
-		glfwWindowHint(GLFW_STEREO, GL_FALSE);
-	}
+		// set error callback
+		glfwSetErrorCallback(errorCallback);
+
+		// compute desired size of window
+		const GLFWvidmode* mode = glfwGetVideoMode(glfwGetPrimaryMonitor());
+		int w = 0.8 * mode->height;
+		int h = 0.5 * mode->height;
+		int x = 0.5 * (mode->width - w);
+		int y = 0.5 * (mode->height - h);
+
+		// set OpenGL version
+		glfwWindowHint(GLFW_CONTEXT_VERSION_MAJOR, 2);
+		glfwWindowHint(GLFW_CONTEXT_VERSION_MINOR, 1);
+		glfwWindowHint(GLFW_RESIZABLE, GLFW_FALSE);
+		// set active stereo mode
+		if (stereoMode == C_STEREO_ACTIVE)
+		{
+			glfwWindowHint(GLFW_STEREO, GL_TRUE);
+		}
+		else
+		{
+			glfwWindowHint(GLFW_STEREO, GL_FALSE);
+		}
 
-	// create display context
-	window = glfwCreateWindow(w, h, "CHAI3D", NULL, NULL);
-	if (!window)
-	{
-		std::cout << "failed to create window" << std::endl;
-		cSleepMs(1000);
-		glfwTerminate();
-		return 1;
-	}
+		// create display context
+		window = glfwCreateWindow(w, h, "CHAI3D", NULL, NULL);
+		if (!window)
+		{
+			std::cout << "failed to create window" << std::endl;
+			cSleepMs(1000);
+			glfwTerminate();
+			return 1;
+		}
 
-	// get width and height of window
-	glfwGetWindowSize(window, &width, &height);
+		// get width and height of window
+		glfwGetWindowSize(window, &width, &height);
 
-	// set position of window
-	glfwSetWindowPos(window, x, y);
+		// set position of window
+		glfwSetWindowPos(window, x, y);
 
-	// set key callback
-	glfwSetKeyCallback(window, keyCallback);
+		// set key callback
+		glfwSetKeyCallback(window, keyCallback);
 
-	// set resize callback
-	glfwSetWindowSizeCallback(window, windowSizeCallback);
+		// set resize callback
+		glfwSetWindowSizeCallback(window, windowSizeCallback);
 
-	// set current display context
-	glfwMakeContextCurrent(window);
+		// set current display context
+		glfwMakeContextCurrent(window);
 
-	// sets the swap interval for the current display context
-	glfwSwapInterval(swapInterval);
+		// sets the swap interval for the current display context
+		glfwSwapInterval(swapInterval);
 
 #ifdef GLEW_VERSION
-	// initialize GLEW library
-	if (glewInit() != GLEW_OK)
-	{
-		std::cout << "failed to initialize GLEW library" << std::endl;
-		glfwTerminate();
-		return 1;
-	}
+		// initialize GLEW library
+		if (glewInit() != GLEW_OK)
+		{
+			std::cout << "failed to initialize GLEW library" << std::endl;
+			glfwTerminate();
+			return 1;
+		}
 #endif
+	}
 
 	//-----------------------------------------------------------------------
 	// WORLD - CAMERA - LIGHTING
@@ -868,12 +721,14 @@ int main(int argc, char* argv[])
 	// set uniform concentration level of light 
 	light->setSpotExponent(0.0);
 
-	// enable this light source to generate shadows
-	light->setShadowMapEnabled(true);
+	if (!headless) {
+		// enable this light source to generate shadows
+		light->setShadowMapEnabled(true);
 
-	// set the resolution of the shadow map
-	light->m_shadowMap->setQualityLow();
-	//light->m_shadowMap->setQualityMedium();
+		// set the resolution of the shadow map
+		light->m_shadowMap->setQualityLow();
+		//light->m_shadowMap->setQualityMedium();
+	}
 
 	// set light cone half angle
 	light->setCutOffAngleDeg(45);
@@ -936,7 +791,15 @@ int main(int argc, char* argv[])
 	double maxStiffness = hapticDeviceInfo.m_maxLinearStiffness / workspaceScaleFactor;//Falcon.m_maxLinearStiffness / workspaceScaleFactor;
 	std::cout << workspaceScaleFactor << std::endl;
 	world->setGravity(0.0, 0.0, -9.8);
-	WAVE.scaleFactor = workspaceScaleFactor;
+	Controller.WAVE().scaleFactor = workspaceScaleFactor;
+	Controller.WAVE().vr.CorrectionTime = WaveCorrectionTime;
+	Controller.WAVE().vr.PredictionGain = WavePredictionGain;
+	Controller.WAVE().vr.ReserveLimit = WaveReserveLimit;
+	if (RecordSignals) {
+		TDPATelemetryFile.open("TDPATelemetry.txt");
+		Controller.TDPA().TelemetryChannel = &TDPATelemetry;
+	}
+	MMTIdentification.Estimator().MassFriction.Lambda = MMTForgettingFactor;
 	//////////////////////////////////////////////////////////////////////////
 	// 3 BULLET BLOCKS
 	//////////////////////////////////////////////////////////////////////////
@@ -1040,23 +903,25 @@ int main(int argc, char* argv[])
 	ground->setSurfaceFriction(0.4);
 	// set material properties
 	bool fileload;
-	ground->m_texture = cTexture2d::create();
-	fileload = ground->m_texture->loadFromFile("resources/wood.jpg");
-	if (!fileload)
-	{
-		std::cout << "Error - Texture image failed to load correctly." << std::endl;
-		close();
-		return (-1);
-	}
+	if (!headless) {
+		ground->m_texture = cTexture2d::create();
+		fileload = ground->m_texture->loadFromFile("resources/wood.jpg");
+		if (!fileload)
+		{
+			std::cout << "Error - Texture image failed to load correctly." << std::endl;
+			close();
+			return (-1);
+		}
 
-	// enable texture mapping
-	ground->setUseTexture(true);
-	ground->m_material->setWhite();
+		// enable texture mapping
+		ground->setUseTexture(true);
+		ground->m_material->setWhite();
 
-	// create normal map from texture data
-	cNormalMapPtr normalMap0 = cNormalMap::create();
-	normalMap0->createMap(ground->m_texture);
-	ground->m_normalMap = normalMap0;
+		// create normal map from texture data
+		cNormalMapPtr normalMap0 = cNormalMap::create();
+		normalMap0->createMap(ground->m_texture);
+		ground->m_normalMap = normalMap0;
+	}
 	//--------------------------------------------------------------------------
 	// WIDGETS
 	//--------------------------------------------------------------------------
@@ -1067,6 +932,19 @@ int main(int argc, char* argv[])
 	// create a label to display the haptic and graphic rate of the simulation
 	labelRates = new cLabel(font);
 	camera->m_frontLayer->addChild(labelRates);
+
+	// create a label to display the latency of the haptic loop phases
+	labelProfile = new cLabel(font);
+	camera->m_frontLayer->addChild(labelProfile);
+	hapticsProfiler.setPhaseName(PHASE_GLOBAL_POSITIONS, "computeGlobalPositions");
+	hapticsProfiler.setPhaseName(PHASE_RECEIVE, "recv");
+	hapticsProfiler.setPhaseName(PHASE_COMMAND_REVISE, "command revise");
+	hapticsProfiler.setPhaseName(PHASE_INTERACTION_FORCES, "computeInteractionForces");
+	hapticsProfiler.setPhaseName(PHASE_FEEDBACK_REVISE, "feedback revise");
+	hapticsProfiler.setPhaseName(PHASE_SEND, "send");
+	hapticsProfiler.setPhaseName(PHASE_ENVIRONMENT_UPDATE, "environment update");
+	hapticsProfiler.setPhaseName(PHASE_DYNAMICS, "physics exchange");
+	hapticsProfiler.setPhaseName(PHASE_MMT_INPUT, "MMT input");
 	
 
 	//-----------------------------------------------------------------------
@@ -1118,12 +996,14 @@ int main(int argc, char* argv[])
 	// set uniform concentration level of light 
 	light_MMT->setSpotExponent(0.0);
 
-	// enable this light source to generate shadows
-	light_MMT->setShadowMapEnabled(true);
+	if (!headless) {
+		// enable this light source to generate shadows
+		light_MMT->setShadowMapEnabled(true);
 
-	// set the resolution of the shadow map
-	light_MMT->m_shadowMap->setQualityLow();
-	//light->m_shadowMap->setQualityMedium();
+		// set the resolution of the shadow map
+		light_MMT->m_shadowMap->setQualityLow();
+		//light->m_shadowMap->setQualityMedium();
+	}
 
 	// set light cone half angle
 	light_MMT->setCutOffAngleDeg(45);
@@ -1236,23 +1116,25 @@ int main(int argc, char* argv[])
 	// set friction values
 	ground_MMT->setSurfaceFriction(0.4);
 	// set material properties
-	ground_MMT->m_texture = cTexture2d::create();
-	fileload = ground_MMT->m_texture->loadFromFile("resources/wood.jpg");
-	if (!fileload)
-	{
-		std::cout << "Error - Texture image failed to load correctly." << std::endl;
-		close();
-		return (-1);
-	}
+	if (!headless) {
+		ground_MMT->m_texture = cTexture2d::create();
+		fileload = ground_MMT->m_texture->loadFromFile("resources/wood.jpg");
+		if (!fileload)
+		{
+			std::cout << "Error - Texture image failed to load correctly." << std::endl;
+			close();
+			return (-1);
+		}
 
-	// enable texture mapping
-	ground_MMT->setUseTexture(true);
-	ground_MMT->m_material->setWhite();
+		// enable texture mapping
+		ground_MMT->setUseTexture(true);
+		ground_MMT->m_material->setWhite();
 
-	// create normal map from texture data
-	cNormalMapPtr normalMap0_MMT = cNormalMap::create();
-	normalMap0_MMT->createMap(ground_MMT->m_texture);
-	ground_MMT->m_normalMap = normalMap0_MMT;
+		// create normal map from texture data
+		cNormalMapPtr normalMap0_MMT = cNormalMap::create();
+		normalMap0_MMT->createMap(ground_MMT->m_texture);
+		ground_MMT->m_normalMap = normalMap0_MMT;
+	}
 	world_MMT->setEnabled(false, true);
 	//--------------------------------------------------------------------------
 	// WIDGETS
@@ -1295,16 +1177,35 @@ int main(int argc, char* argv[])
 
 	game.StopGame();
 
+	// create the thread which steps the Bullet world
+	physicsThread = new cBulletPhysicsThread(world);
+	physicsThread->setCouplingTimeConstant(PhysicsCouplingTime);
+	physicsThread->start(PhysicsRate);
+
 	// create a thread which starts the main haptics rendering loop
-	hapticsThread = new cThread();
+	hapticsThread = new cRealtimeScheduler(HapticRate);
+	hapticsThread->setAffinity(HapticCPU);
+	hapticsThread->setSpinWindow(HapticSpinWindow);
+	// allocate the session file before the haptic loop starts writing to it
+	if (RecordSession != "none") {
+		if (!session.Open(RecordSession.c_str(), SessionColumnNames, SC_COUNT, (unsigned long long)(RecordSessionDuration * HapticRate)))
+			std::cout << "error - failed to create " << RecordSession << std::endl;
+	}
 	hapticsThread->start(updateHaptics, CTHREAD_PRIORITY_HAPTICS);
 
+	// start the MMT identification thread
+	MMTIdentification.Start();
+
 	// setup callback when application exits
 	atexit(close);
 
 	sender = new Sender<hapticMessageS2M>();
 	sender->Q = &backwardQ;
 	sender->s = sClient;
+	sender->constantDelay = ForceDelay;
+	sender->gamma_alpha = ForceDelay;
+	sender->dynamicDelay = DynamicDelay != 0;
+	sender->lossRate = PacketLossRate;
 	unsigned  uiThread1ID;
 	HANDLE hth1 = (HANDLE)_beginthreadex(NULL, // security
 		0,             // stack size
@@ -1312,6 +1213,23 @@ int main(int argc, char* argv[])
 		sender,           // arg list holding the "this" pointer
 		0, // so we can later call ResumeThread()
 		&uiThread1ID);
+	//--------------------------------------------------------------------------
+	// MAIN HEADLESS LOOP
+	//--------------------------------------------------------------------------
+
+	if (headless) {
+		cPrecisionClock runClock;
+		runClock.start();
+		while ((HeadlessDuration <= 0.0) || (runClock.getcurrentTimeSeconds() < HeadlessDuration)) {
+			updateHeadless();
+			freqCounterGraphics.signal(1);
+			cSleepMs(1);
+		}
+		if (BenchmarkFile != "none")
+			writeBenchmark(runClock.getcurrentTimeSeconds());
+		return (0);
+	}
+
 	//--------------------------------------------------------------------------
 	// MAIN GRAPHIC LOOP
 	//--------------------------------------------------------------------------
@@ -1464,6 +1382,11 @@ void keyCallback(GLFWwindow* a_window, int a_key, int a_scancode, int a_action,
 		std::cout << "Game stop" << std::endl;
 		game.StopGame();
 	}
+
+	if (a_key == GLFW_KEY_P) {
+		if (hapticsProfiler.saveCSV("HapticProfile.csv"))
+			std::cout << "> Saved haptic loop profile to HapticProfile.csv" << std::endl;
+	}
 }
 
 //------------------------------------------------------------------------------
@@ -1475,9 +1398,15 @@ void close(void)
 
 	// wait for graphics and haptics loops to terminate
 	while (!simulationFinished) { cSleepMs(100); }
+	MMTIdentification.Stop();
+	physicsThread->stop();
+
+	// the recorded rows stay in the session file
+	session.Close();
 
 	// delete resources
 	delete hapticsThread;
+	delete physicsThread;
 	delete world;
 }
 
@@ -1495,16 +1424,23 @@ void updateHaptics(void)
 	// reset clock
 	cPrecisionClock clock;
 	clock.reset();
-	__int64 lastCounter = 0;
-	QueryPerformanceCounter((LARGE_INTEGER *)&lastCounter);
+
+	// totals of the run, published to the main thread after each tick
+	BenchmarkTotals totals;
+
+	// time base of the recorded session
+	cPrecisionClock sessionClock;
+	sessionClock.start(true);
 
 	// main haptic simulation loop
 	while (simulationRunning)
 	{
+		C_PROFILE_START(phaseTimer, hapticsProfiler);
 
 		// compute global reference frames for each object
 		world->computeGlobalPositions(true);
 		world_MMT->computeGlobalPositions(true);
+		C_PROFILE_LAP(phaseTimer, PHASE_GLOBAL_POSITIONS);
 		/////////////////////////////////////////////////////////////////////
 		// READ HAPTIC DEVICE
 		/////////////////////////////////////////////////////////////////////
@@ -1521,6 +1457,7 @@ void updateHaptics(void)
 			for (; i < unprocessedPtr / hapticMsgL; i++) {
 				commandQ.push(*(hapticMessageM2S*)(recData + i* hapticMsgL));
 			}
+			totals.received += i;
 			//std::queue<hapticMessageM2S> empty;
 			//commandQ.swap(empty);
 			//commandQ.push(*(hapticMessageM2S*)(recData + i* hapticMsgL));
@@ -1531,6 +1468,8 @@ void updateHaptics(void)
 				recData[i] = recData[processedPtr + i];
 			}
 		}
+		C_PROFILE_LAP(phaseTimer, PHASE_RECEIVE);
+		MMT_Algorithm& MMT = Controller.MMT();
 		while (commandQ.size()) {
 			msgM2S = commandQ.front();
 			
@@ -1539,10 +1478,8 @@ void updateHaptics(void)
 			cVector3d position(msgM2S.position[0], msgM2S.position[1], msgM2S.position[2]);
 
 			// read orientation 
-			cVector3d col0(msgM2S.rotation[0], msgM2S.rotation[1], msgM2S.rotation[2]);
-			cVector3d col1(msgM2S.rotation[3], msgM2S.rotation[4], msgM2S.rotation[5]);
-			cVector3d col2(msgM2S.rotation[6], msgM2S.rotation[7], msgM2S.rotation[8]);
-			cMatrix3d rotation(col0, col1, col2);
+			cMatrix3d rotation;
+			DecompressQuaternion(msgM2S.rotation).toRotMat(rotation);
 
 			// read gripper position
 			double gripperAngle = msgM2S.gripperAngle;
@@ -1582,8 +1519,9 @@ void updateHaptics(void)
 			tool_MMT->computeInteractionForces();
 			cVector3d pos = bulletBox1_MMT->getLocalPos();
 			cHapticPoint* p = tool_MMT->getHapticPoint(0);
-			double force[3];
-			MMT.ForceRevise(force, p->getLocalPosGoal(), p->getLocalPosProxy());
+			double force[3] = { 0, 0, 0 };
+			if (Controller.Active() == AlgorithmType::AT_MMT)
+				MMT.ForceRevise(force, p->getLocalPosGoal(), p->getLocalPosProxy());
 
 			if (tool_MMT->getHapticPoint(0)->getNumCollisionEvents()) {
 				cBulletBox* bulletobject = dynamic_cast<cBulletBox*>(tool_MMT->getHapticPoint(0)->getCollisionEvent(0)->m_object->getOwner()->getOwner());
@@ -1634,7 +1572,8 @@ void updateHaptics(void)
 			}
 				
 		}
-		if (commandQ.size()) {
+		bool command = commandQ.size() > 0;
+		if (command) {
 
 			
 			msgM2S = commandQ.front();
@@ -1644,15 +1583,22 @@ void updateHaptics(void)
 			__int64 curtime;
 			QueryPerformanceCounter((LARGE_INTEGER *)&curtime);			
 			delay = ((double)(curtime - msgM2S.timestamp) / (double)cpuFreq.QuadPart) * 1000;
+			totals.commands++;
+			totals.delaySum += delay;
+			totals.delayMax = cMax(totals.delayMax, delay);
+
+			// the energy observers integrate with the measured command interval
+			if (lastCommandTime)
+				Controller.SetSampleInterval(cClamp((double)(curtime - lastCommandTime) / (double)cpuFreq.QuadPart, 0.0001, 0.001));
+			lastCommandTime = curtime;
 
 			// read position 
 			cVector3d position(msgM2S.position[0], msgM2S.position[1], msgM2S.position[2]);
 
-			// read orientation 
-			cVector3d col0(msgM2S.rotation[0], msgM2S.rotation[1], msgM2S.rotation[2]);
-			cVector3d col1(msgM2S.rotation[3], msgM2S.rotation[4], msgM2S.rotation[5]);
-			cVector3d col2(msgM2S.rotation[6], msgM2S.rotation[7], msgM2S.rotation[8]);
-			cMatrix3d rotation(col0, col1, col2);
+			// read orientation, blended towards the last deadband update
+			cMatrix3d rotation;
+			RotReconstruction->GetReceivedSample(msgM2S.rotation);
+			RotReconstruction->ApplySlerpReconstruction(rotation);
 
 			// read gripper position
 			double gripperAngle = msgM2S.gripperAngle;
@@ -1676,60 +1622,33 @@ void updateHaptics(void)
 			button3 = msgM2S.button3;
 			
 			memcpy(MasterVelocity, msgM2S.linearVelocity, 3 * sizeof(double));
-			memcpy(TDPA.E_recv, msgM2S.energy, 3*sizeof(double));
-
-			double vr[3];
-			memcpy(vr, msgM2S.waveVariable, 3 * sizeof(double));
-			WAVE.WV.vr = cVector3d(vr[0], vr[1], vr[2]);
+			memcpy(Controller.TDPA().E_recv, msgM2S.energy, 3*sizeof(double));
+			Controller.WAVE().vr.Receive(msgM2S.waveVariable, msgM2S.waveIntegral);
+			Controller.WAVE().vr.UpdateDelay(delay * 0.001);
 
 			switch (msgM2S.ATypeChange) {
 			case AlgorithmType::AT_None:
+			case AlgorithmType::AT_MMT:
 				ControlMode = 0;
-				TDPA.TDPAon = false;
-				MMT.enable = false;
-				world_MMT->setEnabled(false, true);
-				WAVE.waveOn = false;
 				break;
 			case AlgorithmType::AT_TDPA:
-				ControlMode = 1;
-				TDPA.TDPAon = true;
-				TDPA.Initialize();
-				MMT.enable = false;
-				world_MMT->setEnabled(false, true);
-				WAVE.waveOn = false;
-				break;
 			case AlgorithmType::AT_ISS:
-				ControlMode = 1;
-				TDPA.TDPAon = false;
-				MMT.enable = false;
-				world_MMT->setEnabled(false, true);
-				WAVE.waveOn = false;
-				break;
-			case AlgorithmType::AT_MMT:
-				ControlMode = 0;
-				TDPA.TDPAon = false;
-				MMT.enable = true;
-				MMT.Initialize();
-				world_MMT->setEnabled(true, true);
-				WAVE.waveOn = false;
-				break;
 			case AlgorithmType::AT_WAVE:
 				ControlMode = 1;
-				TDPA.TDPAon = false;
-				MMT.enable = false;
-				world_MMT->setEnabled(false, true);
-				WAVE.waveOn = true;
-				WAVE.Initialize();
 				break;
 			case AlgorithmType::AT_KEEP:
 				break;
 			}
-							
-			
-
+			if (msgM2S.ATypeChange != AlgorithmType::AT_KEEP) {
+				Controller.Select(msgM2S.ATypeChange);
+				if (msgM2S.ATypeChange == AlgorithmType::AT_MMT)
+					MMTIdentification.Reset();
+				world_MMT->setEnabled(msgM2S.ATypeChange == AlgorithmType::AT_MMT, true);
+			}
 
-			TDPA.VelocityRevise(MasterVelocity, SlaveForce);
-			WAVE.VelocityRevise(MasterVelocity, &WAVE.WV, SlaveForce);
+			// revise the command with the active control algorithm (TDPA passivity controller, WAVE decoding)
+			Controller.SlaveCommandRevise(MasterVelocity, SlaveForce);
+			C_PROFILE_LAP(phaseTimer, PHASE_COMMAND_REVISE);
 
 			if (ControlMode == 1) { // if velocity control mode is selected
 									// Compute tool position using delayed velocity signal
@@ -1764,6 +1683,7 @@ void updateHaptics(void)
 
 			// compute interaction forces
 			tool->computeInteractionForces();
+			C_PROFILE_LAP(phaseTimer, PHASE_INTERACTION_FORCES);
 
 			
 
@@ -1771,11 +1691,10 @@ void updateHaptics(void)
 			cVector3d force = tool->getDeviceLocalForce();
 			cVector3d torque = tool->getDeviceLocalTorque();
 			double gripperForce = tool->getGripperForce();
-			WAVE.getWave_r(WAVE.b, &WAVE.WV, cVector3d(SlaveForce[0], SlaveForce[1], SlaveForce[2]));
-			
-			double ur[3] = { WAVE.WV.ur.x(), WAVE.WV.ur.y(), WAVE.WV.ur.z() };
+			Controller.SlaveFeedbackRevise(SlaveForce);
 
-			MMT_ALGORITHM::envPar MMTParameters;
+			MMT_Algorithm::envPar MMTParameters;
+			MMTIdentification.Fetch(MMT);
 			if (MMT.isTransmit()) {
 				MMTParameters = MMT.SlavePar;
 				MMT.MasterPar = MMT.SlavePar;
@@ -1800,14 +1719,8 @@ void updateHaptics(void)
 			SlaveForce[1] = -1 * force.y();
 			SlaveForce[2] = -1 * force.z();
 			
-			if (ForceTransmitFlag == true) {
-				memcpy(TDPA.E_trans, TDPA.E_in, 3 * sizeof(double));
-				memcpy(TDPA.E_in_last, TDPA.E_in, 3 * sizeof(double));
-			}
-			else
-			{
-				memcpy(TDPA.E_trans, TDPA.E_in_last, 3 * sizeof(double));
-			}
+			Controller.TDPA().UpdateTransmitEnergy(ForceTransmitFlag);
+			C_PROFILE_LAP(phaseTimer, PHASE_FEEDBACK_REVISE);
 
 			/////////////////////////////////////////////////////////////////////
 			// Send Forces
@@ -1823,27 +1736,31 @@ void updateHaptics(void)
 			msgS2M.MMTParameters[7] = MMTParameters.FrictionF;
 			msgS2M.MMTParameters[8] = MMTParameters.Flag;
 			msgS2M.gripperForce = gripperForce;
-			memcpy(msgS2M.energy, TDPA.E_trans, 3 * sizeof(double));
-			memcpy(msgS2M.waveVariable, ur, 3 * sizeof(double));
+			memcpy(msgS2M.energy, Controller.TDPA().E_trans, 3 * sizeof(double));
+			memcpy(msgS2M.waveVariable, Controller.WAVE().ur, 3 * sizeof(double));
+			memcpy(msgS2M.waveIntegral, Controller.WAVE().Ur, 3 * sizeof(double));
 			QueryPerformanceCounter((LARGE_INTEGER *)&curtime);
 			msgS2M.timestamp = curtime;
+			msgS2M.echoTimestamp = msgM2S.timestamp;
+			memcpy(msgS2M.position, MasterPosition, 3 * sizeof(double));
 			//send(sClient, (char *)&msgS2M, sizeof(hapticMessageS2M), 0); 
 			backwardQ.push(msgS2M);
 			freqCounterHaptics.signal(1);
+			C_PROFILE_LAP(phaseTimer, PHASE_SEND);
 		}
-		__int64 currentCounter;
-		QueryPerformanceCounter((LARGE_INTEGER *)&currentCounter);
-		if (currentCounter - lastCounter < 3609)continue;
-		lastCounter = currentCounter;
+		// wait for the next tick of the haptic loop
+		hapticsThread->waitForNextTick();
+		C_PROFILE_RESTART(phaseTimer);
 		/////////////////////////////////////////////////////////////////////
 		// SIMULATION TIME    
 		/////////////////////////////////////////////////////////////////////
 		game.EnvironmentUpdate();
+		C_PROFILE_LAP(phaseTimer, PHASE_ENVIRONMENT_UPDATE);
 		// stop the simulation clock
 		clock.stop();
 
 		// read the time increment in seconds
-		double timeInterval = cClamp(clock.getcurrentTimeSeconds(), 0.0001, 0.001);
+		double timeInterval = cClamp(clock.getcurrentTimeSeconds(), 0.0001, cMax(0.001, 1.0 / HapticRate));
 
 		// restart the simulation clock
 		clock.reset();
@@ -1876,18 +1793,19 @@ void updateHaptics(void)
 				// cast to Bullet object
 				cBulletGenericObject* bulletobject = dynamic_cast<cBulletGenericObject*>(object);
 
-				// if Bullet object, we apply interaction forces
+				// if Bullet object, we send the interaction forces to the physics thread
 				if (bulletobject != NULL)
 				{
-					bulletobject->addExternalForceAtPoint(-interactionPoint->getLastComputedForce(),
-						collisionEvent->m_globalPos - object->getLocalPos());
+					physicsThread->addExternalForceAtPoint(bulletobject, -interactionPoint->getLastComputedForce(),
+						collisionEvent->m_globalPos - object->getLocalPos(), timeInterval);
 				}
 			}
 		}
 
 
-		// update simulation
-		world->updateDynamics(timeInterval);
+		// follow the bodies simulated by the physics thread
+		physicsThread->updatePositions(timeInterval);
+		C_PROFILE_LAP(phaseTimer, PHASE_DYNAMICS);
 		cHapticPoint* p = tool->getHapticPoint(0);
 		bool contact = false;
 		if (tool->getHapticPoint(0)->getNumCollisionEvents()) {
@@ -1895,7 +1813,38 @@ void updateHaptics(void)
 			if (bulletobject != NULL)contact = true;
 		}
 
-		MMT.Input(p->getLocalPosGoal(), p->getLocalPosProxy(), -p->getLastComputedForce(),1, bulletBox1->getLocalPos(), contact);
+		MMTIdentification.Submit(p->getLocalPosGoal(), p->getLocalPosProxy(), -p->getLastComputedForce(),1, bulletBox1->getLocalPos(), contact, timeInterval);
+		C_PROFILE_LAP(phaseTimer, PHASE_MMT_INPUT);
+
+		// publish the state of this tick to the graphics thread
+		HapticFrameState& frame = hapticFrame.edit();
+		frame.tick = hapticsThread->getTickCount();
+		frame.delay = delay;
+		frame.toolPosition = tool->getDeviceGlobalPos();
+		frame.toolRotation = tool->getDeviceGlobalRot();
+		frame.proxyPosition = p->getGlobalPosProxy();
+		frame.masterVelocity.set(MasterVelocity[0], MasterVelocity[1], MasterVelocity[2]);
+		frame.slaveForce.set(SlaveForce[0], SlaveForce[1], SlaveForce[2]);
+		frame.objectPosition = bulletBox1->getLocalPos();
+		hapticFrame.publish();
+		benchmarkTotals.publish(totals);
+
+		// record the signals of this tick
+		if (session.IsOpen()) {
+			session.Set(SC_TIME, sessionClock.getcurrentTimeSeconds());
+			session.Set(SC_DELAY, delay);
+			session.Set(SC_POSITION, MasterPosition, 3);
+			session.Set(SC_VELOCITY, MasterVelocity, 3);
+			session.Set(SC_FORCE, MasterForce, 3);
+			session.Set(SC_SLAVE_FORCE, SlaveForce, 3);
+			session.Set(SC_ENERGY_TRANS, Controller.TDPA().E_trans, 3);
+			session.Set(SC_ENERGY_RECV, Controller.TDPA().E_recv, 3);
+			session.Set(SC_WAVE, Controller.WAVE().ur, 3);
+			session.Set(SC_FORCE_FLAG, ForceTransmitFlag);
+			session.Set(SC_COMMAND, command);
+			session.Set(SC_ALGORITHM, Controller.Active());
+			session.Commit();
+		}
 	}
 
 	// exit haptics thread
@@ -1909,14 +1858,29 @@ void updateGraphics(void)
 	// UPDATE WIDGETS
 	/////////////////////////////////////////////////////////////////////
 
+	// latest state published by the haptic thread
+	hapticFrame.update();
+	const HapticFrameState& frame = hapticFrame.get();
+
 	// update haptic and graphic rate data
 	labelRates->setText(cStr(freqCounterGraphics.getFrequency(), 0) + " Hz / " +
-		cStr(freqCounterHaptics.getFrequency(), 0) + " Hz " + "M2S delay:" + cStr(delay, 3) 
-		+ " " + cStr(MasterVelocity[0], 3) + " " + cStr(MasterVelocity[1], 3) + " " + cStr(MasterVelocity[2], 3));
+		cStr(freqCounterHaptics.getFrequency(), 0) + " Hz " + "M2S delay:" + cStr(frame.delay, 3) 
+		+ " overruns " + cStr(hapticsThread->getOverrunCount()) + " jitter p99 " + cStr(1e6 * hapticsThread->getJitterPercentile(0.99), 0) + " us"
+		+ " " + cStr(frame.masterVelocity(0), 3) + " " + cStr(frame.masterVelocity(1), 3) + " " + cStr(frame.masterVelocity(2), 3));
 
 	// update position of label
 	labelRates->setLocalPos((int)(0.5 * (width - labelRates->getWidth())), 15);
 
+	// update haptic loop phase latencies
+	labelProfile->setText(hapticsProfiler.getSummary());
+	labelProfile->setLocalPos(10, (int)(height - labelProfile->getHeight() - 10));
+
+	// write TDPA observer samples collected since the last frame
+	TDPA_Policy<3>::Telemetry telemetry;
+	while (TDPATelemetry.Pop(telemetry)) {
+		TDPA_Policy<3>::WriteTelemetry(TDPATelemetryFile, telemetry);
+	}
+
 	/////////////////////////////////////////////////////////////////////
 	// RENDER SCENE
 	/////////////////////////////////////////////////////////////////////
@@ -1945,3 +1909,103 @@ void updateGraphics(void)
 }
 
 
+
+//------------------------------------------------------------------------------
+
+// test pattern frame being sent in headless mode
+std::vector<unsigned char> headlessVideoFrame(4 * VideoWidth * VideoHeight);
+int headlessVideoBytes = 0; // bytes of the current frame sent so far, 0: no frame pending
+unsigned int headlessVideoFrames = 0; // number of test pattern frames started
+unsigned int headlessVideoSent = 0; // complete frames since the last statistics line
+cPrecisionClock headlessVideoClock;
+cPrecisionClock headlessStatsClock;
+double headlessRateSum = 0.0; // sum of the haptic rates of the statistics lines, for the benchmark summary
+double headlessRateSum2 = 0.0; // sum of their squares
+unsigned int headlessRateCount = 0;
+
+void updateHeadless(void)
+{
+	// start a new test pattern frame at VideoTestPatternRate
+	if (!headlessVideoClock.on()) headlessVideoClock.start(true);
+	if (VideoTestPattern && (headlessVideoBytes == 0) && (headlessVideoClock.getcurrentTimeSeconds() >= 1.0 / VideoTestPatternRate)) {
+		headlessVideoClock.start(true);
+		FillVideoTestPattern(headlessVideoFrame.data(), VideoWidth, VideoHeight, headlessVideoFrames++);
+		headlessVideoBytes = (int)headlessVideoFrame.size();
+	}
+
+	// the socket is non-blocking: send what fits and keep the rest for the next call, so frames stay aligned
+	if (headlessVideoBytes > 0) {
+		int offset = (int)headlessVideoFrame.size() - headlessVideoBytes;
+		int ret = send(sClient_Image, (const char*)headlessVideoFrame.data() + offset, headlessVideoBytes, 0);
+		if (ret > 0) {
+			headlessVideoBytes -= ret;
+			if (headlessVideoBytes == 0) headlessVideoSent++;
+		}
+	}
+
+	// write TDPA observer samples collected since the last call
+	TDPA_Policy<3>::Telemetry telemetry;
+	while (TDPATelemetry.Pop(telemetry)) {
+		TDPA_Policy<3>::WriteTelemetry(TDPATelemetryFile, telemetry);
+	}
+
+	if (!headlessStatsClock.on()) headlessStatsClock.start(true);
+	double period = headlessStatsClock.getcurrentTimeSeconds();
+	if (period < HeadlessStatsPeriod) return;
+	headlessStatsClock.start(true);
+
+	// latest state published by the haptic thread
+	hapticFrame.update();
+	const HapticFrameState& frame = hapticFrame.get();
+
+	double rate = freqCounterHaptics.getFrequency();
+	headlessRateSum += rate;
+	headlessRateSum2 += rate * rate;
+	headlessRateCount++;
+
+	std::cout << "haptics " << cStr(rate, 0) << " Hz"
+		<< "  M2S delay " << cStr(frame.delay, 3) << " ms"
+		<< "  overruns " << hapticsThread->getOverrunCount()
+		<< "  jitter p99 " << cStr(1e6 * hapticsThread->getJitterPercentile(0.99), 0) << " us"
+		<< "  physics overruns " << physicsThread->getScheduler().getOverrunCount()
+		<< "  force " << cStr(frame.slaveForce.length(), 3) << " N"
+		<< "  video " << cStr(headlessVideoSent / period, 1) << " fps" << std::endl;
+	headlessVideoSent = 0;
+}
+
+//------------------------------------------------------------------------------
+
+void writeBenchmark(double runTime)
+{
+	benchmarkTotals.update();
+	const BenchmarkTotals& totals = benchmarkTotals.get();
+
+	double rateMean = headlessRateCount ? headlessRateSum / headlessRateCount : 0.0;
+	double rateVariance = headlessRateCount ? headlessRateSum2 / headlessRateCount - rateMean * rateMean : 0.0;
+
+	// parameters of the run, then its results
+	BenchmarkReport report;
+	report.Add("process", "slave");
+	report.Add("delay", ForceDelay);
+	report.Add("dynamicDelay", DynamicDelay);
+	report.Add("lossRate", PacketLossRate);
+	report.Add("forceDeadband", ForceDeadbandParameter);
+	report.Add("physicsRate", PhysicsRate);
+	report.Add("duration", runTime);
+	report.Add("hapticRate", rateMean);
+	report.Add("hapticRateStd", sqrt(cMax(0.0, rateVariance)));
+	report.Add("overruns", hapticsThread->getOverrunCount());
+	report.Add("jitterP99us", 1e6 * hapticsThread->getJitterPercentile(0.99));
+	report.Add("physicsOverruns", physicsThread->getScheduler().getOverrunCount());
+	report.Add("delayMeanMs", totals.commands ? totals.delaySum / totals.commands : 0.0);
+	report.Add("delayMaxMs", totals.delayMax);
+	report.Add("sentPerSecond", sender->sentCount / runTime);
+	report.Add("droppedPerSecond", sender->droppedCount / runTime);
+	report.Add("receivedPerSecond", totals.received / runTime);
+	report.Add("cpu", GetProcessCPUSeconds() / runTime);
+
+	if (report.Append(BenchmarkFile))
+		std::cout << "> Appended benchmark summary to " << BenchmarkFile << std::endl;
+	else
+		std::cout << "error - failed to write " << BenchmarkFile << std::endl;
+}
@@ -82,6 +82,7 @@
 #include "CBulletSphere.h"
 #include "CBulletStaticPlane.h"
 #include "CBulletVehicle.h"
+#include "CBulletPhysicsThread.h"
 
 
 //---------------------------------------------------------------------------
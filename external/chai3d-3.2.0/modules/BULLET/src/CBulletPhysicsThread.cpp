@@ -0,0 +1,433 @@
+//==============================================================================
+/*
+    Software License Agreement (BSD License)
+    Copyright (c) 2003-2016, CHAI3D.
+    (www.chai3d.org)
+
+    All rights reserved.
+
+    Redistribution and use in source and binary forms, with or without
+    modification, are permitted provided that the following conditions
+    are met:
+
+    * Redistributions of source code must retain the above copyright
+    notice, this list of conditions and the following disclaimer.
+
+    * Redistributions in binary form must reproduce the above
+    copyright notice, this list of conditions and the following
+    disclaimer in the documentation and/or other materials provided
+    with the distribution.
+
+    * Neither the name of CHAI3D nor the names of its contributors may
+    be used to endorse or promote products derived from this software
+    without specific prior written permission.
+
+    THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS
+    "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT
+    LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS
+    FOR A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE
+    COPYRIGHT OWNER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT,
+    INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING,
+    BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES;
+    LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER
+    CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT
+    LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN
+    ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+    POSSIBILITY OF SUCH DAMAGE. 
+
+    \author    <http://www.chai3d.org>
+    \version   3.2.0 $Rev: 2182 $
+*/
+//==============================================================================
+
+
+//------------------------------------------------------------------------------
+#include "CBulletPhysicsThread.h"
+//------------------------------------------------------------------------------
+using namespace std;
+//------------------------------------------------------------------------------
+
+//------------------------------------------------------------------------------
+namespace chai3d {
+//------------------------------------------------------------------------------
+
+//==============================================================================
+/*!
+    Constructor of cBulletPhysicsThread.
+
+    \param  a_world  Bullet world simulated by the thread.
+*/
+//==============================================================================
+cBulletPhysicsThread::cBulletPhysicsThread(cBulletWorld* a_world)
+{
+    m_world = a_world;
+    m_couplingTimeConstant = 0.005;
+    m_commandHead = 0;
+    m_commandTail = 0;
+    m_droppedCommands = 0;
+    m_lastStepTime = 0.0;
+
+    // the physics thread runs below the haptic thread
+    m_scheduler.setRealtimePriority(false);
+}
+
+
+//==============================================================================
+/*!
+    Destructor of cBulletPhysicsThread.
+*/
+//==============================================================================
+cBulletPhysicsThread::~cBulletPhysicsThread()
+{
+    stop();
+}
+
+
+//==============================================================================
+/*!
+    This method collects the dynamic bodies of the world (bodies with a 
+    rigid body that are not static) and starts the physics thread. Bodies
+    must not be added to or removed from the world while the thread runs.
+
+    \param  a_rate  Rate of the physics thread in Hz.
+*/
+//==============================================================================
+void cBulletPhysicsThread::start(const double a_rate)
+{
+    if (isRunning())
+    {
+        return;
+    }
+
+    m_bodies.clear();
+    m_objects.clear();
+    list<cBulletGenericObject*>::iterator i;
+    for (i = m_world->m_bodies.begin(); i != m_world->m_bodies.end(); ++i)
+    {
+        cBulletGenericObject* body = *i;
+        cGenericObject* object = dynamic_cast<cGenericObject*>(body);
+        if ((body->m_bulletRigidBody != NULL) && (!body->getStatic()) && (object != NULL))
+        {
+            m_bodies.push_back(body);
+            m_objects.push_back(object);
+        }
+    }
+
+    // initial states are the current poses of the CHAI3D objects
+    BodyState state;
+    state.m_linVel.zero();
+    state.m_angVel.zero();
+    m_coupledStates.clear();
+    for (unsigned int j=0; j<m_objects.size(); j++)
+    {
+        state.m_pos = m_objects[j]->getLocalPos();
+        state.m_rot.fromRotMat(m_objects[j]->getLocalRot());
+        m_coupledStates.push_back(state);
+    }
+    Frame frame;
+    frame.m_time = cPrecisionClock::getCPUTimeSeconds();
+    frame.m_bodies = m_coupledStates;
+    m_frames.reset(frame);
+    m_impulses.assign(2 * m_bodies.size(), cVector3d(0.0, 0.0, 0.0));
+
+    m_commandHead = 0;
+    m_commandTail = 0;
+    m_lastStepTime = 0.0;
+
+    m_scheduler.setRate(a_rate);
+    m_scheduler.startPeriodic(stepCallback, this, CTHREAD_PRIORITY_GRAPHICS);
+}
+
+
+//==============================================================================
+/*!
+    This method stops the physics thread and waits until the current step
+    has completed.
+*/
+//==============================================================================
+void cBulletPhysicsThread::stop()
+{
+    m_scheduler.stopPeriodic();
+}
+
+
+//==============================================================================
+/*!
+    This method applies a force to a body during a haptic interval. The force
+    is applied by the physics thread as part of the average force over its 
+    next step, so that the impulse is preserved whatever the two rates are.
+
+    \param  a_object       Body.
+    \param  a_force        Force in world coordinates.
+    \param  a_relativePos  Position of the force relative to the center of the body, in world coordinates.
+    \param  a_interval     Duration of the force (the haptic interval) in seconds.
+
+    \return __true__ if the command was queued, __false__ otherwise.
+*/
+//==============================================================================
+bool cBulletPhysicsThread::addExternalForceAtPoint(cBulletGenericObject* a_object, 
+                                                   const cVector3d& a_force, 
+                                                   const cVector3d& a_relativePos, 
+                                                   const double a_interval)
+{
+    Command command;
+    command.m_type = Command::FORCE_AT_POINT;
+    command.m_body = getBodyIndex(a_object);
+    command.m_vector0 = a_force;
+    command.m_vector1 = a_relativePos;
+    command.m_interval = a_interval;
+
+    if (command.m_body < 0)
+    {
+        return (false);
+    }
+
+    return (pushCommand(command));
+}
+
+
+//==============================================================================
+/*!
+    This method moves a body to a new pose and stops it. The CHAI3D object 
+    is moved immediately.
+
+    \param  a_object    Body.
+    \param  a_position  New position.
+    \param  a_rotation  New orientation.
+
+    \return __true__ if the command was queued, __false__ otherwise.
+*/
+//==============================================================================
+bool cBulletPhysicsThread::setBodyTransform(cBulletGenericObject* a_object, 
+                                            const cVector3d& a_position, 
+                                            const cMatrix3d& a_rotation)
+{
+    Command command;
+    command.m_type = Command::SET_TRANSFORM;
+    command.m_body = getBodyIndex(a_object);
+    command.m_vector0 = a_position;
+    command.m_rotation.fromRotMat(a_rotation);
+    command.m_interval = 0.0;
+
+    if (command.m_body < 0)
+    {
+        return (false);
+    }
+
+    BodyState& state = m_coupledStates[command.m_body];
+    state.m_pos = a_position;
+    state.m_rot = command.m_rotation;
+    m_objects[command.m_body]->cGenericObject::setLocalPos(a_position);
+    m_objects[command.m_body]->cGenericObject::setLocalRot(a_rotation);
+
+    return (pushCommand(command));
+}
+
+
+//==============================================================================
+/*!
+    This method moves the CHAI3D objects of the dynamic bodies towards the 
+    latest poses computed by the physics thread. It never blocks.\n
+
+    The latest pose of each body is extrapolated with its velocity to the 
+    current time (by at most two physics periods), and the CHAI3D object 
+    follows the result through a first order filter with the coupling time
+    constant. Only the CHAI3D pose is changed; the Bullet body is owned by 
+    the physics thread.
+
+    \param  a_interval  Time since the previous call (the haptic interval) in seconds.
+*/
+//==============================================================================
+void cBulletPhysicsThread::updatePositions(const double a_interval)
+{
+    // take the latest frame if the physics thread has published a new one
+    m_frames.update();
+    const Frame& frame = m_frames.get();
+
+    double age = cClamp(cPrecisionClock::getCPUTimeSeconds() - frame.m_time, 0.0, 2.0 * m_scheduler.getPeriod());
+    double level = (m_couplingTimeConstant > 0.0) ? cClamp(a_interval / (m_couplingTimeConstant + a_interval), 0.0, 1.0) : 1.0;
+
+    for (unsigned int i=0; i<m_objects.size(); i++)
+    {
+        const BodyState& published = frame.m_bodies[i];
+        BodyState& coupled = m_coupledStates[i];
+
+        // extrapolate the published pose to the current time
+        cVector3d targetPos = published.m_pos + age * published.m_linVel;
+        cQuaternion targetRot = published.m_rot;
+        double angle = age * published.m_angVel.length();
+        if (angle > 1e-9)
+        {
+            cQuaternion rotation;
+            rotation.fromAxisAngle(published.m_angVel, angle);
+            targetRot = rotation;
+            targetRot.mul(published.m_rot);
+        }
+
+        // virtual coupling: first order filter towards the target pose
+        coupled.m_pos = coupled.m_pos + level * (targetPos - coupled.m_pos);
+        if (coupled.m_rot.dot(targetRot) < 0.0)
+        {
+            targetRot.negate();
+        }
+        cQuaternion rot;
+        rot.slerp(level, coupled.m_rot, targetRot);
+        coupled.m_rot = rot;
+
+        cMatrix3d rotMat;
+        coupled.m_rot.toRotMat(rotMat);
+        m_objects[i]->cGenericObject::setLocalPos(coupled.m_pos);
+        m_objects[i]->cGenericObject::setLocalRot(rotMat);
+    }
+}
+
+
+//==============================================================================
+/*!
+    This method returns the index of a body simulated by the thread.
+
+    \param  a_object  Body.
+
+    \return Index of the body, or -1 if the body is not simulated by the thread.
+*/
+//==============================================================================
+int cBulletPhysicsThread::getBodyIndex(cBulletGenericObject* a_object) const
+{
+    for (unsigned int i=0; i<m_bodies.size(); i++)
+    {
+        if (m_bodies[i] == a_object)
+        {
+            return (i);
+        }
+    }
+    return (-1);
+}
+
+
+//==============================================================================
+/*!
+    This method pushes a command into the command ring. Commands are dropped
+    when the ring is full.
+
+    \param  a_command  Command.
+
+    \return __true__ if the command was queued, __false__ otherwise.
+*/
+//==============================================================================
+bool cBulletPhysicsThread::pushCommand(const Command& a_command)
+{
+    unsigned int head = m_commandHead.load(std::memory_order_relaxed);
+    if (head - m_commandTail.load(std::memory_order_acquire) >= (unsigned int)C_BULLET_COMMAND_RING_SIZE)
+    {
+        m_droppedCommands.store(m_droppedCommands.load(std::memory_order_relaxed) + 1, std::memory_order_relaxed);
+        return (false);
+    }
+
+    m_commands[head % C_BULLET_COMMAND_RING_SIZE] = a_command;
+    m_commandHead.store(head + 1, std::memory_order_release);
+    return (true);
+}
+
+
+//==============================================================================
+/*!
+    This method performs one step of the physics thread: it executes the 
+    pending commands, applies the average haptic forces, steps Bullet over 
+    the measured interval and publishes the new body states.
+*/
+//==============================================================================
+void cBulletPhysicsThread::step()
+{
+    double now = cPrecisionClock::getCPUTimeSeconds();
+    double interval = m_scheduler.getPeriod();
+    if (m_lastStepTime > 0.0)
+    {
+        interval = cClamp(now - m_lastStepTime, 0.0, 4.0 * m_scheduler.getPeriod());
+    }
+    m_lastStepTime = now;
+
+    // execute commands
+    unsigned int tail = m_commandTail.load(std::memory_order_relaxed);
+    unsigned int head = m_commandHead.load(std::memory_order_acquire);
+    for (; tail != head; tail++)
+    {
+        const Command& command = m_commands[tail % C_BULLET_COMMAND_RING_SIZE];
+        btRigidBody* body = m_bodies[command.m_body]->m_bulletRigidBody;
+
+        if (command.m_type == Command::FORCE_AT_POINT)
+        {
+            // accumulate the impulse of the force and of its torque
+            m_impulses[2 * command.m_body] += command.m_interval * command.m_vector0;
+            m_impulses[2 * command.m_body + 1] += command.m_interval * cCross(command.m_vector1, command.m_vector0);
+        }
+        else
+        {
+            btTransform trans;
+            trans.setOrigin(btVector3(command.m_vector0(0), command.m_vector0(1), command.m_vector0(2)));
+            trans.setRotation(btQuaternion(command.m_rotation.x, command.m_rotation.y, command.m_rotation.z, command.m_rotation.w));
+            body->getMotionState()->setWorldTransform(trans);
+            body->setCenterOfMassTransform(trans);
+            body->setLinearVelocity(btVector3(0, 0, 0));
+            body->setAngularVelocity(btVector3(0, 0, 0));
+        }
+    }
+    m_commandTail.store(tail, std::memory_order_release);
+
+    if (interval <= 0.0)
+    {
+        return;
+    }
+
+    // apply the average haptic force over the step
+    for (unsigned int i=0; i<m_bodies.size(); i++)
+    {
+        cVector3d force = (1.0 / interval) * m_impulses[2 * i];
+        cVector3d torque = (1.0 / interval) * m_impulses[2 * i + 1];
+        m_bodies[i]->m_bulletRigidBody->applyCentralForce(btVector3(force(0), force(1), force(2)));
+        m_bodies[i]->m_bulletRigidBody->applyTorque(btVector3(torque(0), torque(1), torque(2)));
+        m_impulses[2 * i].zero();
+        m_impulses[2 * i + 1].zero();
+    }
+
+    // step Bullet only; CHAI3D objects are updated by the haptic thread
+    m_world->m_bulletWorld->stepSimulation(interval, m_world->getIntegrationMaxIterations(), m_world->getIntegrationTimeStep());
+
+    // publish the body states
+    Frame& frame = m_frames.edit();
+    for (unsigned int i=0; i<m_bodies.size(); i++)
+    {
+        btRigidBody* body = m_bodies[i]->m_bulletRigidBody;
+        btTransform trans;
+        body->getMotionState()->getWorldTransform(trans);
+        btVector3 pos = trans.getOrigin();
+        btQuaternion q = trans.getRotation();
+        btVector3 linVel = body->getLinearVelocity();
+        btVector3 angVel = body->getAngularVelocity();
+
+        BodyState& state = frame.m_bodies[i];
+        state.m_pos.set(pos[0], pos[1], pos[2]);
+        state.m_rot = cQuaternion(q.getW(), q.getX(), q.getY(), q.getZ());
+        state.m_linVel.set(linVel[0], linVel[1], linVel[2]);
+        state.m_angVel.set(angVel[0], angVel[1], angVel[2]);
+    }
+    frame.m_time = now;
+    m_frames.publish();
+}
+
+
+//==============================================================================
+/*!
+    Tick function of the physics thread.
+
+    \param  a_physicsThread  Pointer to the physics thread.
+*/
+//==============================================================================
+void cBulletPhysicsThread::stepCallback(void* a_physicsThread)
+{
+    ((cBulletPhysicsThread*)a_physicsThread)->step();
+}
+
+
+//------------------------------------------------------------------------------
+} // namespace chai3d
+//------------------------------------------------------------------------------
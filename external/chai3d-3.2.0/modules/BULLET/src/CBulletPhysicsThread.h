@@ -0,0 +1,284 @@
+//==============================================================================
+/*
+    Software License Agreement (BSD License)
+    Copyright (c) 2003-2016, CHAI3D.
+    (www.chai3d.org)
+
+    All rights reserved.
+
+    Redistribution and use in source and binary forms, with or without
+    modification, are permitted provided that the following conditions
+    are met:
+
+    * Redistributions of source code must retain the above copyright
+    notice, this list of conditions and the following disclaimer.
+
+    * Redistributions in binary form must reproduce the above
+    copyright notice, this list of conditions and the following
+    disclaimer in the documentation and/or other materials provided
+    with the distribution.
+
+    * Neither the name of CHAI3D nor the names of its contributors may
+    be used to endorse or promote products derived from this software
+    without specific prior written permission.
+
+    THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS
+    "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT
+    LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS
+    FOR A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE
+    COPYRIGHT OWNER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT,
+    INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING,
+    BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES;
+    LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER
+    CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT
+    LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN
+    ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+    POSSIBILITY OF SUCH DAMAGE. 
+
+    \author    <http://www.chai3d.org>
+    \version   3.2.0 $Rev: 2182 $
+*/
+//==============================================================================
+
+
+//------------------------------------------------------------------------------
+#ifndef CBulletPhysicsThreadH
+#define CBulletPhysicsThreadH
+//------------------------------------------------------------------------------
+#include "CBulletWorld.h"
+#include "system/CStateSnapshot.h"
+#include <atomic>
+#include <vector>
+//------------------------------------------------------------------------------
+
+//------------------------------------------------------------------------------
+namespace chai3d {
+//------------------------------------------------------------------------------
+
+//==============================================================================
+/*!
+    \file       CBulletPhysicsThread.h
+
+    \brief
+    Implementation of a Bullet simulation running on its own thread.
+*/
+//==============================================================================
+
+//------------------------------------------------------------------------------
+//! Capacity of the command ring between the haptic thread and the physics thread.
+const int C_BULLET_COMMAND_RING_SIZE = 1024;
+//------------------------------------------------------------------------------
+
+
+//==============================================================================
+/*!
+    \class      cBulletPhysicsThread
+    \ingroup    Bullet
+
+    \brief
+    This class steps a Bullet world on its own thread.
+
+    \details
+    cBulletPhysicsThread decouples the Bullet simulation of a __cBulletWorld__
+    from the haptic loop. Bullet is stepped at its own rate by a 
+    __cRealtimeScheduler__, so that the haptic loop keeps its rate 
+    regardless of the complexity of the scene.\n
+
+    The two threads never share Bullet or CHAI3D state. The haptic thread 
+    sends contact forces and pose changes through a lock-free command ring.
+    The physics thread sends the poses and velocities of the dynamic bodies 
+    back through a __cStateSnapshot__, which the haptic thread reads without 
+    blocking in updatePositions().\n
+
+    Two mechanisms keep the coupling stable across the rate boundary. 
+    Forces are converted to impulses with the haptic interval and applied
+    as their average over the physics step, so no impulse is lost or 
+    counted twice when the rates differ. On the haptic side, the CHAI3D 
+    object of each body follows the Bullet pose, extrapolated with the
+    published velocity, through a first order virtual coupling. This avoids
+    steps in the rendered surfaces (and forces) at the physics rate.\n
+
+    Only one haptic thread may send commands and call updatePositions().
+*/
+//==============================================================================
+class cBulletPhysicsThread
+{
+    //--------------------------------------------------------------------------
+    // CONSTRUCTOR & DESTRUCTOR:
+    //--------------------------------------------------------------------------
+
+public:
+
+    //! Constructor of cBulletPhysicsThread.
+    cBulletPhysicsThread(cBulletWorld* a_world);
+
+    //! Destructor of cBulletPhysicsThread.
+    virtual ~cBulletPhysicsThread();
+
+
+    //--------------------------------------------------------------------------
+    // PUBLIC METHODS:
+    //--------------------------------------------------------------------------
+
+public:
+
+    //! This method collects the dynamic bodies of the world and starts the physics thread.
+    void start(const double a_rate = 1000.0);
+
+    //! This method stops the physics thread.
+    void stop();
+
+    //! This method returns __true__ if the physics thread is running.
+    bool isRunning() const { return (m_scheduler.isRunning()); }
+
+    //! This method returns the scheduler of the physics thread (rate, affinity and timing statistics).
+    cRealtimeScheduler& getScheduler() { return (m_scheduler); }
+
+    //! This method sets the time constant in seconds of the virtual coupling (0: no filtering).
+    void setCouplingTimeConstant(const double a_timeConstant) { m_couplingTimeConstant = cMax(0.0, a_timeConstant); }
+
+    //! This method returns the time constant in seconds of the virtual coupling.
+    double getCouplingTimeConstant() const { return (m_couplingTimeConstant); }
+
+    //! This method returns the number of commands dropped because the command ring was full.
+    unsigned int getNumDroppedCommands() const { return (m_droppedCommands.load(std::memory_order_relaxed)); }
+
+
+    //--------------------------------------------------------------------------
+    // PUBLIC METHODS - HAPTIC THREAD:
+    //--------------------------------------------------------------------------
+
+public:
+
+    //! This method applies a force at a position relative to the center of a body during a haptic interval.
+    bool addExternalForceAtPoint(cBulletGenericObject* a_object, const cVector3d& a_force, const cVector3d& a_relativePos, const double a_interval);
+
+    //! This method moves a body to a new pose and stops it.
+    bool setBodyTransform(cBulletGenericObject* a_object, const cVector3d& a_position, const cMatrix3d& a_rotation);
+
+    //! This method moves the CHAI3D objects towards the latest poses computed by the physics thread.
+    void updatePositions(const double a_interval);
+
+
+    //--------------------------------------------------------------------------
+    // PROTECTED TYPES:
+    //--------------------------------------------------------------------------
+
+protected:
+
+    //! Command sent from the haptic thread to the physics thread.
+    struct Command
+    {
+        enum Type { FORCE_AT_POINT, SET_TRANSFORM };
+
+        //! Type of the command.
+        Type m_type;
+
+        //! Index of the body.
+        int m_body;
+
+        //! Force, or position of the body.
+        cVector3d m_vector0;
+
+        //! Relative position of the force.
+        cVector3d m_vector1;
+
+        //! Orientation of the body.
+        cQuaternion m_rotation;
+
+        //! Duration of the force in seconds.
+        double m_interval;
+    };
+
+    //! State of a body published by the physics thread.
+    struct BodyState
+    {
+        cVector3d m_pos;
+        cQuaternion m_rot;
+        cVector3d m_linVel;
+        cVector3d m_angVel;
+    };
+
+    //! Set of body states published at once.
+    struct Frame
+    {
+        //! Time at which the frame was computed (cPrecisionClock::getCPUTimeSeconds()).
+        double m_time;
+
+        //! States of the bodies.
+        std::vector<BodyState> m_bodies;
+    };
+
+
+    //--------------------------------------------------------------------------
+    // PROTECTED METHODS:
+    //--------------------------------------------------------------------------
+
+protected:
+
+    //! This method returns the index of a body, or -1 if the body is not simulated by the thread.
+    int getBodyIndex(cBulletGenericObject* a_object) const;
+
+    //! This method pushes a command into the command ring.
+    bool pushCommand(const Command& a_command);
+
+    //! This method performs one step of the physics thread.
+    void step();
+
+    //! Tick function of the physics thread.
+    static void stepCallback(void* a_physicsThread);
+
+
+    //--------------------------------------------------------------------------
+    // PROTECTED MEMBERS:
+    //--------------------------------------------------------------------------
+
+protected:
+
+    //! Bullet world.
+    cBulletWorld* m_world;
+
+    //! Scheduler of the physics thread.
+    cRealtimeScheduler m_scheduler;
+
+    //! Dynamic bodies simulated by the thread.
+    std::vector<cBulletGenericObject*> m_bodies;
+
+    //! CHAI3D objects of the dynamic bodies.
+    std::vector<cGenericObject*> m_objects;
+
+    //! Time constant of the virtual coupling.
+    double m_couplingTimeConstant;
+
+    //! Command ring.
+    Command m_commands[C_BULLET_COMMAND_RING_SIZE];
+
+    //! Next command written by the haptic thread.
+    std::atomic<unsigned int> m_commandHead;
+
+    //! Next command read by the physics thread.
+    std::atomic<unsigned int> m_commandTail;
+
+    //! Number of commands dropped because the ring was full.
+    std::atomic<unsigned int> m_droppedCommands;
+
+    //! Body states published by the physics thread.
+    cStateSnapshot<Frame> m_frames;
+
+    //! Time of the previous physics step.
+    double m_lastStepTime;
+
+    //! Impulses accumulated by the physics thread over a step (force, torque per body).
+    std::vector<cVector3d> m_impulses;
+
+    //! Poses of the CHAI3D objects, as seen by the haptic thread.
+    std::vector<BodyState> m_coupledStates;
+};
+
+//------------------------------------------------------------------------------
+} // namespace chai3d
+//------------------------------------------------------------------------------
+
+//------------------------------------------------------------------------------
+#endif
+//------------------------------------------------------------------------------
@@ -72,11 +72,13 @@
 #include "devices/CGenericDevice.h"
 #include "devices/CGenericHapticDevice.h"
 #include "devices/CHapticDeviceHandler.h"
+#include "devices/CMultirateHapticDevice.h"
 #include "devices/CMyCustomDevice.h"
 #include "devices/CDeltaDevices.h"
 #include "devices/CLeapDevices.h"
 #include "devices/CPhantomDevices.h"
 #include "devices/CSixenseDevices.h"
+#include "devices/CTraceHapticDevice.h"
 
 
 //---------------------------------------------------------------------------
@@ -167,6 +169,7 @@
 #include "world/CShapeLine.h"
 #include "world/CShapeSphere.h"
 #include "world/CShapeTorus.h"
+#include "world/CVoxelBrickMap.h"
 #include "world/CVoxelObject.h"
 #include "world/CWorld.h"
 
@@ -220,6 +223,7 @@
 #include "forces/CAlgorithmFingerProxy.h"
 #include "forces/CAlgorithmPotentialField.h"
 #include "forces/CInteractionBasics.h"
+#include "forces/CLocalContactModel.h"
 
 
 //---------------------------------------------------------------------------
@@ -230,13 +234,16 @@
 #include "collisions/CCollisionBasics.h"
 #include "collisions/CCollisionBrute.h"
 #include "collisions/CCollisionAABB.h"
+#include "collisions/CCollisionBroadphase.h"
+#include "collisions/CCollisionSDF.h"
 
 
 //---------------------------------------------------------------------------
 //! \defgroup   timers  Timers
-//! \brief      Implements a frequency counter and high precision clock.
+//! \brief      Implements a frequency counter, high precision clock and phase profiler.
 //---------------------------------------------------------------------------
 #include "timers/CFrequencyCounter.h"
+#include "timers/CPhaseProfiler.h"
 #include "timers/CPrecisionClock.h"
 
 
@@ -261,9 +268,12 @@
 //! \defgroup   system  System
 //! \brief      Implements general capabilities that are OS dependent.
 //---------------------------------------------------------------------------
+#include "system/CAllocationCounter.h"
 #include "system/CGenericType.h"
 #include "system/CGlobals.h"
 #include "system/CMutex.h"
+#include "system/CRealtimeScheduler.h"
+#include "system/CStateSnapshot.h"
 #include "system/CString.h"
 #include "system/CThread.h"
 
@@ -47,6 +47,10 @@
 #include "collisions/CCollisionAABB.h"
 //------------------------------------------------------------------------------
 #include <iostream>
+#include <thread>
+#include <cfloat>
+#include <chrono>
+#include <atomic>
 //------------------------------------------------------------------------------
 using namespace std;
 //------------------------------------------------------------------------------
@@ -55,6 +59,51 @@ using namespace std;
 namespace chai3d {
 //------------------------------------------------------------------------------
 
+//! Last version assigned to a collision tree. Versions are unique across all trees.
+static std::atomic<unsigned long long> s_lastTreeVersion(0);
+
+
+//==============================================================================
+/*!
+    Constructor of cCollisionAABBCache.
+*/
+//==============================================================================
+cCollisionAABBCache::cCollisionAABBCache()
+{
+    m_margin = C_AABB_CACHE_DEFAULT_MARGIN;
+    m_numQueries = 0;
+    m_numHits = 0;
+    m_numMisses = 0;
+
+    // reserve memory so that queries do not allocate memory
+    for (int i=0; i<C_AABB_CACHE_NUM_ENTRIES; i++)
+    {
+        m_entries[i].m_leaves.reserve(C_AABB_CACHE_NUM_LEAVES);
+    }
+
+    clear();
+}
+
+
+//==============================================================================
+/*!
+    This method discards all neighbourhoods stored in the cache.
+*/
+//==============================================================================
+void cCollisionAABBCache::clear()
+{
+    for (int i=0; i<C_AABB_CACHE_NUM_ENTRIES; i++)
+    {
+        cCollisionAABBCacheEntry& entry = m_entries[i];
+        entry.m_tree = NULL;
+        entry.m_version = 0;
+        entry.m_leaves.clear();
+        entry.m_overflow = false;
+        entry.m_lastQuery = 0;
+    }
+}
+
+
 //==============================================================================
 /*!
     Constructor of cCollisionAABB.
@@ -78,6 +127,18 @@ cCollisionAABB::cCollisionAABB()
     m_rootIndex = -1;
     m_maxDepth = 0;
     m_radius = 0.0;
+    m_buildMethod = C_AABB_BUILD_MIDPOINT;
+    m_numBuildThreads = 0;
+
+    // refit settings
+    m_nodesOutdated = false;
+    m_rebuildThreshold = 2.0;
+    m_buildCost = 0.0;
+    m_cost = 0.0;
+    m_rebuildTree = NULL;
+
+    // no version until the tree is built
+    m_version = 0;
 }
 
 
@@ -88,6 +149,9 @@ cCollisionAABB::cCollisionAABB()
 //==============================================================================
 cCollisionAABB::~cCollisionAABB()
 {
+    // wait for background rebuild to complete
+    cancelRebuild();
+
     // clear all nodes
     m_nodes.clear();
 }
@@ -104,16 +168,22 @@ cCollisionAABB::~cCollisionAABB()
     with a boundary box of minimal dimensions such that it fully encloses
     the boundary boxes of its two children and is aligned with the axes.
 
-    \param  a_elements  Pointer to element array.
-    \param  a_radius    Bounding radius to add around each elements.
+    \param  a_elements     Pointer to element array.
+    \param  a_radius       Bounding radius to add around each elements.
+    \param  a_buildMethod  Algorithm used to build the tree.
 */
 //==============================================================================
-void cCollisionAABB::initialize(const cGenericArrayPtr a_elements, const double a_radius)
+void cCollisionAABB::initialize(const cGenericArrayPtr a_elements, 
+                                const double a_radius,
+                                const cCollisionAABBBuildMethod a_buildMethod)
 {
     ////////////////////////////////////////////////////////////////////////////
     // INITIALIZATION
     ////////////////////////////////////////////////////////////////////////////
 
+    // discard any tree being rebuilt in background
+    cancelRebuild();
+
     // sanity check
     if (a_elements == nullptr)
     {
@@ -122,11 +192,15 @@ void cCollisionAABB::initialize(const cGenericArrayPtr a_elements, const double
     }
     m_elements = a_elements;
 
-    // store radius
+    // store radius and build method
     m_radius = a_radius;
+    m_buildMethod = a_buildMethod;
 
     // clear previous tree
     m_nodes.clear();
+    m_compactNodes.clear();
+    m_compactElements.clear();
+    m_compactNodeSources.clear();
 
     // get number of elements
     m_numElements = m_elements->getNumElements();
@@ -146,106 +220,390 @@ void cCollisionAABB::initialize(const cGenericArrayPtr a_elements, const double
     // CREATE LEAF NODES
     ////////////////////////////////////////////////////////////////////////////
 
-    // get number of vertices per element
-    int numVerticesPerElement = m_elements->getNumVerticesPerElement();
+    // a binary tree with n leaves holds 2n-1 nodes
+    m_nodes.reserve(2 * m_numElements - 1);
 
-    switch (numVerticesPerElement)
+    // create leaf node for each element
+    for (int i=0; i<m_numElements; ++i)
     {
-    case 1:
+        cCollisionAABBNode leaf;
+
+        leaf.m_leftSubTree = i;
+        leaf.m_nodeType = C_AABB_NODE_LEAF;
+        fitLeaf(leaf);
+
+        // add leaf to list
+        m_nodes.push_back(leaf);
+    }
+
+    // build tree above the leaves
+    buildFromLeaves();
+}
+
+
+//==============================================================================
+/*!
+    This method builds the collision tree above the leaves stored at the 
+    beginning of \ref m_nodes, one per element, and flattens it into its 
+    compact representation. The elements themselves are not accessed, so 
+    that a tree can be built on another thread from a copy of the leaves.
+*/
+//==============================================================================
+void cCollisionAABB::buildFromLeaves()
+{
+    ////////////////////////////////////////////////////////////////////////////
+    // CREATE TREE
+    ////////////////////////////////////////////////////////////////////////////
+    int indexFirst = 0;
+    int indexLast = m_numElements - 1;
+    int depth = 0;
+
+    if ((m_numElements > 1) && (m_buildMethod == C_AABB_BUILD_SAH))
+    {
+        // internal nodes are stored after the leaves, starting with the root
+        m_nodes.resize(2 * m_numElements - 1);
+
+        // number of recursion levels on which subtrees are built in parallel
+        int numThreadLevels = 0;
+        unsigned int numThreads = (m_numBuildThreads > 0) ? m_numBuildThreads : std::thread::hardware_concurrency();
+        while ((1u << numThreadLevels) < numThreads)
         {
-            // create leaf node for each element
-            for (int i=0; i<m_numElements; ++i)
+            numThreadLevels++;
+        }
+
+        // copy boundary boxes of leaves into a compact working list, which is
+        // partitioned by the builder instead of the leaves themselves
+        std::vector<cCollisionAABBBuildItem> items(m_numElements);
+        for (int i=0; i<m_numElements; i++)
+        {
+            for (int k=0; k<3; k++)
             {
-                // get position of vertices
-                cVector3d vertex0 = m_elements->m_vertices->getLocalPos(m_elements->getVertexIndex(i, 0));
+                items[i].m_min[k] = m_nodes[i].m_bbox.m_min(k);
+                items[i].m_max[k] = m_nodes[i].m_bbox.m_max(k);
+                items[i].m_center[k] = m_nodes[i].m_bbox.m_center(k);
+            }
+            items[i].m_leafIndex = i;
+            items[i].m_depth = 0;
+        }
 
-                // create leaf node
-                cCollisionAABBNode leaf;
+        m_rootIndex = m_numElements;
+        m_maxDepth = buildTreeSAH(&items[0], indexFirst, indexLast, m_rootIndex, depth, numThreadLevels);
 
-                leaf.fitBBox(m_radius, vertex0);
-                leaf.m_leftSubTree = i;
-                leaf.m_nodeType = C_AABB_NODE_LEAF;
+        // reorder leaves to match the order of the working list
+        std::vector<cCollisionAABBNode> leaves(m_nodes.begin(), m_nodes.begin() + m_numElements);
+        for (int i=0; i<m_numElements; i++)
+        {
+            m_nodes[i] = leaves[items[i].m_leafIndex];
+            m_nodes[i].m_depth = items[i].m_depth;
+        }
+    }
+    else if (m_numElements > 1)
+    {
+        m_rootIndex = buildTree(indexFirst, indexLast, depth);
+    }
+    else
+    {
+        m_rootIndex = 0;
+    }
+
+
+    ////////////////////////////////////////////////////////////////////////////
+    // CREATE COMPACT TREE
+    ////////////////////////////////////////////////////////////////////////////
+    buildCompactTree();
+}
+
+
+//==============================================================================
+/*!
+    This methods updates the collision detector and should be called if the 
+    3D model it represents is modified.
+*/
+//==============================================================================
+void cCollisionAABB::update()
+{
+    initialize(m_elements, m_radius, m_buildMethod);
+}
+
+
+//==============================================================================
+/*!
+    This method refits the collision tree to the current positions of the 
+    vertices of the elements, and should be called instead of \ref update() 
+    when the 3D model it represents is deformed but its elements remain the 
+    same. \n\n
+
+    The boundary boxes of the leaves are recomputed and propagated to their 
+    parents in a single bottom-up sweep of the compact tree, in O(n) time. 
+    The structure of the tree is left unchanged, so its quality degrades as 
+    elements move away from their initial positions. The cost of the tree is
+    therefore monitored at each refit, and when it exceeds the cost of the 
+    tree at build time by the factor set with \ref setRebuildThreshold(), a 
+    new tree is built on a background thread. The new tree replaces the 
+    current one at the first refit that follows its completion. \n\n
+
+    As for \ref update(), this method must not be called while the tree is 
+    being queried by another thread.
+*/
+//==============================================================================
+void cCollisionAABB::refit()
+{
+    // sanity check
+    if ((m_elements == nullptr) || (m_rootIndex == -1))
+    {
+        return;
+    }
+
+    // if the number of elements has changed, the tree must be rebuilt
+    if ((int)(m_elements->getNumElements()) != m_numElements)
+    {
+        update();
+        return;
+    }
 
-                // add leaf to list
-                m_nodes.push_back(leaf);
+    // if a tree has been rebuilt in background, it replaces the current tree
+    bool rebuilt = false;
+    if ((m_rebuildTree != NULL) &&
+        (m_rebuildTask.wait_for(std::chrono::seconds(0)) == std::future_status::ready))
+    {
+        m_rebuildTask.get();
+        m_nodes.swap(m_rebuildTree->m_nodes);
+        m_compactNodes.swap(m_rebuildTree->m_compactNodes);
+        m_compactElements.swap(m_rebuildTree->m_compactElements);
+        m_compactNodeSources.swap(m_rebuildTree->m_compactNodeSources);
+        m_rootIndex = m_rebuildTree->m_rootIndex;
+        m_maxDepth = m_rebuildTree->m_maxDepth;
+        delete m_rebuildTree;
+        m_rebuildTree = NULL;
+        rebuilt = true;
+    }
+
+    ////////////////////////////////////////////////////////////////////////////
+    // REFIT COMPACT TREE
+    ////////////////////////////////////////////////////////////////////////////
+
+    // children are stored after their parents in the compact tree, so a 
+    // reverse sweep visits each node after its children. Only the compact
+    // tree, which is traversed by queries, is refitted; the boxes of the
+    // nodes are updated when they are rendered
+    double cost = 0.0;
+    int numNodes = (int)m_compactNodes.size();
+    int numVerticesPerElement = (int)m_elements->getNumVerticesPerElement();
+    const unsigned int* indices = &m_elements->m_indices[0];
+    const cVector3d* positions = &m_elements->m_vertices->m_localPos[0];
+    cCollisionAABBCompactNode* nodes = &m_compactNodes[0];
+
+    for (int i=numNodes-1; i>=0; i--)
+    {
+        cCollisionAABBCompactNode& node = nodes[i];
+
+        if (node.isLeaf())
+        {
+            fitCompactLeaf(node, numVerticesPerElement, indices, positions);
+        }
+        else
+        {
+            const cCollisionAABBCompactNode& left = nodes[i+1];
+            const cCollisionAABBCompactNode& right = nodes[node.m_index];
+            for (int k=0; k<3; k++)
+            {
+                node.m_min[k] = cMin(left.m_min[k], right.m_min[k]);
+                node.m_max[k] = cMax(left.m_max[k], right.m_max[k]);
             }
-            break;
+
+            // accumulate cost of tree
+            cost += node.getSurfaceArea();
         }
+    }
 
-    case 2:
+    m_nodesOutdated = true;
+
+    ////////////////////////////////////////////////////////////////////////////
+    // MONITOR QUALITY
+    ////////////////////////////////////////////////////////////////////////////
+
+    // cost is normalized by the area of the root node
+    double rootArea = nodes[0].getSurfaceArea();
+    m_cost = (rootArea > 0.0) ? (cost / rootArea) : 0.0;
+
+    // a rebuilt tree was built from older vertex positions; its refitted cost
+    // is the new reference
+    if (rebuilt)
+    {
+        m_buildCost = m_cost;
+    }
+
+    // start a rebuild in background if the tree has degraded. The new tree 
+    // is built from a copy of the refitted leaves, since the vertices may be 
+    // modified by the caller while the build is in progress
+    else if ((m_rebuildThreshold > 0.0) && 
+             (m_rebuildTree == NULL) && 
+             (m_cost > m_rebuildThreshold * m_buildCost))
+    {
+        m_rebuildTree = new cCollisionAABB();
+        cCollisionAABB* tree = m_rebuildTree;
+        tree->m_radius = m_radius;
+        tree->m_buildMethod = m_buildMethod;
+        tree->m_numBuildThreads = m_numBuildThreads;
+        tree->m_numElements = m_numElements;
+        tree->m_nodes.reserve(2 * m_numElements - 1);
+        for (int i=0; i<numNodes; i++)
         {
-            // create leaf node for each element
-            for (int i=0; i<m_numElements; ++i)
+            const cCollisionAABBCompactNode& node = nodes[i];
+            for (int j=0; j<node.m_count; j++)
             {
-                // get position of vertices
-                cVector3d vertex0 = m_elements->m_vertices->getLocalPos(m_elements->getVertexIndex(i, 0));
-                cVector3d vertex1 = m_elements->m_vertices->getLocalPos(m_elements->getVertexIndex(i, 1));
-
-                // create leaf node
                 cCollisionAABBNode leaf;
-
-                leaf.fitBBox(m_radius, vertex0, vertex1);
-                leaf.m_leftSubTree = i;
+                leaf.m_leftSubTree = m_compactElements[node.m_index + j];
                 leaf.m_nodeType = C_AABB_NODE_LEAF;
-
-                // add leaf to list
-                m_nodes.push_back(leaf);
+                leaf.m_bbox.setValue(cVector3d(node.m_min[0], node.m_min[1], node.m_min[2]),
+                                     cVector3d(node.m_max[0], node.m_max[1], node.m_max[2]));
+                tree->m_nodes.push_back(leaf);
             }
+        }
+
+        m_rebuildTask = std::async(std::launch::async, [tree]()
+        {
+            tree->buildFromLeaves();
+        });
+    }
+
+    // invalidate neighbourhoods stored in caches
+    m_version = ++s_lastTreeVersion;
+}
+
+
+//==============================================================================
+/*!
+    This method waits for any tree being rebuilt in background and discards it.
+*/
+//==============================================================================
+void cCollisionAABB::cancelRebuild()
+{
+    if (m_rebuildTree != NULL)
+    {
+        m_rebuildTask.wait();
+        m_rebuildTask = std::future<void>();
+        delete m_rebuildTree;
+        m_rebuildTree = NULL;
+    }
+}
+
+
+//==============================================================================
+/*!
+    This method recomputes the boundary box of a leaf from the current 
+    position of the vertices of its element.
+
+    \param  a_leaf  Leaf node. Its left subtree holds the index of its element.
+*/
+//==============================================================================
+void cCollisionAABB::fitLeaf(cCollisionAABBNode& a_leaf) const
+{
+    int index = a_leaf.m_leftSubTree;
+
+    switch (m_elements->getNumVerticesPerElement())
+    {
+    case 1:
+        {
+            // get position of vertices
+            cVector3d vertex0 = m_elements->m_vertices->getLocalPos(m_elements->getVertexIndex(index, 0));
+
+            a_leaf.fitBBox(m_radius, vertex0);
             break;
         }
 
-    case 3:
+    case 2:
         {
-            // create leaf node for each element
-            for (int i=0; i<m_numElements; ++i)
-            {
-                // get position of vertices
-                cVector3d vertex0 = m_elements->m_vertices->getLocalPos(m_elements->getVertexIndex(i, 0));
-                cVector3d vertex1 = m_elements->m_vertices->getLocalPos(m_elements->getVertexIndex(i, 1));
-                cVector3d vertex2 = m_elements->m_vertices->getLocalPos(m_elements->getVertexIndex(i, 2));
+            // get position of vertices
+            cVector3d vertex0 = m_elements->m_vertices->getLocalPos(m_elements->getVertexIndex(index, 0));
+            cVector3d vertex1 = m_elements->m_vertices->getLocalPos(m_elements->getVertexIndex(index, 1));
 
-                // create leaf node
-                cCollisionAABBNode leaf;
+            a_leaf.fitBBox(m_radius, vertex0, vertex1);
+            break;
+        }
 
-                leaf.fitBBox(m_radius, vertex0, vertex1, vertex2);
-                leaf.m_leftSubTree = i;
-                leaf.m_nodeType = C_AABB_NODE_LEAF;
+    case 3:
+        {
+            // get position of vertices
+            cVector3d vertex0 = m_elements->m_vertices->getLocalPos(m_elements->getVertexIndex(index, 0));
+            cVector3d vertex1 = m_elements->m_vertices->getLocalPos(m_elements->getVertexIndex(index, 1));
+            cVector3d vertex2 = m_elements->m_vertices->getLocalPos(m_elements->getVertexIndex(index, 2));
 
-                // add leaf to list
-                m_nodes.push_back(leaf);
-            }
+            a_leaf.fitBBox(m_radius, vertex0, vertex1, vertex2);
             break;
         }
     }
+}
 
 
-    ////////////////////////////////////////////////////////////////////////////
-    // CREATE TREE
-    ////////////////////////////////////////////////////////////////////////////
-    int indexFirst = 0;
-    int indexLast = m_numElements - 1;
-    int depth = 0;
+//==============================================================================
+/*!
+    This method recomputes the boundary box of a leaf of the compact tree 
+    from the current position of the vertices of its elements.
 
-    if (m_numElements > 1)
-    {
-        m_rootIndex = buildTree(indexFirst, indexLast, depth);
-    }
-    else
+    \param  a_node                   Leaf of the compact tree.
+    \param  a_numVerticesPerElement  Number of vertices of each element.
+    \param  a_indices                Vertex indices of the elements.
+    \param  a_positions              Positions of the vertices.
+*/
+//==============================================================================
+void cCollisionAABB::fitCompactLeaf(cCollisionAABBCompactNode& a_node,
+                                    const int a_numVerticesPerElement,
+                                    const unsigned int* a_indices,
+                                    const cVector3d* a_positions) const
+{
+    cVector3d min( C_LARGE, C_LARGE, C_LARGE);
+    cVector3d max(-C_LARGE,-C_LARGE,-C_LARGE);
+
+    for (int i=0; i<a_node.m_count; i++)
     {
-        m_rootIndex = 0;
+        const unsigned int* vertexIndices = a_indices + a_numVerticesPerElement * m_compactElements[a_node.m_index + i];
+        for (int j=0; j<a_numVerticesPerElement; j++)
+        {
+            const cVector3d& vertex = a_positions[vertexIndices[j]];
+            for (int k=0; k<3; k++)
+            {
+                min(k) = cMin(min(k), vertex(k));
+                max(k) = cMax(max(k), vertex(k));
+            }
+        }
     }
+
+    // add radius envelope
+    min.sub(m_radius, m_radius, m_radius);
+    max.add(m_radius, m_radius, m_radius);
+
+    a_node.setBBox(min, max);
 }
 
 
 //==============================================================================
 /*!
-    This methods updates the collision detector and should be called if the 
-    3D model it represents is modified.
+    This method computes the cost of the collision tree, defined as the sum of
+    the surface areas of its internal nodes divided by the surface area of its 
+    root. This value is proportional to the expected number of internal nodes 
+    visited by a random segment query.
+
+    \return Cost of the tree.
 */
 //==============================================================================
-void cCollisionAABB::update()
+double cCollisionAABB::computeTreeCost() const
 {
-    initialize(m_elements, m_radius);
+    if (m_compactNodes.size() == 0) { return (0.0); }
+
+    // boxes of the compact tree are those refitted by refit()
+    double cost = 0.0;
+    int numNodes = (int)m_compactNodes.size();
+    for (int i=0; i<numNodes; i++)
+    {
+        if (!m_compactNodes[i].isLeaf())
+        {
+            cost += m_compactNodes[i].getSurfaceArea();
+        }
+    }
+
+    double rootArea = m_compactNodes[0].getSurfaceArea();
+    return ((rootArea > 0.0) ? (cost / rootArea) : 0.0);
 }
 
 
@@ -372,160 +730,935 @@ int cCollisionAABB::buildTree(const int a_indexFirstNode, const int a_indexLastN
 
 //==============================================================================
 /*!
-    This method checks if the given line segment intersects any element of the 
-    mesh. 
-
-    If a collision occurs, the method returns __true__, and the collision events
-    are reported through the collision recorder. Each collision event reports 
-    pointers to the intersected element, the mesh of which this element is a part, 
-    the point of intersection, and the distance from the origin of the segment to 
-    the collision point.
-
-    \param  a_object         Object for which collision detector is being used.
-    \param  a_segmentPointA  Initial point of segment.
-    \param  a_segmentPointB  End point of segment.
-    \param  a_recorder       Recorder which stores all collision events.
-    \param  a_settings       Contains collision settings information.
-
-    \return  __true__ if a collision event has occurred, __false__otherwise.
+    Given a __start__ and __end__ index value of leaf nodes, this method creates
+    a collision tree using a binned surface area heuristic (SAH). \n\n
+
+    The centers of the leaves are sorted into \ref C_AABB_SAH_NUM_BINS bins 
+    along each axis, and the node is split between the two bins that minimize
+    the expected cost of a segment query, estimated as the sum of the surface
+    areas of both children weighted by their number of elements. \n\n
+
+    The builder partitions a compact working list of leaf boundary boxes 
+    rather than the leaves themselves; the leaves are reordered once the tree
+    is complete. Internal nodes are written into a preallocated list: a 
+    subtree of n leaves uses the n-1 internal nodes that follow its root, so 
+    that subtrees can be built on separate threads without synchronization. 
+    When both subtrees of a node are larger than \ref C_AABB_PARALLEL_BUILD_SIZE,
+    they are built in parallel, up to \p a_numThreadLevels times along each
+    branch of the recursion.
+
+    \param  a_items            Working list of leaf boundary boxes.
+    \param  a_indexFirstNode   Lower index value of leaf node.
+    \param  a_indexLastNode    Upper index value of leaf node.
+    \param  a_nodeIndex        Index of the internal node to be created.
+    \param  a_depth            Current depth of the tree. Root starts at 0.
+    \param  a_numThreadLevels  Number of times subtrees may still be split between two threads.
+
+    \return Maximum depth of the leaves of the subtree.
 */
 //==============================================================================
-bool cCollisionAABB::computeCollision(cGenericObject* a_object,
-                                      cVector3d& a_segmentPointA, 
-                                      cVector3d& a_segmentPointB,
-                                      cCollisionRecorder& a_recorder, 
-                                      cCollisionSettings& a_settings)
+int cCollisionAABB::buildTreeSAH(cCollisionAABBBuildItem* a_items,
+                                 const int a_indexFirstNode,
+                                 const int a_indexLastNode,
+                                 const int a_nodeIndex,
+                                 const int a_depth,
+                                 const int a_numThreadLevels)
 {
-    // sanity check
-    if (m_rootIndex == -1) { return (false); }
-
-    // init stack
-    std::vector<cCollisionAABBStack> stack;
-    stack.resize(m_maxDepth+1);
-
-    int index = 0;
-    stack[0].m_index = m_rootIndex;
-    stack[0].m_state = C_AABB_STATE_TEST_CURRENT_NODE;
+    // compute boundary box of leaf centers
+    double centerMin[3] = {  DBL_MAX,  DBL_MAX,  DBL_MAX };
+    double centerMax[3] = { -DBL_MAX, -DBL_MAX, -DBL_MAX };
+    for (int i=a_indexFirstNode; i<=a_indexLastNode; i++)
+    {
+        for (int k=0; k<3; k++)
+        {
+            centerMin[k] = cMin(centerMin[k], a_items[i].m_center[k]);
+            centerMax[k] = cMax(centerMax[k], a_items[i].m_center[k]);
+        }
+    }
 
-    // no collision occurred yet
-    bool result = false;
+    // sort leaves into bins along each axis
+    struct cBin
+    {
+        double m_min[3];
+        double m_max[3];
+        int m_count;
+    };
+
+    cBin bins[3][C_AABB_SAH_NUM_BINS];
+    double scale[3];
+    for (int axis=0; axis<3; axis++)
+    {
+        double extent = centerMax[axis] - centerMin[axis];
+        scale[axis] = (extent > 0.0) ? (C_AABB_SAH_NUM_BINS / extent) : 0.0;
 
-    // create an axis-aligned boundary box for the line
-    cCollisionAABBBox lineBox;
-    lineBox.setEmpty();
-    lineBox.enclose(a_segmentPointA);
-    lineBox.enclose(a_segmentPointB);
+        for (int b=0; b<C_AABB_SAH_NUM_BINS; b++)
+        {
+            for (int k=0; k<3; k++)
+            {
+                bins[axis][b].m_min[k] =  DBL_MAX;
+                bins[axis][b].m_max[k] = -DBL_MAX;
+            }
+            bins[axis][b].m_count = 0;
+        }
+    }
 
-    // collision search
-    while (index > -1)
+    for (int i=a_indexFirstNode; i<=a_indexLastNode; i++)
     {
-        // get index of current node on stack 
-        int nodeIndex = stack[index].m_index;
+        const cCollisionAABBBuildItem& item = a_items[i];
+        for (int axis=0; axis<3; axis++)
+        {
+            int index = cMin((int)((item.m_center[axis] - centerMin[axis]) * scale[axis]), C_AABB_SAH_NUM_BINS - 1);
+            cBin& bin = bins[axis][index];
+            for (int k=0; k<3; k++)
+            {
+                bin.m_min[k] = cMin(bin.m_min[k], item.m_min[k]);
+                bin.m_max[k] = cMax(bin.m_max[k], item.m_max[k]);
+            }
+            bin.m_count++;
+        }
+    }
 
-        // get type of current node
-        cAABBNodeType nodeType = m_nodes[nodeIndex].m_nodeType;
+    // find best split plane over all axes
+    int bestAxis = -1;
+    int bestSplit = 0;
+    double bestCost = DBL_MAX;
 
+    for (int axis=0; axis<3; axis++)
+    {
+        if (scale[axis] == 0.0) { continue; }
 
-        //----------------------------------------------------------------------
-        // INTERNAL NODE:
-        //----------------------------------------------------------------------
-        if (nodeType == C_AABB_NODE_INTERNAL)
+        // sweep from the right to compute the cost of the right side of each 
+        // split, then sweep from the left and evaluate each split
+        double rightArea[C_AABB_SAH_NUM_BINS];
+        int rightCount[C_AABB_SAH_NUM_BINS];
+        for (int pass=0; pass<2; pass++)
         {
-            switch (stack[index].m_state)
+            cCollisionAABBBox box;
+            cVector3d lower( DBL_MAX,  DBL_MAX,  DBL_MAX);
+            cVector3d upper(-DBL_MAX, -DBL_MAX, -DBL_MAX);
+            int count = 0;
+
+            for (int n=0; n<C_AABB_SAH_NUM_BINS-1; n++)
             {
-                ////////////////////////////////////////////////////////////////
-                // TEST CURRENT NODE
-                ////////////////////////////////////////////////////////////////
-                case C_AABB_STATE_TEST_CURRENT_NODE:
+                int b = (pass == 0) ? (C_AABB_SAH_NUM_BINS - 1 - n) : n;
+                const cBin& bin = bins[axis][b];
+                if (bin.m_count > 0)
                 {
-                    // check if line box intersects box of current node
-                    if (m_nodes[nodeIndex].m_bbox.intersect(lineBox))
+                    for (int k=0; k<3; k++)
                     {
-                        // check if segment intersects box of current node
-                        if (m_nodes[nodeIndex].m_bbox.intersect(a_segmentPointA, a_segmentPointB))
-                        {
-                            stack[index].m_state = C_AABB_STATE_TEST_LEFT_NODE;
-                        }
-                        else
-                        {
-                            stack[index].m_state = C_AABB_STATE_TEST_CURRENT_NODE;
-                            index--;
-                        }
-                    }
-                    else
-                    {
-                        stack[index].m_state = C_AABB_STATE_TEST_CURRENT_NODE;
-                        index--;
+                        lower(k) = cMin(lower(k), bin.m_min[k]);
+                        upper(k) = cMax(upper(k), bin.m_max[k]);
                     }
+                    count += bin.m_count;
+                    box.setValue(lower, upper);
                 }
-                break;
 
-                ////////////////////////////////////////////////////////////////
-                // TEST LEFT NODE
-                ////////////////////////////////////////////////////////////////
-                case C_AABB_STATE_TEST_LEFT_NODE:
+                if (pass == 0)
                 {
-                    stack[index].m_state = C_AABB_STATE_TEST_RIGHT_NODE;
-
-                    // push left child node on stack
-                    index++;
-                    stack[index].m_index =  m_nodes[nodeIndex].m_leftSubTree;
-                    stack[index].m_state = C_AABB_STATE_TEST_CURRENT_NODE;
+                    rightArea[b] = box.getSurfaceArea();
+                    rightCount[b] = count;
                 }
-                break;
+                else if ((count > 0) && (rightCount[b+1] > 0))
+                {
+                    double cost = box.getSurfaceArea() * count + rightArea[b+1] * rightCount[b+1];
+                    if (cost < bestCost)
+                    {
+                        bestCost = cost;
+                        bestAxis = axis;
+                        bestSplit = b+1;
+                    }
+                }
+            }
+        }
+    }
+
+    // move leaves located in bins on the left of the split plane towards the
+    // beginning of the list, and the others towards the end of the list
+    int mid = a_indexFirstNode - 1;
+    if (bestAxis >= 0)
+    {
+        int i = a_indexFirstNode;
+        int j = a_indexLastNode;
+        while (i <= j)
+        {
+            int bin = cMin((int)((a_items[i].m_center[bestAxis] - centerMin[bestAxis]) * scale[bestAxis]), C_AABB_SAH_NUM_BINS - 1);
+            if (bin < bestSplit)
+            {
+                i++;
+            }
+            else
+            {
+                std::swap(a_items[i], a_items[j]);
+                j--;
+            }
+        }
+        mid = i - 1;
+    }
+
+    // if all leaves share the same center, or if one side of the split is 
+    // empty, split the leaves in two halves
+    if ((mid < a_indexFirstNode) || (mid >= a_indexLastNode))
+    {
+        mid = (a_indexLastNode + a_indexFirstNode) / 2;
+    }
+
+    // increment depth for child nodes
+    int depth = a_depth + 1;
+    int maxDepthLeft = depth;
+    int maxDepthRight = depth;
+
+    // number of leaves of each subtree
+    int numLeft = mid - a_indexFirstNode + 1;
+    int numRight = a_indexLastNode - mid;
+
+    // the left subtree follows the current node; the right subtree follows the
+    // numLeft-1 internal nodes of the left subtree
+    int indexLeft  = (numLeft  > 1) ? (a_nodeIndex + 1) : a_indexFirstNode;
+    int indexRight = (numRight > 1) ? (a_nodeIndex + numLeft) : a_indexLastNode;
+
+    // build subtrees, in parallel if both are large enough
+    if ((a_numThreadLevels > 0) && 
+        (numLeft >= C_AABB_PARALLEL_BUILD_SIZE) && 
+        (numRight >= C_AABB_PARALLEL_BUILD_SIZE))
+    {
+        std::thread thread([&]()
+        {
+            maxDepthLeft = buildTreeSAH(a_items, a_indexFirstNode, mid, indexLeft, depth, a_numThreadLevels - 1);
+        });
+        maxDepthRight = buildTreeSAH(a_items, mid + 1, a_indexLastNode, indexRight, depth, a_numThreadLevels - 1);
+        thread.join();
+    }
+    else
+    {
+        // a large subtree next to a small one may still be split in parallel
+        if (numLeft > 1)
+        {
+            maxDepthLeft = buildTreeSAH(a_items, a_indexFirstNode, mid, indexLeft, depth, a_numThreadLevels);
+        }
+        if (numRight > 1)
+        {
+            maxDepthRight = buildTreeSAH(a_items, mid + 1, a_indexLastNode, indexRight, depth, a_numThreadLevels);
+        }
+    }
+
+    // compute boundary box enclosing both subtrees. leaves are read from the 
+    // working list since they are only reordered once the tree is complete.
+    cCollisionAABBNode& node = m_nodes[a_nodeIndex];
+    node.m_depth = a_depth;
+    node.m_nodeType = C_AABB_NODE_INTERNAL;
+    node.m_leftSubTree = indexLeft;
+    node.m_rightSubTree = indexRight;
+
+    cVector3d lower, upper;
+    for (int k=0; k<3; k++)
+    {
+        lower(k) = DBL_MAX;
+        upper(k) = -DBL_MAX;
+    }
+
+    const int children[2] = { indexLeft, indexRight };
+    const int numChildren[2] = { numLeft, numRight };
+    for (int c=0; c<2; c++)
+    {
+        if (numChildren[c] == 1)
+        {
+            cCollisionAABBBuildItem& item = a_items[children[c]];
+            item.m_depth = depth;
+            for (int k=0; k<3; k++)
+            {
+                lower(k) = cMin(lower(k), item.m_min[k]);
+                upper(k) = cMax(upper(k), item.m_max[k]);
+            }
+        }
+        else
+        {
+            const cCollisionAABBBox& bbox = m_nodes[children[c]].m_bbox;
+            for (int k=0; k<3; k++)
+            {
+                lower(k) = cMin(lower(k), bbox.m_min(k));
+                upper(k) = cMax(upper(k), bbox.m_max(k));
+            }
+        }
+    }
+    node.m_bbox.setValue(lower, upper);
+
+    return (cMax(maxDepthLeft, maxDepthRight));
+}
+
+
+//==============================================================================
+/*!
+    This method flattens the collision tree into a list of compact nodes stored
+    in depth-first order. The left child of each internal node immediately 
+    follows its parent, and the element indices of the leaves are stored in the
+    order in which the leaves are visited, so that a traversal of the tree 
+    walks through memory mostly sequentially.
+*/
+//==============================================================================
+void cCollisionAABB::buildCompactTree()
+{
+    m_compactNodes.clear();
+    m_compactElements.clear();
+    m_compactNodeSources.clear();
+
+    if (m_rootIndex == -1) { return; }
+
+    // a binary tree with n leaves holds 2n-1 nodes
+    m_compactNodes.reserve(m_nodes.size());
+    m_compactNodeSources.reserve(m_nodes.size());
+    m_compactElements.reserve(m_numElements);
+
+    flattenTree(m_rootIndex);
+    m_nodesOutdated = false;
+
+    // store cost of new tree as reference for quality monitoring
+    m_buildCost = computeTreeCost();
+    m_cost = m_buildCost;
+
+    // invalidate neighbourhoods stored in caches
+    m_version = ++s_lastTreeVersion;
+}
+
+
+//==============================================================================
+/*!
+    This method appends the subtree located at a given node index to the list 
+    of compact nodes in depth-first order.
+
+    \param  a_nodeIndex  Index of the root node of the subtree in \ref m_nodes.
+*/
+//==============================================================================
+void cCollisionAABB::flattenTree(const int a_nodeIndex)
+{
+    const cCollisionAABBNode& node = m_nodes[a_nodeIndex];
+
+    // append compact node
+    int index = (int)m_compactNodes.size();
+    cCollisionAABBCompactNode compactNode;
+    compactNode.setBBox(node.m_bbox);
+    m_compactNodeSources.push_back(a_nodeIndex);
+
+    if (node.m_nodeType == C_AABB_NODE_LEAF)
+    {
+        compactNode.m_index = (int)m_compactElements.size();
+        compactNode.m_count = 1;
+        m_compactElements.push_back(node.m_leftSubTree);
+        m_compactNodes.push_back(compactNode);
+    }
+    else
+    {
+        compactNode.m_index = -1;
+        compactNode.m_count = 0;
+        m_compactNodes.push_back(compactNode);
+
+        // left child is stored immediately after its parent
+        flattenTree(node.m_leftSubTree);
+
+        // right child follows the complete left subtree
+        m_compactNodes[index].m_index = (int)m_compactNodes.size();
+        flattenTree(node.m_rightSubTree);
+    }
+}
+
+
+//==============================================================================
+/*!
+    This method checks if the given line segment intersects any element of the 
+    mesh. 
+
+    If a collision occurs, the method returns __true__, and the collision events
+    are reported through the collision recorder. Each collision event reports 
+    pointers to the intersected element, the mesh of which this element is a part, 
+    the point of intersection, and the distance from the origin of the segment to 
+    the collision point.
 
-                ////////////////////////////////////////////////////////////////
-                // TEST RIGHT NODE
-                ////////////////////////////////////////////////////////////////
-                case C_AABB_STATE_TEST_RIGHT_NODE:
+    \param  a_object         Object for which collision detector is being used.
+    \param  a_segmentPointA  Initial point of segment.
+    \param  a_segmentPointB  End point of segment.
+    \param  a_recorder       Recorder which stores all collision events.
+    \param  a_settings       Contains collision settings information.
+
+    \return  __true__ if a collision event has occurred, __false__otherwise.
+*/
+//==============================================================================
+bool cCollisionAABB::computeCollision(cGenericObject* a_object,
+                                      cVector3d& a_segmentPointA, 
+                                      cVector3d& a_segmentPointB,
+                                      cCollisionRecorder& a_recorder, 
+                                      cCollisionSettings& a_settings)
+{
+    // sanity check
+    if ((m_rootIndex == -1) || (m_compactNodes.size() == 0)) { return (false); }
+
+    // compute boundary box, origin and inverse direction of segment
+    cCollisionAABBSegment segment;
+    for (int i=0; i<3; i++)
+    {
+        segment.m_origin[i] = a_segmentPointA(i);
+        segment.m_min[i] = cMin(a_segmentPointA(i), a_segmentPointB(i));
+        segment.m_max[i] = cMax(a_segmentPointA(i), a_segmentPointB(i));
+
+        double dir = a_segmentPointB(i) - a_segmentPointA(i);
+        segment.m_parallel[i] = (dir == 0.0);
+        segment.m_invDir[i] = segment.m_parallel[i] ? 0.0 : (1.0 / dir);
+    }
+
+    // if a neighbourhood of the cache encloses the segment, only its leaves 
+    // need to be tested
+    if (a_settings.m_contactCache != NULL)
+    {
+        const cCollisionAABBCacheEntry* entry = lookupCache(*a_settings.m_contactCache, segment);
+        if (entry != NULL)
+        {
+            bool result = false;
+            int numLeaves = (int)(entry->m_leaves.size());
+            for (int i=0; i<numLeaves; i++)
+            {
+                if (traverseTree(entry->m_leaves[i],
+                                 segment,
+                                 a_object,
+                                 a_segmentPointA,
+                                 a_segmentPointB,
+                                 a_recorder,
+                                 a_settings))
                 {
-                    stack[index].m_state = C_AABB_STATE_POP_STACK;
+                    result = true;
+                }
+            }
+            return (result);
+        }
+    }
+
+    // traverse tree from root node
+    return (traverseTree(0,
+                         segment,
+                         a_object,
+                         a_segmentPointA,
+                         a_segmentPointB,
+                         a_recorder,
+                         a_settings));
+}
+
+
+//==============================================================================
+/*!
+    This method computes all collisions between a batch of segments and the 
+    elements of the tree. Segments are grouped in packets of 
+    \ref C_COLLISION_PACKET_SIZE, and each packet is tested against the tree 
+    in a single traversal. Every segment reports the same collision events, 
+    in the same order, as if it were tested alone by \ref computeCollision().
+    \n\n
+
+    Packets holding a single segment are tested by \ref computeCollision(), 
+    which may use the contact cache of its settings.
+
+    \param  a_object      Object for which collision detector is being used.
+    \param  a_queries     Array of queries, expressed in the local frame of the object.
+    \param  a_numQueries  Number of queries.
+
+    \return  __true__ if a collision event has occurred, __false__otherwise.
+*/
+//==============================================================================
+bool cCollisionAABB::computeCollisions(cGenericObject* a_object,
+                                       cCollisionQuery* a_queries,
+                                       const int a_numQueries)
+{
+    // sanity check
+    if ((m_rootIndex == -1) || (m_compactNodes.size() == 0)) { return (false); }
+
+    bool result = false;
+
+    for (int first=0; first<a_numQueries; first+=C_COLLISION_PACKET_SIZE)
+    {
+        cCollisionQuery* queries = &a_queries[first];
+        int numQueries = cMin(C_COLLISION_PACKET_SIZE, a_numQueries - first);
+
+        // a single segment is traversed on its own
+        if (numQueries == 1)
+        {
+            if (computeCollision(a_object,
+                                 queries[0].m_segmentPointA,
+                                 queries[0].m_segmentPointB,
+                                 *queries[0].m_recorder,
+                                 *queries[0].m_settings))
+            {
+                queries[0].m_hit = true;
+                result = true;
+            }
+            continue;
+        }
+
+        // compute boundary box, origin and inverse direction of each segment.
+        // unused lanes repeat the first segment and are masked out.
+        cCollisionAABBPacket packet;
+        for (int j=0; j<C_COLLISION_PACKET_SIZE; j++)
+        {
+            const cCollisionQuery& query = queries[(j < numQueries) ? j : 0];
+            cCollisionAABBSegment& segment = packet.m_segments[j];
+            for (int i=0; i<3; i++)
+            {
+                segment.m_origin[i] = query.m_segmentPointA(i);
+                segment.m_min[i] = cMin(query.m_segmentPointA(i), query.m_segmentPointB(i));
+                segment.m_max[i] = cMax(query.m_segmentPointA(i), query.m_segmentPointB(i));
+                double dir = query.m_segmentPointB(i) - query.m_segmentPointA(i);
+                segment.m_parallel[i] = (dir == 0.0);
+                segment.m_invDir[i] = segment.m_parallel[i] ? 0.0 : (1.0 / dir);
+
+                packet.m_min[i][j] = segment.m_min[i];
+                packet.m_max[i][j] = segment.m_max[i];
+            }
+        }
+
+        // traverse tree from root node
+        unsigned int mask = (1u << numQueries) - 1;
+        if (traversePacket(0, mask, packet, a_object, queries))
+        {
+            result = true;
+        }
+    }
+
+    return (result);
+}
+
+
+//==============================================================================
+/*!
+    This method searches a cache for a neighbourhood of this tree that encloses
+    a segment. If none is found, the neighbourhood of the segment is computed 
+    and stored in the cache, replacing the entry of this tree or else the 
+    least recently used entry, and the query must be answered by a full 
+    traversal of the tree. \n\n
+
+    The leaves of a neighbourhood are collected in the order in which 
+    traverseTree() visits them, so that collision events are reported in the 
+    same order as by a full traversal.
+
+    \param  a_cache    Cache of neighbourhoods.
+    \param  a_segment  Precomputed boundary box and direction of segment.
+
+    \return Neighbourhood enclosing the segment, or __NULL__ if the tree must 
+            be traversed from its root.
+*/
+//==============================================================================
+const cCollisionAABBCacheEntry* cCollisionAABB::lookupCache(cCollisionAABBCache& a_cache,
+                                                            const cCollisionAABBSegment& a_segment) const
+{
+    a_cache.m_numQueries++;
+
+    // search entry of this tree, or else the least recently used entry
+    cCollisionAABBCacheEntry* entry = NULL;
+    for (int i=0; i<C_AABB_CACHE_NUM_ENTRIES; i++)
+    {
+        cCollisionAABBCacheEntry& candidate = a_cache.m_entries[i];
+        if (candidate.m_tree == this)
+        {
+            entry = &candidate;
+            break;
+        }
+        if ((entry == NULL) || (candidate.m_lastQuery < entry->m_lastQuery))
+        {
+            entry = &candidate;
+        }
+    }
+    entry->m_lastQuery = a_cache.m_numQueries;
+
+    // check if the entry is still valid and encloses the segment
+    if ((entry->m_tree == this) && (entry->m_version == m_version))
+    {
+        bool inside = true;
+        for (int i=0; i<3; i++)
+        {
+            if ((a_segment.m_min[i] < entry->m_min[i]) || (a_segment.m_max[i] > entry->m_max[i]))
+            {
+                inside = false;
+            }
+        }
+
+        if (inside)
+        {
+            if (entry->m_overflow)
+            {
+                a_cache.m_numMisses++;
+                return (NULL);
+            }
+            a_cache.m_numHits++;
+            return (entry);
+        }
+    }
+
+    // build new neighbourhood around segment
+    entry->m_tree = this;
+    entry->m_version = m_version;
+    entry->m_leaves.clear();
+    entry->m_overflow = false;
+    for (int i=0; i<3; i++)
+    {
+        entry->m_min[i] = a_segment.m_min[i] - a_cache.m_margin;
+        entry->m_max[i] = a_segment.m_max[i] + a_cache.m_margin;
+    }
+
+    // collect leaves overlapping the neighbourhood in depth-first order
+    int stack[C_AABB_STACK_SIZE];
+    int index = 0;
+    stack[0] = 0;
+
+    const cCollisionAABBCompactNode* nodes = &m_compactNodes[0];
+
+    while ((index > -1) && (!entry->m_overflow))
+    {
+        int nodeIndex = stack[index];
+        index--;
+
+        while (true)
+        {
+            const cCollisionAABBCompactNode& node = nodes[nodeIndex];
 
-                    // push right child node on stack
-                    index++;
-                    stack[index].m_index =  m_nodes[nodeIndex].m_rightSubTree;
-                    stack[index].m_state = C_AABB_STATE_TEST_CURRENT_NODE;
+            if (!node.intersect(entry->m_min, entry->m_max))
+            {
+                break;
+            }
+
+            if (node.isLeaf())
+            {
+                if ((int)(entry->m_leaves.size()) < C_AABB_CACHE_NUM_LEAVES)
+                {
+                    entry->m_leaves.push_back(nodeIndex);
                 }
+                else
+                {
+                    entry->m_overflow = true;
+                }
+                break;
+            }
+
+            // the neighbourhood is not used if the tree is too deep to be 
+            // collected without recursion
+            if (index >= (C_AABB_STACK_SIZE - 1))
+            {
+                entry->m_overflow = true;
                 break;
+            }
+            index++;
+            stack[index] = node.m_index;
+            nodeIndex = nodeIndex + 1;
+        }
+    }
 
-                ////////////////////////////////////////////////////////////////
-                // POP STACK
-                ////////////////////////////////////////////////////////////////
-                case C_AABB_STATE_POP_STACK:
+    if (entry->m_overflow)
+    {
+        entry->m_leaves.clear();
+    }
+
+    a_cache.m_numMisses++;
+    return (NULL);
+}
+
+
+//==============================================================================
+/*!
+    This method traverses the subtree of the compact tree located at a given 
+    node and computes all collisions between a segment and the elements it 
+    covers. \n\n
+
+    The traversal uses a stack of fixed capacity located on the call stack, so 
+    that no memory is allocated on the heap. If a degenerate tree is deeper 
+    than the capacity of the stack, the remaining subtrees are traversed by 
+    recursive calls.
+
+    \param  a_nodeIndex      Index of root node of subtree in compact tree.
+    \param  a_segment        Precomputed boundary box and direction of segment.
+    \param  a_object         Object for which collision detector is being used.
+    \param  a_segmentPointA  Initial point of segment.
+    \param  a_segmentPointB  End point of segment.
+    \param  a_recorder       Recorder which stores all collision events.
+    \param  a_settings       Contains collision settings information.
+
+    \return  __true__ if a collision event has occurred, __false__otherwise.
+*/
+//==============================================================================
+bool cCollisionAABB::traverseTree(const int a_nodeIndex,
+                                  const cCollisionAABBSegment& a_segment,
+                                  cGenericObject* a_object,
+                                  cVector3d& a_segmentPointA,
+                                  cVector3d& a_segmentPointB,
+                                  cCollisionRecorder& a_recorder,
+                                  cCollisionSettings& a_settings)
+{
+    // init stack. the stack holds the right children which remain to be
+    // visited.
+    int stack[C_AABB_STACK_SIZE];
+    int index = 0;
+    stack[0] = a_nodeIndex;
+
+    // get direct pointers to compact tree
+    const cCollisionAABBCompactNode* nodes = &m_compactNodes[0];
+    const int* elements = &m_compactElements[0];
+
+    // no collision occurred yet
+    bool result = false;
+
+    // collision search
+    while (index > -1)
+    {
+        // pop node from stack
+        int nodeIndex = stack[index];
+        index--;
+
+        // descend the tree along left children, which are stored next to their parent
+        while (true)
+        {
+            const cCollisionAABBCompactNode& node = nodes[nodeIndex];
+
+            // check if line box and segment intersect box of current node
+            if (!node.intersect(a_segment.m_min, a_segment.m_max) ||
+                !node.intersect(a_segment.m_origin, a_segment.m_invDir, a_segment.m_parallel))
+            {
+                break;
+            }
+
+            //------------------------------------------------------------------
+            // LEAF NODE:
+            //------------------------------------------------------------------
+            if (node.isLeaf())
+            {
+                for (int i=0; i<node.m_count; i++)
                 {
-                    // restore state of current node for next search and pop stack
-                    stack[index].m_state = C_AABB_STATE_TEST_CURRENT_NODE;
-                    index--;
+                    // get index of leaf element
+                    int elementIndex = elements[node.m_index + i];
+
+                    // call the element's collision detection method
+                    if (m_elements->m_allocated[elementIndex])
+                    {
+                        if (m_elements->computeCollision(elementIndex,
+                            a_object,
+                            a_segmentPointA,
+                            a_segmentPointB,
+                            a_recorder,
+                            a_settings))
+                        {
+                            result = true;
+                        }
+                    }
                 }
                 break;
             }
+
+            //------------------------------------------------------------------
+            // INTERNAL NODE:
+            //------------------------------------------------------------------
+
+            // push right child node on stack, or traverse it separately if 
+            // the stack is full, and continue with left child
+            if (index < (C_AABB_STACK_SIZE - 1))
+            {
+                index++;
+                stack[index] = node.m_index;
+            }
+            else
+            {
+                if (traverseTree(node.m_index,
+                                 a_segment,
+                                 a_object,
+                                 a_segmentPointA,
+                                 a_segmentPointB,
+                                 a_recorder,
+                                 a_settings))
+                {
+                    result = true;
+                }
+            }
+            nodeIndex = nodeIndex + 1;
         }
+    }
+
+    // return result
+    return (result);
+}
+
 
+//==============================================================================
+/*!
+    This method tests the boundary boxes of all segments of a packet against 
+    a node. The test is written without branches over the lanes of the packet 
+    so that compilers can evaluate several segments per instruction.
+
+    \param  a_node    Node of the compact tree.
+    \param  a_packet  Precomputed boundary boxes and directions of segments.
 
-        //----------------------------------------------------------------------
-        // LEAF NODE:
-        //----------------------------------------------------------------------
-        else if (nodeType == C_AABB_NODE_LEAF)
+    \return  Mask of the segments whose boundary box overlaps the node.
+*/
+//==============================================================================
+unsigned int cCollisionAABB::intersectPacket(const cCollisionAABBCompactNode& a_node,
+                                             const cCollisionAABBPacket& a_packet) const
+{
+    double nodeMin[3] = { a_node.m_min[0], a_node.m_min[1], a_node.m_min[2] };
+    double nodeMax[3] = { a_node.m_max[0], a_node.m_max[1], a_node.m_max[2] };
+
+    int inside[C_COLLISION_PACKET_SIZE];
+    for (int j=0; j<C_COLLISION_PACKET_SIZE; j++)
+    {
+        inside[j] = (int)(a_packet.m_min[0][j] <= nodeMax[0]) & (int)(a_packet.m_max[0][j] >= nodeMin[0]) &
+                    (int)(a_packet.m_min[1][j] <= nodeMax[1]) & (int)(a_packet.m_max[1][j] >= nodeMin[1]) &
+                    (int)(a_packet.m_min[2][j] <= nodeMax[2]) & (int)(a_packet.m_max[2][j] >= nodeMin[2]);
+    }
+
+    unsigned int mask = 0;
+    for (int j=0; j<C_COLLISION_PACKET_SIZE; j++)
+    {
+        mask |= ((unsigned int)inside[j]) << j;
+    }
+
+    return (mask);
+}
+
+
+//==============================================================================
+/*!
+    This method traverses the subtree of the compact tree located at a given 
+    node with a packet of segments. \n\n
+
+    Internal nodes are only tested against the boundary boxes of the segments,
+    and the path of each segment is tested at leaves. Since the box of a node 
+    encloses the boxes of its children, a segment whose path misses a node 
+    misses every leaf below it; each segment therefore visits the same 
+    leaves, in the same order, as when it is tested alone by 
+    \ref traverseTree(). Subtrees reached by a single segment are traversed 
+    by \ref traverseTree().
+
+    \param  a_nodeIndex  Index of root node of subtree in compact tree.
+    \param  a_mask       Mask of the segments of the packet that reached the node.
+    \param  a_packet     Precomputed boundary boxes and directions of segments.
+    \param  a_object     Object for which collision detector is being used.
+    \param  a_queries    Queries of the packet.
+
+    \return  __true__ if a collision event has occurred, __false__otherwise.
+*/
+//==============================================================================
+bool cCollisionAABB::traversePacket(const int a_nodeIndex,
+                                    const unsigned int a_mask,
+                                    const cCollisionAABBPacket& a_packet,
+                                    cGenericObject* a_object,
+                                    cCollisionQuery* a_queries)
+{
+    // init stack. the stack holds the right children which remain to be
+    // visited, together with the segments that reached their parent.
+    int stack[C_AABB_STACK_SIZE];
+    unsigned int stackMask[C_AABB_STACK_SIZE];
+    int index = 0;
+    stack[0] = a_nodeIndex;
+    stackMask[0] = a_mask;
+
+    // get direct pointers to compact tree
+    const cCollisionAABBCompactNode* nodes = &m_compactNodes[0];
+    const int* elements = &m_compactElements[0];
+
+    // no collision occurred yet
+    bool result = false;
+
+    // collision search
+    while (index > -1)
+    {
+        // pop node from stack
+        int nodeIndex = stack[index];
+        unsigned int mask = stackMask[index];
+        index--;
+
+        // descend the tree along left children, which are stored next to their parent
+        while (true)
         {
-            // get index of leaf element
-            int elementIndex =  m_nodes[nodeIndex].m_leftSubTree;
+            const cCollisionAABBCompactNode& node = nodes[nodeIndex];
 
-            // call the element's collision detection method
-            if (m_elements->m_allocated[elementIndex])
+            // keep segments whose boundary box overlaps the node
+            mask = mask & intersectPacket(node, a_packet);
+            if (mask == 0)
             {
-                if (m_elements->computeCollision(elementIndex,
-                    a_object,
-                    a_segmentPointA, 
-                    a_segmentPointB, 
-                    a_recorder, 
-                    a_settings))
+                break;
+            }
+
+            // if a single segment remains, its subtree is traversed on its own
+            if ((mask & (mask - 1)) == 0)
+            {
+                int j = 0;
+                while ((mask & (1u << j)) == 0) { j++; }
+
+                cCollisionQuery& query = a_queries[j];
+                if (traverseTree(nodeIndex,
+                                 a_packet.m_segments[j],
+                                 a_object,
+                                 query.m_segmentPointA,
+                                 query.m_segmentPointB,
+                                 *query.m_recorder,
+                                 *query.m_settings))
                 {
+                    query.m_hit = true;
                     result = true;
                 }
+                break;
             }
 
-            // pop stack
-            index--;
+            //------------------------------------------------------------------
+            // LEAF NODE:
+            //------------------------------------------------------------------
+            if (node.isLeaf())
+            {
+                // keep segments whose path intersects the leaf
+                for (int j=0; j<C_COLLISION_PACKET_SIZE; j++)
+                {
+                    const cCollisionAABBSegment& segment = a_packet.m_segments[j];
+                    if (((mask & (1u << j)) != 0) && 
+                        (!node.intersect(segment.m_origin, segment.m_invDir, segment.m_parallel)))
+                    {
+                        mask = mask & ~(1u << j);
+                    }
+                }
+
+                for (int i=0; (i<node.m_count) && (mask != 0); i++)
+                {
+                    // get index of leaf element
+                    int elementIndex = elements[node.m_index + i];
+                    if (!m_elements->m_allocated[elementIndex]) { continue; }
+
+                    // call the element's collision detection method for each segment
+                    for (int j=0; j<C_COLLISION_PACKET_SIZE; j++)
+                    {
+                        if ((mask & (1u << j)) == 0) { continue; }
+
+                        cCollisionQuery& query = a_queries[j];
+                        if (m_elements->computeCollision(elementIndex,
+                            a_object,
+                            query.m_segmentPointA,
+                            query.m_segmentPointB,
+                            *query.m_recorder,
+                            *query.m_settings))
+                        {
+                            query.m_hit = true;
+                            result = true;
+                        }
+                    }
+                }
+                break;
+            }
+
+            //------------------------------------------------------------------
+            // INTERNAL NODE:
+            //------------------------------------------------------------------
+
+            // push right child node on stack, or traverse it separately if 
+            // the stack is full, and continue with left child
+            if (index < (C_AABB_STACK_SIZE - 1))
+            {
+                index++;
+                stack[index] = node.m_index;
+                stackMask[index] = mask;
+            }
+            else
+            {
+                if (traversePacket(node.m_index, mask, a_packet, a_object, a_queries))
+                {
+                    result = true;
+                }
+            }
+            nodeIndex = nodeIndex + 1;
         }
     }
 
@@ -534,6 +1667,37 @@ bool cCollisionAABB::computeCollision(cGenericObject* a_object,
 }
 
 
+//==============================================================================
+/*!
+    This method returns the boundary box of the root of the collision tree,
+    which encloses every element together with the radius around them. If the
+    tree is empty, \p a_min is set larger than \p a_max.
+
+    \param  a_min  Returned lower corner of the boundary box.
+    \param  a_max  Returned upper corner of the boundary box.
+
+    \return __true__ since the tree always bounds its elements.
+*/
+//==============================================================================
+bool cCollisionAABB::getBoundaryBox(cVector3d& a_min, cVector3d& a_max) const
+{
+    if ((m_rootIndex < 0) || (m_compactNodes.size() == 0))
+    {
+        a_min.set( C_LARGE, C_LARGE, C_LARGE);
+        a_max.set(-C_LARGE,-C_LARGE,-C_LARGE);
+    }
+    else
+    {
+        // the root of the compact tree is kept up to date by refit()
+        const cCollisionAABBCompactNode& root = m_compactNodes[0];
+        a_min.set(root.m_min[0], root.m_min[1], root.m_min[2]);
+        a_max.set(root.m_max[0], root.m_max[1], root.m_max[2]);
+    }
+
+    return (true);
+}
+
+
 //==============================================================================
 /*!
     This method graphically renders the boundary boxes of the collision tree 
@@ -544,6 +1708,19 @@ void cCollisionAABB::render(cRenderOptions& a_options)
 {
 #ifdef C_USE_OPENGL
 
+    // copy the boxes refitted in the compact tree to the nodes
+    if (m_nodesOutdated)
+    {
+        int numNodes = (int)m_compactNodes.size();
+        for (int i=0; i<numNodes; i++)
+        {
+            const cCollisionAABBCompactNode& node = m_compactNodes[i];
+            m_nodes[m_compactNodeSources[i]].m_bbox.setValue(cVector3d(node.m_min[0], node.m_min[1], node.m_min[2]),
+                                                             cVector3d(node.m_max[0], node.m_max[1], node.m_max[2]));
+        }
+        m_nodesOutdated = false;
+    }
+
     // set rendering settings
     glDisable(GL_LIGHTING);
     glLineWidth(1.0);
@@ -52,12 +52,40 @@
 #include "collisions/CCollisionAABBTree.h"
 //------------------------------------------------------------------------------
 #include <vector>
+#include <future>
 //------------------------------------------------------------------------------
 
 //------------------------------------------------------------------------------
 namespace chai3d {
 //------------------------------------------------------------------------------
 
+//------------------------------------------------------------------------------
+//! Capacity of the node stack used to traverse a collision tree without heap allocations.
+const int C_AABB_STACK_SIZE = 64;
+
+//! Number of bins per axis evaluated by the surface area heuristic builder.
+const int C_AABB_SAH_NUM_BINS = 16;
+
+//! Minimum number of elements of a subtree for it to be built on a separate thread.
+const int C_AABB_PARALLEL_BUILD_SIZE = 4096;
+
+//! Number of collision trees for which a cCollisionAABBCache stores a neighbourhood.
+const int C_AABB_CACHE_NUM_ENTRIES = 8;
+
+//! Maximum number of leaves stored for each neighbourhood of a cCollisionAABBCache.
+const int C_AABB_CACHE_NUM_LEAVES = 256;
+
+//! Default distance by which the neighbourhoods of a cCollisionAABBCache enclose the segment from which they were built.
+const double C_AABB_CACHE_DEFAULT_MARGIN = 0.002;
+
+//! Algorithms used to build an AABB collision tree.
+typedef enum
+{
+    C_AABB_BUILD_MIDPOINT,
+    C_AABB_BUILD_SAH
+} cCollisionAABBBuildMethod;
+//------------------------------------------------------------------------------
+
 //==============================================================================
 /*!
     \file       CCollisionAABB.h
@@ -67,6 +95,136 @@ namespace chai3d {
 */
 //==============================================================================
 
+//------------------------------------------------------------------------------
+class cCollisionAABB;
+//------------------------------------------------------------------------------
+
+//==============================================================================
+/*!
+    \struct     cCollisionAABBCacheEntry
+    \ingroup    collisions
+
+    \brief
+    This structure stores the neighbourhood of a segment in a collision tree.
+
+    \details
+    This structure stores a box, expressed in the local frame of a collision 
+    tree, and the list of leaves of the compact tree that overlap this box.
+*/
+//==============================================================================
+struct cCollisionAABBCacheEntry
+{
+    //! Collision tree, or __NULL__ if the entry is unused.
+    const cCollisionAABB* m_tree;
+
+    //! Version of the collision tree when the entry was built.
+    unsigned long long m_version;
+
+    //! Lower corner of the neighbourhood.
+    double m_min[3];
+
+    //! Upper corner of the neighbourhood.
+    double m_max[3];
+
+    //! Compact leaves that overlap the neighbourhood, in depth-first order.
+    std::vector<int> m_leaves;
+
+    //! If __true__, too many leaves overlap the neighbourhood and \ref m_leaves is not used.
+    bool m_overflow;
+
+    //! Query count of the cache when the entry was last used.
+    unsigned long long m_lastQuery;
+};
+
+
+//==============================================================================
+/*!
+    \class      cCollisionAABBCache
+    \ingroup    collisions
+
+    \brief
+    This class implements a cache of neighbourhoods in AABB collision trees.
+
+    \details
+    Haptic queries issued at consecutive updates usually cover the same small
+    region of an object. When a cCollisionAABBCache is passed to 
+    cCollisionAABB::computeCollision() through 
+    cCollisionSettings::m_contactCache, the tree stores the leaves that 
+    overlap a box enclosing the segment, enlarged by a margin. As long as 
+    later segments remain inside that box and the tree is not modified, only 
+    these leaves are tested, in the order in which the full traversal would 
+    have visited them. Results are therefore identical to those of a full 
+    traversal. \n\n
+
+    A cache should be owned by a single haptic point, and must not be shared
+    between threads.
+*/
+//==============================================================================
+class cCollisionAABBCache
+{
+    friend class cCollisionAABB;
+
+    //--------------------------------------------------------------------------
+    // CONSTRUCTOR & DESTRUCTOR:
+    //--------------------------------------------------------------------------
+
+public:
+
+    //! Constructor of cCollisionAABBCache.
+    cCollisionAABBCache();
+
+    //! Destructor of cCollisionAABBCache.
+    virtual ~cCollisionAABBCache() {}
+
+
+    //--------------------------------------------------------------------------
+    // PUBLIC METHODS:
+    //--------------------------------------------------------------------------
+
+public:
+
+    //! This method discards all neighbourhoods stored in the cache.
+    void clear();
+
+    //! This method sets the distance by which neighbourhoods enclose the segment from which they are built.
+    void setMargin(const double a_margin) { m_margin = cMax(0.0, a_margin); }
+
+    //! This method returns the distance by which neighbourhoods enclose the segment from which they are built.
+    double getMargin() const { return (m_margin); }
+
+    //! This method returns the number of queries answered from a stored neighbourhood.
+    unsigned int getNumHits() const { return (m_numHits); }
+
+    //! This method returns the number of queries that required a full traversal of the tree.
+    unsigned int getNumMisses() const { return (m_numMisses); }
+
+    //! This method resets the number of hits and misses.
+    void resetStatistics() { m_numHits = 0; m_numMisses = 0; }
+
+
+    //--------------------------------------------------------------------------
+    // PROTECTED MEMBERS:
+    //--------------------------------------------------------------------------
+
+protected:
+
+    //! Stored neighbourhoods.
+    cCollisionAABBCacheEntry m_entries[C_AABB_CACHE_NUM_ENTRIES];
+
+    //! Distance by which neighbourhoods enclose the segment from which they are built.
+    double m_margin;
+
+    //! Number of queries made through the cache.
+    unsigned long long m_numQueries;
+
+    //! Number of queries answered from a stored neighbourhood.
+    unsigned int m_numHits;
+
+    //! Number of queries that required a full traversal of the tree.
+    unsigned int m_numMisses;
+};
+
+
 //==============================================================================
 /*!
     \class      cCollisionAABB
@@ -79,22 +237,49 @@ namespace chai3d {
     This class implements an axis-aligned bounding box collision detection
     tree to efficiently detect for any collision between a line segment and 
     a collection of elements (point, segment, triangle) that compose an object.
+    \n\n
+
+    The tree is built either by splitting nodes at the center of their 
+    longest axis (\ref C_AABB_BUILD_MIDPOINT), or by a binned surface area 
+    heuristic (\ref C_AABB_BUILD_SAH), which takes longer to evaluate but builds
+    trees of better quality for irregular meshes. The SAH builder builds 
+    large subtrees in parallel on all available cores.
+    \n\n
+
+    Once built, the tree is flattened into a compact representation
+    (\ref cCollisionAABBCompactNode) stored in depth-first order, which is the
+    representation traversed by collision queries. Queries can skip the 
+    traversal by reusing the neighbourhood of a previous query stored in a 
+    \ref cCollisionAABBCache. Batches of segments are tested in a single 
+    traversal, each node being tested against all segments of a packet at 
+    once.
 */
 //==============================================================================
 class cCollisionAABB : public cGenericCollision
 {
-    enum cCollisionAABBState
+    struct cCollisionAABBSegment
+    {
+        double m_min[3];
+        double m_max[3];
+        double m_origin[3];
+        double m_invDir[3];
+        bool m_parallel[3];
+    };
+
+    struct cCollisionAABBPacket
     {
-        C_AABB_STATE_TEST_CURRENT_NODE,
-        C_AABB_STATE_TEST_LEFT_NODE,
-        C_AABB_STATE_TEST_RIGHT_NODE,
-        C_AABB_STATE_POP_STACK
+        cCollisionAABBSegment m_segments[C_COLLISION_PACKET_SIZE];
+        double m_min[3][C_COLLISION_PACKET_SIZE];
+        double m_max[3][C_COLLISION_PACKET_SIZE];
     };
 
-    struct cCollisionAABBStack
+    struct cCollisionAABBBuildItem
     {
-        int m_index;
-        cCollisionAABBState m_state;
+        double m_min[3];
+        double m_max[3];
+        double m_center[3];
+        int m_leafIndex;
+        int m_depth;
     };
 
     //--------------------------------------------------------------------------
@@ -119,6 +304,9 @@ public:
     //! This methods updates the collision detector and should be called if the 3D model it represents is modified.
     virtual void update();
 
+    //! This method refits the collision tree to the current vertex positions and should be called if the 3D model it represents is deformed.
+    virtual void refit();
+
     //! This method computes all collisions between a segment passed as argument and the attributed 3D object.
     virtual bool computeCollision(cGenericObject* a_object,
                                   cVector3d& a_segmentPointA,
@@ -126,12 +314,42 @@ public:
                                   cCollisionRecorder& a_recorder,
                                   cCollisionSettings& a_settings);
 
+    //! This method computes all collisions between a batch of segments and the attributed 3D object in a single traversal of the tree.
+    virtual bool computeCollisions(cGenericObject* a_object,
+                                   cCollisionQuery* a_queries,
+                                   const int a_numQueries);
+
     //! This method renders a visual representation of the collision tree.
     virtual void render(cRenderOptions& a_options);
 
+    //! This method returns the boundary box that encloses all elements of the collision tree.
+    virtual bool getBoundaryBox(cVector3d& a_min, cVector3d& a_max) const;
+
     //! This method initializes and builds the AABB collision tree.
     void initialize(const cGenericArrayPtr a_elements,
-                    const double a_radius = 0.0);
+                    const double a_radius = 0.0,
+                    const cCollisionAABBBuildMethod a_buildMethod = C_AABB_BUILD_MIDPOINT);
+
+    //! This method returns the algorithm used to build the tree.
+    cCollisionAABBBuildMethod getBuildMethod() const { return (m_buildMethod); }
+
+    //! This method sets the number of threads used by the next builds with \ref C_AABB_BUILD_SAH. A value of 0 uses one thread per core.
+    void setNumBuildThreads(const unsigned int a_numBuildThreads) { m_numBuildThreads = a_numBuildThreads; }
+
+    //! This method returns the number of threads used to build trees with \ref C_AABB_BUILD_SAH, or 0 if one thread is used per core.
+    unsigned int getNumBuildThreads() const { return (m_numBuildThreads); }
+
+    //! This method sets the ratio between the current and initial cost of the tree above which it is rebuilt in background. A value of 0 disables rebuilds.
+    void setRebuildThreshold(const double a_rebuildThreshold) { m_rebuildThreshold = cMax(0.0, a_rebuildThreshold); }
+
+    //! This method returns the ratio between the current and initial cost of the tree above which it is rebuilt in background.
+    double getRebuildThreshold() const { return (m_rebuildThreshold); }
+
+    //! This method returns the cost of the tree computed at the last build or refit.
+    double getTreeCost() const { return (m_cost); }
+
+    //! This method returns __true__ if a tree is being rebuilt in background, __false__ otherwise.
+    bool isRebuilding() const { return (m_rebuildTree != NULL); }
 
 
     //--------------------------------------------------------------------------
@@ -140,9 +358,65 @@ public:
 
 protected:
 
+    //! This method builds the collision tree above the leaves stored in \ref m_nodes.
+    void buildFromLeaves();
+
     // This method is used to recursively build the collision tree.
     int buildTree(const int a_indexFirstNode, const int a_indexLastNode, const int a_depth);
 
+    //! This method is used to recursively build the collision tree with the surface area heuristic.
+    int buildTreeSAH(cCollisionAABBBuildItem* a_items,
+                     const int a_indexFirstNode,
+                     const int a_indexLastNode,
+                     const int a_nodeIndex,
+                     const int a_depth,
+                     const int a_numThreadLevels);
+
+    //! This method flattens the collision tree into its compact depth-first representation.
+    void buildCompactTree();
+
+    //! This method is used to recursively flatten a subtree of the collision tree.
+    void flattenTree(const int a_nodeIndex);
+
+    //! This method recomputes the boundary box of a leaf from the current position of its vertices.
+    void fitLeaf(cCollisionAABBNode& a_leaf) const;
+
+    //! This method recomputes the boundary box of a leaf of the compact tree from the current position of its vertices.
+    void fitCompactLeaf(cCollisionAABBCompactNode& a_node,
+                        const int a_numVerticesPerElement,
+                        const unsigned int* a_indices,
+                        const cVector3d* a_positions) const;
+
+    //! This method computes the cost of the tree, used to monitor its quality.
+    double computeTreeCost() const;
+
+    //! This method waits for any tree being rebuilt in background and discards it.
+    void cancelRebuild();
+
+    //! This method returns the neighbourhood of a cache that encloses a segment, or updates the cache and returns __NULL__.
+    const cCollisionAABBCacheEntry* lookupCache(cCollisionAABBCache& a_cache,
+                                                const cCollisionAABBSegment& a_segment) const;
+
+    //! This method computes all collisions between a segment and the elements of a subtree of the compact tree.
+    bool traverseTree(const int a_nodeIndex,
+                      const cCollisionAABBSegment& a_segment,
+                      cGenericObject* a_object,
+                      cVector3d& a_segmentPointA,
+                      cVector3d& a_segmentPointB,
+                      cCollisionRecorder& a_recorder,
+                      cCollisionSettings& a_settings);
+
+    //! This method returns the mask of the segments of a packet whose boundary boxes overlap a node.
+    unsigned int intersectPacket(const cCollisionAABBCompactNode& a_node,
+                                 const cCollisionAABBPacket& a_packet) const;
+
+    //! This method computes all collisions between a packet of segments and the elements of a subtree of the compact tree.
+    bool traversePacket(const int a_nodeIndex,
+                        const unsigned int a_mask,
+                        const cCollisionAABBPacket& a_packet,
+                        cGenericObject* a_object,
+                        cCollisionQuery* a_queries);
+
 
     //--------------------------------------------------------------------------
     // PROTECTED MEMBERS:
@@ -165,8 +439,44 @@ protected:
     //! Index number of root node.
     int m_rootIndex;
 
+    //! List of compact nodes in depth-first order. The root node is located at index 0.
+    std::vector<cCollisionAABBCompactNode> m_compactNodes;
+
+    //! List of element indices referenced by the compact leaf nodes, in depth-first order.
+    std::vector<int> m_compactElements;
+
+    //! Index in \ref m_nodes of the node from which each compact node was created.
+    std::vector<int> m_compactNodeSources;
+
     //! Maximum depth of tree.
     int m_maxDepth;
+
+    //! Algorithm used to build the tree.
+    cCollisionAABBBuildMethod m_buildMethod;
+
+    //! Number of threads used to build trees with \ref C_AABB_BUILD_SAH, or 0 for one thread per core.
+    unsigned int m_numBuildThreads;
+
+    //! If __true__, the boundary boxes of \ref m_nodes have not been updated since the last refit.
+    bool m_nodesOutdated;
+
+    //! Ratio between the current and initial cost of the tree above which it is rebuilt in background.
+    double m_rebuildThreshold;
+
+    //! Cost of the tree when it was built.
+    double m_buildCost;
+
+    //! Cost of the tree computed at the last build or refit.
+    double m_cost;
+
+    //! Tree being rebuilt in background, or __NULL__ if no rebuild is in progress.
+    cCollisionAABB* m_rebuildTree;
+
+    //! Task rebuilding \ref m_rebuildTree in background.
+    std::future<void> m_rebuildTask;
+
+    //! Version of the tree, renewed each time the tree is built or refitted.
+    unsigned long long m_version;
 };
 
 //------------------------------------------------------------------------------
@@ -591,6 +591,30 @@ public:
     }
 
 
+    //--------------------------------------------------------------------------
+    /*!
+        \brief
+        This method returns the surface area of the boundary box.
+
+        \details
+        This method returns the surface area of the boundary box, which is 
+        proportional to the probability that a random segment crosses the box.
+        An empty box has a surface area of zero.
+
+        \return Surface area of the box.
+    */
+    //--------------------------------------------------------------------------
+    inline double getSurfaceArea() const
+    {
+        cVector3d size = cSub(m_max, m_min);
+        if ((size(0) < 0.0) || (size(1) < 0.0) || (size(2) < 0.0))
+        {
+            return (0.0);
+        }
+        return (2.0 * (size(0) * size(1) + size(1) * size(2) + size(2) * size(0)));
+    }
+
+
     //--------------------------------------------------------------------------
     /*!
         \brief
@@ -46,6 +46,9 @@
 //------------------------------------------------------------------------------
 #include "collisions/CCollisionAABBTree.h"
 //------------------------------------------------------------------------------
+#include <cfloat>
+#include <cmath>
+//------------------------------------------------------------------------------
 
 //------------------------------------------------------------------------------
 namespace chai3d {
@@ -190,6 +193,47 @@ void cCollisionAABBNode::render(int a_depth)
 }
 
 
+//==============================================================================
+/*!
+    This method sets the single precision boundary box of this compact node
+    from a double precision box. Values are rounded outwards so that the
+    resulting box always encloses the original one.
+
+    \param  a_bbox  Boundary box to be stored.
+*/
+//==============================================================================
+void cCollisionAABBCompactNode::setBBox(const cCollisionAABBBox& a_bbox)
+{
+    setBBox(a_bbox.m_min, a_bbox.m_max);
+}
+
+
+//==============================================================================
+/*!
+    This method sets the single precision boundary box of this compact node
+    from the double precision corners of a box. Values are rounded outwards 
+    so that the resulting box always encloses the original one.
+
+    \param  a_min  Lower corner of box.
+    \param  a_max  Upper corner of box.
+*/
+//==============================================================================
+void cCollisionAABBCompactNode::setBBox(const cVector3d& a_min, const cVector3d& a_max)
+{
+    // relative size of a float step (2^-23). Each corner is moved outwards by 
+    // one step before it is rounded, which is more than the rounding error of 
+    // the conversion. Testing the rounding direction of each corner instead 
+    // costs a poorly predicted branch per value, which doubles refit times.
+    const double step = 1.0 / 8388608.0;
+
+    for (int i=0; i<3; i++)
+    {
+        m_min[i] = (float)(a_min(i) - (fabs(a_min(i)) * step + FLT_MIN));
+        m_max[i] = (float)(a_max(i) + (fabs(a_max(i)) * step + FLT_MIN));
+    }
+}
+
+
 //------------------------------------------------------------------------------
 } // namespace chai3d
 //------------------------------------------------------------------------------
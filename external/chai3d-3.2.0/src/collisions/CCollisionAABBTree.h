@@ -154,6 +154,144 @@ public:
 };
 
 
+//==============================================================================
+/*!
+    \class      cCollisionAABBCompactNode
+    \ingroup    collisions
+
+    \brief
+    This structure implements a compact node of a flattened AABB collision tree.
+
+    \details
+    This structure stores a tree node in 32 bytes so that two nodes fit in a
+    single cache line. Boundary box values are stored in single precision and
+    are rounded outwards so that the compact box always encloses the original
+    double precision box. \n\n
+
+    Nodes are stored in depth-first order: the left child of an internal node
+    is always the node that immediately follows it, so only the index of the
+    right child needs to be stored. For leaf nodes, \ref m_index refers to the
+    first entry of a list of element indices that is stored in the same
+    depth-first order, and \ref m_count holds the number of elements.
+*/
+//==============================================================================
+struct cCollisionAABBCompactNode
+{
+    //--------------------------------------------------------------------------
+    // PUBLIC METHODS:
+    //--------------------------------------------------------------------------
+
+public:
+
+    //! This method sets the boundary box of this node from a double precision box.
+    void setBBox(const cCollisionAABBBox& a_bbox);
+
+    //! This method sets the boundary box of this node from the double precision corners of a box.
+    void setBBox(const cVector3d& a_min, const cVector3d& a_max);
+
+    //! This method returns the surface area of the boundary box of this node.
+    inline double getSurfaceArea() const
+    {
+        double x = (double)m_max[0] - (double)m_min[0];
+        double y = (double)m_max[1] - (double)m_min[1];
+        double z = (double)m_max[2] - (double)m_min[2];
+        if ((x < 0.0) || (y < 0.0) || (z < 0.0)) { return (0.0); }
+        return (2.0 * (x * y + y * z + z * x));
+    }
+
+    //! This method returns __true__ if this node is a leaf, __false__ otherwise.
+    inline bool isLeaf() const { return (m_count > 0); }
+
+    //--------------------------------------------------------------------------
+    /*!
+        \brief
+        This method determines whether this node overlaps a boundary box
+        described by its lower and upper corners.
+
+        \param  a_min  Lower corner of box.
+        \param  a_max  Upper corner of box.
+
+        \return __true__ if both boxes overlap, __false__ otherwise.
+    */
+    //--------------------------------------------------------------------------
+    inline bool intersect(const double a_min[3], const double a_max[3]) const
+    {
+        if (a_min[0] > m_max[0]) return (false);
+        if (a_min[1] > m_max[1]) return (false);
+        if (a_min[2] > m_max[2]) return (false);
+        if (a_max[0] < m_min[0]) return (false);
+        if (a_max[1] < m_min[1]) return (false);
+        if (a_max[2] < m_min[2]) return (false);
+
+        return (true);
+    }
+
+    //--------------------------------------------------------------------------
+    /*!
+        \brief
+        This method determines whether a segment intersects this node.
+
+        \details
+        This method implements a slab test between the boundary box of this
+        node and a segment described by its origin and by the inverse of its
+        direction. Axes along which the segment is parallel to the box are
+        flagged in \p a_parallel and are tested against the origin only.
+
+        \param  a_origin    Initial point of segment.
+        \param  a_invDir    Inverse of segment direction (B - A) for each axis.
+        \param  a_parallel  Flags for axes along which the segment has no extent.
+
+        \return __true__ if the segment intersects the box, __false__ otherwise.
+    */
+    //--------------------------------------------------------------------------
+    inline bool intersect(const double a_origin[3],
+                          const double a_invDir[3],
+                          const bool a_parallel[3]) const
+    {
+        double tmin = 0.0;
+        double tmax = 1.0;
+
+        for (int i=0; i<3; i++)
+        {
+            if (a_parallel[i])
+            {
+                if ((a_origin[i] < m_min[i]) || (a_origin[i] > m_max[i])) return (false);
+            }
+            else
+            {
+                double t0 = ((double)m_min[i] - a_origin[i]) * a_invDir[i];
+                double t1 = ((double)m_max[i] - a_origin[i]) * a_invDir[i];
+                if (t0 > t1) { double t = t0; t0 = t1; t1 = t; }
+                if (t0 > tmin) tmin = t0;
+                if (t1 < tmax) tmax = t1;
+                if (tmin > tmax) return (false);
+            }
+        }
+
+        return (true);
+    }
+
+
+    //--------------------------------------------------------------------------
+    // PUBLIC MEMBERS:
+    //--------------------------------------------------------------------------
+
+public:
+
+    //! Lower corner of boundary box.
+    float m_min[3];
+
+    //! Upper corner of boundary box.
+    float m_max[3];
+
+    //! Index of right child node (internal node) or of first element in the element list (leaf node).
+    int m_index;
+
+    //! Number of elements covered by this leaf, 0 for internal nodes.
+    int m_count;
+};
+
+
 //------------------------------------------------------------------------------
 }   // namespace chai3d
 //------------------------------------------------------------------------------
@@ -68,6 +68,16 @@ namespace chai3d {
 */
 //==============================================================================
 
+//------------------------------------------------------------------------------
+class cCollisionAABBCache;
+//------------------------------------------------------------------------------
+
+//------------------------------------------------------------------------------
+//! Maximum number of segments that collision detectors process together in a single pass.
+const int C_COLLISION_PACKET_SIZE = 4;
+
+//------------------------------------------------------------------------------
+
 enum cCollisionType
 {
     C_COL_NOT_DEFINED,
@@ -251,6 +261,7 @@ struct cCollisionSettings
         m_adjustObjectMotion            = false;
         m_ignoreShapes                  = false;
         m_collisionRadius               = 0.0;
+        m_contactCache                  = NULL;
     }
 
     //! If __true__, only return the nearest collision event.
@@ -273,6 +284,55 @@ struct cCollisionSettings
 
     //! Collision radius. This value typically corresponds to the radius of the virtual tool or cursor.
     double m_collisionRadius;
+
+    //! If not __NULL__, AABB collision trees store and reuse the neighbourhood of the segment in this cache.
+    cCollisionAABBCache* m_contactCache;
+};
+
+
+//==============================================================================
+/*!
+    \struct     cCollisionQuery
+    \ingroup    collisions
+
+    \brief
+    This structure describes one segment of a batch of collision queries.
+
+    \details
+    Several segments can be tested against the same objects in a single pass 
+    by passing an array of cCollisionQuery to 
+    cGenericObject::computeCollisionDetection(). Each query reports its 
+    collision events in its own recorder, exactly as if it had been tested 
+    alone. Recorders must therefore not be shared between queries of a 
+    same batch.
+*/
+//==============================================================================
+struct cCollisionQuery
+{
+    //! Constructor of cCollisionQuery.
+    cCollisionQuery()
+    {
+        m_segmentPointA.zero();
+        m_segmentPointB.zero();
+        m_recorder  = NULL;
+        m_settings  = NULL;
+        m_hit       = false;
+    }
+
+    //! Start point of segment.
+    cVector3d m_segmentPointA;
+
+    //! End point of segment.
+    cVector3d m_segmentPointB;
+
+    //! Recorder which stores the collision events of this segment.
+    cCollisionRecorder* m_recorder;
+
+    //! Collision settings of this segment.
+    cCollisionSettings* m_settings;
+
+    //! Set to __true__ when a collision is detected for this segment. It is never reset by collision detectors.
+    bool m_hit;
 };
 
 //------------------------------------------------------------------------------
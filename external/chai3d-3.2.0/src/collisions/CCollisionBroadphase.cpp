@@ -0,0 +1,821 @@
+//==============================================================================
+/*
+    Software License Agreement (BSD License)
+    Copyright (c) 2003-2016, CHAI3D.
+    (www.chai3d.org)
+
+    All rights reserved.
+
+    Redistribution and use in source and binary forms, with or without
+    modification, are permitted provided that the following conditions
+    are met:
+
+    * Redistributions of source code must retain the above copyright
+    notice, this list of conditions and the following disclaimer.
+
+    * Redistributions in binary form must reproduce the above
+    copyright notice, this list of conditions and the following
+    disclaimer in the documentation and/or other materials provided
+    with the distribution.
+
+    * Neither the name of CHAI3D nor the names of its contributors may
+    be used to endorse or promote products derived from this software
+    without specific prior written permission.
+
+    THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS
+    "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT
+    LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS
+    FOR A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE
+    COPYRIGHT OWNER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT,
+    INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING,
+    BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES;
+    LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER
+    CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT
+    LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN
+    ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+    POSSIBILITY OF SUCH DAMAGE. 
+
+    \author    <http://www.chai3d.org>
+    \version   3.2.0 $Rev: 2182 $
+*/
+//==============================================================================
+
+//------------------------------------------------------------------------------
+#include "collisions/CCollisionBroadphase.h"
+#include "world/CGenericObject.h"
+//------------------------------------------------------------------------------
+#include <algorithm>
+//------------------------------------------------------------------------------
+using namespace std;
+//------------------------------------------------------------------------------
+
+//------------------------------------------------------------------------------
+namespace chai3d {
+//------------------------------------------------------------------------------
+
+//==============================================================================
+/*!
+    This function returns the surface area of the box that encloses two boxes.
+
+    \param  a_minA  Lower corner of the first box.
+    \param  a_maxA  Upper corner of the first box.
+    \param  a_minB  Lower corner of the second box.
+    \param  a_maxB  Upper corner of the second box.
+
+    \return Surface area of the enclosing box.
+*/
+//==============================================================================
+static inline double cBroadphaseArea(const cVector3d& a_minA, const cVector3d& a_maxA,
+                                     const cVector3d& a_minB, const cVector3d& a_maxB)
+{
+    double dx = cMax(a_maxA(0), a_maxB(0)) - cMin(a_minA(0), a_minB(0));
+    double dy = cMax(a_maxA(1), a_maxB(1)) - cMin(a_minA(1), a_minB(1));
+    double dz = cMax(a_maxA(2), a_maxB(2)) - cMin(a_minA(2), a_minB(2));
+    return (2.0 * (dx * dy + dy * dz + dz * dx));
+}
+
+
+//==============================================================================
+/*!
+    Constructor of cCollisionBroadphase.
+*/
+//==============================================================================
+cCollisionBroadphase::cCollisionBroadphase()
+{
+    m_rootIndex = -1;
+    m_freeIndex = -1;
+    m_margin = C_BROADPHASE_DEFAULT_MARGIN;
+    m_numReinsertedObjects = 0;
+}
+
+
+//==============================================================================
+/*!
+    This method removes all objects and nodes from the broadphase.
+*/
+//==============================================================================
+void cCollisionBroadphase::clear()
+{
+    m_nodes.clear();
+    m_rootIndex = -1;
+    m_freeIndex = -1;
+    m_objects.clear();
+    m_objectLeaves.clear();
+    m_objectMoving.clear();
+    m_unboundedObjects.clear();
+    m_movingObjects.clear();
+    m_numReinsertedObjects = 0;
+}
+
+
+//==============================================================================
+/*!
+    This method updates the broadphase from a list of objects. \n
+
+    If the list differs from the one passed at the previous call, the tree is 
+    rebuilt. Otherwise the boundary box of each object is computed from its 
+    current position, and the objects whose box has left their enlarged box 
+    in the tree are removed and inserted again. \n
+
+    The boundary box of an object encloses the collision boundary boxes of the
+    object and of all its descendants, expressed in the frame of the parent of
+    the objects. The global positions of the objects must be up to date for 
+    their motion to be detected.
+
+    \param  a_objects  List of objects.
+*/
+//==============================================================================
+void cCollisionBroadphase::update(const vector<cGenericObject*>& a_objects)
+{
+    ////////////////////////////////////////////////////////////////////////////
+    // SYNCHRONIZE OBJECTS
+    ////////////////////////////////////////////////////////////////////////////
+
+    if (a_objects != m_objects)
+    {
+        clear();
+
+        size_t numObjects = a_objects.size();
+        m_objects = a_objects;
+        m_objectLeaves.assign(numObjects, -1);
+        m_objectMoving.assign(numObjects, false);
+        m_unboundedObjects.reserve(numObjects);
+        m_movingObjects.reserve(numObjects);
+        m_nodes.reserve(2 * numObjects);
+    }
+
+    m_unboundedObjects.clear();
+    m_movingObjects.clear();
+    m_numReinsertedObjects = 0;
+
+
+    ////////////////////////////////////////////////////////////////////////////
+    // UPDATE BOUNDARY BOXES
+    ////////////////////////////////////////////////////////////////////////////
+
+    cVector3d pos(0.0, 0.0, 0.0);
+    cMatrix3d rot = cIdentity3d();
+
+    int numObjects = (int)(m_objects.size());
+    for (int i=0; i<numObjects; i++)
+    {
+        // compute boundary box of object and descendants
+        cVector3d min( C_LARGE, C_LARGE, C_LARGE);
+        cVector3d max(-C_LARGE,-C_LARGE,-C_LARGE);
+        bool moving = false;
+        bool bounded = encloseObject(m_objects[i], pos, rot, min, max, moving);
+
+        m_objectMoving[i] = moving;
+        if (moving)
+        {
+            m_movingObjects.push_back(i);
+        }
+
+        int leafIndex = m_objectLeaves[i];
+
+        // objects that cannot be bounded, or contain nothing to collide with, are not stored in the tree
+        bool empty = (min(0) > max(0)) || (min(1) > max(1)) || (min(2) > max(2));
+        if (!bounded || empty)
+        {
+            if (!bounded)
+            {
+                m_unboundedObjects.push_back(i);
+            }
+
+            if (leafIndex >= 0)
+            {
+                removeLeaf(leafIndex);
+                freeNode(leafIndex);
+                m_objectLeaves[i] = -1;
+            }
+            continue;
+        }
+
+        // nothing to do if the object remains inside its enlarged box
+        if (leafIndex >= 0)
+        {
+            cCollisionBroadphaseNode& leaf = m_nodes[leafIndex];
+            if ((min(0) >= leaf.m_min(0)) && (min(1) >= leaf.m_min(1)) && (min(2) >= leaf.m_min(2)) &&
+                (max(0) <= leaf.m_max(0)) && (max(1) <= leaf.m_max(1)) && (max(2) <= leaf.m_max(2)))
+            {
+                continue;
+            }
+
+            removeLeaf(leafIndex);
+        }
+        else
+        {
+            leafIndex = allocateNode();
+            m_objectLeaves[i] = leafIndex;
+        }
+
+        // store enlarged box and insert leaf
+        cCollisionBroadphaseNode& leaf = m_nodes[leafIndex];
+        leaf.m_min = min - cVector3d(m_margin, m_margin, m_margin);
+        leaf.m_max = max + cVector3d(m_margin, m_margin, m_margin);
+        leaf.m_left = -1;
+        leaf.m_right = -1;
+        leaf.m_height = 0;
+        leaf.m_object = i;
+        insertLeaf(leafIndex);
+
+        m_numReinsertedObjects++;
+    }
+}
+
+
+//==============================================================================
+/*!
+    This method returns the indices of the objects whose enlarged boundary 
+    boxes are crossed by a segment, together with the objects that cannot be 
+    bounded and, if \\p a_settings requests motion adjustment, the objects that
+    moved at the last update. The indices are sorted in increasing order so 
+    that objects are tested in the same order as without the broadphase. \n
+
+    The boxes are further enlarged by the collision radius of \\p a_settings.
+    No memory is allocated if the capacity of \\p a_candidates is at least the
+    number of objects.
+
+    \param  a_segmentPointA  Start point of segment.
+    \param  a_segmentPointB  End point of segment.
+    \param  a_settings       Collision settings information.
+    \param  a_candidates     Returned indices of the objects to be tested.
+*/
+//==============================================================================
+void cCollisionBroadphase::computeCandidates(const cVector3d& a_segmentPointA,
+                                             const cVector3d& a_segmentPointB,
+                                             const cCollisionSettings& a_settings,
+                                             vector<int>& a_candidates) const
+{
+    a_candidates.clear();
+
+    bool adjustObjectMotion = a_settings.m_adjustObjectMotion;
+
+    // collect objects from the tree
+    if (m_rootIndex >= 0)
+    {
+        cVector3d invDir;
+        bool parallel[3];
+        for (int i=0; i<3; i++)
+        {
+            double dir = a_segmentPointB(i) - a_segmentPointA(i);
+            parallel[i] = (dir == 0.0);
+            invDir(i) = parallel[i] ? 0.0 : (1.0 / dir);
+        }
+
+        traverseTree(m_rootIndex,
+                     a_segmentPointA,
+                     invDir,
+                     parallel,
+                     a_settings.m_collisionRadius,
+                     adjustObjectMotion,
+                     a_candidates);
+    }
+
+    // objects that cannot be bounded
+    a_candidates.insert(a_candidates.end(), m_unboundedObjects.begin(), m_unboundedObjects.end());
+
+    // objects whose motion is compensated
+    if (adjustObjectMotion)
+    {
+        for (size_t i=0; i<m_movingObjects.size(); i++)
+        {
+            // unbounded objects have already been added
+            if (m_objectLeaves[m_movingObjects[i]] >= 0)
+            {
+                a_candidates.push_back(m_movingObjects[i]);
+            }
+        }
+    }
+
+    // restore the order of the objects
+    sort(a_candidates.begin(), a_candidates.end());
+}
+
+
+//==============================================================================
+/*!
+    This method encloses the boundary box of an object and of all its 
+    descendants. The box of each object, returned by 
+    cGenericObject::getCollisionBoundaryBox(), is transformed into the frame 
+    of the objects passed to update(). Ghost objects and their descendants are
+    ignored, as they are by the collision detection.
+
+    \param  a_object     Object.
+    \param  a_parentPos  Position of the parent of the object.
+    \param  a_parentRot  Rotation of the parent of the object.
+    \param  a_min        Lower corner of the box, enlarged to enclose the object.
+    \param  a_max        Upper corner of the box, enlarged to enclose the object.
+    \param  a_moving     Set to __true__ if the object or a descendant has moved.
+
+    \return __true__ if the object and its descendants are bounded, __false__ otherwise.
+*/
+//==============================================================================
+bool cCollisionBroadphase::encloseObject(cGenericObject* a_object,
+                                         const cVector3d& a_parentPos,
+                                         const cMatrix3d& a_parentRot,
+                                         cVector3d& a_min,
+                                         cVector3d& a_max,
+                                         bool& a_moving)
+{
+    // ghost objects are ignored by the collision detection
+    if (a_object->getGhostEnabled()) { return (true); }
+
+    // position and rotation of the object
+    cVector3d pos = a_parentPos + a_parentRot * a_object->getLocalPos();
+    cMatrix3d rot = cMul(a_parentRot, a_object->getLocalRot());
+
+    // detect motion since the previous computation of global positions
+    cMatrix3d prevGlobalRot = a_object->getPrevGlobalRot();
+    if (!a_object->getGlobalPos().equals(a_object->getPrevGlobalPos()) ||
+        !a_object->getGlobalRot().equals(prevGlobalRot))
+    {
+        a_moving = true;
+    }
+
+    // boundary box of the object
+    cVector3d min, max;
+    if (!a_object->getCollisionBoundaryBox(min, max))
+    {
+        return (false);
+    }
+
+    if ((min(0) <= max(0)) && (min(1) <= max(1)) && (min(2) <= max(2)))
+    {
+        cVector3d center = pos + rot * (0.5 * (min + max));
+        cVector3d extent = 0.5 * (max - min);
+        for (int i=0; i<3; i++)
+        {
+            double e = fabs(rot(i,0)) * extent(0) +
+                       fabs(rot(i,1)) * extent(1) +
+                       fabs(rot(i,2)) * extent(2);
+            a_min(i) = cMin(a_min(i), center(i) - e);
+            a_max(i) = cMax(a_max(i), center(i) + e);
+        }
+    }
+
+    // boundary boxes of the children
+    int numChildren = a_object->getNumChildren();
+    for (int i=0; i<numChildren; i++)
+    {
+        if (!encloseObject(a_object->getChild(i), pos, rot, a_min, a_max, a_moving))
+        {
+            return (false);
+        }
+    }
+
+    return (true);
+}
+
+
+//==============================================================================
+/*!
+    This method returns an unused node, allocating one if needed.
+
+    \return Index of the node.
+*/
+//==============================================================================
+int cCollisionBroadphase::allocateNode()
+{
+    if (m_freeIndex < 0)
+    {
+        cCollisionBroadphaseNode node;
+        node.m_min.zero();
+        node.m_max.zero();
+        node.m_left = -1;
+        node.m_right = -1;
+        node.m_height = -1;
+        node.m_object = -1;
+        node.m_parent = -1;
+        m_nodes.push_back(node);
+        m_freeIndex = (int)(m_nodes.size()) - 1;
+    }
+
+    int nodeIndex = m_freeIndex;
+    cCollisionBroadphaseNode& node = m_nodes[nodeIndex];
+    m_freeIndex = node.m_parent;
+    node.m_parent = -1;
+    node.m_left = -1;
+    node.m_right = -1;
+    node.m_height = 0;
+    node.m_object = -1;
+
+    return (nodeIndex);
+}
+
+
+//==============================================================================
+/*!
+    This method releases a node so that it can be reused.
+
+    \param  a_nodeIndex  Index of the node.
+*/
+//==============================================================================
+void cCollisionBroadphase::freeNode(const int a_nodeIndex)
+{
+    cCollisionBroadphaseNode& node = m_nodes[a_nodeIndex];
+    node.m_parent = m_freeIndex;
+    node.m_height = -1;
+    node.m_object = -1;
+    m_freeIndex = a_nodeIndex;
+}
+
+
+//==============================================================================
+/*!
+    This method inserts a leaf in the tree. The leaf is paired with the node
+    that minimizes the increase of surface area of the tree, after which the 
+    ancestors of the leaf are refitted and rebalanced.
+
+    \param  a_leafIndex  Index of the leaf.
+*/
+//==============================================================================
+void cCollisionBroadphase::insertLeaf(const int a_leafIndex)
+{
+    if (m_rootIndex < 0)
+    {
+        m_rootIndex = a_leafIndex;
+        m_nodes[a_leafIndex].m_parent = -1;
+        return;
+    }
+
+    ////////////////////////////////////////////////////////////////////////////
+    // FIND SIBLING
+    ////////////////////////////////////////////////////////////////////////////
+
+    cVector3d leafMin = m_nodes[a_leafIndex].m_min;
+    cVector3d leafMax = m_nodes[a_leafIndex].m_max;
+
+    int index = m_rootIndex;
+    while (m_nodes[index].m_left >= 0)
+    {
+        const cCollisionBroadphaseNode& node = m_nodes[index];
+        const cCollisionBroadphaseNode& left = m_nodes[node.m_left];
+        const cCollisionBroadphaseNode& right = m_nodes[node.m_right];
+
+        double area = cBroadphaseArea(node.m_min, node.m_max, node.m_min, node.m_max);
+        double combinedArea = cBroadphaseArea(node.m_min, node.m_max, leafMin, leafMax);
+
+        // cost of creating a new parent for this node and the leaf
+        double cost = 2.0 * combinedArea;
+
+        // minimum cost of pushing the leaf further down the tree
+        double inheritanceCost = 2.0 * (combinedArea - area);
+
+        double costLeft = cBroadphaseArea(left.m_min, left.m_max, leafMin, leafMax) + inheritanceCost;
+        if (left.m_left >= 0)
+        {
+            costLeft -= cBroadphaseArea(left.m_min, left.m_max, left.m_min, left.m_max);
+        }
+
+        double costRight = cBroadphaseArea(right.m_min, right.m_max, leafMin, leafMax) + inheritanceCost;
+        if (right.m_left >= 0)
+        {
+            costRight -= cBroadphaseArea(right.m_min, right.m_max, right.m_min, right.m_max);
+        }
+
+        if ((cost < costLeft) && (cost < costRight))
+        {
+            break;
+        }
+
+        index = (costLeft < costRight) ? node.m_left : node.m_right;
+    }
+
+    int siblingIndex = index;
+
+
+    ////////////////////////////////////////////////////////////////////////////
+    // CREATE PARENT
+    ////////////////////////////////////////////////////////////////////////////
+
+    int oldParentIndex = m_nodes[siblingIndex].m_parent;
+    int newParentIndex = allocateNode();
+
+    cCollisionBroadphaseNode& newParent = m_nodes[newParentIndex];
+    newParent.m_parent = oldParentIndex;
+    newParent.m_left = siblingIndex;
+    newParent.m_right = a_leafIndex;
+    fitNode(newParentIndex);
+
+    if (oldParentIndex >= 0)
+    {
+        cCollisionBroadphaseNode& oldParent = m_nodes[oldParentIndex];
+        if (oldParent.m_left == siblingIndex)
+        {
+            oldParent.m_left = newParentIndex;
+        }
+        else
+        {
+            oldParent.m_right = newParentIndex;
+        }
+    }
+    else
+    {
+        m_rootIndex = newParentIndex;
+    }
+
+    m_nodes[siblingIndex].m_parent = newParentIndex;
+    m_nodes[a_leafIndex].m_parent = newParentIndex;
+
+
+    ////////////////////////////////////////////////////////////////////////////
+    // REFIT ANCESTORS
+    ////////////////////////////////////////////////////////////////////////////
+
+    index = oldParentIndex;
+    while (index >= 0)
+    {
+        index = balance(index);
+        fitNode(index);
+        index = m_nodes[index].m_parent;
+    }
+}
+
+
+//==============================================================================
+/*!
+    This method removes a leaf from the tree. The parent of the leaf is 
+    released and replaced by the sibling of the leaf, after which the 
+    ancestors are refitted and rebalanced. The leaf itself is not released.
+
+    \param  a_leafIndex  Index of the leaf.
+*/
+//==============================================================================
+void cCollisionBroadphase::removeLeaf(const int a_leafIndex)
+{
+    if (a_leafIndex == m_rootIndex)
+    {
+        m_rootIndex = -1;
+        return;
+    }
+
+    int parentIndex = m_nodes[a_leafIndex].m_parent;
+    int grandParentIndex = m_nodes[parentIndex].m_parent;
+    int siblingIndex = (m_nodes[parentIndex].m_left == a_leafIndex) ?
+                        m_nodes[parentIndex].m_right : m_nodes[parentIndex].m_left;
+
+    if (grandParentIndex >= 0)
+    {
+        // connect sibling to grand parent
+        cCollisionBroadphaseNode& grandParent = m_nodes[grandParentIndex];
+        if (grandParent.m_left == parentIndex)
+        {
+            grandParent.m_left = siblingIndex;
+        }
+        else
+        {
+            grandParent.m_right = siblingIndex;
+        }
+        m_nodes[siblingIndex].m_parent = grandParentIndex;
+        freeNode(parentIndex);
+
+        // refit ancestors
+        int index = grandParentIndex;
+        while (index >= 0)
+        {
+            index = balance(index);
+            fitNode(index);
+            index = m_nodes[index].m_parent;
+        }
+    }
+    else
+    {
+        m_rootIndex = siblingIndex;
+        m_nodes[siblingIndex].m_parent = -1;
+        freeNode(parentIndex);
+    }
+
+    m_nodes[a_leafIndex].m_parent = -1;
+}
+
+
+//==============================================================================
+/*!
+    This method updates the boundary box and the height of an internal node 
+    from those of its children.
+
+    \param  a_nodeIndex  Index of the node.
+*/
+//==============================================================================
+void cCollisionBroadphase::fitNode(const int a_nodeIndex)
+{
+    cCollisionBroadphaseNode& node = m_nodes[a_nodeIndex];
+    const cCollisionBroadphaseNode& left = m_nodes[node.m_left];
+    const cCollisionBroadphaseNode& right = m_nodes[node.m_right];
+
+    for (int i=0; i<3; i++)
+    {
+        node.m_min(i) = cMin(left.m_min(i), right.m_min(i));
+        node.m_max(i) = cMax(left.m_max(i), right.m_max(i));
+    }
+    node.m_height = 1 + cMax(left.m_height, right.m_height);
+}
+
+
+//==============================================================================
+/*!
+    This method checks the heights of the two subtrees of a node. If they 
+    differ by more than one, the taller subtree is rotated up and replaces the
+    node.
+
+    \param  a_nodeIndex  Index of the node.
+
+    \return Index of the node that is now at the position of \p a_nodeIndex.
+*/
+//==============================================================================
+int cCollisionBroadphase::balance(const int a_nodeIndex)
+{
+    int iA = a_nodeIndex;
+    if ((m_nodes[iA].m_left < 0) || (m_nodes[iA].m_height < 2))
+    {
+        return (iA);
+    }
+
+    int iB = m_nodes[iA].m_left;
+    int iC = m_nodes[iA].m_right;
+    int difference = m_nodes[iC].m_height - m_nodes[iB].m_height;
+
+    // the taller child (C or B) is rotated up, and its taller child (F or D) 
+    // stays below it while its shorter child (G or E) is moved below A.
+    if ((difference > 1) || (difference < -1))
+    {
+        bool rotateRight = (difference > 1);
+        int iUp = rotateRight ? iC : iB;
+        int iF = m_nodes[iUp].m_left;
+        int iG = m_nodes[iUp].m_right;
+
+        // the node moving up takes the place of A
+        m_nodes[iUp].m_left = iA;
+        m_nodes[iUp].m_parent = m_nodes[iA].m_parent;
+        m_nodes[iA].m_parent = iUp;
+
+        int iParent = m_nodes[iUp].m_parent;
+        if (iParent >= 0)
+        {
+            if (m_nodes[iParent].m_left == iA)
+            {
+                m_nodes[iParent].m_left = iUp;
+            }
+            else
+            {
+                m_nodes[iParent].m_right = iUp;
+            }
+        }
+        else
+        {
+            m_rootIndex = iUp;
+        }
+
+        // keep the taller grandchild below the node moving up
+        int iKeep = iF;
+        int iMove = iG;
+        if (m_nodes[iF].m_height < m_nodes[iG].m_height)
+        {
+            iKeep = iG;
+            iMove = iF;
+        }
+
+        m_nodes[iUp].m_right = iKeep;
+        if (rotateRight)
+        {
+            m_nodes[iA].m_right = iMove;
+        }
+        else
+        {
+            m_nodes[iA].m_left = iMove;
+        }
+        m_nodes[iMove].m_parent = iA;
+
+        fitNode(iA);
+        fitNode(iUp);
+
+        return (iUp);
+    }
+
+    return (iA);
+}
+
+
+//==============================================================================
+/*!
+    This method returns __true__ if the boundary box of a node, enlarged by a
+    radius, is crossed by a segment. The segment is described by its origin 
+    and the inverse of its direction along each axis.
+
+    \param  a_node      Node.
+    \param  a_origin    Start point of segment.
+    \param  a_invDir    Inverse of the direction of the segment along each axis.
+    \param  a_parallel  For each axis, __true__ if the segment is parallel to it.
+    \param  a_radius    Radius by which the box is enlarged.
+
+    \return __true__ if the segment crosses the box, __false__ otherwise.
+*/
+//==============================================================================
+bool cCollisionBroadphase::intersect(const cCollisionBroadphaseNode& a_node,
+                                     const cVector3d& a_origin,
+                                     const cVector3d& a_invDir,
+                                     const bool a_parallel[3],
+                                     const double a_radius) const
+{
+    double tmin = 0.0;
+    double tmax = 1.0;
+
+    for (int i=0; i<3; i++)
+    {
+        double lower = a_node.m_min(i) - a_radius;
+        double upper = a_node.m_max(i) + a_radius;
+
+        if (a_parallel[i])
+        {
+            if ((a_origin(i) < lower) || (a_origin(i) > upper))
+            {
+                return (false);
+            }
+        }
+        else
+        {
+            double t0 = (lower - a_origin(i)) * a_invDir(i);
+            double t1 = (upper - a_origin(i)) * a_invDir(i);
+            if (t0 > t1)
+            {
+                double t = t0; t0 = t1; t1 = t;
+            }
+            tmin = cMax(tmin, t0);
+            tmax = cMin(tmax, t1);
+            if (tmin > tmax)
+            {
+                return (false);
+            }
+        }
+    }
+
+    return (true);
+}
+
+
+//==============================================================================
+/*!
+    This method collects the objects of a subtree whose boundary boxes are 
+    crossed by a segment. Nodes are visited depth first using a stack of 
+    fixed size; if the stack is full, the subtree is visited recursively.
+
+    \param  a_nodeIndex          Index of the root of the subtree.
+    \param  a_origin             Start point of segment.
+    \param  a_invDir             Inverse of the direction of the segment along each axis.
+    \param  a_parallel           For each axis, __true__ if the segment is parallel to it.
+    \param  a_radius             Radius by which the boxes are enlarged.
+    \param  a_skipMovingObjects  If __true__, objects that moved at the last update are ignored.
+    \param  a_candidates         List to which the indices of the objects are appended.
+*/
+//==============================================================================
+void cCollisionBroadphase::traverseTree(const int a_nodeIndex,
+                                        const cVector3d& a_origin,
+                                        const cVector3d& a_invDir,
+                                        const bool a_parallel[3],
+                                        const double a_radius,
+                                        const bool a_skipMovingObjects,
+                                        vector<int>& a_candidates) const
+{
+    int stack[C_BROADPHASE_STACK_SIZE];
+    int stackSize = 0;
+    stack[stackSize++] = a_nodeIndex;
+
+    while (stackSize > 0)
+    {
+        const cCollisionBroadphaseNode& node = m_nodes[stack[--stackSize]];
+
+        if (!intersect(node, a_origin, a_invDir, a_parallel, a_radius))
+        {
+            continue;
+        }
+
+        // leaf node
+        if (node.m_left < 0)
+        {
+            if (!(a_skipMovingObjects && m_objectMoving[node.m_object]))
+            {
+                a_candidates.push_back(node.m_object);
+            }
+            continue;
+        }
+
+        // internal node
+        for (int i=0; i<2; i++)
+        {
+            int childIndex = (i == 0) ? node.m_right : node.m_left;
+            if (stackSize < C_BROADPHASE_STACK_SIZE)
+            {
+                stack[stackSize++] = childIndex;
+            }
+            else
+            {
+                traverseTree(childIndex, a_origin, a_invDir, a_parallel, a_radius, a_skipMovingObjects, a_candidates);
+            }
+        }
+    }
+}
+
+//------------------------------------------------------------------------------
+} // namespace chai3d
+//------------------------------------------------------------------------------
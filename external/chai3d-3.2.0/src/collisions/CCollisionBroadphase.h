@@ -0,0 +1,291 @@
+//==============================================================================
+/*
+    Software License Agreement (BSD License)
+    Copyright (c) 2003-2016, CHAI3D.
+    (www.chai3d.org)
+
+    All rights reserved.
+
+    Redistribution and use in source and binary forms, with or without
+    modification, are permitted provided that the following conditions
+    are met:
+
+    * Redistributions of source code must retain the above copyright
+    notice, this list of conditions and the following disclaimer.
+
+    * Redistributions in binary form must reproduce the above
+    copyright notice, this list of conditions and the following
+    disclaimer in the documentation and/or other materials provided
+    with the distribution.
+
+    * Neither the name of CHAI3D nor the names of its contributors may
+    be used to endorse or promote products derived from this software
+    without specific prior written permission.
+
+    THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS
+    "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT
+    LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS
+    FOR A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE
+    COPYRIGHT OWNER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT,
+    INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING,
+    BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES;
+    LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER
+    CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT
+    LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN
+    ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+    POSSIBILITY OF SUCH DAMAGE. 
+
+    \author    <http://www.chai3d.org>
+    \version   3.2.0 $Rev: 2182 $
+*/
+//==============================================================================
+
+//------------------------------------------------------------------------------
+#ifndef CCollisionBroadphaseH
+#define CCollisionBroadphaseH
+//------------------------------------------------------------------------------
+#include "collisions/CCollisionBasics.h"
+#include "math/CMaths.h"
+//------------------------------------------------------------------------------
+#include <vector>
+//------------------------------------------------------------------------------
+
+//------------------------------------------------------------------------------
+namespace chai3d {
+//------------------------------------------------------------------------------
+
+//==============================================================================
+/*!
+    \file       CCollisionBroadphase.h
+
+    \brief
+    Implements a dynamic AABB tree that culls the objects of a world before
+    their collision detection is computed.
+*/
+//==============================================================================
+
+//------------------------------------------------------------------------------
+class cGenericObject;
+//------------------------------------------------------------------------------
+
+//! Number of nodes that can be stored on the stack while traversing the broadphase tree. Deeper trees fall back on recursion.
+const int C_BROADPHASE_STACK_SIZE = 64;
+
+//! Default distance by which the boundary boxes stored in the broadphase are enlarged.
+const double C_BROADPHASE_DEFAULT_MARGIN = 0.01;
+
+
+//==============================================================================
+/*!
+    \struct     cCollisionBroadphaseNode
+    \ingroup    collisions
+
+    \brief
+    This structure implements a node of the broadphase tree.
+
+    \details
+    A leaf node stores the enlarged boundary box of one object. An internal 
+    node stores the box that encloses its two children. Unused nodes are 
+    chained together through their parent index.
+*/
+//==============================================================================
+struct cCollisionBroadphaseNode
+{
+    //! Lower corner of the boundary box.
+    cVector3d m_min;
+
+    //! Upper corner of the boundary box.
+    cVector3d m_max;
+
+    //! Index of the parent node, or of the next unused node if this node is unused.
+    int m_parent;
+
+    //! Index of the left child node, -1 for leaves.
+    int m_left;
+
+    //! Index of the right child node, -1 for leaves.
+    int m_right;
+
+    //! Height of the node in the tree (0 for leaves, -1 for unused nodes).
+    int m_height;
+
+    //! Index of the object stored in a leaf, -1 for internal nodes.
+    int m_object;
+};
+
+
+//==============================================================================
+/*!
+    \class      cCollisionBroadphase
+    \ingroup    collisions
+
+    \brief
+    This class implements a dynamic AABB tree over the boundary boxes of a 
+    list of objects.
+
+    \details
+    cCollisionBroadphase stores, for every object of a list (typically the 
+    children of a world), a box that encloses the object and all of its 
+    descendants. The boxes are expressed in the frame in which the segments
+    are passed to computeCandidates(), and enlarged by a margin so that small 
+    motions do not modify the tree.\n\n
+
+    Each call to update() recomputes the boxes of the objects from their 
+    current positions and from the collision boundary boxes returned by
+    cGenericObject::getCollisionBoundaryBox(). Only the objects that leave 
+    their enlarged box are removed and inserted again, and the tree is kept 
+    balanced by rotations. A query then only visits the branches of the tree
+    whose boxes are crossed by the segment, so its cost grows with the 
+    logarithm of the number of objects.\n\n
+
+    Objects whose elements cannot be bounded are always reported by queries.
+    Since the first point of a segment is moved with the object when 
+    cCollisionSettings::m_adjustObjectMotion is enabled, objects that moved 
+    at the last update are also always reported by such queries.\n\n
+
+    The broadphase is not thread safe. Updates and queries must be issued 
+    from the same thread.
+*/
+//==============================================================================
+class cCollisionBroadphase
+{
+    //--------------------------------------------------------------------------
+    // CONSTRUCTOR & DESTRUCTOR:
+    //--------------------------------------------------------------------------
+
+public:
+
+    //! Constructor of cCollisionBroadphase.
+    cCollisionBroadphase();
+
+    //! Destructor of cCollisionBroadphase.
+    virtual ~cCollisionBroadphase() {}
+
+
+    //--------------------------------------------------------------------------
+    // PUBLIC METHODS:
+    //--------------------------------------------------------------------------
+
+public:
+
+    //! This method removes all objects from the broadphase.
+    void clear();
+
+    //! This method updates the broadphase from a list of objects and their current boundary boxes.
+    void update(const std::vector<cGenericObject*>& a_objects);
+
+    //! This method returns, in increasing order, the indices of the objects that may collide with a segment.
+    void computeCandidates(const cVector3d& a_segmentPointA,
+                           const cVector3d& a_segmentPointB,
+                           const cCollisionSettings& a_settings,
+                           std::vector<int>& a_candidates) const;
+
+    //! This method sets the distance by which the boundary boxes of the objects are enlarged.
+    void setMargin(const double a_margin) { m_margin = cMax(0.0, a_margin); }
+
+    //! This method returns the distance by which the boundary boxes of the objects are enlarged.
+    double getMargin() const { return (m_margin); }
+
+    //! This method returns the number of objects stored in the broadphase.
+    int getNumObjects() const { return ((int)(m_objects.size())); }
+
+    //! This method returns the height of the tree.
+    int getHeight() const { return ((m_rootIndex < 0) ? 0 : m_nodes[m_rootIndex].m_height); }
+
+    //! This method returns the number of objects that were inserted again in the tree during the last update.
+    int getNumReinsertedObjects() const { return (m_numReinsertedObjects); }
+
+
+    //--------------------------------------------------------------------------
+    // PROTECTED METHODS:
+    //--------------------------------------------------------------------------
+
+protected:
+
+    //! This method encloses the boundary box of an object and its descendants.
+    bool encloseObject(cGenericObject* a_object,
+                       const cVector3d& a_parentPos,
+                       const cMatrix3d& a_parentRot,
+                       cVector3d& a_min,
+                       cVector3d& a_max,
+                       bool& a_moving);
+
+    //! This method returns an unused node.
+    int allocateNode();
+
+    //! This method releases a node.
+    void freeNode(const int a_nodeIndex);
+
+    //! This method inserts a leaf in the tree.
+    void insertLeaf(const int a_leafIndex);
+
+    //! This method removes a leaf from the tree.
+    void removeLeaf(const int a_leafIndex);
+
+    //! This method performs a rotation at a node if its subtrees are unbalanced, and returns the node that replaces it.
+    int balance(const int a_nodeIndex);
+
+    //! This method updates the boundary box and height of an internal node from its children.
+    void fitNode(const int a_nodeIndex);
+
+    //! This method collects the objects of a subtree whose boundary boxes are crossed by a segment.
+    void traverseTree(const int a_nodeIndex,
+                      const cVector3d& a_origin,
+                      const cVector3d& a_invDir,
+                      const bool a_parallel[3],
+                      const double a_radius,
+                      const bool a_skipMovingObjects,
+                      std::vector<int>& a_candidates) const;
+
+    //! This method returns __true__ if the boundary box of a node, enlarged by a radius, is crossed by a segment.
+    bool intersect(const cCollisionBroadphaseNode& a_node,
+                   const cVector3d& a_origin,
+                   const cVector3d& a_invDir,
+                   const bool a_parallel[3],
+                   const double a_radius) const;
+
+
+    //--------------------------------------------------------------------------
+    // PROTECTED MEMBERS:
+    //--------------------------------------------------------------------------
+
+protected:
+
+    //! Nodes of the tree.
+    std::vector<cCollisionBroadphaseNode> m_nodes;
+
+    //! Index of the root node, -1 if the tree is empty.
+    int m_rootIndex;
+
+    //! Index of the first unused node, -1 if all nodes are used.
+    int m_freeIndex;
+
+    //! Distance by which the boundary boxes of the objects are enlarged.
+    double m_margin;
+
+    //! Objects stored in the broadphase, in the order of the list passed to update().
+    std::vector<cGenericObject*> m_objects;
+
+    //! Leaf node of each object, -1 if the object is not stored in the tree.
+    std::vector<int> m_objectLeaves;
+
+    //! For each object, __true__ if the object or one of its descendants moved at the last update.
+    std::vector<bool> m_objectMoving;
+
+    //! Objects whose elements cannot be bounded.
+    std::vector<int> m_unboundedObjects;
+
+    //! Objects that moved at the last update.
+    std::vector<int> m_movingObjects;
+
+    //! Number of objects that were inserted again in the tree during the last update.
+    int m_numReinsertedObjects;
+};
+
+//------------------------------------------------------------------------------
+} // namespace chai3d
+//------------------------------------------------------------------------------
+
+//------------------------------------------------------------------------------
+#endif
+//------------------------------------------------------------------------------
@@ -0,0 +1,1537 @@
+//==============================================================================
+/*
+    Software License Agreement (BSD License)
+    Copyright (c) 2003-2016, CHAI3D.
+    (www.chai3d.org)
+
+    All rights reserved.
+
+    Redistribution and use in source and binary forms, with or without
+    modification, are permitted provided that the following conditions
+    are met:
+
+    * Redistributions of source code must retain the above copyright
+    notice, this list of conditions and the following disclaimer.
+
+    * Redistributions in binary form must reproduce the above
+    copyright notice, this list of conditions and the following
+    disclaimer in the documentation and/or other materials provided
+    with the distribution.
+
+    * Neither the name of CHAI3D nor the names of its contributors may
+    be used to endorse or promote products derived from this software
+    without specific prior written permission.
+
+    THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS
+    "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT
+    LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS
+    FOR A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE
+    COPYRIGHT OWNER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT,
+    INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING,
+    BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES;
+    LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER
+    CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT
+    LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN
+    ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+    POSSIBILITY OF SUCH DAMAGE. 
+
+    \author    <http://www.chai3d.org>
+    \version   3.2.0 $Rev: 2182 $
+*/
+//==============================================================================
+
+//------------------------------------------------------------------------------
+#include "collisions/CCollisionSDF.h"
+#include "graphics/CDraw3D.h"
+#include "world/CGenericObject.h"
+//------------------------------------------------------------------------------
+#include <algorithm>
+#include <atomic>
+#include <fstream>
+#include <functional>
+#include <thread>
+#include <unordered_map>
+//------------------------------------------------------------------------------
+using namespace std;
+//------------------------------------------------------------------------------
+
+//------------------------------------------------------------------------------
+namespace chai3d {
+//------------------------------------------------------------------------------
+
+//! Identifier written at the beginning of distance field cache files.
+static const char C_SDF_FILE_ID[8] = { 'C', 'H', 'A', 'I', '3', 'D', 'S', 'D' };
+
+//! Version of the distance field cache file format.
+static const int C_SDF_FILE_VERSION = 1;
+
+//! Number of bisection steps used to locate the surface along a segment.
+static const int C_SDF_NUM_BISECTIONS = 16;
+
+
+//==============================================================================
+/*!
+    \struct     cSDFBakeTriangle
+    \ingroup    collisions
+
+    \brief
+    This structure stores a triangle prepared for baking a distance field.
+
+    \details
+    The sign of the distance is given by the angle-weighted pseudo-normal of 
+    the feature (face, edge or vertex) of the triangle which is nearest to 
+    the sample. Pseudo-normals are shared by all triangles adjacent to a 
+    feature, so that the sign does not depend on which of them is retained.
+*/
+//==============================================================================
+struct cSDFBakeTriangle
+{
+    //! Vertices of the triangle.
+    cVector3d m_vertices[3];
+
+    //! Minimum corner of the boundary box of the triangle.
+    cVector3d m_min;
+
+    //! Maximum corner of the boundary box of the triangle.
+    cVector3d m_max;
+
+    //! Unit normal of the triangle.
+    cVector3d m_normal;
+
+    //! Pseudo-normals of edges 01, 12 and 20.
+    cVector3d m_edgeNormals[3];
+
+    //! Indices of the vertices after merging vertices located at the same position.
+    int m_welded[3];
+};
+
+
+//==============================================================================
+/*!
+    \struct     cSDFBakeData
+    \ingroup    collisions
+
+    \brief
+    This structure stores the data shared by all threads baking a distance field.
+
+    \details
+    While baking, each sample of the grid belongs to a single candidate brick: 
+    the samples located on the upper faces of a brick belong to the next 
+    bricks. Each sample stores its closest known triangle.
+*/
+//==============================================================================
+struct cSDFBakeData
+{
+    //! Triangles of the mesh.
+    vector<cSDFBakeTriangle> m_triangles;
+
+    //! Pseudo-normals of the merged vertices.
+    vector<cVector3d> m_vertexNormals;
+
+    //! Offset of the triangle list of each brick in \ref m_brickTriangles.
+    vector<int> m_brickFirst;
+
+    //! Triangles located within the band of each brick.
+    vector<int> m_brickTriangles;
+
+    //! Bricks which have at least one triangle within their band.
+    vector<int> m_candidates;
+
+    //! Index of each brick of the grid in \ref m_candidates, or -1 if the brick is not a candidate.
+    vector<int> m_slots;
+
+    //! Square distance from each sample to its closest triangle. Propagation passes alternate between both buffers.
+    vector<float> m_distancesSq[2];
+
+    //! Closest triangle of each sample, or -1 if no triangle is known within the band.
+    vector<int> m_closest[2];
+
+    //! Flags of the candidate bricks whose samples changed during the last propagation pass.
+    vector<char> m_changed[2];
+
+    //! Samples of the candidate bricks which have at least one sample within the band.
+    vector<vector<float> > m_samples;
+
+    //! Position of the first sample of the grid.
+    cVector3d m_origin;
+
+    //! Size of a cell.
+    double m_voxelSize;
+
+    //! Band width.
+    double m_bandWidth;
+
+    //! Number of bricks along each axis.
+    int m_size[3];
+};
+
+
+//==============================================================================
+/*!
+    This function expands a boundary box so that it encloses a second box.
+
+    \param  a_min       Minimum corner of the box to expand.
+    \param  a_max       Maximum corner of the box to expand.
+    \param  a_otherMin  Minimum corner of the enclosed box.
+    \param  a_otherMax  Maximum corner of the enclosed box.
+*/
+//==============================================================================
+static inline void cSDFExpandBox(cVector3d& a_min,
+                                 cVector3d& a_max,
+                                 const cVector3d& a_otherMin,
+                                 const cVector3d& a_otherMax)
+{
+    for (int i=0; i<3; i++)
+    {
+        a_min(i) = cMin(a_min(i), a_otherMin(i));
+        a_max(i) = cMax(a_max(i), a_otherMax(i));
+    }
+}
+
+
+//==============================================================================
+/*!
+    This function computes the point of a triangle which is nearest to a 
+    given point, and the feature of the triangle on which it is located.
+
+    \param  a_point     Query point.
+    \param  a_vertex0   Vertex 0 of triangle.
+    \param  a_vertex1   Vertex 1 of triangle.
+    \param  a_vertex2   Vertex 2 of triangle.
+    \param  a_feature   Returned feature: 0 for the face, 1 to 3 for vertices 0 to 2, 4 to 6 for edges 01, 12 and 20.
+
+    \return Nearest point of the triangle.
+*/
+//==============================================================================
+static inline cVector3d cSDFClosestPointTriangle(const cVector3d& a_point,
+                                                 const cVector3d& a_vertex0,
+                                                 const cVector3d& a_vertex1,
+                                                 const cVector3d& a_vertex2,
+                                                 int& a_feature)
+{
+    cVector3d v01 = a_vertex1 - a_vertex0;
+    cVector3d v02 = a_vertex2 - a_vertex0;
+
+    // vertex 0 region
+    cVector3d p0 = a_point - a_vertex0;
+    double d1 = cDot(v01, p0);
+    double d2 = cDot(v02, p0);
+    if ((d1 <= 0.0) && (d2 <= 0.0))
+    {
+        a_feature = 1;
+        return (a_vertex0);
+    }
+
+    // vertex 1 region
+    cVector3d p1 = a_point - a_vertex1;
+    double d3 = cDot(v01, p1);
+    double d4 = cDot(v02, p1);
+    if ((d3 >= 0.0) && (d4 <= d3))
+    {
+        a_feature = 2;
+        return (a_vertex1);
+    }
+
+    // edge 01 region
+    double vc = d1 * d4 - d3 * d2;
+    if ((vc <= 0.0) && (d1 >= 0.0) && (d3 <= 0.0))
+    {
+        a_feature = 4;
+        return (a_vertex0 + (d1 / (d1 - d3)) * v01);
+    }
+
+    // vertex 2 region
+    cVector3d p2 = a_point - a_vertex2;
+    double d5 = cDot(v01, p2);
+    double d6 = cDot(v02, p2);
+    if ((d6 >= 0.0) && (d5 <= d6))
+    {
+        a_feature = 3;
+        return (a_vertex2);
+    }
+
+    // edge 20 region
+    double vb = d5 * d2 - d1 * d6;
+    if ((vb <= 0.0) && (d2 >= 0.0) && (d6 <= 0.0))
+    {
+        a_feature = 6;
+        return (a_vertex0 + (d2 / (d2 - d6)) * v02);
+    }
+
+    // edge 12 region
+    double va = d3 * d6 - d5 * d4;
+    if ((va <= 0.0) && ((d4 - d3) >= 0.0) && ((d5 - d6) >= 0.0))
+    {
+        a_feature = 5;
+        return (a_vertex1 + ((d4 - d3) / ((d4 - d3) + (d5 - d6))) * (a_vertex2 - a_vertex1));
+    }
+
+    // face region
+    a_feature = 0;
+    double denom = 1.0 / (va + vb + vc);
+    return (a_vertex0 + (vb * denom) * v01 + (vc * denom) * v02);
+}
+
+
+//==============================================================================
+/*!
+    This function calls a function for each index of a range on all cores. 
+    Indices are distributed dynamically between threads.
+
+    \param  a_count     Number of indices.
+    \param  a_function  Function called for each index.
+*/
+//==============================================================================
+static void cSDFParallelFor(const int a_count, const function<void(int)>& a_function)
+{
+    atomic<int> next(0);
+    auto worker = [&]()
+    {
+        for (int i = next++; i < a_count; i = next++)
+        {
+            a_function(i);
+        }
+    };
+
+    unsigned int numThreads = cMin(cMax(1u, std::thread::hardware_concurrency()), (unsigned int)cMax(1, a_count));
+    vector<thread> threads;
+    for (unsigned int i=1; i<numThreads; i++)
+    {
+        threads.push_back(thread(worker));
+    }
+    worker();
+    for (unsigned int i=0; i<threads.size(); i++)
+    {
+        threads[i].join();
+    }
+}
+
+
+//==============================================================================
+/*!
+    This function returns the index of a sample of the grid in the working 
+    arrays of a bake.
+
+    \param  a_data  Bake data.
+    \param  a_x     Index of the sample along the x axis.
+    \param  a_y     Index of the sample along the y axis.
+    \param  a_z     Index of the sample along the z axis.
+
+    \return Index of the sample, or -1 if it does not belong to a candidate brick.
+*/
+//==============================================================================
+static inline int cSDFFindSample(const cSDFBakeData& a_data, const int a_x, const int a_y, const int a_z)
+{
+    const int size = C_SDF_BRICK_SIZE;
+    if ((a_x < 0) || (a_y < 0) || (a_z < 0)) { return (-1); }
+
+    int bx = a_x / size;
+    int by = a_y / size;
+    int bz = a_z / size;
+    if ((bx >= a_data.m_size[0]) || (by >= a_data.m_size[1]) || (bz >= a_data.m_size[2])) { return (-1); }
+
+    int slot = a_data.m_slots[(bz * a_data.m_size[1] + by) * a_data.m_size[0] + bx];
+    if (slot < 0) { return (-1); }
+
+    return (slot * size * size * size + ((a_z - bz * size) * size + (a_y - by * size)) * size + (a_x - bx * size));
+}
+
+
+//==============================================================================
+/*!
+    This function seeds the samples of a candidate brick located close to the 
+    triangles with their exact distance. Samples farther away are reached 
+    by \ref cSDFPropagateBrick().
+
+    \param  a_data  Bake data.
+    \param  a_slot  Index of the candidate brick.
+*/
+//==============================================================================
+static void cSDFSeedBrick(cSDFBakeData& a_data, const int a_slot)
+{
+    const int size = C_SDF_BRICK_SIZE;
+    const int numSamples = size * size * size;
+    const double voxel = a_data.m_voxelSize;
+    const double bandSq = a_data.m_bandWidth * a_data.m_bandWidth;
+
+    // distance from the triangles up to which samples are seeded
+    const double margin = 1.5 * voxel;
+
+    int brickIndex = a_data.m_candidates[a_slot];
+    int brick[3];
+    brick[0] = brickIndex % a_data.m_size[0];
+    brick[1] = (brickIndex / a_data.m_size[0]) % a_data.m_size[1];
+    brick[2] = brickIndex / (a_data.m_size[0] * a_data.m_size[1]);
+    cVector3d base = a_data.m_origin + (voxel * size) * cVector3d(brick[0], brick[1], brick[2]);
+
+    float* distancesSq = &a_data.m_distancesSq[0][a_slot * numSamples];
+    int* closest = &a_data.m_closest[0][a_slot * numSamples];
+    for (int i=0; i<numSamples; i++)
+    {
+        distancesSq[i] = (float)bandSq;
+        closest[i] = -1;
+    }
+
+    for (int n=a_data.m_brickFirst[brickIndex]; n<a_data.m_brickFirst[brickIndex + 1]; n++)
+    {
+        int index = a_data.m_brickTriangles[n];
+        const cSDFBakeTriangle& triangle = a_data.m_triangles[index];
+
+        // samples located close to the boundary box of the triangle
+        int lo[3], hi[3];
+        bool empty = false;
+        for (int i=0; i<3; i++)
+        {
+            lo[i] = cMax(0, (int)ceil((triangle.m_min(i) - margin - base(i)) / voxel));
+            hi[i] = cMin(size - 1, (int)floor((triangle.m_max(i) + margin - base(i)) / voxel));
+            empty = empty || (lo[i] > hi[i]);
+        }
+        if (empty) { continue; }
+
+        for (int k=lo[2]; k<=hi[2]; k++)
+        {
+            for (int j=lo[1]; j<=hi[1]; j++)
+            {
+                for (int i=lo[0]; i<=hi[0]; i++)
+                {
+                    int s = (k * size + j) * size + i;
+                    cVector3d point(base(0) + i * voxel, base(1) + j * voxel, base(2) + k * voxel);
+
+                    int feature;
+                    cVector3d nearest = cSDFClosestPointTriangle(point,
+                                                                 triangle.m_vertices[0],
+                                                                 triangle.m_vertices[1],
+                                                                 triangle.m_vertices[2],
+                                                                 feature);
+                    float d = (float)cDistanceSq(point, nearest);
+                    if (d < distancesSq[s])
+                    {
+                        distancesSq[s] = d;
+                        closest[s] = index;
+                    }
+                }
+            }
+        }
+    }
+
+    a_data.m_changed[0][a_slot] = 1;
+}
+
+
+//==============================================================================
+/*!
+    This function performs one propagation pass over a candidate brick. Each 
+    sample tests the closest triangles of its 26 neighbours and keeps the 
+    nearest one. Bricks whose neighbourhood did not change during the previous 
+    pass are copied.
+
+    \param  a_data    Bake data.
+    \param  a_slot    Index of the candidate brick.
+    \param  a_source  Buffer of the previous pass.
+*/
+//==============================================================================
+static void cSDFPropagateBrick(cSDFBakeData& a_data, const int a_slot, const int a_source)
+{
+    const int size = C_SDF_BRICK_SIZE;
+    const int numSamples = size * size * size;
+    const int target = 1 - a_source;
+    const double voxel = a_data.m_voxelSize;
+
+    int brickIndex = a_data.m_candidates[a_slot];
+    int brick[3];
+    brick[0] = brickIndex % a_data.m_size[0];
+    brick[1] = (brickIndex / a_data.m_size[0]) % a_data.m_size[1];
+    brick[2] = brickIndex / (a_data.m_size[0] * a_data.m_size[1]);
+
+    const float* sourceDistancesSq = &a_data.m_distancesSq[a_source][a_slot * numSamples];
+    const int* sourceClosest = &a_data.m_closest[a_source][a_slot * numSamples];
+    float* distancesSq = &a_data.m_distancesSq[target][a_slot * numSamples];
+    int* closest = &a_data.m_closest[target][a_slot * numSamples];
+
+    // skip brick if neither it nor its neighbours changed
+    bool active = false;
+    for (int k=-1; (k<=1) && !active; k++)
+    {
+        for (int j=-1; (j<=1) && !active; j++)
+        {
+            for (int i=-1; (i<=1) && !active; i++)
+            {
+                int x = brick[0] + i;
+                int y = brick[1] + j;
+                int z = brick[2] + k;
+                if ((x < 0) || (y < 0) || (z < 0) || (x >= a_data.m_size[0]) || (y >= a_data.m_size[1]) || (z >= a_data.m_size[2])) { continue; }
+
+                int slot = a_data.m_slots[(z * a_data.m_size[1] + y) * a_data.m_size[0] + x];
+                active = (slot >= 0) && (a_data.m_changed[a_source][slot] != 0);
+            }
+        }
+    }
+
+    if (!active)
+    {
+        copy(sourceDistancesSq, sourceDistancesSq + numSamples, distancesSq);
+        copy(sourceClosest, sourceClosest + numSamples, closest);
+        a_data.m_changed[target][a_slot] = 0;
+        return;
+    }
+
+    bool changed = false;
+    for (int k=0; k<size; k++)
+    {
+        for (int j=0; j<size; j++)
+        {
+            for (int i=0; i<size; i++)
+            {
+                int s = (k * size + j) * size + i;
+                int x = brick[0] * size + i;
+                int y = brick[1] * size + j;
+                int z = brick[2] * size + k;
+                cVector3d point = a_data.m_origin + voxel * cVector3d(x, y, z);
+
+                float bestDistanceSq = sourceDistancesSq[s];
+                int best = sourceClosest[s];
+
+                // triangles already tested for this sample
+                int tested[27];
+                int numTested = 0;
+                if (best >= 0) { tested[numTested++] = best; }
+
+                for (int n=0; n<27; n++)
+                {
+                    if (n == 13) { continue; }
+
+                    int neighbour = cSDFFindSample(a_data, x + (n % 3) - 1, y + ((n / 3) % 3) - 1, z + (n / 9) - 1);
+                    if (neighbour < 0) { continue; }
+
+                    int index = a_data.m_closest[a_source][neighbour];
+                    if (index < 0) { continue; }
+
+                    bool known = false;
+                    for (int m=0; (m<numTested) && !known; m++)
+                    {
+                        known = (tested[m] == index);
+                    }
+                    if (known) { continue; }
+                    tested[numTested++] = index;
+
+                    const cSDFBakeTriangle& triangle = a_data.m_triangles[index];
+                    int feature;
+                    cVector3d nearest = cSDFClosestPointTriangle(point,
+                                                                 triangle.m_vertices[0],
+                                                                 triangle.m_vertices[1],
+                                                                 triangle.m_vertices[2],
+                                                                 feature);
+                    float d = (float)cDistanceSq(point, nearest);
+                    if (d < bestDistanceSq)
+                    {
+                        bestDistanceSq = d;
+                        best = index;
+                    }
+                }
+
+                distancesSq[s] = bestDistanceSq;
+                closest[s] = best;
+                changed = changed || (best != sourceClosest[s]);
+            }
+        }
+    }
+
+    a_data.m_changed[target][a_slot] = changed ? 1 : 0;
+}
+
+
+//==============================================================================
+/*!
+    This function computes the signed distances of all samples of a candidate 
+    brick, including the samples of its upper faces, from their closest 
+    triangles. The brick is only stored if one of its samples lies within 
+    the band.
+
+    \param  a_data    Bake data.
+    \param  a_slot    Index of the candidate brick.
+    \param  a_buffer  Buffer of the last propagation pass.
+*/
+//==============================================================================
+static void cSDFAssembleBrick(cSDFBakeData& a_data, const int a_slot, const int a_buffer)
+{
+    const int size = C_SDF_BRICK_SIZE;
+    const int sy = C_SDF_BRICK_SIZE + 1;
+    const int sz = sy * sy;
+    const double voxel = a_data.m_voxelSize;
+    const double band = a_data.m_bandWidth;
+
+    int brickIndex = a_data.m_candidates[a_slot];
+    int brick[3];
+    brick[0] = brickIndex % a_data.m_size[0];
+    brick[1] = (brickIndex / a_data.m_size[0]) % a_data.m_size[1];
+    brick[2] = brickIndex / (a_data.m_size[0] * a_data.m_size[1]);
+
+    double distance[C_SDF_BRICK_NUM_SAMPLES];
+    signed char sign[C_SDF_BRICK_NUM_SAMPLES];
+
+    ////////////////////////////////////////////////////////////////////////////
+    // SAMPLES WITHIN THE BAND
+    ////////////////////////////////////////////////////////////////////////////
+
+    // the sign is given by the pseudo-normal of the nearest feature of the 
+    // closest triangle
+    bool near = false;
+    for (int k=0; k<=size; k++)
+    {
+        for (int j=0; j<=size; j++)
+        {
+            for (int i=0; i<=size; i++)
+            {
+                int s = k * sz + j * sy + i;
+                int x = brick[0] * size + i;
+                int y = brick[1] * size + j;
+                int z = brick[2] * size + k;
+                distance[s] = band;
+                sign[s] = 0;
+
+                int sample = cSDFFindSample(a_data, x, y, z);
+                if (sample < 0) { continue; }
+
+                int index = a_data.m_closest[a_buffer][sample];
+                if (index < 0) { continue; }
+
+                const cSDFBakeTriangle& triangle = a_data.m_triangles[index];
+                cVector3d point = a_data.m_origin + voxel * cVector3d(x, y, z);
+                int feature;
+                cVector3d nearest = cSDFClosestPointTriangle(point,
+                                                             triangle.m_vertices[0],
+                                                             triangle.m_vertices[1],
+                                                             triangle.m_vertices[2],
+                                                             feature);
+                cVector3d offset = point - nearest;
+                double d = offset.length();
+                if (d >= band) { continue; }
+
+                const cVector3d* normal;
+                if (feature == 0)      { normal = &triangle.m_normal; }
+                else if (feature < 4)  { normal = &a_data.m_vertexNormals[triangle.m_welded[feature - 1]]; }
+                else                   { normal = &triangle.m_edgeNormals[feature - 4]; }
+
+                distance[s] = d;
+                sign[s] = (cDot(offset, *normal) >= 0.0) ? 1 : -1;
+                near = true;
+            }
+        }
+    }
+
+    // bricks without any sample in the band are classified later as inside or outside
+    if (!near) { return; }
+
+    ////////////////////////////////////////////////////////////////////////////
+    // SIGN OF SAMPLES OUTSIDE THE BAND
+    ////////////////////////////////////////////////////////////////////////////
+
+    // the band is wider than a cell, so the surface never passes between 
+    // a sample located outside the band and its neighbours. the sign of 
+    // these samples is therefore propagated from their neighbours.
+    bool changed = true;
+    while (changed)
+    {
+        changed = false;
+        for (int k=0; k<=size; k++)
+        {
+            for (int j=0; j<=size; j++)
+            {
+                for (int i=0; i<=size; i++)
+                {
+                    int s = k * sz + j * sy + i;
+                    if (sign[s] != 0) { continue; }
+
+                    signed char value = 0;
+                    if      ((i > 0)    && (sign[s - 1]  != 0)) { value = sign[s - 1]; }
+                    else if ((i < size) && (sign[s + 1]  != 0)) { value = sign[s + 1]; }
+                    else if ((j > 0)    && (sign[s - sy] != 0)) { value = sign[s - sy]; }
+                    else if ((j < size) && (sign[s + sy] != 0)) { value = sign[s + sy]; }
+                    else if ((k > 0)    && (sign[s - sz] != 0)) { value = sign[s - sz]; }
+                    else if ((k < size) && (sign[s + sz] != 0)) { value = sign[s + sz]; }
+
+                    if (value != 0)
+                    {
+                        sign[s] = value;
+                        changed = true;
+                    }
+                }
+            }
+        }
+    }
+
+    // store brick
+    vector<float>& samples = a_data.m_samples[a_slot];
+    samples.resize(C_SDF_BRICK_NUM_SAMPLES);
+    for (int s=0; s<C_SDF_BRICK_NUM_SAMPLES; s++)
+    {
+        samples[s] = (float)(sign[s] * distance[s]);
+    }
+}
+
+
+//==============================================================================
+/*!
+    Constructor of cCollisionSDF.
+*/
+//==============================================================================
+cCollisionSDF::cCollisionSDF()
+{
+    m_triangles = nullptr;
+    m_signature = 0;
+    m_voxelSize = 0.0;
+    m_invVoxelSize = 0.0;
+    m_bandWidth = 0.0;
+    m_origin.zero();
+    m_size[0] = 0;
+    m_size[1] = 0;
+    m_size[2] = 0;
+    m_boxMin.zero();
+    m_boxMax.zero();
+    m_numBricks = 0;
+    m_segmentQueriesEnabled = true;
+}
+
+
+//==============================================================================
+/*!
+    This method initializes the distance field of a triangle mesh. If a cache 
+    file is given and it was baked from the same triangles and resolution, the 
+    distance field is read from the file. Otherwise it is baked and, if a file 
+    name is given, saved to the cache file. \n\n
+
+    The mesh must be closed for the sign of the distance to be meaningful.
+    The band width is enlarged to at least two cells.
+
+    \param  a_triangles  Triangles of the mesh.
+    \param  a_voxelSize  Size of a cell of the distance field.
+    \param  a_bandWidth  Distance from the surface up to which distances are stored.
+    \param  a_filename   Name of the cache file, or an empty string to disable caching.
+
+    \return __true__ if the distance field was read from the cache file, __false__ if it was baked.
+*/
+//==============================================================================
+bool cCollisionSDF::initialize(const cTriangleArrayPtr a_triangles,
+                               const double a_voxelSize,
+                               const double a_bandWidth,
+                               const std::string& a_filename)
+{
+    m_triangles = a_triangles;
+    m_voxelSize = cMax(a_voxelSize, C_SMALL);
+    m_invVoxelSize = 1.0 / m_voxelSize;
+    m_bandWidth = cMax(a_bandWidth, 2.0 * m_voxelSize);
+    m_filename = a_filename;
+    m_signature = computeSignature();
+
+    // read distance field from cache
+    if ((m_filename != "") && loadFromFile(m_filename))
+    {
+        return (true);
+    }
+
+    // bake distance field and store it to cache
+    bake();
+    if (m_filename != "")
+    {
+        saveToFile(m_filename);
+    }
+
+    return (false);
+}
+
+
+//==============================================================================
+/*!
+    This method bakes the distance field again after the triangles of the mesh 
+    have been modified, and updates the cache file if one is used.
+*/
+//==============================================================================
+void cCollisionSDF::update()
+{
+    m_signature = computeSignature();
+    bake();
+    if (m_filename != "")
+    {
+        saveToFile(m_filename);
+    }
+}
+
+
+//==============================================================================
+/*!
+    This method computes a 64-bit FNV-1a hash of the vertex positions of all 
+    triangles and of the resolution of the distance field.
+
+    \return Signature of the distance field.
+*/
+//==============================================================================
+unsigned long long cCollisionSDF::computeSignature() const
+{
+    unsigned long long hash = 14695981039346656037ULL;
+    auto add = [&hash](const void* a_data, size_t a_size)
+    {
+        const unsigned char* bytes = (const unsigned char*)a_data;
+        for (size_t i=0; i<a_size; i++)
+        {
+            hash = (hash ^ bytes[i]) * 1099511628211ULL;
+        }
+    };
+
+    add(&m_voxelSize, sizeof(m_voxelSize));
+    add(&m_bandWidth, sizeof(m_bandWidth));
+
+    if (m_triangles != nullptr)
+    {
+        int numTriangles = (int)m_triangles->getNumElements();
+        for (int i=0; i<numTriangles; i++)
+        {
+            if (!m_triangles->getAllocated(i)) { continue; }
+
+            for (int j=0; j<3; j++)
+            {
+                cVector3d pos = m_triangles->m_vertices->getLocalPos(m_triangles->getVertexIndex(i, j));
+                add(&pos(0), 3 * sizeof(double));
+            }
+        }
+    }
+
+    return (hash);
+}
+
+
+//==============================================================================
+/*!
+    This method bakes the distance field from the triangles of the mesh. 
+    Triangles are first binned into the bricks located within their band, 
+    then candidate bricks are baked in parallel on all cores. Bricks without 
+    any sample in the band are finally classified as inside or outside by 
+    sweeping the grid along the x axis from its boundary, which lies outside 
+    the object.
+*/
+//==============================================================================
+void cCollisionSDF::bake()
+{
+    const int size = C_SDF_BRICK_SIZE;
+
+    m_brickIndices.clear();
+    m_samples.clear();
+    m_numBricks = 0;
+    m_size[0] = 0;
+    m_size[1] = 0;
+    m_size[2] = 0;
+
+    if (m_triangles == nullptr) { return; }
+
+    cSDFBakeData data;
+
+    ////////////////////////////////////////////////////////////////////////////
+    // MERGE VERTICES LOCATED AT THE SAME POSITION
+    ////////////////////////////////////////////////////////////////////////////
+
+    // vertices duplicated along texture seams or at the poles of generated 
+    // shapes are merged so that their pseudo-normals cover all adjacent 
+    // triangles. Positions may differ by rounding errors.
+    int numVertices = (int)m_triangles->m_vertices->getNumElements();
+    if (numVertices == 0) { return; }
+
+    vector<cVector3d> positions(numVertices);
+    vector<int> order(numVertices);
+    cVector3d vertexMin = m_triangles->m_vertices->getLocalPos(0);
+    cVector3d vertexMax = vertexMin;
+    for (int i=0; i<numVertices; i++)
+    {
+        positions[i] = m_triangles->m_vertices->getLocalPos(i);
+        order[i] = i;
+        cSDFExpandBox(vertexMin, vertexMax, positions[i], positions[i]);
+    }
+    double tolerance = 1e-9 * cDistance(vertexMin, vertexMax);
+
+    sort(order.begin(), order.end(), [&positions](int a, int b)
+    {
+        return (positions[a](0) < positions[b](0));
+    });
+
+    vector<int> welded(numVertices, -1);
+    int numWelded = 0;
+    for (int i=0; i<numVertices; i++)
+    {
+        int a = order[i];
+        if (welded[a] >= 0) { continue; }
+
+        welded[a] = numWelded;
+        for (int j=i+1; (j<numVertices) && (positions[order[j]](0) - positions[a](0) <= tolerance); j++)
+        {
+            int b = order[j];
+            if ((welded[b] < 0) && cEqualPoints(positions[a], positions[b], tolerance))
+            {
+                welded[b] = numWelded;
+            }
+        }
+        numWelded++;
+    }
+
+    ////////////////////////////////////////////////////////////////////////////
+    // PSEUDO-NORMALS
+    ////////////////////////////////////////////////////////////////////////////
+
+    data.m_vertexNormals.assign(numWelded, cVector3d(0.0, 0.0, 0.0));
+    unordered_map<unsigned long long, cVector3d> edgeNormals;
+
+    int numTriangles = (int)m_triangles->getNumElements();
+    data.m_triangles.reserve(numTriangles);
+    for (int i=0; i<numTriangles; i++)
+    {
+        if (!m_triangles->getAllocated(i)) { continue; }
+
+        cSDFBakeTriangle triangle;
+        for (int j=0; j<3; j++)
+        {
+            int index = m_triangles->getVertexIndex(i, j);
+            triangle.m_vertices[j] = positions[index];
+            triangle.m_welded[j] = welded[index];
+        }
+
+        // ignore degenerate triangles
+        cVector3d normal = cCross(triangle.m_vertices[1] - triangle.m_vertices[0],
+                                  triangle.m_vertices[2] - triangle.m_vertices[0]);
+        double area = normal.length();
+        if (area < C_TINY) { continue; }
+        triangle.m_normal = normal / area;
+
+        triangle.m_min = triangle.m_vertices[0];
+        triangle.m_max = triangle.m_vertices[0];
+        for (int j=1; j<3; j++)
+        {
+            cSDFExpandBox(triangle.m_min, triangle.m_max, triangle.m_vertices[j], triangle.m_vertices[j]);
+        }
+
+        // vertices are weighted by the angle of the triangle at the vertex
+        for (int j=0; j<3; j++)
+        {
+            cVector3d e0 = triangle.m_vertices[(j + 1) % 3] - triangle.m_vertices[j];
+            cVector3d e1 = triangle.m_vertices[(j + 2) % 3] - triangle.m_vertices[j];
+            double angle = cAngle(e0, e1);
+            data.m_vertexNormals[triangle.m_welded[j]] += angle * triangle.m_normal;
+        }
+
+        // edges are shared by two triangles of equal weight
+        for (int j=0; j<3; j++)
+        {
+            unsigned long long a = triangle.m_welded[j];
+            unsigned long long b = triangle.m_welded[(j + 1) % 3];
+            unsigned long long key = (cMin(a, b) << 32) | cMax(a, b);
+            auto edge = edgeNormals.find(key);
+            if (edge == edgeNormals.end())
+            {
+                edgeNormals.insert(make_pair(key, triangle.m_normal));
+            }
+            else
+            {
+                edge->second += triangle.m_normal;
+            }
+        }
+
+        data.m_triangles.push_back(triangle);
+    }
+
+    for (unsigned int i=0; i<data.m_triangles.size(); i++)
+    {
+        cSDFBakeTriangle& triangle = data.m_triangles[i];
+        for (int j=0; j<3; j++)
+        {
+            unsigned long long a = triangle.m_welded[j];
+            unsigned long long b = triangle.m_welded[(j + 1) % 3];
+            triangle.m_edgeNormals[j] = edgeNormals[(cMin(a, b) << 32) | cMax(a, b)];
+        }
+    }
+
+    if (data.m_triangles.size() == 0) { return; }
+
+    ////////////////////////////////////////////////////////////////////////////
+    // GRID
+    ////////////////////////////////////////////////////////////////////////////
+
+    m_boxMin = data.m_triangles[0].m_min;
+    m_boxMax = data.m_triangles[0].m_max;
+    for (unsigned int i=1; i<data.m_triangles.size(); i++)
+    {
+        cSDFExpandBox(m_boxMin, m_boxMax, data.m_triangles[i].m_min, data.m_triangles[i].m_max);
+    }
+
+    // the grid extends beyond the band so that its boundary lies outside the object
+    double brickSize = size * m_voxelSize;
+    double padding = m_bandWidth + m_voxelSize;
+    m_origin = m_boxMin - cVector3d(padding, padding, padding);
+    for (int i=0; i<3; i++)
+    {
+        m_size[i] = cMax(1, (int)ceil((m_boxMax(i) - m_boxMin(i) + 2.0 * padding) / brickSize));
+    }
+    int numGridBricks = m_size[0] * m_size[1] * m_size[2];
+
+    data.m_origin = m_origin;
+    data.m_voxelSize = m_voxelSize;
+    data.m_bandWidth = m_bandWidth;
+    data.m_size[0] = m_size[0];
+    data.m_size[1] = m_size[1];
+    data.m_size[2] = m_size[2];
+
+    ////////////////////////////////////////////////////////////////////////////
+    // BIN TRIANGLES INTO BRICKS
+    ////////////////////////////////////////////////////////////////////////////
+
+    // two passes: count the triangles of each brick, then store them
+    data.m_brickFirst.assign(numGridBricks + 1, 0);
+    for (int pass=0; pass<2; pass++)
+    {
+        vector<int> next;
+        if (pass == 1)
+        {
+            for (int i=0; i<numGridBricks; i++)
+            {
+                data.m_brickFirst[i + 1] += data.m_brickFirst[i];
+            }
+            data.m_brickTriangles.resize(data.m_brickFirst[numGridBricks]);
+            next.assign(data.m_brickFirst.begin(), data.m_brickFirst.end() - 1);
+        }
+
+        for (unsigned int n=0; n<data.m_triangles.size(); n++)
+        {
+            const cSDFBakeTriangle& triangle = data.m_triangles[n];
+            int lo[3], hi[3];
+            for (int i=0; i<3; i++)
+            {
+                lo[i] = cClamp((int)floor((triangle.m_min(i) - m_bandWidth - m_origin(i)) / brickSize), 0, m_size[i] - 1);
+                hi[i] = cClamp((int)floor((triangle.m_max(i) + m_bandWidth - m_origin(i)) / brickSize), 0, m_size[i] - 1);
+            }
+
+            for (int k=lo[2]; k<=hi[2]; k++)
+            {
+                for (int j=lo[1]; j<=hi[1]; j++)
+                {
+                    for (int i=lo[0]; i<=hi[0]; i++)
+                    {
+                        int brick = (k * m_size[1] + j) * m_size[0] + i;
+                        if (pass == 0)
+                        {
+                            data.m_brickFirst[brick + 1]++;
+                        }
+                        else
+                        {
+                            data.m_brickTriangles[next[brick]++] = n;
+                        }
+                    }
+                }
+            }
+        }
+    }
+
+    for (int i=0; i<numGridBricks; i++)
+    {
+        if (data.m_brickFirst[i + 1] > data.m_brickFirst[i])
+        {
+            data.m_candidates.push_back(i);
+        }
+    }
+
+    ////////////////////////////////////////////////////////////////////////////
+    // BAKE CANDIDATE BRICKS ON ALL CORES
+    ////////////////////////////////////////////////////////////////////////////
+
+    // exact distances are computed close to the triangles only, then the 
+    // closest triangles are propagated from sample to sample across the band
+    int numCandidates = (int)data.m_candidates.size();
+    int numWorkingSamples = numCandidates * size * size * size;
+    data.m_slots.assign(numGridBricks, -1);
+    for (int i=0; i<numCandidates; i++)
+    {
+        data.m_slots[data.m_candidates[i]] = i;
+    }
+    for (int i=0; i<2; i++)
+    {
+        data.m_distancesSq[i].resize(numWorkingSamples);
+        data.m_closest[i].resize(numWorkingSamples);
+        data.m_changed[i].assign(numCandidates, 0);
+    }
+    data.m_samples.resize(numCandidates);
+
+    cSDFParallelFor(numCandidates, [&data](int a_slot) { cSDFSeedBrick(data, a_slot); });
+
+    int buffer = 0;
+    int numPasses = (int)ceil(m_bandWidth / m_voxelSize) + 1;
+    for (int pass=0; pass<numPasses; pass++)
+    {
+        cSDFParallelFor(numCandidates, [&data, buffer](int a_slot) { cSDFPropagateBrick(data, a_slot, buffer); });
+        buffer = 1 - buffer;
+
+        if (find(data.m_changed[buffer].begin(), data.m_changed[buffer].end(), 1) == data.m_changed[buffer].end()) { break; }
+    }
+
+    cSDFParallelFor(numCandidates, [&data, buffer](int a_slot) { cSDFAssembleBrick(data, a_slot, buffer); });
+
+    // gather bricks in grid order
+    m_numBricks = 0;
+    m_brickIndices.assign(numGridBricks, C_SDF_BRICK_OUTSIDE);
+    for (int i=0; i<numCandidates; i++)
+    {
+        if (data.m_samples[i].size() > 0)
+        {
+            m_brickIndices[data.m_candidates[i]] = m_numBricks;
+            m_numBricks++;
+        }
+    }
+
+    m_samples.resize((size_t)m_numBricks * C_SDF_BRICK_NUM_SAMPLES);
+    for (int i=0; i<numCandidates; i++)
+    {
+        if (data.m_samples[i].size() > 0)
+        {
+            copy(data.m_samples[i].begin(), data.m_samples[i].end(),
+                 m_samples.begin() + (size_t)m_brickIndices[data.m_candidates[i]] * C_SDF_BRICK_NUM_SAMPLES);
+        }
+    }
+
+    ////////////////////////////////////////////////////////////////////////////
+    // CLASSIFY EMPTY BRICKS
+    ////////////////////////////////////////////////////////////////////////////
+
+    // an empty brick has the sign of the face it shares with the previous 
+    // brick of its row, which is constant since the surface does not cross it
+    const int sy = size + 1;
+    for (int k=0; k<m_size[2]; k++)
+    {
+        for (int j=0; j<m_size[1]; j++)
+        {
+            int state = C_SDF_BRICK_OUTSIDE;
+            for (int i=0; i<m_size[0]; i++)
+            {
+                int& brick = m_brickIndices[(k * m_size[1] + j) * m_size[0] + i];
+                if (brick < 0)
+                {
+                    brick = state;
+                }
+                else
+                {
+                    float value = m_samples[(size_t)brick * C_SDF_BRICK_NUM_SAMPLES + ((size / 2) * sy + (size / 2)) * sy + size];
+                    state = (value < 0.0f) ? C_SDF_BRICK_INSIDE : C_SDF_BRICK_OUTSIDE;
+                }
+            }
+        }
+    }
+}
+
+
+//==============================================================================
+/*!
+    This method saves the distance field to a binary cache file. The file is 
+    only meant to be read back on the same platform.
+
+    \param  a_filename  Name of the cache file.
+
+    \return __true__ if the file was written successfully, __false__ otherwise.
+*/
+//==============================================================================
+bool cCollisionSDF::saveToFile(const std::string& a_filename) const
+{
+    ofstream file(a_filename.c_str(), ios::binary);
+    if (!file) { return (false); }
+
+    file.write(C_SDF_FILE_ID, sizeof(C_SDF_FILE_ID));
+    file.write((const char*)&C_SDF_FILE_VERSION, sizeof(C_SDF_FILE_VERSION));
+    file.write((const char*)&m_signature, sizeof(m_signature));
+    file.write((const char*)&m_origin(0), 3 * sizeof(double));
+    file.write((const char*)&m_boxMin(0), 3 * sizeof(double));
+    file.write((const char*)&m_boxMax(0), 3 * sizeof(double));
+    file.write((const char*)m_size, sizeof(m_size));
+    file.write((const char*)&m_numBricks, sizeof(m_numBricks));
+    if (m_brickIndices.size() > 0)
+    {
+        file.write((const char*)&m_brickIndices[0], m_brickIndices.size() * sizeof(int));
+    }
+    if (m_samples.size() > 0)
+    {
+        file.write((const char*)&m_samples[0], m_samples.size() * sizeof(float));
+    }
+
+    return (file.good());
+}
+
+
+//==============================================================================
+/*!
+    This method loads the distance field from a cache file. The file is only 
+    accepted if it was baked from the same triangles, cell size and band width 
+    as those passed to \ref initialize().
+
+    \param  a_filename  Name of the cache file.
+
+    \return __true__ if the distance field was loaded, __false__ otherwise.
+*/
+//==============================================================================
+bool cCollisionSDF::loadFromFile(const std::string& a_filename)
+{
+    ifstream file(a_filename.c_str(), ios::binary);
+    if (!file) { return (false); }
+
+    // verify header
+    char id[sizeof(C_SDF_FILE_ID)];
+    int version = 0;
+    unsigned long long signature = 0;
+    file.read(id, sizeof(id));
+    file.read((char*)&version, sizeof(version));
+    file.read((char*)&signature, sizeof(signature));
+    if (!file ||
+        !equal(id, id + sizeof(id), C_SDF_FILE_ID) ||
+        (version != C_SDF_FILE_VERSION) ||
+        (signature != m_signature))
+    {
+        return (false);
+    }
+
+    // read grid
+    cVector3d origin, boxMin, boxMax;
+    int gridSize[3];
+    int numBricks = 0;
+    file.read((char*)&origin(0), 3 * sizeof(double));
+    file.read((char*)&boxMin(0), 3 * sizeof(double));
+    file.read((char*)&boxMax(0), 3 * sizeof(double));
+    file.read((char*)gridSize, sizeof(gridSize));
+    file.read((char*)&numBricks, sizeof(numBricks));
+    if (!file || (gridSize[0] < 0) || (gridSize[1] < 0) || (gridSize[2] < 0) || (numBricks < 0))
+    {
+        return (false);
+    }
+
+    vector<int> brickIndices((size_t)gridSize[0] * gridSize[1] * gridSize[2]);
+    vector<float> samples((size_t)numBricks * C_SDF_BRICK_NUM_SAMPLES);
+    if (brickIndices.size() > 0)
+    {
+        file.read((char*)&brickIndices[0], brickIndices.size() * sizeof(int));
+    }
+    if (samples.size() > 0)
+    {
+        file.read((char*)&samples[0], samples.size() * sizeof(float));
+    }
+    if (!file) { return (false); }
+
+    for (unsigned int i=0; i<brickIndices.size(); i++)
+    {
+        if ((brickIndices[i] < C_SDF_BRICK_INSIDE) || (brickIndices[i] >= numBricks)) { return (false); }
+    }
+
+    m_origin = origin;
+    m_boxMin = boxMin;
+    m_boxMax = boxMax;
+    m_size[0] = gridSize[0];
+    m_size[1] = gridSize[1];
+    m_size[2] = gridSize[2];
+    m_numBricks = numBricks;
+    m_brickIndices.swap(brickIndices);
+    m_samples.swap(samples);
+
+    return (true);
+}
+
+
+//==============================================================================
+/*!
+    This method computes the signed distance from a point to the surface of the 
+    mesh, and the outward surface normal at the nearest surface point. Distances 
+    are negative inside the object. The nearest surface point is located at 
+    \p a_point - \p a_distance * \p a_normal. \n\n
+
+    The lookup reads a single cell of the distance field, so its cost does not 
+    depend on the number of triangles.
+
+    \param  a_point     Query point expressed in the local frame of the object.
+    \param  a_distance  Returned signed distance. Outside the band, its magnitude is the band width.
+    \param  a_normal    Returned surface normal.
+
+    \return __true__ if the point is located within the band, __false__ otherwise.
+*/
+//==============================================================================
+bool cCollisionSDF::computeDistance(const cVector3d& a_point,
+                                    double& a_distance,
+                                    cVector3d& a_normal) const
+{
+    a_normal.zero();
+    if (m_brickIndices.size() == 0)
+    {
+        a_distance = C_LARGE;
+        return (false);
+    }
+
+    cVector3d gradient;
+    if (!interpolate(a_point, a_distance, gradient))
+    {
+        return (false);
+    }
+
+    double length = gradient.length();
+    if (length < C_SMALL)
+    {
+        return (false);
+    }
+
+    gradient.divr(length, a_normal);
+    return (true);
+}
+
+
+//==============================================================================
+/*!
+    This method computes the first collision between a segment and the shell 
+    located at the collision radius from the surface. The segment is traced 
+    through the field by steps equal to the distance to the shell, and the 
+    crossing is refined by bisection. A segment which starts inside the shell 
+    only collides if it moves deeper, so that a proxy resting on the surface 
+    can slide along it.
+
+    \param  a_object         Pointer to the object on which collision detection is being performed.
+    \param  a_segmentPointA  Initial point of segment.
+    \param  a_segmentPointB  End point of segment.
+    \param  a_recorder       Recorder which stores all collision events.
+    \param  a_settings       Collision settings information.
+
+    \return __true__ if a collision has occurred, __false__ otherwise.
+*/
+//==============================================================================
+bool cCollisionSDF::computeCollision(cGenericObject* a_object,
+                                     cVector3d& a_segmentPointA,
+                                     cVector3d& a_segmentPointB,
+                                     cCollisionRecorder& a_recorder,
+                                     cCollisionSettings& a_settings)
+{
+    if (!m_segmentQueriesEnabled || (m_numBricks == 0)) { return (false); }
+
+    double radius = a_settings.m_collisionRadius;
+
+    cVector3d direction = a_segmentPointB - a_segmentPointA;
+    double length = direction.length();
+    if (length < C_SMALL) { return (false); }
+    direction.div(length);
+
+    // clip segment to grid
+    double tMin = 0.0;
+    double tMax = length;
+    for (int i=0; i<3; i++)
+    {
+        double gridMin = m_origin(i);
+        double gridMax = m_origin(i) + m_size[i] * C_SDF_BRICK_SIZE * m_voxelSize;
+        if (fabs(direction(i)) < C_TINY)
+        {
+            if ((a_segmentPointA(i) < gridMin) || (a_segmentPointA(i) > gridMax)) { return (false); }
+        }
+        else
+        {
+            double t0 = (gridMin - a_segmentPointA(i)) / direction(i);
+            double t1 = (gridMax - a_segmentPointA(i)) / direction(i);
+            if (t0 > t1) { cSwap(t0, t1); }
+            tMin = cMax(tMin, t0);
+            tMax = cMin(tMax, t1);
+        }
+    }
+    if (tMin > tMax) { return (false); }
+
+    // distance from point to shell. Outside the band, the shell is never 
+    // considered as crossed even if the radius exceeds the band width.
+    double minStep = 0.1 * m_voxelSize;
+    auto shell = [&](const double a_t, cVector3d& a_gradient) -> double
+    {
+        double distance;
+        bool valid = interpolate(a_segmentPointA + a_t * direction, distance, a_gradient);
+        if (!valid && (distance > 0.0))
+        {
+            return (cMax(distance - radius, minStep));
+        }
+        return (distance - radius);
+    };
+
+    ////////////////////////////////////////////////////////////////////////////
+    // TRACE SEGMENT
+    ////////////////////////////////////////////////////////////////////////////
+
+    cVector3d gradient;
+    double t = tMin;
+    double f = shell(t, gradient);
+    bool inside = (f < 0.0);
+    double tHit = -1.0;
+
+    if (inside && (cDot(gradient, direction) < 0.0))
+    {
+        tHit = t;
+    }
+
+    int steps = 0;
+    while ((tHit < 0.0) && (t < tMax) && (steps < C_SDF_MAX_TRACE_STEPS))
+    {
+        double tNext = cMin(t + cMax(fabs(f), minStep), tMax);
+        double fNext = shell(tNext, gradient);
+
+        if (!inside && (fNext < 0.0))
+        {
+            // refine crossing, keeping the collision point outside the shell
+            double t0 = t;
+            double t1 = tNext;
+            for (int i=0; i<C_SDF_NUM_BISECTIONS; i++)
+            {
+                double tm = 0.5 * (t0 + t1);
+                if (shell(tm, gradient) < 0.0) { t1 = tm; } else { t0 = tm; }
+            }
+            tHit = t0;
+        }
+        else if (inside && (fNext >= 0.0))
+        {
+            inside = false;
+        }
+
+        t = tNext;
+        f = fNext;
+        steps++;
+    }
+
+    if (tHit < 0.0) { return (false); }
+
+    ////////////////////////////////////////////////////////////////////////////
+    // REPORT COLLISION
+    ////////////////////////////////////////////////////////////////////////////
+
+    cVector3d collisionPoint = a_segmentPointA + tHit * direction;
+    cVector3d collisionNormal;
+    double distance;
+    if (!computeDistance(collisionPoint, distance, collisionNormal))
+    {
+        collisionNormal = -direction;
+    }
+    double collisionDistanceSq = tHit * tHit;
+
+    if (a_settings.m_checkForNearestCollisionOnly)
+    {
+        // no new collision event is create. We just check if we need
+        // to update the nearest collision
+        if (collisionDistanceSq <= a_recorder.m_nearestCollision.m_squareDistance)
+        {
+            // report basic collision data
+            a_recorder.m_nearestCollision.m_type = C_COL_SHAPE;
+            a_recorder.m_nearestCollision.m_object = a_object;
+            a_recorder.m_nearestCollision.m_triangles = nullptr;
+            a_recorder.m_nearestCollision.m_index = -1;
+            a_recorder.m_nearestCollision.m_localPos = collisionPoint;
+            a_recorder.m_nearestCollision.m_localNormal = collisionNormal;
+            a_recorder.m_nearestCollision.m_squareDistance = collisionDistanceSq;
+            a_recorder.m_nearestCollision.m_adjustedSegmentAPoint = a_segmentPointA;
+
+            // report advanced collision data
+            if (!a_settings.m_returnMinimalCollisionData)
+            {
+                a_recorder.m_nearestCollision.m_globalPos = cAdd(a_object->getGlobalPos(),
+                    cMul(a_object->getGlobalRot(),
+                    a_recorder.m_nearestCollision.m_localPos));
+                a_recorder.m_nearestCollision.m_globalNormal = cMul(a_object->getGlobalRot(),
+                    a_recorder.m_nearestCollision.m_localNormal);
+            }
+        }
+    }
+    else
+    {
+        cCollisionEvent newCollisionEvent;
+
+        // report basic collision data
+        newCollisionEvent.m_type = C_COL_SHAPE;
+        newCollisionEvent.m_object = a_object;
+        newCollisionEvent.m_triangles = nullptr;
+        newCollisionEvent.m_index = -1;
+        newCollisionEvent.m_localPos = collisionPoint;
+        newCollisionEvent.m_localNormal = collisionNormal;
+        newCollisionEvent.m_squareDistance = collisionDistanceSq;
+        newCollisionEvent.m_adjustedSegmentAPoint = a_segmentPointA;
+
+        // report advanced collision data
+        if (!a_settings.m_returnMinimalCollisionData)
+        {
+            newCollisionEvent.m_globalPos = cAdd(a_object->getGlobalPos(),
+                cMul(a_object->getGlobalRot(),
+                newCollisionEvent.m_localPos));
+            newCollisionEvent.m_globalNormal = cMul(a_object->getGlobalRot(),
+                newCollisionEvent.m_localNormal);
+        }
+
+        // add new collision even to collision list
+        a_recorder.m_collisions.push_back(newCollisionEvent);
+
+        // check if this new collision is a candidate for "nearest one"
+        if (collisionDistanceSq <= a_recorder.m_nearestCollision.m_squareDistance)
+        {
+            a_recorder.m_nearestCollision = newCollisionEvent;
+        }
+    }
+
+    return (true);
+}
+
+
+//==============================================================================
+/*!
+    This method returns the boundary box of the triangles from which the 
+    distance field was baked.
+
+    \param  a_min  Returned minimum corner of the box.
+    \param  a_max  Returned maximum corner of the box.
+
+    \return __true__ if the distance field is not empty, __false__ otherwise.
+*/
+//==============================================================================
+bool cCollisionSDF::getBoundaryBox(cVector3d& a_min, cVector3d& a_max) const
+{
+    if (m_brickIndices.size() == 0) { return (false); }
+
+    a_min = m_boxMin;
+    a_max = m_boxMax;
+    return (true);
+}
+
+
+//==============================================================================
+/*!
+    This method renders the stored bricks of the distance field using OpenGL.
+
+    \param  a_options  Rendering options.
+*/
+//==============================================================================
+void cCollisionSDF::render(cRenderOptions& a_options)
+{
+#ifdef C_USE_OPENGL
+
+    // set rendering settings
+    glDisable(GL_LIGHTING);
+    glLineWidth(1.0);
+    glColor4fv(m_color.getData());
+
+    // render bricks
+    double brickSize = C_SDF_BRICK_SIZE * m_voxelSize;
+    for (int k=0; k<m_size[2]; k++)
+    {
+        for (int j=0; j<m_size[1]; j++)
+        {
+            for (int i=0; i<m_size[0]; i++)
+            {
+                if (m_brickIndices[(k * m_size[1] + j) * m_size[0] + i] >= 0)
+                {
+                    cVector3d pos = m_origin + brickSize * cVector3d(i, j, k);
+                    cDrawWireBox(pos(0), pos(0) + brickSize,
+                                 pos(1), pos(1) + brickSize,
+                                 pos(2), pos(2) + brickSize);
+                }
+            }
+        }
+    }
+
+    // restore lighting settings
+    glEnable(GL_LIGHTING);
+
+#endif
+}
+
+
+//------------------------------------------------------------------------------
+} // namespace chai3d
+//------------------------------------------------------------------------------
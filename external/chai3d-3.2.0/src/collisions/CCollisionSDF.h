@@ -0,0 +1,321 @@
+//==============================================================================
+/*
+    Software License Agreement (BSD License)
+    Copyright (c) 2003-2016, CHAI3D.
+    (www.chai3d.org)
+
+    All rights reserved.
+
+    Redistribution and use in source and binary forms, with or without
+    modification, are permitted provided that the following conditions
+    are met:
+
+    * Redistributions of source code must retain the above copyright
+    notice, this list of conditions and the following disclaimer.
+
+    * Redistributions in binary form must reproduce the above
+    copyright notice, this list of conditions and the following
+    disclaimer in the documentation and/or other materials provided
+    with the distribution.
+
+    * Neither the name of CHAI3D nor the names of its contributors may
+    be used to endorse or promote products derived from this software
+    without specific prior written permission.
+
+    THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS
+    "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT
+    LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS
+    FOR A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE
+    COPYRIGHT OWNER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT,
+    INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING,
+    BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES;
+    LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER
+    CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT
+    LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN
+    ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+    POSSIBILITY OF SUCH DAMAGE. 
+
+    \author    <http://www.chai3d.org>
+    \version   3.2.0 $Rev: 2182 $
+*/
+//==============================================================================
+
+//------------------------------------------------------------------------------
+#ifndef CCollisionSDFH
+#define CCollisionSDFH
+//------------------------------------------------------------------------------
+#include "math/CMaths.h"
+#include "collisions/CGenericCollision.h"
+#include "graphics/CTriangleArray.h"
+//------------------------------------------------------------------------------
+#include <string>
+#include <vector>
+//------------------------------------------------------------------------------
+
+//------------------------------------------------------------------------------
+namespace chai3d {
+//------------------------------------------------------------------------------
+
+//------------------------------------------------------------------------------
+//! Number of cells along each side of a brick of a signed distance field.
+const int C_SDF_BRICK_SIZE = 8;
+
+//! Number of distance samples stored by a brick. Bricks store their boundary samples so that any lookup reads a single brick.
+const int C_SDF_BRICK_NUM_SAMPLES = (C_SDF_BRICK_SIZE + 1) * (C_SDF_BRICK_SIZE + 1) * (C_SDF_BRICK_SIZE + 1);
+
+//! Brick index of a region located outside the object and farther than the band width from its surface.
+const int C_SDF_BRICK_OUTSIDE = -1;
+
+//! Brick index of a region located inside the object and farther than the band width from its surface.
+const int C_SDF_BRICK_INSIDE = -2;
+
+//! Maximum number of steps taken when tracing a segment through a signed distance field.
+const int C_SDF_MAX_TRACE_STEPS = 1024;
+
+//------------------------------------------------------------------------------
+
+//==============================================================================
+/*!
+    \file       CCollisionSDF.h
+
+    \brief
+    Implements a collision detector based on a sparse signed distance field.
+*/
+//==============================================================================
+
+//==============================================================================
+/*!
+    \class      cCollisionSDF
+    \ingroup    collisions
+
+    \brief
+    This class implements a collision detector based on a sparse signed 
+    distance field.
+
+    \details
+    This class samples the signed distance to the surface of a closed triangle 
+    mesh on a regular grid. Only the samples located within a narrow band 
+    around the surface are stored. They are grouped in bricks of 
+    \ref C_SDF_BRICK_SIZE cells per side, indexed by a coarse grid which also 
+    records whether empty regions are located inside or outside the object. \n\n
+
+    The distance and surface normal at any point are interpolated from the 
+    eight samples of the cell that contains it by calling 
+    \ref computeDistance(). The cost of this lookup is constant and does not 
+    depend on the number of triangles of the mesh, which makes the detector 
+    well suited to very dense rigid models such as 3D scans. Meshes rendered 
+    with a cEffectSurface use this lookup to compute their interaction point. \n\n
+
+    Segment queries issued by the finger-proxy algorithm are answered by 
+    tracing the segment through the field, and can be disabled by calling 
+    \ref setSegmentQueriesEnabled() so that the object is only rendered by 
+    its haptic effects. \n\n
+
+    The field is baked on all cores when the detector is initialized, and 
+    may be stored to a cache file which is read back on the next 
+    initialization if the mesh and the resolution have not changed. 
+    Distances are only defined up to the band width, which must therefore 
+    be larger than the radius of the proxy and the deepest expected 
+    penetration of the haptic point.
+*/
+//==============================================================================
+class cCollisionSDF : public cGenericCollision
+{
+    //--------------------------------------------------------------------------
+    // CONSTRUCTOR & DESTRUCTOR:
+    //--------------------------------------------------------------------------
+
+public:
+
+    //! Constructor of cCollisionSDF.
+    cCollisionSDF();
+
+    //! Destructor of cCollisionSDF.
+    virtual ~cCollisionSDF() {}
+
+
+    //--------------------------------------------------------------------------
+    // PUBLIC METHODS:
+    //--------------------------------------------------------------------------
+
+public:
+
+    //! This methods bakes the distance field again and should be called if the 3D model it represents is modified.
+    virtual void update();
+
+    //! This method computes all collisions between a segment passed as argument and the attributed 3D object.
+    virtual bool computeCollision(cGenericObject* a_object,
+                                  cVector3d& a_segmentPointA,
+                                  cVector3d& a_segmentPointB,
+                                  cCollisionRecorder& a_recorder,
+                                  cCollisionSettings& a_settings);
+
+    //! This method computes the signed distance and the surface normal at a point expressed in the local frame of the object.
+    virtual bool computeDistance(const cVector3d& a_point,
+                                 double& a_distance,
+                                 cVector3d& a_normal) const;
+
+    //! This method renders a visual representation of the bricks of the distance field.
+    virtual void render(cRenderOptions& a_options);
+
+    //! This method returns the boundary box that encloses all triangles of the mesh.
+    virtual bool getBoundaryBox(cVector3d& a_min, cVector3d& a_max) const;
+
+    //! This method initializes the distance field by reading it from a cache file or by baking it.
+    bool initialize(const cTriangleArrayPtr a_triangles,
+                    const double a_voxelSize,
+                    const double a_bandWidth,
+                    const std::string& a_filename = "");
+
+    //! This method saves the distance field to a cache file.
+    bool saveToFile(const std::string& a_filename) const;
+
+    //! This method loads the distance field from a cache file if it was baked from the same mesh and resolution.
+    bool loadFromFile(const std::string& a_filename);
+
+    //! This method returns the size of a cell of the distance field.
+    double getVoxelSize() const { return (m_voxelSize); }
+
+    //! This method returns the distance from the surface up to which distances are stored.
+    double getBandWidth() const { return (m_bandWidth); }
+
+    //! This method returns the number of bricks stored by the distance field.
+    int getNumBricks() const { return (m_numBricks); }
+
+    //! This method enables or disables collision detection with segments (finger-proxy algorithm).
+    void setSegmentQueriesEnabled(const bool a_segmentQueriesEnabled) { m_segmentQueriesEnabled = a_segmentQueriesEnabled; }
+
+    //! This method returns __true__ if collision detection with segments is enabled, __false__ otherwise.
+    bool getSegmentQueriesEnabled() const { return (m_segmentQueriesEnabled); }
+
+
+    //--------------------------------------------------------------------------
+    // PROTECTED METHODS:
+    //--------------------------------------------------------------------------
+
+protected:
+
+    //! This method bakes the distance field from the triangles of the mesh.
+    void bake();
+
+    //! This method computes a signature of the triangles and the resolution used to validate cache files.
+    unsigned long long computeSignature() const;
+
+    //! This method interpolates the distance and its gradient at a point. It returns __false__ if the point is located outside the band.
+    inline bool interpolate(const cVector3d& a_point,
+                            double& a_distance,
+                            cVector3d& a_gradient) const
+    {
+        const int size = C_SDF_BRICK_SIZE;
+        const int sy = C_SDF_BRICK_SIZE + 1;
+        const int sz = sy * sy;
+
+        // grid coordinates of point
+        double g[3];
+        int brick[3];
+        for (int i=0; i<3; i++)
+        {
+            g[i] = (a_point(i) - m_origin(i)) * m_invVoxelSize;
+            if (!(g[i] >= 0.0) || !(g[i] < (double)(m_size[i] * size)))
+            {
+                a_distance = m_bandWidth;
+                return (false);
+            }
+            brick[i] = (int)g[i] / size;
+        }
+
+        // retrieve brick
+        int index = m_brickIndices[(brick[2] * m_size[1] + brick[1]) * m_size[0] + brick[0]];
+        if (index < 0)
+        {
+            a_distance = (index == C_SDF_BRICK_INSIDE) ? -m_bandWidth : m_bandWidth;
+            return (false);
+        }
+
+        // locate cell inside brick
+        int cell[3];
+        double f[3];
+        for (int i=0; i<3; i++)
+        {
+            double local = g[i] - (double)(brick[i] * size);
+            cell[i] = cMin((int)local, size - 1);
+            f[i] = local - (double)cell[i];
+        }
+
+        // trilinear interpolation of the eight samples of the cell
+        const float* s = &m_samples[index * C_SDF_BRICK_NUM_SAMPLES + (cell[2] * sy + cell[1]) * sy + cell[0]];
+        double c00 = s[0]       + f[0] * (s[1]           - s[0]);
+        double c10 = s[sy]      + f[0] * (s[sy + 1]      - s[sy]);
+        double c01 = s[sz]      + f[0] * (s[sz + 1]      - s[sz]);
+        double c11 = s[sz + sy] + f[0] * (s[sz + sy + 1] - s[sz + sy]);
+        double c0 = c00 + f[1] * (c10 - c00);
+        double c1 = c01 + f[1] * (c11 - c01);
+        a_distance = c0 + f[2] * (c1 - c0);
+
+        // gradient of the interpolated distance
+        double dx0 = (1.0 - f[1]) * (s[1] - s[0]) + f[1] * (s[sy + 1] - s[sy]);
+        double dx1 = (1.0 - f[1]) * (s[sz + 1] - s[sz]) + f[1] * (s[sz + sy + 1] - s[sz + sy]);
+        a_gradient.set(((1.0 - f[2]) * dx0 + f[2] * dx1) * m_invVoxelSize,
+                       ((1.0 - f[2]) * (c10 - c00) + f[2] * (c11 - c01)) * m_invVoxelSize,
+                       (c1 - c0) * m_invVoxelSize);
+
+        return (fabs(a_distance) < m_bandWidth);
+    }
+
+
+    //--------------------------------------------------------------------------
+    // PROTECTED MEMBERS:
+    //--------------------------------------------------------------------------
+
+protected:
+
+    //! Triangles from which the distance field is baked.
+    cTriangleArrayPtr m_triangles;
+
+    //! Name of the cache file of the distance field.
+    std::string m_filename;
+
+    //! Signature of the triangles and resolution from which the distance field was baked.
+    unsigned long long m_signature;
+
+    //! Size of a cell of the distance field.
+    double m_voxelSize;
+
+    //! Inverse of the size of a cell.
+    double m_invVoxelSize;
+
+    //! Distance from the surface up to which distances are stored.
+    double m_bandWidth;
+
+    //! Position of the first sample of the grid.
+    cVector3d m_origin;
+
+    //! Number of bricks of the grid along each axis.
+    int m_size[3];
+
+    //! Minimum corner of the boundary box of the triangles.
+    cVector3d m_boxMin;
+
+    //! Maximum corner of the boundary box of the triangles.
+    cVector3d m_boxMax;
+
+    //! Index of each brick of the grid in \ref m_samples, or \ref C_SDF_BRICK_OUTSIDE or \ref C_SDF_BRICK_INSIDE for empty bricks.
+    std::vector<int> m_brickIndices;
+
+    //! Distance samples of all stored bricks.
+    std::vector<float> m_samples;
+
+    //! Number of stored bricks.
+    int m_numBricks;
+
+    //! If __true__, collisions with segments are computed.
+    bool m_segmentQueriesEnabled;
+};
+
+//------------------------------------------------------------------------------
+} // namespace chai3d
+//------------------------------------------------------------------------------
+
+//------------------------------------------------------------------------------
+#endif
+//------------------------------------------------------------------------------
@@ -68,6 +68,46 @@ cGenericCollision::cGenericCollision()
 }
 
 
+//==============================================================================
+/*!
+    This method computes all collisions between a batch of segments and the 
+    elements of this collision detector. Segments are expressed in the local 
+    frame of \p a_object. The flag \ref cCollisionQuery::m_hit of each query 
+    is set when a collision is detected. \n\n
+
+    This implementation tests the segments one after the other. Collision 
+    detectors that can share work between segments override this method.
+
+    \param  a_object      Object for which collision detector is being used.
+    \param  a_queries     Array of queries.
+    \param  a_numQueries  Number of queries.
+
+    \return __true__ if one or more collisions have occurred, __false__ otherwise.
+*/
+//==============================================================================
+bool cGenericCollision::computeCollisions(cGenericObject* a_object,
+                                          cCollisionQuery* a_queries,
+                                          const int a_numQueries)
+{
+    bool hit = false;
+    for (int i=0; i<a_numQueries; i++)
+    {
+        cCollisionQuery& query = a_queries[i];
+        if (computeCollision(a_object,
+                             query.m_segmentPointA,
+                             query.m_segmentPointB,
+                             *query.m_recorder,
+                             *query.m_settings))
+        {
+            query.m_hit = true;
+            hit = true;
+        }
+    }
+
+    return (hit);
+}
+
+
 //------------------------------------------------------------------------------
 } // namespace chai3d
 //------------------------------------------------------------------------------
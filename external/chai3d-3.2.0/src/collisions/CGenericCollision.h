@@ -92,7 +92,9 @@ namespace chai3d {
     If the shape of the object is modified (e.g triangles are added or removed
     from a mesh), then the \ref update() command of the collision detector
     must be called again. The method is responsible for deallocating any 
-    previously built data structures.\n\n
+    previously built data structures. If only the positions of the vertices 
+    are modified (e.g. deformable objects), the \ref refit() command may be 
+    called instead, which detectors can implement more efficiently.\n\n
 
     Please note that this class does not support collision detection 
     between objects themselves.\n\n
@@ -123,6 +125,9 @@ public:
     //! This methods updates the collision detector and should be called if the 3D model it represents is modified.
     virtual void update() {}
 
+    //! This method updates the collision detector after the vertices of the 3D model it represents have moved.
+    virtual void refit() { update(); }
+
     //! This method computes all collisions between a segment passed as argument and the attributed 3D object.
     virtual bool computeCollision(cGenericObject* a_object,
                                   cVector3d& a_segmentPointA,
@@ -131,9 +136,23 @@ public:
                                   cCollisionSettings& a_settings)
                                   { return (false); }
 
+    //! This method computes all collisions between a batch of segments and the attributed 3D object.
+    virtual bool computeCollisions(cGenericObject* a_object,
+                                   cCollisionQuery* a_queries,
+                                   const int a_numQueries);
+
+    //! This method computes the signed distance and the surface normal at a point, if the collision detector supports distance queries.
+    virtual bool computeDistance(const cVector3d& a_point,
+                                 double& a_distance,
+                                 cVector3d& a_normal) const
+                                 { return (false); }
+
     //! This method renders a visual representation of the collision tree.
     virtual void render(cRenderOptions& a_options) {};
 
+    //! This method returns the boundary box that encloses all elements, or __false__ if the collision detector cannot provide one.
+    virtual bool getBoundaryBox(cVector3d& a_min, cVector3d& a_max) const { return (false); }
+
     //! This method returns the radius of the boundary shell that covers every triangles.
     double getBoundaryRadius() const { return (m_radiusAroundElements); }
 
@@ -0,0 +1,479 @@
+//==============================================================================
+/*
+    Software License Agreement (BSD License)
+    Copyright (c) 2003-2016, CHAI3D.
+    (www.chai3d.org)
+
+    All rights reserved.
+
+    Redistribution and use in source and binary forms, with or without
+    modification, are permitted provided that the following conditions
+    are met:
+
+    * Redistributions of source code must retain the above copyright
+    notice, this list of conditions and the following disclaimer.
+
+    * Redistributions in binary form must reproduce the above
+    copyright notice, this list of conditions and the following
+    disclaimer in the documentation and/or other materials provided
+    with the distribution.
+
+    * Neither the name of CHAI3D nor the names of its contributors may
+    be used to endorse or promote products derived from this software
+    without specific prior written permission.
+
+    THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS
+    "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT
+    LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS
+    FOR A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE
+    COPYRIGHT OWNER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT,
+    INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING,
+    BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES;
+    LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER
+    CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT
+    LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN
+    ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+    POSSIBILITY OF SUCH DAMAGE. 
+
+    \author    <http://www.chai3d.org>
+    \version   3.2.0 $Rev: 2182 $
+*/
+//==============================================================================
+
+
+
+//------------------------------------------------------------------------------
+#include "devices/CMultirateHapticDevice.h"
+//------------------------------------------------------------------------------
+#include "math/CMaths.h"
+#include "timers/CPrecisionClock.h"
+//------------------------------------------------------------------------------
+
+//------------------------------------------------------------------------------
+namespace chai3d {
+//------------------------------------------------------------------------------
+
+//==============================================================================
+/*!
+    Constructor of cMultirateHapticDevice. The specifications of the wrapped
+    device are copied, so that tools can map their workspace before the
+    device is opened.
+
+    \param  a_device     Haptic device driven by the servo loop.
+    \param  a_servoRate  Rate of the servo loop [Hz].
+*/
+//==============================================================================
+cMultirateHapticDevice::cMultirateHapticDevice(cGenericHapticDevicePtr a_device, 
+                                               const double a_servoRate) : 
+    m_device(a_device),
+    m_scheduler(a_servoRate)
+{
+    if (m_device != nullptr)
+    {
+        m_specifications = m_device->getSpecifications();
+    }
+
+    m_modelGain = 1.0;
+
+    DeviceState state;
+    state.m_position.zero();
+    state.m_rotation.identity();
+    state.m_linearVelocity.zero();
+    state.m_angularVelocity.zero();
+    state.m_gripperAngle = 0.0;
+    state.m_gripperAngularVelocity = 0.0;
+    state.m_userSwitches = 0;
+    state.m_valid = false;
+    m_states.reset(state);
+
+    ForceCommand command;
+    command.m_time = 0.0;
+    command.m_force.zero();
+    command.m_torque.zero();
+    command.m_gripperForce = 0.0;
+    command.m_position.zero();
+    command.m_modelGain = 1.0;
+    m_commands.reset(command);
+}
+
+
+//==============================================================================
+/*!
+    Destructor of cMultirateHapticDevice.
+*/
+//==============================================================================
+cMultirateHapticDevice::~cMultirateHapticDevice()
+{
+    m_scheduler.stopPeriodic();
+}
+
+
+//==============================================================================
+/*!
+    This method opens a connection to the wrapped haptic device and starts 
+    the servo loop at the rate of the scheduler.
+
+    \return __true__ if the operation succeeds, __false__ otherwise.
+*/
+//==============================================================================
+bool cMultirateHapticDevice::open()
+{
+    if (m_device == nullptr) { return (C_ERROR); }
+    if (m_deviceReady) { return (C_SUCCESS); }
+
+    if (!m_device->open()) { return (C_ERROR); }
+    m_specifications = m_device->getSpecifications();
+    m_deviceReady = true;
+
+    startServo();
+
+    return (C_SUCCESS);
+}
+
+
+//==============================================================================
+/*!
+    This method stops the servo loop and closes the connection to the 
+    wrapped haptic device.
+
+    \return __true__ if the operation succeeds, __false__ otherwise.
+*/
+//==============================================================================
+bool cMultirateHapticDevice::close()
+{
+    if (m_device == nullptr) { return (C_ERROR); }
+
+    m_scheduler.stopPeriodic();
+    m_device->setForceAndTorqueAndGripperForce(cVector3d(0,0,0), cVector3d(0,0,0), 0.0);
+    m_deviceReady = false;
+
+    return (m_device->close());
+}
+
+
+//==============================================================================
+/*!
+    This method calibrates the wrapped haptic device, then starts the servo 
+    loop. The device is not accessed by the servo loop during calibration.
+
+    \param  a_forceCalibration  Force the calibration if __true__.
+
+    \return __true__ if the operation succeeds, __false__ otherwise.
+*/
+//==============================================================================
+bool cMultirateHapticDevice::calibrate(bool a_forceCalibration)
+{
+    if (!m_deviceReady) { return (C_ERROR); }
+
+    m_scheduler.stopPeriodic();
+    bool result = m_device->calibrate(a_forceCalibration);
+    startServo();
+
+    return (result);
+}
+
+
+//==============================================================================
+/*!
+    This method resets the buffers shared with the servo loop and starts it.
+    The device is sampled once beforehand, so that the first state read by 
+    the haptic loop is valid. Pending force commands are discarded.
+*/
+//==============================================================================
+void cMultirateHapticDevice::startServo()
+{
+    DeviceState state;
+    state.m_valid = m_device->getPosition(state.m_position);
+    m_device->getRotation(state.m_rotation);
+    m_device->getLinearVelocity(state.m_linearVelocity);
+    m_device->getAngularVelocity(state.m_angularVelocity);
+    m_device->getGripperAngleRad(state.m_gripperAngle);
+    m_device->getGripperAngularVelocity(state.m_gripperAngularVelocity);
+    m_device->getUserSwitches(state.m_userSwitches);
+
+    m_states.reset(state);
+
+    ForceCommand command = m_commands.get();
+    command.m_time = 0.0;
+    m_commands.reset(command);
+
+    m_scheduler.startPeriodic(servoCallback, this, CTHREAD_PRIORITY_HAPTICS);
+}
+
+
+//==============================================================================
+/*!
+    This method returns the position of the device, as sampled by the latest
+    iteration of the servo loop. The other getters return the values of the 
+    same sample, so this method should be called first.
+
+    \param  a_position  Return value.
+
+    \return __true__ if the operation succeeds, __false__ otherwise.
+*/
+//==============================================================================
+bool cMultirateHapticDevice::getPosition(cVector3d& a_position)
+{
+    if (!m_scheduler.isRunning())
+    {
+        return ((m_device != nullptr) && m_device->getPosition(a_position));
+    }
+
+    m_states.update();
+    const DeviceState& state = m_states.get();
+    a_position = state.m_position;
+
+    return (state.m_valid);
+}
+
+
+//==============================================================================
+/*!
+    This method returns the linear velocity of the device.
+
+    \param  a_linearVelocity  Return value.
+
+    \return __true__ if the operation succeeds, __false__ otherwise.
+*/
+//==============================================================================
+bool cMultirateHapticDevice::getLinearVelocity(cVector3d& a_linearVelocity)
+{
+    if (!m_scheduler.isRunning())
+    {
+        return ((m_device != nullptr) && m_device->getLinearVelocity(a_linearVelocity));
+    }
+
+    a_linearVelocity = m_states.get().m_linearVelocity;
+    return (m_states.get().m_valid);
+}
+
+
+//==============================================================================
+/*!
+    This method returns the orientation frame of the device end-effector.
+
+    \param  a_rotation  Return value.
+
+    \return __true__ if the operation succeeds, __false__ otherwise.
+*/
+//==============================================================================
+bool cMultirateHapticDevice::getRotation(cMatrix3d& a_rotation)
+{
+    if (!m_scheduler.isRunning())
+    {
+        return ((m_device != nullptr) && m_device->getRotation(a_rotation));
+    }
+
+    a_rotation = m_states.get().m_rotation;
+    return (m_states.get().m_valid);
+}
+
+
+//==============================================================================
+/*!
+    This method returns the angular velocity of the device.
+
+    \param  a_angularVelocity  Return value.
+
+    \return __true__ if the operation succeeds, __false__ otherwise.
+*/
+//==============================================================================
+bool cMultirateHapticDevice::getAngularVelocity(cVector3d& a_angularVelocity)
+{
+    if (!m_scheduler.isRunning())
+    {
+        return ((m_device != nullptr) && m_device->getAngularVelocity(a_angularVelocity));
+    }
+
+    a_angularVelocity = m_states.get().m_angularVelocity;
+    return (m_states.get().m_valid);
+}
+
+
+//==============================================================================
+/*!
+    This method returns the gripper angle in radian.
+
+    \param  a_angle  Return value.
+
+    \return __true__ if the operation succeeds, __false__ otherwise.
+*/
+//==============================================================================
+bool cMultirateHapticDevice::getGripperAngleRad(double& a_angle)
+{
+    if (!m_scheduler.isRunning())
+    {
+        return ((m_device != nullptr) && m_device->getGripperAngleRad(a_angle));
+    }
+
+    a_angle = m_states.get().m_gripperAngle;
+    return (m_states.get().m_valid);
+}
+
+
+//==============================================================================
+/*!
+    This method returns the angular velocity of the gripper.
+
+    \param  a_gripperAngularVelocity  Return value.
+
+    \return __true__ if the operation succeeds, __false__ otherwise.
+*/
+//==============================================================================
+bool cMultirateHapticDevice::getGripperAngularVelocity(double& a_gripperAngularVelocity)
+{
+    if (!m_scheduler.isRunning())
+    {
+        return ((m_device != nullptr) && m_device->getGripperAngularVelocity(a_gripperAngularVelocity));
+    }
+
+    a_gripperAngularVelocity = m_states.get().m_gripperAngularVelocity;
+    return (m_states.get().m_valid);
+}
+
+
+//==============================================================================
+/*!
+    This method returns the status of all user switches of the device.
+
+    \param  a_userSwitches  Return value.
+
+    \return __true__ if the operation succeeds, __false__ otherwise.
+*/
+//==============================================================================
+bool cMultirateHapticDevice::getUserSwitches(unsigned int& a_userSwitches)
+{
+    if (!m_scheduler.isRunning())
+    {
+        return ((m_device != nullptr) && m_device->getUserSwitches(a_userSwitches));
+    }
+
+    a_userSwitches = m_states.get().m_userSwitches;
+    return (m_states.get().m_valid);
+}
+
+
+//==============================================================================
+/*!
+    This method sends the force computed by the haptic loop to the servo 
+    loop, together with the current local contact model.\n
+
+    The gain of the local model is adjusted so that the model agrees with 
+    the force actually sent. This follows the force rise and the small force
+    startup mode of the tools, during which the force of the haptic loop is
+    smaller than the force of the contacts.
+
+    \param  a_force         Force command.
+    \param  a_torque        Torque command.
+    \param  a_gripperForce  Gripper force command.
+
+    \return __true__ if the operation succeeds, __false__ otherwise.
+*/
+//==============================================================================
+bool cMultirateHapticDevice::setForceAndTorqueAndGripperForce(const cVector3d& a_force, 
+                                                              const cVector3d& a_torque, 
+                                                              double a_gripperForce)
+{
+    m_prevForce = a_force;
+    m_prevTorque = a_torque;
+    m_prevGripperForce = a_gripperForce;
+
+    if (!m_scheduler.isRunning())
+    {
+        return ((m_device != nullptr) && m_device->setForceAndTorqueAndGripperForce(a_force, a_torque, a_gripperForce));
+    }
+
+    const DeviceState& state = m_states.get();
+    double modelForce = m_contactModel.computeForce(state.m_position, cVector3d(0,0,0)).length();
+    if (modelForce > C_SMALL)
+    {
+        m_modelGain = cClamp(a_force.length() / modelForce, 0.0, 1.0);
+    }
+
+    ForceCommand& command = m_commands.edit();
+    command.m_time = cPrecisionClock::getCPUTimeSeconds();
+    command.m_force = a_force;
+    command.m_torque = a_torque;
+    command.m_gripperForce = a_gripperForce;
+    command.m_position = state.m_position;
+    command.m_model = m_contactModel;
+    command.m_modelGain = m_modelGain;
+
+    m_commands.publish();
+
+    return (state.m_valid);
+}
+
+
+//==============================================================================
+/*!
+    This method performs one iteration of the servo loop: it samples the 
+    wrapped device, publishes its state, and sends the latest force of the
+    haptic loop corrected by the local contact model.
+*/
+//==============================================================================
+void cMultirateHapticDevice::servo()
+{
+    // sample device
+    DeviceState& state = m_states.edit();
+    state.m_valid = m_device->getPosition(state.m_position);
+    m_device->getRotation(state.m_rotation);
+    m_device->getLinearVelocity(state.m_linearVelocity);
+    m_device->getAngularVelocity(state.m_angularVelocity);
+    m_device->getGripperAngleRad(state.m_gripperAngle);
+    m_device->getGripperAngularVelocity(state.m_gripperAngularVelocity);
+    m_device->getUserSwitches(state.m_userSwitches);
+
+    cVector3d position = state.m_position;
+    cVector3d linearVelocity = state.m_linearVelocity;
+
+    m_states.publish();
+
+    // fetch latest command
+    m_commands.update();
+    const ForceCommand& command = m_commands.get();
+
+    // stop rendering if the haptic loop stalls
+    double age = cPrecisionClock::getCPUTimeSeconds() - command.m_time;
+    if ((command.m_time <= 0.0) || (age > C_MULTIRATE_COMMAND_TIMEOUT))
+    {
+        m_device->setForceAndTorqueAndGripperForce(cVector3d(0,0,0), cVector3d(0,0,0), 0.0);
+        return;
+    }
+
+    // correct the force of the haptic loop with the local contact model
+    cVector3d force = command.m_force;
+    if (command.m_model.getNumPlanes() > 0)
+    {
+        cVector3d correction = command.m_model.computeForce(position, linearVelocity) - 
+                               command.m_model.computeForce(command.m_position, linearVelocity);
+        force.add(command.m_modelGain * correction);
+    }
+
+    // clamp to the capabilities of the device
+    double maxForce = m_specifications.m_maxLinearForce;
+    double length = force.length();
+    if ((maxForce > 0.0) && (length > maxForce))
+    {
+        force.mul(maxForce / length);
+    }
+
+    m_device->setForceAndTorqueAndGripperForce(force, command.m_torque, command.m_gripperForce);
+}
+
+
+//==============================================================================
+/*!
+    Tick function of the servo loop.
+
+    \param  a_device  Multirate device.
+*/
+//==============================================================================
+void cMultirateHapticDevice::servoCallback(void* a_device)
+{
+    ((cMultirateHapticDevice*)a_device)->servo();
+}
+
+//------------------------------------------------------------------------------
+} // namespace chai3d
+//------------------------------------------------------------------------------
@@ -0,0 +1,279 @@
+//==============================================================================
+/*
+    Software License Agreement (BSD License)
+    Copyright (c) 2003-2016, CHAI3D.
+    (www.chai3d.org)
+
+    All rights reserved.
+
+    Redistribution and use in source and binary forms, with or without
+    modification, are permitted provided that the following conditions
+    are met:
+
+    * Redistributions of source code must retain the above copyright
+    notice, this list of conditions and the following disclaimer.
+
+    * Redistributions in binary form must reproduce the above
+    copyright notice, this list of conditions and the following
+    disclaimer in the documentation and/or other materials provided
+    with the distribution.
+
+    * Neither the name of CHAI3D nor the names of its contributors may
+    be used to endorse or promote products derived from this software
+    without specific prior written permission.
+
+    THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS
+    "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT
+    LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS
+    FOR A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE
+    COPYRIGHT OWNER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT,
+    INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING,
+    BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES;
+    LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER
+    CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT
+    LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN
+    ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+    POSSIBILITY OF SUCH DAMAGE. 
+
+    \author    <http://www.chai3d.org>
+    \version   3.2.0 $Rev: 2182 $
+*/
+//==============================================================================
+
+
+
+//------------------------------------------------------------------------------
+#ifndef CMultirateHapticDeviceH
+#define CMultirateHapticDeviceH
+//------------------------------------------------------------------------------
+#include "devices/CGenericHapticDevice.h"
+#include "forces/CLocalContactModel.h"
+#include "system/CRealtimeScheduler.h"
+#include "system/CStateSnapshot.h"
+//------------------------------------------------------------------------------
+
+//------------------------------------------------------------------------------
+namespace chai3d {
+//------------------------------------------------------------------------------
+
+//==============================================================================
+/*!
+    \file       CMultirateHapticDevice.h
+
+    \brief
+    Implements a haptic device rendered by a fast servo loop.
+*/
+//==============================================================================
+
+//------------------------------------------------------------------------------
+class cMultirateHapticDevice;
+typedef std::shared_ptr<cMultirateHapticDevice> cMultirateHapticDevicePtr;
+//------------------------------------------------------------------------------
+
+//------------------------------------------------------------------------------
+//! Age [s] after which the servo loop stops rendering the forces of the haptic loop.
+const double C_MULTIRATE_COMMAND_TIMEOUT = 0.05;
+//------------------------------------------------------------------------------
+
+
+//==============================================================================
+/*!
+    \class      cMultirateHapticDevice
+    \ingroup    devices
+
+    \brief
+    This class renders the forces of a haptic device at a higher rate than 
+    the haptic loop.
+
+    \details
+    cMultirateHapticDevice wraps another haptic device and drives it from its
+    own servo thread, typically at 4 to 10 kHz. The haptic loop (the slow
+    thread) uses the wrapper like any other device: it reads the latest 
+    state sampled by the servo loop and sends the forces computed at its own 
+    rate.\n
+
+    Between two updates of the haptic loop, the servo loop renders the 
+    contacts with a __cLocalContactModel__ set by setContactModel(). The
+    force sent to the device is the force of the haptic loop, corrected by 
+    the difference of the local model between the current device position 
+    and the position used by the haptic loop. Stiff contacts are therefore
+    rendered with the latency and rate of the servo loop, while the haptic 
+    loop keeps the full collision detection and proxy algorithm.\n
+
+    The two threads exchange the device state and the force commands 
+    through __cStateSnapshot__ buffers and never block each other. If the haptic loop
+    stops sending commands for more than C_MULTIRATE_COMMAND_TIMEOUT, the 
+    servo loop sends zero forces.\n
+
+    If the servo loop is not running, all calls are forwarded to the 
+    wrapped device.
+*/
+//==============================================================================
+class cMultirateHapticDevice : public cGenericHapticDevice
+{
+    //--------------------------------------------------------------------------
+    // CONSTRUCTOR & DESTRUCTOR:
+    //--------------------------------------------------------------------------
+
+public:
+
+    //! Constructor of cMultirateHapticDevice.
+    cMultirateHapticDevice(cGenericHapticDevicePtr a_device, const double a_servoRate = 4000.0);
+
+    //! Destructor of cMultirateHapticDevice.
+    virtual ~cMultirateHapticDevice();
+
+    //! Shared cMultirateHapticDevice allocator.
+    static cMultirateHapticDevicePtr create(cGenericHapticDevicePtr a_device, const double a_servoRate = 4000.0) { return (std::make_shared<cMultirateHapticDevice>(a_device, a_servoRate)); }
+
+
+    //--------------------------------------------------------------------------
+    // PUBLIC METHODS:
+    //--------------------------------------------------------------------------
+
+public:
+
+    //! This method opens a connection to the haptic device and starts the servo loop.
+    virtual bool open();
+
+    //! This method stops the servo loop and closes the connection to the haptic device.
+    virtual bool close();
+
+    //! This method calibrates the haptic device.
+    virtual bool calibrate(bool a_forceCalibration = false);
+
+    //! This method returns the position of the device.
+    virtual bool getPosition(cVector3d& a_position);
+
+    //! This method returns the linear velocity of the device.
+    virtual bool getLinearVelocity(cVector3d& a_linearVelocity);
+
+    //! This method returns the orientation frame of the device end-effector.
+    virtual bool getRotation(cMatrix3d& a_rotation);
+
+    //! This method returns the angular velocity of the device.
+    virtual bool getAngularVelocity(cVector3d& a_angularVelocity);
+
+    //! This method returns the gripper angle in radian [rad].
+    virtual bool getGripperAngleRad(double& a_angle);
+
+    //! This method returns the angular velocity of the gripper.
+    virtual bool getGripperAngularVelocity(double& a_gripperAngularVelocity);
+
+    //! This method returns the status of all user switches [__true__ = __ON__ / __false__ = __OFF__].
+    virtual bool getUserSwitches(unsigned int& a_userSwitches);
+
+    //! This method sends a force [N] and a torque [N*m] and gripper force [N] to the haptic device.
+    virtual bool setForceAndTorqueAndGripperForce(const cVector3d& a_force, const cVector3d& a_torque, double a_gripperForce);
+
+
+    //--------------------------------------------------------------------------
+    // PUBLIC METHODS - MULTIRATE RENDERING:
+    //--------------------------------------------------------------------------
+
+public:
+
+    //! This method sets the local contact model sent with the next force command.
+    void setContactModel(const cLocalContactModel& a_model) { m_contactModel = a_model; }
+
+    //! This method returns the local contact model sent with the next force command.
+    const cLocalContactModel& getContactModel() const { return (m_contactModel); }
+
+    //! This method returns the wrapped haptic device.
+    cGenericHapticDevicePtr getDevice() { return (m_device); }
+
+    //! This method returns the scheduler of the servo loop (rate, affinity and timing statistics).
+    cRealtimeScheduler& getScheduler() { return (m_scheduler); }
+
+    //! This method returns __true__ if the servo loop is running.
+    bool isServoRunning() const { return (m_scheduler.isRunning()); }
+
+
+    //--------------------------------------------------------------------------
+    // PROTECTED TYPES:
+    //--------------------------------------------------------------------------
+
+protected:
+
+    //! State of the device sampled by the servo loop.
+    struct DeviceState
+    {
+        cVector3d m_position;
+        cMatrix3d m_rotation;
+        cVector3d m_linearVelocity;
+        cVector3d m_angularVelocity;
+        double m_gripperAngle;
+        double m_gripperAngularVelocity;
+        unsigned int m_userSwitches;
+        bool m_valid;
+    };
+
+    //! Force command sent by the haptic loop.
+    struct ForceCommand
+    {
+        //! Time at which the command was sent (cPrecisionClock::getCPUTimeSeconds()).
+        double m_time;
+
+        cVector3d m_force;
+        cVector3d m_torque;
+        double m_gripperForce;
+
+        //! Device position used by the haptic loop to compute the force.
+        cVector3d m_position;
+
+        //! Local contact model around the position.
+        cLocalContactModel m_model;
+
+        //! Gain of the local model, so that its force agrees with the force of the haptic loop.
+        double m_modelGain;
+    };
+
+
+    //--------------------------------------------------------------------------
+    // PROTECTED METHODS:
+    //--------------------------------------------------------------------------
+
+protected:
+
+    //! This method samples the device, resets the buffers and starts the servo loop.
+    void startServo();
+
+    //! This method performs one iteration of the servo loop.
+    void servo();
+
+    //! Tick function of the servo loop.
+    static void servoCallback(void* a_device);
+
+
+    //--------------------------------------------------------------------------
+    // PROTECTED MEMBERS:
+    //--------------------------------------------------------------------------
+
+protected:
+
+    //! Wrapped haptic device.
+    cGenericHapticDevicePtr m_device;
+
+    //! Scheduler of the servo loop.
+    cRealtimeScheduler m_scheduler;
+
+    //! Local contact model sent with the next force command.
+    cLocalContactModel m_contactModel;
+
+    //! Gain of the local model of the last force command.
+    double m_modelGain;
+
+    //! Device states published by the servo loop.
+    cStateSnapshot<DeviceState> m_states;
+
+    //! Force commands published by the haptic loop.
+    cStateSnapshot<ForceCommand> m_commands;
+};
+
+//------------------------------------------------------------------------------
+} // namespace chai3d
+//------------------------------------------------------------------------------
+
+//------------------------------------------------------------------------------
+#endif
+//------------------------------------------------------------------------------
@@ -0,0 +1,557 @@
+//==============================================================================
+/*
+    Software License Agreement (BSD License)
+    Copyright (c) 2003-2016, CHAI3D.
+    (www.chai3d.org)
+
+    All rights reserved.
+
+    Redistribution and use in source and binary forms, with or without
+    modification, are permitted provided that the following conditions
+    are met:
+
+    * Redistributions of source code must retain the above copyright
+    notice, this list of conditions and the following disclaimer.
+
+    * Redistributions in binary form must reproduce the above
+    copyright notice, this list of conditions and the following
+    disclaimer in the documentation and/or other materials provided
+    with the distribution.
+
+    * Neither the name of CHAI3D nor the names of its contributors may
+    be used to endorse or promote products derived from this software
+    without specific prior written permission.
+
+    THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS
+    "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT
+    LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS
+    FOR A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE
+    COPYRIGHT OWNER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT,
+    INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING,
+    BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES;
+    LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER
+    CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT
+    LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN
+    ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+    POSSIBILITY OF SUCH DAMAGE. 
+
+    \author    <http://www.chai3d.org>
+    \version   3.2.0 $Rev: 2182 $
+*/
+//==============================================================================
+
+
+
+//------------------------------------------------------------------------------
+#include "devices/CTraceHapticDevice.h"
+//------------------------------------------------------------------------------
+#include "math/CMaths.h"
+#include <cstdio>
+#include <fstream>
+#include <sstream>
+//------------------------------------------------------------------------------
+
+//------------------------------------------------------------------------------
+namespace chai3d {
+//------------------------------------------------------------------------------
+
+//==============================================================================
+/*!
+    Constructor of cTraceHapticDevice.
+
+    \param  a_deviceNumber  Index number of the device.
+*/
+//==============================================================================
+cTraceHapticDevice::cTraceHapticDevice(unsigned int a_deviceNumber): cGenericHapticDevice(a_deviceNumber)
+{
+    m_deviceReady = false;
+    m_deviceAvailable = true;
+
+    m_specifications.m_model                         = C_HAPTIC_DEVICE_VIRTUAL;
+    m_specifications.m_manufacturerName              = "CHAI3D";
+    m_specifications.m_modelName                     = "Trace";
+    m_specifications.m_maxLinearForce                = 8.0;     // [N]
+    m_specifications.m_maxAngularTorque              = 0.0;     // [N*m]
+    m_specifications.m_maxGripperForce               = 0.0;     // [N]
+    m_specifications.m_maxLinearStiffness            = 3000.0;  // [N/m]
+    m_specifications.m_maxAngularStiffness           = 0.0;     // [N*m/Rad]
+    m_specifications.m_maxGripperLinearStiffness     = 0.0;     // [N*m]
+    m_specifications.m_maxLinearDamping              = 20.0;    // [N/(m/s)]
+    m_specifications.m_maxAngularDamping             = 0.0;     // [N*m/(Rad/s)]
+    m_specifications.m_maxGripperAngularDamping      = 0.0;     // [N*m/(Rad/s)]
+    m_specifications.m_workspaceRadius               = 0.04;    // [m]
+    m_specifications.m_gripperMaxAngleRad            = cDegToRad(30.0);
+    m_specifications.m_sensedPosition                = true;
+    m_specifications.m_sensedRotation                = true;
+    m_specifications.m_sensedGripper                 = true;
+    m_specifications.m_actuatedPosition              = true;
+    m_specifications.m_actuatedRotation              = false;
+    m_specifications.m_actuatedGripper               = false;
+    m_specifications.m_leftHand                      = true;
+    m_specifications.m_rightHand                     = true;
+
+    m_traceIndex = 0;
+    m_traceRecording = false;
+    m_loop = false;
+    m_profile = C_TRACE_MOTION_STATIC;
+    m_amplitude.zero();
+    m_frequency = 0.0;
+    m_center.zero();
+    m_fixedTimeStep = 0.0;
+    m_time = 0.0;
+    m_forceRecording = false;
+
+    computeSample(0.0, m_sample);
+}
+
+
+//==============================================================================
+/*!
+    This method opens the device. The trace restarts from its first sample,
+    and the force log is cleared.
+
+    \return __true__ if the operation succeeds, __false__ otherwise.
+*/
+//==============================================================================
+bool cTraceHapticDevice::open()
+{
+    m_time = 0.0;
+    m_traceIndex = 0;
+    m_clock.reset();
+    m_clock.start();
+    m_forceLog.clear();
+    computeSample(0.0, m_sample);
+
+    m_deviceReady = true;
+    return (C_SUCCESS);
+}
+
+
+//==============================================================================
+/*!
+    This method closes the device.
+
+    \return __true__ if the operation succeeds, __false__ otherwise.
+*/
+//==============================================================================
+bool cTraceHapticDevice::close()
+{
+    m_clock.stop();
+    m_deviceReady = false;
+    return (C_SUCCESS);
+}
+
+
+//==============================================================================
+/*!
+    This method advances the trace time, either in real time or by the fixed
+    time step, and returns the position of the device at the new time.
+    The other getters return the values of the same sample.
+
+    \param  a_position  Return value.
+
+    \return __true__ if the operation succeeds, __false__ otherwise.
+*/
+//==============================================================================
+bool cTraceHapticDevice::getPosition(cVector3d& a_position)
+{
+    if (!m_deviceReady) return (C_ERROR);
+
+    if (m_fixedTimeStep > 0.0)
+    {
+        m_time += m_fixedTimeStep;
+    }
+    else
+    {
+        m_time = m_clock.getcurrentTimeSeconds();
+    }
+
+    computeSample(m_time, m_sample);
+    a_position = m_sample.m_position;
+    estimateLinearVelocity(a_position);
+
+    return (C_SUCCESS);
+}
+
+
+//==============================================================================
+/*!
+    This method returns the orientation frame of the device end-effector.
+
+    \param  a_rotation  Return value.
+
+    \return __true__ if the operation succeeds, __false__ otherwise.
+*/
+//==============================================================================
+bool cTraceHapticDevice::getRotation(cMatrix3d& a_rotation)
+{
+    if (!m_deviceReady) return (C_ERROR);
+
+    m_sample.m_rotation.toRotMat(a_rotation);
+    estimateAngularVelocity(a_rotation);
+
+    return (C_SUCCESS);
+}
+
+
+//==============================================================================
+/*!
+    This method returns the gripper angle in radian.
+
+    \param  a_angle  Return value.
+
+    \return __true__ if the operation succeeds, __false__ otherwise.
+*/
+//==============================================================================
+bool cTraceHapticDevice::getGripperAngleRad(double& a_angle)
+{
+    if (!m_deviceReady) return (C_ERROR);
+
+    a_angle = m_sample.m_gripperAngle;
+    estimateGripperVelocity(a_angle);
+
+    return (C_SUCCESS);
+}
+
+
+//==============================================================================
+/*!
+    This method returns the status of all user switches of the device.
+
+    \param  a_userSwitches  Return value.
+
+    \return __true__ if the operation succeeds, __false__ otherwise.
+*/
+//==============================================================================
+bool cTraceHapticDevice::getUserSwitches(unsigned int& a_userSwitches)
+{
+    if (!m_deviceReady) return (C_ERROR);
+
+    a_userSwitches = m_sample.m_userSwitches;
+
+    return (C_SUCCESS);
+}
+
+
+//==============================================================================
+/*!
+    This method receives the force, torque and gripper force commands and
+    records them if the force recording is enabled.
+
+    \param  a_force         Force command.
+    \param  a_torque        Torque command.
+    \param  a_gripperForce  Gripper force command.
+
+    \return __true__ if the operation succeeds, __false__ otherwise.
+*/
+//==============================================================================
+bool cTraceHapticDevice::setForceAndTorqueAndGripperForce(const cVector3d& a_force, 
+                                                          const cVector3d& a_torque, 
+                                                          double a_gripperForce)
+{
+    if (!m_deviceReady) return (C_ERROR);
+
+    m_prevForce = a_force;
+    m_prevTorque = a_torque;
+    m_prevGripperForce = a_gripperForce;
+
+    // samples beyond the reserved capacity are dropped rather than reallocating in the haptic loop
+    if (m_forceRecording && (m_forceLog.size() < m_forceLog.capacity()))
+    {
+        cTraceForceSample sample;
+        sample.m_time = m_time;
+        sample.m_position = m_sample.m_position;
+        sample.m_force = a_force;
+        sample.m_torque = a_torque;
+        sample.m_gripperForce = a_gripperForce;
+        m_forceLog.push_back(sample);
+    }
+
+    return (C_SUCCESS);
+}
+
+
+//==============================================================================
+/*!
+    This method loads a trace from a text file. Each line holds a sample:
+    time, position (x, y, z), orientation quaternion (w, x, y, z), gripper 
+    angle and user switches, separated by spaces or commas. Empty lines and
+    lines starting with # are ignored. Samples are sorted by time.
+
+    \param  a_filename  Filename.
+
+    \return __true__ if the trace was loaded, __false__ otherwise.
+*/
+//==============================================================================
+bool cTraceHapticDevice::loadTrace(const std::string& a_filename)
+{
+    std::ifstream file(a_filename.c_str());
+    if (!file.is_open()) { return (C_ERROR); }
+
+    std::vector<cTraceSample> trace;
+    std::string line;
+    while (std::getline(file, line))
+    {
+        size_t first = line.find_first_not_of(" \t\r");
+        if ((first == std::string::npos) || (line[first] == '#')) { continue; }
+        for (size_t i=0; i<line.size(); i++)
+        {
+            if (line[i] == ',') { line[i] = ' '; }
+        }
+
+        std::istringstream stream(line);
+        double values[10];
+        int count = 0;
+        while ((count < 10) && (stream >> values[count])) { count++; }
+        if (count < 4) { continue; }
+
+        cTraceSample sample;
+        sample.m_time = values[0];
+        sample.m_position.set(values[1], values[2], values[3]);
+        sample.m_rotation = (count >= 8) ? cQuaternion(values[4], values[5], values[6], values[7]) : cQuaternion(1.0, 0.0, 0.0, 0.0);
+        sample.m_rotation.normalize();
+        sample.m_gripperAngle = (count >= 9) ? values[8] : 0.0;
+        sample.m_userSwitches = (count >= 10) ? (unsigned int)values[9] : 0;
+
+        if (!trace.empty() && (sample.m_time < trace.back().m_time)) { continue; }
+        trace.push_back(sample);
+    }
+
+    if (trace.empty()) { return (C_ERROR); }
+
+    m_trace.swap(trace);
+    m_traceIndex = 0;
+    return (C_SUCCESS);
+}
+
+
+//==============================================================================
+/*!
+    This method saves the trace to a text file, in the format read by 
+    loadTrace().
+
+    \param  a_filename  Filename.
+
+    \return __true__ if the trace was saved, __false__ otherwise.
+*/
+//==============================================================================
+bool cTraceHapticDevice::saveTrace(const std::string& a_filename) const
+{
+    FILE* file = fopen(a_filename.c_str(), "w");
+    if (file == NULL) { return (C_ERROR); }
+
+    fprintf(file, "# time px py pz qw qx qy qz gripper switches\n");
+    for (unsigned int i=0; i<m_trace.size(); i++)
+    {
+        const cTraceSample& s = m_trace[i];
+        fprintf(file, "%.6f %.9g %.9g %.9g %.9g %.9g %.9g %.9g %.9g %u\n", s.m_time,
+                s.m_position(0), s.m_position(1), s.m_position(2),
+                s.m_rotation.w, s.m_rotation.x, s.m_rotation.y, s.m_rotation.z,
+                s.m_gripperAngle, s.m_userSwitches);
+    }
+
+    fclose(file);
+    return (C_SUCCESS);
+}
+
+
+//==============================================================================
+/*!
+    This method sets the motion synthesized when no trace is loaded. The 
+    amplitude is given per axis:\n
+
+    - __C_TRACE_MOTION_STATIC__: the device stays at the center.\n
+    - __C_TRACE_MOTION_SINE__: each axis oscillates around the center.\n
+    - __C_TRACE_MOTION_CIRCLE__: ellipse in the x-y plane, with the radii 
+      of the x and y amplitudes. The z amplitude is ignored.\n
+    - __C_TRACE_MOTION_SQUARE__: steps between the center plus and minus 
+      the amplitude, to observe step responses.\n
+
+    \param  a_profile    Motion profile.
+    \param  a_amplitude  Amplitude of the motion per axis [m].
+    \param  a_frequency  Frequency of the motion [Hz].
+    \param  a_center     Center of the motion [m].
+*/
+//==============================================================================
+void cTraceHapticDevice::setMotionProfile(const cTraceMotionProfile a_profile, 
+                                          const cVector3d& a_amplitude, 
+                                          const double a_frequency, 
+                                          const cVector3d& a_center)
+{
+    m_profile = a_profile;
+    m_amplitude = a_amplitude;
+    m_frequency = a_frequency;
+    m_center = a_center;
+}
+
+
+//==============================================================================
+/*!
+    This method enables or disables recording the forces sent to the device.
+    The log is allocated once, so that recording does not allocate memory in
+    the haptic loop; commands beyond the capacity are not recorded.
+
+    \param  a_enabled   If __true__, forces are recorded.
+    \param  a_capacity  Maximum number of recorded commands.
+*/
+//==============================================================================
+void cTraceHapticDevice::setForceRecording(const bool a_enabled, const unsigned int a_capacity)
+{
+    m_forceRecording = a_enabled;
+    if (a_enabled)
+    {
+        m_forceLog.reserve(a_capacity);
+    }
+}
+
+
+//==============================================================================
+/*!
+    This method enables or disables recording samples with recordSample().
+    When enabled, the trace is cleared and allocated once, so that recording
+    does not allocate memory in the haptic loop; samples beyond the capacity 
+    are not recorded.
+
+    \param  a_enabled   If __true__, samples are recorded.
+    \param  a_capacity  Maximum number of recorded samples.
+*/
+//==============================================================================
+void cTraceHapticDevice::setTraceRecording(const bool a_enabled, const unsigned int a_capacity)
+{
+    m_traceRecording = a_enabled;
+    if (a_enabled)
+    {
+        clearTrace();
+        m_trace.reserve(a_capacity);
+    }
+}
+
+
+//==============================================================================
+/*!
+    This method saves the recorded forces to a CSV file, with the time, the
+    position of the device, the force, the torque and the gripper force of 
+    each command.
+
+    \param  a_filename  Filename.
+
+    \return __true__ if the log was saved, __false__ otherwise.
+*/
+//==============================================================================
+bool cTraceHapticDevice::saveForceLog(const std::string& a_filename) const
+{
+    FILE* file = fopen(a_filename.c_str(), "w");
+    if (file == NULL) { return (C_ERROR); }
+
+    fprintf(file, "time,px,py,pz,fx,fy,fz,tx,ty,tz,gripperForce\n");
+    for (unsigned int i=0; i<m_forceLog.size(); i++)
+    {
+        const cTraceForceSample& s = m_forceLog[i];
+        fprintf(file, "%.6f,%.9g,%.9g,%.9g,%.9g,%.9g,%.9g,%.9g,%.9g,%.9g,%.9g\n", s.m_time,
+                s.m_position(0), s.m_position(1), s.m_position(2),
+                s.m_force(0), s.m_force(1), s.m_force(2),
+                s.m_torque(0), s.m_torque(1), s.m_torque(2),
+                s.m_gripperForce);
+    }
+
+    fclose(file);
+    return (C_SUCCESS);
+}
+
+
+//==============================================================================
+/*!
+    This method computes the sample of the trace at a given time, 
+    interpolating positions and gripper angles linearly and orientations 
+    spherically. Switches are held from the previous sample. After the last 
+    sample, the trace restarts if the loop is enabled, or holds the last 
+    sample otherwise. Without a trace, the motion profile is evaluated.
+
+    \param  a_time    Time [s].
+    \param  a_sample  Return value.
+*/
+//==============================================================================
+void cTraceHapticDevice::computeSample(double a_time, cTraceSample& a_sample)
+{
+    a_sample.m_time = a_time;
+
+    // motion profile
+    if (m_trace.empty())
+    {
+        double phase = 2.0 * C_PI * m_frequency * a_time;
+        a_sample.m_position = m_center;
+        switch (m_profile)
+        {
+            case C_TRACE_MOTION_SINE:
+                a_sample.m_position.add(sin(phase) * m_amplitude);
+                break;
+
+            case C_TRACE_MOTION_CIRCLE:
+                a_sample.m_position.add(cVector3d(m_amplitude(0) * cos(phase), m_amplitude(1) * sin(phase), 0.0));
+                break;
+
+            case C_TRACE_MOTION_SQUARE:
+                a_sample.m_position.add(((sin(phase) >= 0.0) ? 1.0 : -1.0) * m_amplitude);
+                break;
+
+            default:
+                break;
+        }
+        a_sample.m_rotation = cQuaternion(1.0, 0.0, 0.0, 0.0);
+        a_sample.m_gripperAngle = 0.0;
+        a_sample.m_userSwitches = 0;
+        return;
+    }
+
+    // trace
+    double duration = m_trace.back().m_time;
+    double time = a_time;
+    if (m_loop && (duration > 0.0))
+    {
+        time = fmod(a_time, duration);
+    }
+
+    if (time <= m_trace.front().m_time)
+    {
+        m_traceIndex = 0;
+        a_sample = m_trace.front();
+        a_sample.m_time = a_time;
+        return;
+    }
+    if (time >= duration)
+    {
+        m_traceIndex = (unsigned int)m_trace.size() - 1;
+        a_sample = m_trace.back();
+        a_sample.m_time = a_time;
+        return;
+    }
+
+    // times increase between calls, except when the trace loops
+    if (m_trace[m_traceIndex].m_time > time)
+    {
+        m_traceIndex = 0;
+    }
+    while ((m_traceIndex + 1 < m_trace.size()) && (m_trace[m_traceIndex + 1].m_time <= time))
+    {
+        m_traceIndex++;
+    }
+
+    const cTraceSample& s0 = m_trace[m_traceIndex];
+    const cTraceSample& s1 = m_trace[cMin(m_traceIndex + 1, (unsigned int)m_trace.size() - 1)];
+    double interval = s1.m_time - s0.m_time;
+    double level = (interval > 0.0) ? cClamp((time - s0.m_time) / interval, 0.0, 1.0) : 0.0;
+
+    a_sample.m_position = s0.m_position + level * (s1.m_position - s0.m_position);
+    cQuaternion q1 = s1.m_rotation;
+    if (s0.m_rotation.dot(q1) < 0.0)
+    {
+        q1.negate();
+    }
+    a_sample.m_rotation.slerp(level, s0.m_rotation, q1);
+    a_sample.m_gripperAngle = s0.m_gripperAngle + level * (s1.m_gripperAngle - s0.m_gripperAngle);
+    a_sample.m_userSwitches = s0.m_userSwitches;
+}
+
+//------------------------------------------------------------------------------
+} // namespace chai3d
+//------------------------------------------------------------------------------
@@ -0,0 +1,356 @@
+//==============================================================================
+/*
+    Software License Agreement (BSD License)
+    Copyright (c) 2003-2016, CHAI3D.
+    (www.chai3d.org)
+
+    All rights reserved.
+
+    Redistribution and use in source and binary forms, with or without
+    modification, are permitted provided that the following conditions
+    are met:
+
+    * Redistributions of source code must retain the above copyright
+    notice, this list of conditions and the following disclaimer.
+
+    * Redistributions in binary form must reproduce the above
+    copyright notice, this list of conditions and the following
+    disclaimer in the documentation and/or other materials provided
+    with the distribution.
+
+    * Neither the name of CHAI3D nor the names of its contributors may
+    be used to endorse or promote products derived from this software
+    without specific prior written permission.
+
+    THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS
+    "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT
+    LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS
+    FOR A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE
+    COPYRIGHT OWNER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT,
+    INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING,
+    BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES;
+    LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER
+    CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT
+    LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN
+    ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+    POSSIBILITY OF SUCH DAMAGE. 
+
+    \author    <http://www.chai3d.org>
+    \version   3.2.0 $Rev: 2182 $
+*/
+//==============================================================================
+
+
+
+//------------------------------------------------------------------------------
+#ifndef CTraceHapticDeviceH
+#define CTraceHapticDeviceH
+//------------------------------------------------------------------------------
+#include "devices/CGenericHapticDevice.h"
+#include "math/CQuaternion.h"
+#include "timers/CPrecisionClock.h"
+#include <string>
+#include <vector>
+//------------------------------------------------------------------------------
+
+//------------------------------------------------------------------------------
+namespace chai3d {
+//------------------------------------------------------------------------------
+
+//==============================================================================
+/*!
+    \file       CTraceHapticDevice.h
+
+    \brief
+    Implements a virtual haptic device driven by recorded or synthesized 
+    motion.
+*/
+//==============================================================================
+
+//------------------------------------------------------------------------------
+class cTraceHapticDevice;
+typedef std::shared_ptr<cTraceHapticDevice> cTraceHapticDevicePtr;
+//------------------------------------------------------------------------------
+
+//------------------------------------------------------------------------------
+//! Motion profiles synthesized by a cTraceHapticDevice when no trace is loaded.
+enum cTraceMotionProfile
+{
+    C_TRACE_MOTION_STATIC,
+    C_TRACE_MOTION_SINE,
+    C_TRACE_MOTION_CIRCLE,
+    C_TRACE_MOTION_SQUARE
+};
+//------------------------------------------------------------------------------
+
+
+//==============================================================================
+/*!
+    \struct     cTraceSample
+    \ingroup    devices
+
+    \brief
+    This structure stores a sample of an operator trajectory.
+*/
+//==============================================================================
+struct cTraceSample
+{
+    //! Time of the sample from the start of the trace [s].
+    double m_time;
+
+    //! Position of the device [m].
+    cVector3d m_position;
+
+    //! Orientation of the device.
+    cQuaternion m_rotation;
+
+    //! Gripper angle [rad].
+    double m_gripperAngle;
+
+    //! Status of the user switches.
+    unsigned int m_userSwitches;
+};
+
+
+//==============================================================================
+/*!
+    \struct     cTraceForceSample
+    \ingroup    devices
+
+    \brief
+    This structure stores a force command received by a cTraceHapticDevice.
+*/
+//==============================================================================
+struct cTraceForceSample
+{
+    //! Time of the command from the start of the trace [s].
+    double m_time;
+
+    //! Position of the device when the command was received [m].
+    cVector3d m_position;
+
+    //! Force [N].
+    cVector3d m_force;
+
+    //! Torque [N*m].
+    cVector3d m_torque;
+
+    //! Gripper force [N].
+    double m_gripperForce;
+};
+
+
+//==============================================================================
+/*!
+    \class      cTraceHapticDevice
+    \ingroup    devices
+
+    \brief
+    This class implements a virtual haptic device that replays operator 
+    trajectories.
+
+    \details
+    cTraceHapticDevice replaces a physical device when an application must
+    run without hardware, for instance for load tests or to compare control
+    algorithms run-to-run with identical inputs.\n
+
+    The device either replays a trace (position, orientation, gripper angle 
+    and user switches) loaded with loadTrace(), interpolating between 
+    samples, or synthesizes a motion profile set with setMotionProfile().
+    Velocities are estimated from the replayed positions like on a physical
+    device.\n
+
+    By default the trace is replayed at its original timing, measured from
+    open(). With setFixedTimeStep(), time instead advances by a fixed step 
+    at every call of getPosition(), which makes the replayed motion 
+    independent of scheduling: a haptic loop reads exactly the same 
+    positions on every run.\n
+
+    The forces sent to the device can be recorded with setForceRecording()
+    and saved with saveForceLog(). A trace can also be built with addSample()
+    and saved with saveTrace(). To record an operator with a physical device
+    from a haptic loop, recordSample() appends samples to a trace allocated
+    by setTraceRecording() instead.\n
+
+    Traces are text files with one sample per line:
+    time px py pz qw qx qy qz gripper switches, separated by spaces or 
+    commas. Lines starting with # are ignored.
+*/
+//==============================================================================
+class cTraceHapticDevice : public cGenericHapticDevice
+{
+    //--------------------------------------------------------------------------
+    // CONSTRUCTOR & DESTRUCTOR:
+    //--------------------------------------------------------------------------
+
+public:
+
+    //! Constructor of cTraceHapticDevice.
+    cTraceHapticDevice(unsigned int a_deviceNumber = 0);
+
+    //! Destructor of cTraceHapticDevice.
+    virtual ~cTraceHapticDevice() {};
+
+    //! Shared cTraceHapticDevice allocator.
+    static cTraceHapticDevicePtr create(unsigned int a_deviceNumber = 0) { return (std::make_shared<cTraceHapticDevice>(a_deviceNumber)); }
+
+
+    //--------------------------------------------------------------------------
+    // PUBLIC METHODS:
+    //--------------------------------------------------------------------------
+
+public:
+
+    //! This method opens the device and restarts the trace.
+    virtual bool open();
+
+    //! This method closes the device.
+    virtual bool close();
+
+    //! This method calibrates the device.
+    virtual bool calibrate(bool a_forceCalibration = false) { return (m_deviceReady); }
+
+    //! This method returns the position of the device and advances the trace time.
+    virtual bool getPosition(cVector3d& a_position);
+
+    //! This method returns the orientation frame of the device end-effector.
+    virtual bool getRotation(cMatrix3d& a_rotation);
+
+    //! This method returns the gripper angle in radian [rad].
+    virtual bool getGripperAngleRad(double& a_angle);
+
+    //! This method returns the status of all user switches [__true__ = __ON__ / __false__ = __OFF__].
+    virtual bool getUserSwitches(unsigned int& a_userSwitches);
+
+    //! This method sends a force [N] and a torque [N*m] and gripper force [N] to the haptic device.
+    virtual bool setForceAndTorqueAndGripperForce(const cVector3d& a_force, const cVector3d& a_torque, double a_gripperForce);
+
+
+    //--------------------------------------------------------------------------
+    // PUBLIC METHODS - TRACE:
+    //--------------------------------------------------------------------------
+
+public:
+
+    //! This method loads a trace from a file.
+    bool loadTrace(const std::string& a_filename);
+
+    //! This method saves the trace to a file.
+    bool saveTrace(const std::string& a_filename) const;
+
+    //! This method appends a sample to the trace. Samples must be added in increasing time.
+    void addSample(const cTraceSample& a_sample) { m_trace.push_back(a_sample); }
+
+    //! This method enables or disables recording samples with recordSample(), and clears the trace when enabled.
+    void setTraceRecording(const bool a_enabled, const unsigned int a_capacity = 1 << 20);
+
+    //! This method appends a sample to the trace if recording is enabled, without allocating memory. Samples beyond the capacity are dropped.
+    void recordSample(const cTraceSample& a_sample) { if (m_traceRecording && (m_trace.size() < m_trace.capacity())) { m_trace.push_back(a_sample); } }
+
+    //! This method removes all samples of the trace.
+    void clearTrace() { m_trace.clear(); m_traceIndex = 0; }
+
+    //! This method returns the number of samples of the trace.
+    int getNumSamples() const { return ((int)m_trace.size()); }
+
+    //! This method returns the duration of the trace [s].
+    double getTraceDuration() const { return (m_trace.empty() ? 0.0 : m_trace.back().m_time); }
+
+    //! This method sets the motion synthesized when no trace is loaded.
+    void setMotionProfile(const cTraceMotionProfile a_profile, const cVector3d& a_amplitude, const double a_frequency, const cVector3d& a_center = cVector3d(0,0,0));
+
+    //! This method enables or disables replaying the trace in a loop.
+    void setLoop(const bool a_loop) { m_loop = a_loop; }
+
+    //! This method sets the time step of each getPosition() call [s], or 0 to replay in real time.
+    void setFixedTimeStep(const double a_timeStep) { m_fixedTimeStep = cMax(0.0, a_timeStep); }
+
+    //! This method returns the current time of the trace [s].
+    double getTraceTime() const { return (m_time); }
+
+    //! This method returns __true__ if a trace without loop has been replayed entirely.
+    bool isFinished() const { return (!m_loop && !m_trace.empty() && (m_time > m_trace.back().m_time)); }
+
+
+    //--------------------------------------------------------------------------
+    // PUBLIC METHODS - FORCE LOG:
+    //--------------------------------------------------------------------------
+
+public:
+
+    //! This method enables or disables recording the forces sent to the device.
+    void setForceRecording(const bool a_enabled, const unsigned int a_capacity = 1 << 20);
+
+    //! This method returns the forces recorded since the device was opened.
+    const std::vector<cTraceForceSample>& getForceLog() const { return (m_forceLog); }
+
+    //! This method saves the recorded forces to a file.
+    bool saveForceLog(const std::string& a_filename) const;
+
+
+    //--------------------------------------------------------------------------
+    // PROTECTED METHODS:
+    //--------------------------------------------------------------------------
+
+protected:
+
+    //! This method computes the sample of the trace or motion profile at a given time.
+    void computeSample(double a_time, cTraceSample& a_sample);
+
+
+    //--------------------------------------------------------------------------
+    // PROTECTED MEMBERS:
+    //--------------------------------------------------------------------------
+
+protected:
+
+    //! Samples of the trace.
+    std::vector<cTraceSample> m_trace;
+
+    //! Index of the last sample used for interpolation.
+    unsigned int m_traceIndex;
+
+    //! If __true__, samples passed to recordSample() are appended to the trace.
+    bool m_traceRecording;
+
+    //! If __true__, the trace is replayed in a loop.
+    bool m_loop;
+
+    //! Motion synthesized when no trace is loaded.
+    cTraceMotionProfile m_profile;
+
+    //! Amplitude of the motion profile [m].
+    cVector3d m_amplitude;
+
+    //! Frequency of the motion profile [Hz].
+    double m_frequency;
+
+    //! Center of the motion profile [m].
+    cVector3d m_center;
+
+    //! Time step of each getPosition() call, 0 for real time.
+    double m_fixedTimeStep;
+
+    //! Clock measuring the trace time in real time.
+    cPrecisionClock m_clock;
+
+    //! Current time of the trace.
+    double m_time;
+
+    //! Current sample.
+    cTraceSample m_sample;
+
+    //! If __true__, the forces sent to the device are recorded.
+    bool m_forceRecording;
+
+    //! Recorded forces.
+    std::vector<cTraceForceSample> m_forceLog;
+};
+
+//------------------------------------------------------------------------------
+} // namespace chai3d
+//------------------------------------------------------------------------------
+
+//------------------------------------------------------------------------------
+#endif
+//------------------------------------------------------------------------------
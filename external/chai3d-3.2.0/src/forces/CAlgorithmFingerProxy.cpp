@@ -102,6 +102,7 @@ cAlgorithmFingerProxy::cAlgorithmFingerProxy()
     m_collisionSettings.m_checkHapticObjects            = true;
     m_collisionSettings.m_ignoreShapes                  = true;
     m_collisionSettings.m_adjustObjectMotion            = m_useDynamicProxy;
+    m_collisionSettings.m_contactCache                  = &m_contactCache;
 
     // setup pointers to collision recorders so that user can access
     // collision information about each haptic point.
@@ -109,6 +110,13 @@ cAlgorithmFingerProxy::cAlgorithmFingerProxy()
     m_collisionEvents[1] = &(m_collisionRecorderConstraint1.m_nearestCollision);
     m_collisionEvents[2] = &(m_collisionRecorderConstraint2.m_nearestCollision);
 
+    // reserve memory for collision events so that the haptic loop does not
+    // allocate memory when contacts occur
+    m_collisionRecorderConstraint0.m_collisions.reserve(32);
+    m_collisionRecorderConstraint1.m_collisions.reserve(32);
+    m_collisionRecorderConstraint2.m_collisions.reserve(32);
+    m_collisionRecorderDynamicProxy.m_collisions.reserve(32);
+
     // initialize algorithm variables
     m_algoCounter = 0;
 
@@ -190,6 +198,30 @@ void cAlgorithmFingerProxy::setEpsilonBaseValue(double a_value)
 }
 
 
+//==============================================================================
+/*!
+    This method enables or disables the cache of neighbourhoods in collision 
+    trees. When enabled, consecutive collision queries of the proxy inside the 
+    same small region of an object only test the leaves of the collision tree 
+    located in that region. Results are identical in both cases.
+
+    \param  a_useContactCache  If __true__, the cache is enabled.
+*/
+//==============================================================================
+void cAlgorithmFingerProxy::setUseContactCache(const bool a_useContactCache)
+{
+    if (a_useContactCache)
+    {
+        m_collisionSettings.m_contactCache = &m_contactCache;
+    }
+    else
+    {
+        m_collisionSettings.m_contactCache = NULL;
+        m_contactCache.clear();
+    }
+}
+
+
 //==============================================================================
 /*!
     This method computes the interaction forces that are associated with the
@@ -231,6 +263,120 @@ cVector3d cAlgorithmFingerProxy::computeForces(const cVector3d& a_toolPos,
 }
 
 
+//==============================================================================
+/*!
+    This method computes the interaction forces of several proxies. The 
+    result is identical to calling \ref computeForces() on each proxy, but 
+    the segments along which the proxies first move toward their goals, 
+    which are the only queries made by proxies in free space, are tested in a 
+    single batch for all proxies that share a same world. Collision trees are
+    then traversed once for all of them.
+
+    \param  a_numProxies  Number of proxies.
+    \param  a_proxies     Array of proxies.
+    \param  a_toolPos     New position of the tool of each proxy.
+    \param  a_toolVel     New velocity of the tool of each proxy.
+    \param  a_forces      Returned haptic force of each proxy.
+*/
+//==============================================================================
+void cAlgorithmFingerProxy::computeForces(const int a_numProxies,
+                                          cAlgorithmFingerProxy** a_proxies,
+                                          const cVector3d* a_toolPos,
+                                          const cVector3d* a_toolVel,
+                                          cVector3d* a_forces)
+{
+    for (int first=0; first<a_numProxies; first+=C_COLLISION_PACKET_SIZE)
+    {
+        cAlgorithmFingerProxy** proxies = &a_proxies[first];
+        int numProxies = cMin(C_COLLISION_PACKET_SIZE, a_numProxies - first);
+
+        // update device positions and compute the segments of the first constraint
+        cCollisionQuery queries[C_COLLISION_PACKET_SIZE];
+        bool query0[C_COLLISION_PACKET_SIZE];
+        for (int i=0; i<numProxies; i++)
+        {
+            cAlgorithmFingerProxy* proxy = proxies[i];
+            proxy->m_deviceGlobalPos = a_toolPos[first + i];
+
+            query0[i] = false;
+            if (proxy->m_world != NULL)
+            {
+                query0[i] = proxy->beginNextBestProxyPosition(proxy->m_deviceGlobalPos,
+                                                              queries[i].m_segmentPointA,
+                                                              queries[i].m_segmentPointB);
+            }
+
+            if (query0[i])
+            {
+                proxy->m_collisionRecorderConstraint0.clear();
+                queries[i].m_recorder = &(proxy->m_collisionRecorderConstraint0);
+                queries[i].m_settings = &(proxy->m_collisionSettings);
+            }
+        }
+
+        // test segments of proxies located in a same world together
+        bool tested[C_COLLISION_PACKET_SIZE];
+        for (int i=0; i<numProxies; i++)
+        {
+            tested[i] = !query0[i];
+        }
+
+        for (int i=0; i<numProxies; i++)
+        {
+            if (tested[i]) { continue; }
+
+            cWorld* world = proxies[i]->m_world;
+            cCollisionQuery worldQueries[C_COLLISION_PACKET_SIZE];
+            int worldIndices[C_COLLISION_PACKET_SIZE];
+            int numWorldQueries = 0;
+            for (int j=i; j<numProxies; j++)
+            {
+                if ((!tested[j]) && (proxies[j]->m_world == world))
+                {
+                    worldQueries[numWorldQueries] = queries[j];
+                    worldIndices[numWorldQueries] = j;
+                    numWorldQueries++;
+                    tested[j] = true;
+                }
+            }
+
+            if (numWorldQueries == 1)
+            {
+                queries[i].m_hit = world->computeCollisionDetection(queries[i].m_segmentPointA,
+                                                                    queries[i].m_segmentPointB,
+                                                                    *queries[i].m_recorder,
+                                                                    *queries[i].m_settings);
+            }
+            else
+            {
+                world->computeCollisionDetection(worldQueries, numWorldQueries);
+                for (int j=0; j<numWorldQueries; j++)
+                {
+                    queries[worldIndices[j]].m_hit = worldQueries[j].m_hit;
+                }
+            }
+        }
+
+        // move proxies according to the constraints and compute forces
+        for (int i=0; i<numProxies; i++)
+        {
+            cAlgorithmFingerProxy* proxy = proxies[i];
+            if (proxy->m_world != NULL)
+            {
+                proxy->endNextBestProxyPosition(proxy->m_deviceGlobalPos, query0[i], queries[i].m_hit);
+                proxy->m_proxyGlobalPos = proxy->m_nextBestProxyGlobalPos;
+                proxy->updateForce();
+                a_forces[first + i] = proxy->m_lastGlobalForce;
+            }
+            else
+            {
+                a_forces[first + i].zero();
+            }
+        }
+    }
+}
+
+
 //==============================================================================
 /*!
     Given the new position of the device and considering the current
@@ -247,15 +393,89 @@ cVector3d cAlgorithmFingerProxy::computeForces(const cVector3d& a_toolPos,
 //==============================================================================
 void cAlgorithmFingerProxy::computeNextBestProxyPosition(const cVector3d& a_goal)
 {
-    bool hit0, hit1, hit2;
+    cVector3d segmentPointA, segmentPointB;
+    bool hit0 = false;
+
+    // compute the segment of the first constraint
+    bool query0 = beginNextBestProxyPosition(a_goal, segmentPointA, segmentPointB);
+
+    // search for a collision between this segment and the environment
+    if (query0)
+    {
+        m_collisionRecorderConstraint0.clear();
+        hit0 = m_world->computeCollisionDetection(segmentPointA,
+                                                  segmentPointB,
+                                                  m_collisionRecorderConstraint0,
+                                                  m_collisionSettings);
+    }
+
+    // move the proxy according to the constraints
+    endNextBestProxyPosition(a_goal, query0, hit0);
+}
+
+
+//==============================================================================
+/*!
+    This method starts computing the next best position of the proxy. If the
+    dynamic proxy is enabled, the proxy is first adjusted to the motion of 
+    objects. The segment along which the proxy moves toward its goal is then 
+    computed if the first constraint is searched at this update. \n\n
+
+    The segment must be tested against the world with 
+    \ref m_collisionSettings, the result being stored in the recorder of the 
+    first constraint, before calling \ref endNextBestProxyPosition(). This 
+    allows the segments of several proxies to be tested together.
+
+    \param  a_goal           The goal position of the __proxy__ subject to constraints.
+    \param  a_segmentPointA  Returned start point of segment.
+    \param  a_segmentPointB  Returned end point of segment.
 
+    \return __true__ if the segment must be tested, __false__ otherwise.
+*/
+//==============================================================================
+bool cAlgorithmFingerProxy::beginNextBestProxyPosition(const cVector3d& a_goal,
+                                                       cVector3d& a_segmentPointA,
+                                                       cVector3d& a_segmentPointB)
+{
     if (m_useDynamicProxy)
     {
         // adjust the proxy according moving objects that may have collided with the proxy
         adjustDynamicProxy(a_goal);
 
         // search for a first contact
-        hit0 = computeNextProxyPositionWithContraints0(a_goal);
+        return (computeSegmentWithContraints0(a_goal, a_segmentPointA, a_segmentPointB));
+    }
+    else if (m_algoCounter == 0)
+    {
+        // search for a first contact
+        return (computeSegmentWithContraints0(a_goal, a_segmentPointA, a_segmentPointB));
+    }
+
+    return (false);
+}
+
+
+//==============================================================================
+/*!
+    This method completes the computation of the next best position of the 
+    proxy started by \ref beginNextBestProxyPosition(), given the result of 
+    the collision query of the first constraint.
+
+    \param  a_goal    The goal position of the __proxy__ subject to constraints.
+    \param  a_query0  Value returned by \ref beginNextBestProxyPosition().
+    \param  a_hit0    Result of the collision query of the first constraint.
+*/
+//==============================================================================
+void cAlgorithmFingerProxy::endNextBestProxyPosition(const cVector3d& a_goal,
+                                                     const bool a_query0,
+                                                     const bool a_hit0)
+{
+    bool hit0, hit1, hit2;
+
+    if (m_useDynamicProxy)
+    {
+        // search for a first contact
+        hit0 = a_query0 && computeNextProxyPositionWithContraints0(a_goal, a_hit0);
         m_proxyGlobalPos = m_nextBestProxyGlobalPos;
         if (!hit0) 
         { 
@@ -294,7 +514,7 @@ void cAlgorithmFingerProxy::computeNextBestProxyPosition(const cVector3d& a_goal
         switch(m_algoCounter)
         {
             case 0:
-                hit0 = computeNextProxyPositionWithContraints0(a_goal);
+                hit0 = a_query0 && computeNextProxyPositionWithContraints0(a_goal, a_hit0);
                 if (hit0)
                 {
                     m_contactPointLocalPos0 = cTranspose(m_collisionRecorderConstraint0.m_nearestCollision.m_object->getGlobalRot()) * (m_nextBestProxyGlobalPos - m_collisionRecorderConstraint0.m_nearestCollision.m_object->getGlobalPos());
@@ -338,8 +558,9 @@ void cAlgorithmFingerProxy::adjustDynamicProxy(const cVector3d& a_goal)
         collisionSettings.m_adjustObjectMotion            = true;
         collisionSettings.m_collisionRadius = m_radius;
 
-        // setup recorder
-        cCollisionRecorder collisionRecorder;
+        // setup recorder. the recorder is reused so that its list of events
+        // keeps its memory from one update to the next.
+        cCollisionRecorder& collisionRecorder = m_collisionRecorderDynamicProxy;
         collisionRecorder.clear();
 
         cVector3d nextProxyOffset(0.0, 0.0, 0.0);
@@ -405,7 +626,9 @@ void cAlgorithmFingerProxy::adjustDynamicProxy(const cVector3d& a_goal)
 
 //------------------------------------------------------------------------------
 
-bool cAlgorithmFingerProxy::computeNextProxyPositionWithContraints0(const cVector3d& a_goalGlobalPos)
+bool cAlgorithmFingerProxy::computeSegmentWithContraints0(const cVector3d& a_goalGlobalPos,
+                                                          cVector3d& a_segmentPointA,
+                                                          cVector3d& a_segmentPointB)
 {
     // we define the goal position of the proxy.
     cVector3d goalGlobalPos = a_goalGlobalPos;
@@ -461,18 +684,45 @@ bool cAlgorithmFingerProxy::computeNextProxyPositionWithContraints0(const cVecto
     // for this we create a segment that goes from the proxy position to
     // the goal position plus a little extra to take into account the
     // physical radius of the proxy.
-    cVector3d targetPos =  goalGlobalPos + cMul(m_epsilonCollisionDetection, vProxyToGoalNormalized);
+    a_segmentPointA = m_proxyGlobalPos;
+    a_segmentPointB = goalGlobalPos + cMul(m_epsilonCollisionDetection, vProxyToGoalNormalized);
 
     // setup collision detector
     m_collisionSettings.m_collisionRadius = m_radius;
 
-    // search for a collision between the first segment (proxy-device)
-    // and the environment.
-    m_collisionRecorderConstraint0.clear();
-    bool hit = m_world->computeCollisionDetection(m_proxyGlobalPos,
-                                                  targetPos,
-                                                  m_collisionRecorderConstraint0,
-                                                  m_collisionSettings);
+    return (true);
+}
+
+//------------------------------------------------------------------------------
+
+bool cAlgorithmFingerProxy::computeNextProxyPositionWithContraints0(const cVector3d& a_goalGlobalPos,
+                                                                   const bool a_hit)
+{
+    // we define the goal position of the proxy.
+    cVector3d goalGlobalPos = a_goalGlobalPos;
+
+    // compute the distance between the proxy and the goal positions
+    double distanceProxyGoal = cDistance(m_proxyGlobalPos, goalGlobalPos);
+
+    // compute the normalized form of the vector going from the
+    // current proxy position to the desired goal position
+    cVector3d vProxyToGoal;
+    cVector3d vProxyToGoalNormalized;
+
+    if (distanceProxyGoal > m_epsilon)
+    {
+        goalGlobalPos.subr(m_proxyGlobalPos, vProxyToGoal);
+        vProxyToGoal.normalizer(vProxyToGoalNormalized);
+    }
+    else
+    {
+        vProxyToGoal.zero();
+        vProxyToGoalNormalized.zero();
+    }
+
+    // the segment going from the proxy to the goal has been tested by
+    // computeSegmentWithContraints0().
+    bool hit = a_hit;
 
     // check if collision occurred between proxy and goal positions.
     double collisionDistance;
@@ -46,6 +46,7 @@
 #define CAlgorithmFingerProxyH
 //------------------------------------------------------------------------------
 #include "collisions/CGenericCollision.h"
+#include "collisions/CCollisionAABB.h"
 #include "forces/CGenericForceAlgorithm.h"
 #include "math/CVector3d.h"
 #include "math/CMatrix3d.h"
@@ -111,6 +112,13 @@ public:
     //! This method calculates the interaction forces.
     virtual cVector3d computeForces(const cVector3d& a_toolPos, const cVector3d& a_toolVel);
 
+    //! This method calculates the interaction forces of several proxies, whose first collision queries are tested together.
+    static void computeForces(const int a_numProxies,
+                              cAlgorithmFingerProxy** a_proxies,
+                              const cVector3d* a_toolPos,
+                              const cVector3d* a_toolVel,
+                              cVector3d* a_forces);
+
 
     //----------------------------------------------------------------------
     // METHODS - GETTER AND SETTER FUNCTIONS:
@@ -198,6 +206,22 @@ public:
     double getEpsilonBaseValue() { return (m_epsilonBaseValue); }
 
 
+    //----------------------------------------------------------------------
+    // METHODS - CONTACT CACHE
+    //----------------------------------------------------------------------
+
+public:
+
+    //! This method enables or disables the cache of neighbourhoods in collision trees.
+    void setUseContactCache(const bool a_useContactCache);
+
+    //! This method returns __true__ if the cache of neighbourhoods in collision trees is enabled.
+    bool getUseContactCache() const { return (m_collisionSettings.m_contactCache != NULL); }
+
+    //! This method returns the cache of neighbourhoods in collision trees.
+    cCollisionAABBCache* getContactCache() { return (&m_contactCache); }
+
+
     //--------------------------------------------------------------------------
     // PROTECTED METHODS - GRAPHICS:
     //--------------------------------------------------------------------------
@@ -220,6 +244,16 @@ protected:
     //! This method computes the next goal position of the proxy.
     virtual void computeNextBestProxyPosition(const cVector3d& a_goal);
 
+    //! This method starts computing the next goal position of the proxy, and returns __true__ if the segment of the first constraint must be tested.
+    bool beginNextBestProxyPosition(const cVector3d& a_goal,
+                                    cVector3d& a_segmentPointA,
+                                    cVector3d& a_segmentPointB);
+
+    //! This method completes the computation of the next goal position of the proxy from the collision query of the first constraint.
+    void endNextBestProxyPosition(const cVector3d& a_goal,
+                                  const bool a_query0,
+                                  const bool a_hit0);
+
     //! This method attempts to move the proxy, subject to friction constraints.
     virtual void testFrictionAndMoveProxy(const cVector3d& a_goal, const cVector3d& a_proxy, cVector3d& a_normal, cGenericObject* a_parent);
 
@@ -276,6 +310,12 @@ protected:
     //! Collision detection recorder for searching third constraint.
     cCollisionRecorder m_collisionRecorderConstraint2;
 
+    //! Collision detection recorder for objects moving into the proxy. Reused at every update to avoid heap allocations.
+    cCollisionRecorder m_collisionRecorderDynamicProxy;
+
+    //! Cache of neighbourhoods of the proxy in collision trees.
+    cCollisionAABBCache m_contactCache;
+
     //! Local position of contact point first object.
     cVector3d m_contactPointLocalPos0;
 
@@ -318,8 +358,14 @@ protected:
     //! This method ajust the position of __proxy__ by taking into account motion of objects in the world.
     void adjustDynamicProxy(const cVector3d& a_goal);
 
-    //! This method updates the position of the __proxy__ - constraint 0.
-    bool computeNextProxyPositionWithContraints0(const cVector3d& a_goalGlobalPos);
+    //! This method computes the segment tested for constraint 0, and returns __false__ if the __proxy__ has already reached its goal.
+    bool computeSegmentWithContraints0(const cVector3d& a_goalGlobalPos,
+                                       cVector3d& a_segmentPointA,
+                                       cVector3d& a_segmentPointB);
+
+    //! This method updates the position of the __proxy__ - constraint 0 - from the result of the collision query.
+    bool computeNextProxyPositionWithContraints0(const cVector3d& a_goalGlobalPos,
+                                                 const bool a_hit);
 
     //! This method updates the position of the __proxy__ - constraint 1.
     bool computeNextProxyPositionWithContraints1(const cVector3d& a_goalGlobalPos);
@@ -68,6 +68,10 @@ cAlgorithmPotentialField::cAlgorithmPotentialField()
 
     // increment counter
     m_IDNcounter++;
+
+    // reserve memory for interaction events so that the haptic loop does not
+    // allocate memory when interactions occur
+    m_interactionRecorder.m_interactions.reserve(32);
 }
 
 
@@ -0,0 +1,203 @@
+//==============================================================================
+/*
+    Software License Agreement (BSD License)
+    Copyright (c) 2003-2016, CHAI3D.
+    (www.chai3d.org)
+
+    All rights reserved.
+
+    Redistribution and use in source and binary forms, with or without
+    modification, are permitted provided that the following conditions
+    are met:
+
+    * Redistributions of source code must retain the above copyright
+    notice, this list of conditions and the following disclaimer.
+
+    * Redistributions in binary form must reproduce the above
+    copyright notice, this list of conditions and the following
+    disclaimer in the documentation and/or other materials provided
+    with the distribution.
+
+    * Neither the name of CHAI3D nor the names of its contributors may
+    be used to endorse or promote products derived from this software
+    without specific prior written permission.
+
+    THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS
+    "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT
+    LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS
+    FOR A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE
+    COPYRIGHT OWNER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT,
+    INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING,
+    BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES;
+    LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER
+    CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT
+    LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN
+    ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+    POSSIBILITY OF SUCH DAMAGE. 
+
+    \author    <http://www.chai3d.org>
+    \version   3.2.0 $Rev: 2182 $
+*/
+//==============================================================================
+
+
+
+//------------------------------------------------------------------------------
+#include "forces/CLocalContactModel.h"
+//------------------------------------------------------------------------------
+#include "forces/CAlgorithmFingerProxy.h"
+#include "materials/CMaterial.h"
+#include "tools/CGenericTool.h"
+//------------------------------------------------------------------------------
+
+//------------------------------------------------------------------------------
+namespace chai3d {
+//------------------------------------------------------------------------------
+
+//==============================================================================
+/*!
+    Constructor of cLocalContactModel.
+*/
+//==============================================================================
+cLocalContactModel::cLocalContactModel()
+{
+    m_numPlanes = 0;
+    m_damping = 0.0;
+}
+
+
+//==============================================================================
+/*!
+    This method adds a contact plane to the model. The normal is normalized.
+
+    \param  a_normal     Normal of the plane, in device coordinates.
+    \param  a_offset     Offset of the plane along the normal.
+    \param  a_stiffness  Stiffness of the plane [N/m].
+
+    \return __true__ if the plane was added, __false__ if the model is full
+            or the normal is degenerate.
+*/
+//==============================================================================
+bool cLocalContactModel::addPlane(const cVector3d& a_normal, 
+                                  const double a_offset, 
+                                  const double a_stiffness)
+{
+    double length = a_normal.length();
+    if ((m_numPlanes >= C_LOCAL_CONTACT_MAX_PLANES) || (length < C_SMALL))
+    {
+        return (false);
+    }
+
+    cLocalContactPlane& plane = m_planes[m_numPlanes];
+    plane.m_normal = a_normal / length;
+    plane.m_offset = a_offset / length;
+    plane.m_stiffness = cMax(0.0, a_stiffness);
+    m_numPlanes++;
+
+    return (true);
+}
+
+
+//==============================================================================
+/*!
+    This method rebuilds the model from the collision events of the 
+    finger-proxy algorithm of a haptic point. It must be called on the
+    haptic thread, after the interaction forces of the tool were computed.\n
+
+    With __G__, __R__ and __s__ the global position, rotation and workspace
+    scale factor of the tool, the global position of the device is
+    __G__ + __s__ __R__ __d__. For a surface of normal __n__ through the 
+    proxy __P__, the penetration is therefore __n__ * (__P__ - __G__) -
+    __s__ (__R__^T __n__) * __d__, which gives a plane of normal 
+    __R__^T __n__, offset __n__ * (__P__ - __G__) / __s__ and stiffness
+    __k__ __s__ in device coordinates.
+
+    \param  a_tool               Tool.
+    \param  a_hapticPointIndex   Index of the haptic point of the tool.
+
+    \return __true__ if the model was built, __false__ otherwise.
+*/
+//==============================================================================
+bool cLocalContactModel::update(cGenericTool* a_tool, const int a_hapticPointIndex)
+{
+    clear();
+
+    if ((a_tool == NULL) || (a_hapticPointIndex < 0) || (a_hapticPointIndex >= a_tool->getNumHapticPoints()))
+    {
+        return (false);
+    }
+
+    cHapticPoint* point = a_tool->getHapticPoint(a_hapticPointIndex);
+    cAlgorithmFingerProxy* proxy = point->m_algorithmFingerProxy;
+    double scale = a_tool->getWorkspaceScaleFactor();
+    if ((proxy == NULL) || (scale < C_SMALL))
+    {
+        return (false);
+    }
+
+    cVector3d toolPos = a_tool->getGlobalPos();
+    cMatrix3d toolRotT = cTranspose(a_tool->getGlobalRot());
+    cVector3d proxyPos = proxy->getProxyGlobalPosition();
+
+    int numEvents = cMin(proxy->getNumCollisionEvents(), C_LOCAL_CONTACT_MAX_PLANES);
+    for (int i=0; i<numEvents; i++)
+    {
+        cCollisionEvent* event = proxy->m_collisionEvents[i];
+        if ((event == NULL) || (event->m_object == NULL) || (event->m_object->m_material == nullptr))
+        {
+            continue;
+        }
+
+        cVector3d normal = event->m_globalNormal;
+        double length = normal.length();
+        if (length < C_SMALL) { continue; }
+        normal.div(length);
+
+        double stiffness = event->m_object->m_material->getStiffness();
+        addPlane(toolRotT * normal, 
+                 cDot(normal, proxyPos - toolPos) / scale, 
+                 stiffness * scale);
+    }
+
+    return (true);
+}
+
+
+//==============================================================================
+/*!
+    This method computes the force of the model at a device position. Each
+    penetrated plane contributes a spring along its normal, and a damper
+    that opposes the penetration velocity.
+
+    \param  a_devicePos     Position of the device.
+    \param  a_deviceLinVel  Linear velocity of the device.
+
+    \return Force in device coordinates [N].
+*/
+//==============================================================================
+cVector3d cLocalContactModel::computeForce(const cVector3d& a_devicePos, 
+                                           const cVector3d& a_deviceLinVel) const
+{
+    cVector3d force(0.0, 0.0, 0.0);
+    for (int i=0; i<m_numPlanes; i++)
+    {
+        const cLocalContactPlane& plane = m_planes[i];
+        double depth = plane.m_offset - cDot(plane.m_normal, a_devicePos);
+        if (depth > 0.0)
+        {
+            double magnitude = plane.m_stiffness * depth;
+            double velocity = cDot(plane.m_normal, a_deviceLinVel);
+            if (velocity < 0.0)
+            {
+                magnitude -= m_damping * velocity;
+            }
+            force.add(magnitude * plane.m_normal);
+        }
+    }
+
+    return (force);
+}
+
+//------------------------------------------------------------------------------
+} // namespace chai3d
+//------------------------------------------------------------------------------
@@ -0,0 +1,193 @@
+//==============================================================================
+/*
+    Software License Agreement (BSD License)
+    Copyright (c) 2003-2016, CHAI3D.
+    (www.chai3d.org)
+
+    All rights reserved.
+
+    Redistribution and use in source and binary forms, with or without
+    modification, are permitted provided that the following conditions
+    are met:
+
+    * Redistributions of source code must retain the above copyright
+    notice, this list of conditions and the following disclaimer.
+
+    * Redistributions in binary form must reproduce the above
+    copyright notice, this list of conditions and the following
+    disclaimer in the documentation and/or other materials provided
+    with the distribution.
+
+    * Neither the name of CHAI3D nor the names of its contributors may
+    be used to endorse or promote products derived from this software
+    without specific prior written permission.
+
+    THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS
+    "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT
+    LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS
+    FOR A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE
+    COPYRIGHT OWNER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT,
+    INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING,
+    BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES;
+    LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER
+    CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT
+    LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN
+    ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+    POSSIBILITY OF SUCH DAMAGE. 
+
+    \author    <http://www.chai3d.org>
+    \version   3.2.0 $Rev: 2182 $
+*/
+//==============================================================================
+
+
+
+//------------------------------------------------------------------------------
+#ifndef CLocalContactModelH
+#define CLocalContactModelH
+//------------------------------------------------------------------------------
+#include "math/CVector3d.h"
+//------------------------------------------------------------------------------
+
+//------------------------------------------------------------------------------
+namespace chai3d {
+//------------------------------------------------------------------------------
+
+//------------------------------------------------------------------------------
+class cGenericTool;
+//------------------------------------------------------------------------------
+
+//==============================================================================
+/*!
+    \file       CLocalContactModel.h
+
+    \brief
+    Implements a local contact model for multirate haptic rendering.
+*/
+//==============================================================================
+
+//------------------------------------------------------------------------------
+//! Maximum number of contact planes of a local contact model.
+const int C_LOCAL_CONTACT_MAX_PLANES = 3;
+//------------------------------------------------------------------------------
+
+//==============================================================================
+/*!
+    \struct     cLocalContactPlane
+    \ingroup    forces
+
+    \brief
+    This structure describes a contact plane in device coordinates.
+
+    \details
+    A device position __d__ penetrates the plane when 
+    __m_normal__ * __d__ < __m_offset__. The plane then pushes the device
+    back along __m_normal__ with a force of __m_stiffness__ times the 
+    penetration depth.
+*/
+//==============================================================================
+struct cLocalContactPlane
+{
+    //! Unit normal of the plane, in device coordinates.
+    cVector3d m_normal;
+
+    //! Offset of the plane along the normal [m].
+    double m_offset;
+
+    //! Stiffness of the plane in device coordinates [N/m].
+    double m_stiffness;
+};
+
+
+//==============================================================================
+/*!
+    \class      cLocalContactModel
+    \ingroup    forces
+
+    \brief
+    This class implements an intermediate representation of the contacts
+    of a haptic point.
+
+    \details
+    cLocalContactModel captures the constraints found by the finger-proxy
+    algorithm as up to three planes, expressed in the coordinates of the 
+    haptic device. Evaluating the model only requires a few dot products, so 
+    a servo loop running much faster than the collision detection can 
+    render the contacts against the latest device position 
+    (see __cMultirateHapticDevice__).\n
+
+    The planes pass through the proxy, with the normals of the surfaces in 
+    contact. The stiffness of each plane is the stiffness of the material 
+    of the object in contact, converted to device units with the workspace 
+    scale factor of the tool.
+*/
+//==============================================================================
+class cLocalContactModel
+{
+    //--------------------------------------------------------------------------
+    // CONSTRUCTOR & DESTRUCTOR:
+    //--------------------------------------------------------------------------
+
+public:
+
+    //! Constructor of cLocalContactModel.
+    cLocalContactModel();
+
+    //! Destructor of cLocalContactModel.
+    virtual ~cLocalContactModel() {};
+
+
+    //--------------------------------------------------------------------------
+    // PUBLIC METHODS:
+    //--------------------------------------------------------------------------
+
+public:
+
+    //! This method removes all contact planes.
+    void clear() { m_numPlanes = 0; }
+
+    //! This method adds a contact plane, in device coordinates.
+    bool addPlane(const cVector3d& a_normal, const double a_offset, const double a_stiffness);
+
+    //! This method returns the number of contact planes.
+    int getNumPlanes() const { return (m_numPlanes); }
+
+    //! This method returns a contact plane.
+    const cLocalContactPlane& getPlane(const int a_index) const { return (m_planes[a_index]); }
+
+    //! This method sets the damping [N/(m/s)] applied along the normals of the penetrated planes.
+    void setDamping(const double a_damping) { m_damping = a_damping; }
+
+    //! This method returns the damping [N/(m/s)] applied along the normals of the penetrated planes.
+    double getDamping() const { return (m_damping); }
+
+    //! This method builds the model from the contacts of a haptic point of a tool.
+    bool update(cGenericTool* a_tool, const int a_hapticPointIndex = 0);
+
+    //! This method computes the force [N] of the model at a device position and velocity.
+    cVector3d computeForce(const cVector3d& a_devicePos, const cVector3d& a_deviceLinVel) const;
+
+
+    //--------------------------------------------------------------------------
+    // PROTECTED MEMBERS:
+    //--------------------------------------------------------------------------
+
+protected:
+
+    //! Contact planes.
+    cLocalContactPlane m_planes[C_LOCAL_CONTACT_MAX_PLANES];
+
+    //! Number of contact planes.
+    int m_numPlanes;
+
+    //! Damping along the normals of the penetrated planes.
+    double m_damping;
+};
+
+//------------------------------------------------------------------------------
+} // namespace chai3d
+//------------------------------------------------------------------------------
+
+//------------------------------------------------------------------------------
+#endif
+//------------------------------------------------------------------------------
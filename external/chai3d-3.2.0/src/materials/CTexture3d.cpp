@@ -319,6 +319,32 @@ void cTexture3d::renderFinalize(cRenderOptions& a_options)
 //==============================================================================
 void cTexture3d::markForPartialUpdate(const cVector3d a_voxelUpdateMin, const cVector3d a_voxelUpdateMax)
 {
+    // a full update is already pending
+    if (m_updateTextureFlag && !m_markPartialUpdate)
+    {
+        return;
+    }
+
+    // compute region to be updated.
+    cVector3d voxelUpdateMin, voxelUpdateMax;
+    voxelUpdateMin.x(cClamp((int)(a_voxelUpdateMin.x()), 0, (int)m_image->getWidth()));
+    voxelUpdateMin.y(cClamp((int)(a_voxelUpdateMin.y()), 0, (int)m_image->getHeight()));
+    voxelUpdateMin.z(cClamp((int)(a_voxelUpdateMin.z()), 0, (int)m_image->getImageCount()));
+    voxelUpdateMax.x(cClamp((int)(a_voxelUpdateMax.x()), 0, (int)m_image->getWidth()));
+    voxelUpdateMax.y(cClamp((int)(a_voxelUpdateMax.y()), 0, (int)m_image->getHeight()));
+    voxelUpdateMax.z(cClamp((int)(a_voxelUpdateMax.z()), 0, (int)m_image->getImageCount()));
+
+    // merge with the region of a pending partial update, so that regions 
+    // modified between two rendering passes are all uploaded
+    if (m_updateTextureFlag && m_markPartialUpdate)
+    {
+        for (int i=0; i<3; i++)
+        {
+            voxelUpdateMin(i) = cMin(voxelUpdateMin(i), m_voxelUpdateMin(i));
+            voxelUpdateMax(i) = cMax(voxelUpdateMax(i), m_voxelUpdateMax(i));
+        }
+    }
+
     // mark texture for update
     markForUpdate();
 
@@ -326,12 +352,8 @@ void cTexture3d::markForPartialUpdate(const cVector3d a_voxelUpdateMin, const cV
     m_markPartialUpdate = true;
 
     // store region to be updated.
-    m_voxelUpdateMin.x(cClamp((int)(a_voxelUpdateMin.x()), 0, (int)m_image->getWidth()));
-    m_voxelUpdateMin.y(cClamp((int)(a_voxelUpdateMin.y()), 0, (int)m_image->getHeight()));
-    m_voxelUpdateMin.z(cClamp((int)(a_voxelUpdateMin.z()), 0, (int)m_image->getImageCount()));
-    m_voxelUpdateMax.x(cClamp((int)(a_voxelUpdateMax.x()), 0, (int)m_image->getWidth()));
-    m_voxelUpdateMax.y(cClamp((int)(a_voxelUpdateMax.y()), 0, (int)m_image->getHeight()));
-    m_voxelUpdateMax.z(cClamp((int)(a_voxelUpdateMax.z()), 0, (int)m_image->getImageCount()));
+    m_voxelUpdateMin = voxelUpdateMin;
+    m_voxelUpdateMax = voxelUpdateMax;
 }
 
 
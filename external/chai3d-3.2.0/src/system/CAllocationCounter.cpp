@@ -0,0 +1,166 @@
+//==============================================================================
+/*
+    Software License Agreement (BSD License)
+    Copyright (c) 2003-2016, CHAI3D.
+    (www.chai3d.org)
+
+    All rights reserved.
+
+    Redistribution and use in source and binary forms, with or without
+    modification, are permitted provided that the following conditions
+    are met:
+
+    * Redistributions of source code must retain the above copyright
+    notice, this list of conditions and the following disclaimer.
+
+    * Redistributions in binary form must reproduce the above
+    copyright notice, this list of conditions and the following
+    disclaimer in the documentation and/or other materials provided
+    with the distribution.
+
+    * Neither the name of CHAI3D nor the names of its contributors may
+    be used to endorse or promote products derived from this software
+    without specific prior written permission.
+
+    THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS
+    "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT
+    LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS
+    FOR A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE
+    COPYRIGHT OWNER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT,
+    INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING,
+    BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES;
+    LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER
+    CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT
+    LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN
+    ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+    POSSIBILITY OF SUCH DAMAGE. 
+
+    \author    <http://www.chai3d.org>
+    \version   3.2.0 $Rev: 2182 $
+*/
+//==============================================================================
+
+//------------------------------------------------------------------------------
+#include "system/CAllocationCounter.h"
+//------------------------------------------------------------------------------
+#include <cstdlib>
+#include <new>
+//------------------------------------------------------------------------------
+
+//------------------------------------------------------------------------------
+namespace chai3d {
+//------------------------------------------------------------------------------
+
+#if defined(C_USE_ALLOCATION_COUNTER)
+
+//! Number of heap allocations made by each thread.
+static thread_local unsigned long long s_allocationCount = 0;
+
+#endif
+
+
+//==============================================================================
+/*!
+    This function returns the number of heap allocations made by the calling 
+    thread since it started. If __C_USE_ALLOCATION_COUNTER__ is not defined, 
+    allocations are not counted and the function returns 0.
+
+    \return Number of heap allocations made by the calling thread.
+*/
+//==============================================================================
+unsigned long long cGetAllocationCount()
+{
+#if defined(C_USE_ALLOCATION_COUNTER)
+    return (s_allocationCount);
+#else
+    return (0);
+#endif
+}
+
+
+#if defined(C_USE_ALLOCATION_COUNTER)
+
+//==============================================================================
+/*!
+    This function allocates heap memory and counts the allocation for the 
+    calling thread.
+
+    \param  a_size  Size of memory block.
+
+    \return Pointer to memory block, or __nullptr__ if allocation fails.
+*/
+//==============================================================================
+static void* cCountedAllocate(std::size_t a_size)
+{
+    s_allocationCount++;
+    return (std::malloc((a_size > 0) ? a_size : 1));
+}
+
+#endif
+
+//------------------------------------------------------------------------------
+} // namespace chai3d
+//------------------------------------------------------------------------------
+
+
+#if defined(C_USE_ALLOCATION_COUNTER)
+
+//------------------------------------------------------------------------------
+// GLOBAL ALLOCATION OPERATORS
+//------------------------------------------------------------------------------
+
+void* operator new(std::size_t a_size)
+{
+    void* ptr = chai3d::cCountedAllocate(a_size);
+    if (ptr == nullptr) { throw std::bad_alloc(); }
+    return (ptr);
+}
+
+void* operator new[](std::size_t a_size)
+{
+    void* ptr = chai3d::cCountedAllocate(a_size);
+    if (ptr == nullptr) { throw std::bad_alloc(); }
+    return (ptr);
+}
+
+void* operator new(std::size_t a_size, const std::nothrow_t&) noexcept
+{
+    return (chai3d::cCountedAllocate(a_size));
+}
+
+void* operator new[](std::size_t a_size, const std::nothrow_t&) noexcept
+{
+    return (chai3d::cCountedAllocate(a_size));
+}
+
+void operator delete(void* a_ptr) noexcept
+{
+    std::free(a_ptr);
+}
+
+void operator delete[](void* a_ptr) noexcept
+{
+    std::free(a_ptr);
+}
+
+void operator delete(void* a_ptr, std::size_t) noexcept
+{
+    std::free(a_ptr);
+}
+
+void operator delete[](void* a_ptr, std::size_t) noexcept
+{
+    std::free(a_ptr);
+}
+
+void operator delete(void* a_ptr, const std::nothrow_t&) noexcept
+{
+    std::free(a_ptr);
+}
+
+void operator delete[](void* a_ptr, const std::nothrow_t&) noexcept
+{
+    std::free(a_ptr);
+}
+
+#endif
@@ -0,0 +1,134 @@
+//==============================================================================
+/*
+    Software License Agreement (BSD License)
+    Copyright (c) 2003-2016, CHAI3D.
+    (www.chai3d.org)
+
+    All rights reserved.
+
+    Redistribution and use in source and binary forms, with or without
+    modification, are permitted provided that the following conditions
+    are met:
+
+    * Redistributions of source code must retain the above copyright
+    notice, this list of conditions and the following disclaimer.
+
+    * Redistributions in binary form must reproduce the above
+    copyright notice, this list of conditions and the following
+    disclaimer in the documentation and/or other materials provided
+    with the distribution.
+
+    * Neither the name of CHAI3D nor the names of its contributors may
+    be used to endorse or promote products derived from this software
+    without specific prior written permission.
+
+    THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS
+    "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT
+    LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS
+    FOR A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE
+    COPYRIGHT OWNER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT,
+    INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING,
+    BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES;
+    LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER
+    CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT
+    LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN
+    ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+    POSSIBILITY OF SUCH DAMAGE. 
+
+    \author    <http://www.chai3d.org>
+    \version   3.2.0 $Rev: 2182 $
+*/
+//==============================================================================
+
+//------------------------------------------------------------------------------
+#ifndef CAllocationCounterH
+#define CAllocationCounterH
+//------------------------------------------------------------------------------
+#include "system/CGlobals.h"
+//------------------------------------------------------------------------------
+#include <cassert>
+//------------------------------------------------------------------------------
+
+//------------------------------------------------------------------------------
+namespace chai3d {
+//------------------------------------------------------------------------------
+
+//==============================================================================
+/*!
+    \file       CAllocationCounter.h
+    \ingroup    system
+
+    \brief
+    Implements a counter of heap allocations for debugging real-time loops.
+
+    \details
+    When __C_USE_ALLOCATION_COUNTER__ is defined (it is not by default, see 
+    __CGlobals.h__), CHAI3D replaces the global __operator new__ and counts 
+    the allocations made by each thread. Code that must not allocate memory, 
+    such as the haptic loop, declares a \ref C_ASSERT_NO_ALLOCATION scope which 
+    asserts that the calling thread has not allocated any memory when the 
+    scope ends. Otherwise, the macro compiles to nothing.
+*/
+//==============================================================================
+
+//------------------------------------------------------------------------------
+/*!
+    \addtogroup system
+*/
+//------------------------------------------------------------------------------
+
+//@{
+
+//! This function returns the number of heap allocations made by the calling thread, or 0 if allocations are not counted.
+unsigned long long cGetAllocationCount();
+
+//@}
+
+
+//==============================================================================
+/*!
+    \class      cNoAllocationScope
+    \ingroup    system
+
+    \brief
+    This class asserts that no heap memory is allocated within a scope.
+
+    \details
+    This class records the number of heap allocations made by the calling 
+    thread when it is created, and asserts that this number has not changed
+    when it is destroyed.
+*/
+//==============================================================================
+class cNoAllocationScope
+{
+public:
+
+    //! Constructor of cNoAllocationScope.
+    cNoAllocationScope() { m_count = cGetAllocationCount(); }
+
+    //! Destructor of cNoAllocationScope.
+    ~cNoAllocationScope() { assert((cGetAllocationCount() == m_count) && "heap memory allocated in real-time scope"); }
+
+private:
+
+    //! Number of allocations when the scope was entered.
+    unsigned long long m_count;
+};
+
+
+//------------------------------------------------------------------------------
+//! Asserts, if allocations are counted, that no heap memory is allocated until the end of the enclosing scope.
+#if defined(C_USE_ALLOCATION_COUNTER)
+#define C_ASSERT_NO_ALLOCATION cNoAllocationScope _noAllocationScope
+#else
+#define C_ASSERT_NO_ALLOCATION
+#endif
+//------------------------------------------------------------------------------
+
+//------------------------------------------------------------------------------
+} // namespace chai3d
+//------------------------------------------------------------------------------
+
+//------------------------------------------------------------------------------
+#endif
+//------------------------------------------------------------------------------
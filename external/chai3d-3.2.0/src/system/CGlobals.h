@@ -75,6 +75,9 @@
     - __C_USE_FILE_GIF__: Enable of disable external support for GIF files.\n
     - __C_USE_FILE_JPG__: Enable of disable external support for JPG files.\n
     - __C_USE_FILE_PNG__: Enable of disable external support for PNG files.\n
+    - __C_USE_ALLOCATION_COUNTER__: Enable or disable counting of heap 
+                     allocations, used to check that haptic computations do
+                     not allocate memory. Disabled by default.\n
                         
     Disabling one or more features will reduce the overall capabilities of 
     CHAI3D and may affect some of the examples provided with the framework.
@@ -129,6 +132,12 @@
 // Enable of disable external support for PNG files.
 #define C_USE_FILE_PNG 
 
+// ALLOCATION COUNTER
+// Enable or disable counting of heap allocations. When enabled, the global
+// operator new is replaced and haptic computations assert that they do not
+// allocate memory (see CAllocationCounter.h). Disabled by default.
+// #define C_USE_ALLOCATION_COUNTER
+
 
 //==============================================================================
 // OPERATING SYSTEM SPECIFIC
@@ -0,0 +1,493 @@
+//==============================================================================
+/*
+    Software License Agreement (BSD License)
+    Copyright (c) 2003-2016, CHAI3D.
+    (www.chai3d.org)
+
+    All rights reserved.
+
+    Redistribution and use in source and binary forms, with or without
+    modification, are permitted provided that the following conditions
+    are met:
+
+    * Redistributions of source code must retain the above copyright
+    notice, this list of conditions and the following disclaimer.
+
+    * Redistributions in binary form must reproduce the above
+    copyright notice, this list of conditions and the following
+    disclaimer in the documentation and/or other materials provided
+    with the distribution.
+
+    * Neither the name of CHAI3D nor the names of its contributors may
+    be used to endorse or promote products derived from this software
+    without specific prior written permission.
+
+    THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS
+    "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT
+    LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS
+    FOR A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE
+    COPYRIGHT OWNER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT,
+    INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING,
+    BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES;
+    LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER
+    CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT
+    LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN
+    ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+    POSSIBILITY OF SUCH DAMAGE. 
+
+    \author    <http://www.chai3d.org>
+    \version   3.2.0 $Rev: 2182 $
+*/
+//==============================================================================
+
+
+//------------------------------------------------------------------------------
+#include "system/CRealtimeScheduler.h"
+#include "timers/CPrecisionClock.h"
+#include "math/CMaths.h"
+//------------------------------------------------------------------------------
+#if defined(WIN32) | defined(WIN64)
+#include <mmsystem.h>
+#ifndef CREATE_WAITABLE_TIMER_HIGH_RESOLUTION
+#define CREATE_WAITABLE_TIMER_HIGH_RESOLUTION 0x00000002
+#endif
+#endif
+#if defined(LINUX)
+#include <sched.h>
+#include <cerrno>
+#endif
+//------------------------------------------------------------------------------
+
+//------------------------------------------------------------------------------
+namespace chai3d {
+//------------------------------------------------------------------------------
+
+//------------------------------------------------------------------------------
+// hint to the processor that the calling thread is spinning
+static inline void cSpinPause()
+{
+#if defined(WIN32) | defined(WIN64)
+    YieldProcessor();
+#elif defined(__i386__) || defined(__x86_64__)
+    __builtin_ia32_pause();
+#endif
+}
+//------------------------------------------------------------------------------
+
+
+//==============================================================================
+/*!
+    Constructor of cRealtimeScheduler.
+
+    \param  a_rate  Loop rate in Hz.
+*/
+//==============================================================================
+cRealtimeScheduler::cRealtimeScheduler(const double a_rate)
+{
+    m_period = 0.001;
+    setRate(a_rate);
+    m_spinWindow = 0.0002;
+    m_cpu = -1;
+    m_realtimePriority = true;
+    m_deadline = 0.0;
+    m_ticking = false;
+
+#if defined(WIN32) | defined(WIN64)
+    m_timer = NULL;
+    m_timerPeriodSet = false;
+#endif
+
+    m_tickFunction = NULL;
+    m_tickArg = NULL;
+    m_running = false;
+    m_finished = true;
+    m_resetRequest = false;
+
+    m_tickCount = 0;
+    m_overrunCount = 0;
+    m_maxJitter = 0;
+    for (int i=0; i<C_SCHEDULER_JITTER_BINS; i++)
+    {
+        m_jitterHistogram[i] = 0;
+    }
+}
+
+
+//==============================================================================
+/*!
+    Destructor of cRealtimeScheduler.
+*/
+//==============================================================================
+cRealtimeScheduler::~cRealtimeScheduler()
+{
+    stopPeriodic();
+
+#if defined(WIN32) | defined(WIN64)
+    if (m_timer != NULL)
+    {
+        CloseHandle(m_timer);
+    }
+    if (m_timerPeriodSet)
+    {
+        timeEndPeriod(1);
+    }
+#endif
+}
+
+
+//==============================================================================
+/*!
+    This method sets the loop rate. It must be called before the first tick.
+
+    \param  a_rate  Loop rate in Hz.
+*/
+//==============================================================================
+void cRealtimeScheduler::setRate(const double a_rate)
+{
+    if (a_rate > 0.0)
+    {
+        m_period = 1.0 / a_rate;
+    }
+}
+
+
+//==============================================================================
+/*!
+    This method sets the duration spent spinning before each deadline. A 
+    larger window costs more CPU time but tolerates a larger wake-up latency
+    of the operating system.
+
+    \param  a_spinWindow  Spin window in seconds.
+*/
+//==============================================================================
+void cRealtimeScheduler::setSpinWindow(const double a_spinWindow)
+{
+    m_spinWindow = cMax(0.0, a_spinWindow);
+}
+
+
+//==============================================================================
+/*!
+    This method blocks the calling thread until the deadline of the next tick.
+    If the previous tick ran more than one period past its deadline, the tick 
+    is counted as an overrun and the schedule restarts from the current time
+    instead of firing the missed ticks back to back.
+
+    \return __false__ if the tick is an overrun, __true__ otherwise.
+*/
+//==============================================================================
+bool cRealtimeScheduler::waitForNextTick()
+{
+    if (!m_ticking)
+    {
+        initializeTicking();
+    }
+
+    if (m_resetRequest.exchange(false))
+    {
+        m_tickCount = 0;
+        m_overrunCount = 0;
+        m_maxJitter = 0;
+        for (int i=0; i<C_SCHEDULER_JITTER_BINS; i++)
+        {
+            m_jitterHistogram[i].store(0, std::memory_order_relaxed);
+        }
+    }
+
+    m_deadline += m_period;
+    double now = cPrecisionClock::getCPUTimeSeconds();
+
+    // the deadline has already passed by more than a period
+    if (now - m_deadline > m_period)
+    {
+        recordJitter(now - m_deadline, true);
+        m_deadline = now;
+        return (false);
+    }
+
+    // sleep until the spin window, then spin until the deadline
+    if (m_deadline - now > m_spinWindow)
+    {
+        sleepUntil(m_deadline - m_spinWindow);
+    }
+    while ((now = cPrecisionClock::getCPUTimeSeconds()) < m_deadline)
+    {
+        cSpinPause();
+    }
+
+    recordJitter(now - m_deadline, false);
+    return (true);
+}
+
+
+//==============================================================================
+/*!
+    This method creates a thread that calls a function once per tick until
+    stopPeriodic() is called.
+
+    \param  a_function  Function called once per tick.
+    \param  a_arg       Argument passed to the function.
+    \param  a_level     Priority level of the thread.
+*/
+//==============================================================================
+void cRealtimeScheduler::startPeriodic(void(*a_function)(void*), void* a_arg, const CThreadPriority a_level)
+{
+    if (!m_finished)
+    {
+        return;
+    }
+
+    m_tickFunction = a_function;
+    m_tickArg = a_arg;
+    m_running = true;
+    m_finished = false;
+
+    start(periodicLoop, a_level, this);
+}
+
+
+//==============================================================================
+/*!
+    This method requests the periodic thread to terminate and waits until the
+    current tick has completed.
+*/
+//==============================================================================
+void cRealtimeScheduler::stopPeriodic()
+{
+    m_running = false;
+    while (!m_finished)
+    {
+        cSleepMs(1);
+    }
+}
+
+
+//==============================================================================
+/*!
+    This method returns the tick lateness below which a given fraction of the
+    recorded ticks fall, at the resolution of the jitter histogram.
+
+    \param  a_fraction  Fraction of ticks between 0 and 1 (0.99 for the 99th percentile).
+
+    \return Tick lateness in seconds.
+*/
+//==============================================================================
+double cRealtimeScheduler::getJitterPercentile(const double a_fraction) const
+{
+    unsigned int bins[C_SCHEDULER_JITTER_BINS];
+    getJitterHistogram(bins);
+
+    double total = 0.0;
+    for (int i=0; i<C_SCHEDULER_JITTER_BINS; i++)
+    {
+        total += bins[i];
+    }
+    if (total == 0.0)
+    {
+        return (0.0);
+    }
+
+    double count = 0.0;
+    for (int i=0; i<C_SCHEDULER_JITTER_BINS; i++)
+    {
+        count += bins[i];
+        if (count >= a_fraction * total)
+        {
+            return ((i + 1) * C_SCHEDULER_JITTER_BIN_WIDTH);
+        }
+    }
+
+    return (getMaxJitter());
+}
+
+
+//==============================================================================
+/*!
+    This method copies the tick jitter histogram. Bin __i__ counts the ticks
+    whose lateness lies between __i__ and __i+1__ times 
+    __C_SCHEDULER_JITTER_BIN_WIDTH__. The last bin collects all larger values.
+
+    \param  a_bins  Array of __C_SCHEDULER_JITTER_BINS__ values.
+*/
+//==============================================================================
+void cRealtimeScheduler::getJitterHistogram(unsigned int* a_bins) const
+{
+    for (int i=0; i<C_SCHEDULER_JITTER_BINS; i++)
+    {
+        a_bins[i] = m_jitterHistogram[i].load(std::memory_order_relaxed);
+    }
+}
+
+
+//==============================================================================
+/*!
+    This method binds the calling thread to the requested CPU, raises it to
+    real-time priority, creates the timer, and schedules the first tick one
+    period from now.
+*/
+//==============================================================================
+void cRealtimeScheduler::initializeTicking()
+{
+#if defined(WIN32) | defined(WIN64)
+
+    if (m_cpu >= 0)
+    {
+        SetThreadAffinityMask(GetCurrentThread(), ((DWORD_PTR)1) << m_cpu);
+    }
+
+    if (m_realtimePriority)
+    {
+        SetThreadPriority(GetCurrentThread(), THREAD_PRIORITY_TIME_CRITICAL);
+    }
+
+    // high resolution timers are available from Windows 10 1803 on; older
+    // systems fall back to a regular timer with a 1 ms system timer period
+    m_timer = CreateWaitableTimerExW(NULL, NULL, CREATE_WAITABLE_TIMER_HIGH_RESOLUTION, TIMER_ALL_ACCESS);
+    if (m_timer == NULL)
+    {
+        m_timer = CreateWaitableTimer(NULL, TRUE, NULL);
+        m_timerPeriodSet = (timeBeginPeriod(1) == TIMERR_NOERROR);
+    }
+
+#endif
+
+#if defined(LINUX)
+
+    if (m_cpu >= 0)
+    {
+        cpu_set_t cpus;
+        CPU_ZERO(&cpus);
+        CPU_SET(m_cpu, &cpus);
+        pthread_setaffinity_np(pthread_self(), sizeof(cpu_set_t), &cpus);
+    }
+
+#endif
+
+#if defined(LINUX) || defined(MACOSX)
+
+    if (m_realtimePriority)
+    {
+        struct sched_param sp;
+        sp.sched_priority = sched_get_priority_max(SCHED_FIFO);
+        pthread_setschedparam(pthread_self(), SCHED_FIFO, &sp);
+    }
+
+#endif
+
+    m_deadline = cPrecisionClock::getCPUTimeSeconds();
+    m_ticking = true;
+}
+
+
+//==============================================================================
+/*!
+    This method puts the calling thread to sleep until a given time.
+
+    \param  a_time  Wake-up time in seconds on the clock of 
+                    cPrecisionClock::getCPUTimeSeconds().
+*/
+//==============================================================================
+void cRealtimeScheduler::sleepUntil(const double a_time)
+{
+#if defined(WIN32) | defined(WIN64)
+
+    // waitable timers take absolute times on the system clock only, so the
+    // deadline is converted to a relative due time (negative, in 100 ns units)
+    double remaining = a_time - cPrecisionClock::getCPUTimeSeconds();
+    if (remaining <= 0.0)
+    {
+        return;
+    }
+
+    if (m_timer != NULL)
+    {
+        LARGE_INTEGER due;
+        due.QuadPart = -(LONGLONG)(remaining * 1e7);
+        if (SetWaitableTimer(m_timer, &due, 0, NULL, NULL, FALSE))
+        {
+            WaitForSingleObject(m_timer, INFINITE);
+            return;
+        }
+    }
+    Sleep((DWORD)(remaining * 1000.0));
+
+#endif
+
+#if defined(LINUX)
+
+    // cPrecisionClock uses CLOCK_MONOTONIC on Linux
+    struct timespec deadline;
+    deadline.tv_sec = (time_t)a_time;
+    deadline.tv_nsec = (long)((a_time - (double)deadline.tv_sec) * 1e9);
+    while (clock_nanosleep(CLOCK_MONOTONIC, TIMER_ABSTIME, &deadline, NULL) == EINTR) {}
+
+#endif
+
+#if defined(MACOSX)
+
+    double remaining = a_time - cPrecisionClock::getCPUTimeSeconds();
+    if (remaining > 0.0)
+    {
+        struct timespec duration;
+        duration.tv_sec = (time_t)remaining;
+        duration.tv_nsec = (long)((remaining - (double)duration.tv_sec) * 1e9);
+        nanosleep(&duration, NULL);
+    }
+
+#endif
+}
+
+
+//==============================================================================
+/*!
+    This method records the lateness of a tick in the statistics.
+
+    \param  a_lateness  Time between the deadline and the start of the tick in seconds.
+    \param  a_overrun   __true__ if the tick is an overrun.
+*/
+//==============================================================================
+void cRealtimeScheduler::recordJitter(const double a_lateness, const bool a_overrun)
+{
+    // the counters are only written by the loop thread
+    m_tickCount.store(m_tickCount.load(std::memory_order_relaxed) + 1, std::memory_order_relaxed);
+    if (a_overrun)
+    {
+        m_overrunCount.store(m_overrunCount.load(std::memory_order_relaxed) + 1, std::memory_order_relaxed);
+    }
+
+    double lateness = cClamp(a_lateness, 0.0, 4.0);
+    unsigned int nanoseconds = (unsigned int)(lateness * 1e9);
+    if (nanoseconds > m_maxJitter.load(std::memory_order_relaxed))
+    {
+        m_maxJitter.store(nanoseconds, std::memory_order_relaxed);
+    }
+
+    int bin = cMin((int)(lateness / C_SCHEDULER_JITTER_BIN_WIDTH), C_SCHEDULER_JITTER_BINS - 1);
+    m_jitterHistogram[bin].store(m_jitterHistogram[bin].load(std::memory_order_relaxed) + 1, std::memory_order_relaxed);
+}
+
+
+//==============================================================================
+/*!
+    Thread function of startPeriodic().
+
+    \param  a_scheduler  Pointer to the scheduler.
+*/
+//==============================================================================
+void cRealtimeScheduler::periodicLoop(void* a_scheduler)
+{
+    cRealtimeScheduler* scheduler = (cRealtimeScheduler*)a_scheduler;
+
+    while (scheduler->m_running)
+    {
+        scheduler->waitForNextTick();
+        scheduler->m_tickFunction(scheduler->m_tickArg);
+    }
+
+    scheduler->m_finished = true;
+}
+
+
+//------------------------------------------------------------------------------
+} // namespace chai3d
+//------------------------------------------------------------------------------
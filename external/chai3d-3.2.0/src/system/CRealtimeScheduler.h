@@ -0,0 +1,278 @@
+//==============================================================================
+/*
+    Software License Agreement (BSD License)
+    Copyright (c) 2003-2016, CHAI3D.
+    (www.chai3d.org)
+
+    All rights reserved.
+
+    Redistribution and use in source and binary forms, with or without
+    modification, are permitted provided that the following conditions
+    are met:
+
+    * Redistributions of source code must retain the above copyright
+    notice, this list of conditions and the following disclaimer.
+
+    * Redistributions in binary form must reproduce the above
+    copyright notice, this list of conditions and the following
+    disclaimer in the documentation and/or other materials provided
+    with the distribution.
+
+    * Neither the name of CHAI3D nor the names of its contributors may
+    be used to endorse or promote products derived from this software
+    without specific prior written permission.
+
+    THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS
+    "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT
+    LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS
+    FOR A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE
+    COPYRIGHT OWNER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT,
+    INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING,
+    BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES;
+    LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER
+    CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT
+    LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN
+    ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+    POSSIBILITY OF SUCH DAMAGE. 
+
+    \author    <http://www.chai3d.org>
+    \version   3.2.0 $Rev: 2182 $
+*/
+//==============================================================================
+
+
+//------------------------------------------------------------------------------
+#ifndef CRealtimeSchedulerH
+#define CRealtimeSchedulerH
+//------------------------------------------------------------------------------
+#include "system/CThread.h"
+#include <atomic>
+//------------------------------------------------------------------------------
+
+//------------------------------------------------------------------------------
+namespace chai3d {
+//------------------------------------------------------------------------------
+
+//==============================================================================
+/*!
+    \file       CRealtimeScheduler.h
+    \ingroup    system
+
+    \brief
+    Implements a fixed rate scheduler for haptic loops.
+*/
+//==============================================================================
+
+//------------------------------------------------------------------------------
+//! Number of bins of the tick jitter histogram. The last bin collects all larger values.
+const int C_SCHEDULER_JITTER_BINS = 200;
+
+//! Width of a tick jitter histogram bin in seconds.
+const double C_SCHEDULER_JITTER_BIN_WIDTH = 1e-6;
+//------------------------------------------------------------------------------
+
+
+//==============================================================================
+/*!
+    \class      cRealtimeScheduler
+    \ingroup    system
+
+    \brief
+    This class implements a fixed rate scheduler for haptic loops.
+
+    \details
+    __cRealtimeScheduler__ paces a loop at a configured rate. Each tick has an
+    absolute deadline, so that the time spent in the loop body does not 
+    accumulate as drift. The calling thread sleeps on an operating system 
+    timer (__clock_nanosleep__ on Linux, a high resolution waitable timer on 
+    Windows) until shortly before the deadline, and then spins for the last
+    part of the period (the _spin window_) to absorb the wake-up latency of 
+    the operating system.\n
+
+    A loop that owns its thread calls waitForNextTick() once per iteration.
+    Alternatively, startPeriodic() creates a thread that calls a function
+    once per tick until stopPeriodic() is called.\n
+
+    On the first tick, the calling thread is optionally bound to a CPU and 
+    raised to real-time priority. The scheduler counts overruns (ticks that
+    started more than one period late) and records the lateness of every 
+    tick in a histogram. Statistics may be read from any thread.
+*/
+//==============================================================================
+
+class cRealtimeScheduler : public cThread
+{
+    //--------------------------------------------------------------------------
+    // CONSTRUCTOR & DESTRUCTOR:
+    //--------------------------------------------------------------------------
+
+public:
+
+    //! Constructor of cRealtimeScheduler.
+    cRealtimeScheduler(const double a_rate = 1000.0);
+
+    //! Destructor of cRealtimeScheduler.
+    virtual ~cRealtimeScheduler();
+
+
+    //--------------------------------------------------------------------------
+    // PUBLIC METHODS - SETTINGS:
+    //--------------------------------------------------------------------------
+
+public:
+
+    //! This method sets the loop rate in Hz. It must be called before the first tick.
+    void setRate(const double a_rate);
+
+    //! This method returns the loop rate in Hz.
+    double getRate() const { return (1.0 / m_period); }
+
+    //! This method returns the loop period in seconds.
+    double getPeriod() const { return (m_period); }
+
+    //! This method sets the duration in seconds spent spinning before each deadline.
+    void setSpinWindow(const double a_spinWindow);
+
+    //! This method returns the duration in seconds spent spinning before each deadline.
+    double getSpinWindow() const { return (m_spinWindow); }
+
+    //! This method sets the CPU the loop thread is bound to (-1 for no binding).
+    void setAffinity(const int a_cpu) { m_cpu = a_cpu; }
+
+    //! This method returns the CPU the loop thread is bound to (-1 for no binding).
+    int getAffinity() const { return (m_cpu); }
+
+    //! This method enables or disables real-time priority for the loop thread.
+    void setRealtimePriority(const bool a_enabled) { m_realtimePriority = a_enabled; }
+
+
+    //--------------------------------------------------------------------------
+    // PUBLIC METHODS - SCHEDULING:
+    //--------------------------------------------------------------------------
+
+public:
+
+    //! This method blocks the calling thread until the next tick. It returns __false__ if the tick is an overrun.
+    bool waitForNextTick();
+
+    //! This method creates a thread that calls a function once per tick.
+    void startPeriodic(void(*a_function)(void*), void* a_arg = NULL, const CThreadPriority a_level = CTHREAD_PRIORITY_HAPTICS);
+
+    //! This method requests the periodic thread to terminate and waits until it has.
+    void stopPeriodic();
+
+    //! This method returns __true__ if the periodic thread is running.
+    bool isRunning() const { return (!m_finished); }
+
+
+    //--------------------------------------------------------------------------
+    // PUBLIC METHODS - STATISTICS:
+    //--------------------------------------------------------------------------
+
+public:
+
+    //! This method returns the number of ticks since the last reset.
+    unsigned int getTickCount() const { return (m_tickCount.load(std::memory_order_relaxed)); }
+
+    //! This method returns the number of overruns since the last reset.
+    unsigned int getOverrunCount() const { return (m_overrunCount.load(std::memory_order_relaxed)); }
+
+    //! This method returns the largest tick lateness in seconds since the last reset.
+    double getMaxJitter() const { return (1e-9 * m_maxJitter.load(std::memory_order_relaxed)); }
+
+    //! This method returns the tick lateness in seconds below which a given fraction of the ticks fall.
+    double getJitterPercentile(const double a_fraction) const;
+
+    //! This method copies the tick jitter histogram (__C_SCHEDULER_JITTER_BINS__ values).
+    void getJitterHistogram(unsigned int* a_bins) const;
+
+    //! This method requests the statistics to be cleared by the loop thread.
+    void resetStatistics() { m_resetRequest = true; }
+
+
+    //--------------------------------------------------------------------------
+    // PROTECTED METHODS:
+    //--------------------------------------------------------------------------
+
+protected:
+
+    //! This method sets up the calling thread and the timer on the first tick.
+    void initializeTicking();
+
+    //! This method sleeps until a_time seconds (on the clock of cPrecisionClock::getCPUTimeSeconds()).
+    void sleepUntil(const double a_time);
+
+    //! This method records the lateness of a tick.
+    void recordJitter(const double a_lateness, const bool a_overrun);
+
+    //! Thread function of startPeriodic().
+    static void periodicLoop(void* a_scheduler);
+
+
+    //--------------------------------------------------------------------------
+    // PROTECTED MEMBERS:
+    //--------------------------------------------------------------------------
+
+protected:
+
+    //! Loop period in seconds.
+    double m_period;
+
+    //! Duration spent spinning before each deadline in seconds.
+    double m_spinWindow;
+
+    //! CPU the loop thread is bound to (-1 for no binding).
+    int m_cpu;
+
+    //! If __true__, the loop thread is raised to real-time priority.
+    bool m_realtimePriority;
+
+    //! Absolute deadline of the current tick in seconds.
+    double m_deadline;
+
+    //! If __true__, the first tick has been scheduled.
+    bool m_ticking;
+
+#if defined(WIN32) | defined(WIN64)
+    //! Waitable timer of the loop thread.
+    HANDLE m_timer;
+
+    //! If __true__, the system timer resolution has been raised to 1 ms.
+    bool m_timerPeriodSet;
+#endif
+
+    //! Function called by the periodic thread.
+    void(*m_tickFunction)(void*);
+
+    //! Argument passed to the function called by the periodic thread.
+    void* m_tickArg;
+
+    //! If __true__, the periodic thread keeps running.
+    std::atomic<bool> m_running;
+
+    //! If __true__, the periodic thread has terminated (or was never started).
+    std::atomic<bool> m_finished;
+
+    //! If __true__, the loop thread clears the statistics on the next tick.
+    std::atomic<bool> m_resetRequest;
+
+    //! Number of ticks since the last reset.
+    std::atomic<unsigned int> m_tickCount;
+
+    //! Number of overruns since the last reset.
+    std::atomic<unsigned int> m_overrunCount;
+
+    //! Largest tick lateness since the last reset in nanoseconds.
+    std::atomic<unsigned int> m_maxJitter;
+
+    //! Tick jitter histogram.
+    std::atomic<unsigned int> m_jitterHistogram[C_SCHEDULER_JITTER_BINS];
+};
+
+//------------------------------------------------------------------------------
+} // namespace chai3d
+//------------------------------------------------------------------------------
+
+//------------------------------------------------------------------------------
+#endif
+//------------------------------------------------------------------------------
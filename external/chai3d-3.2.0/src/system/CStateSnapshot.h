@@ -0,0 +1,204 @@
+//==============================================================================
+/*
+    Software License Agreement (BSD License)
+    Copyright (c) 2003-2016, CHAI3D.
+    (www.chai3d.org)
+
+    All rights reserved.
+
+    Redistribution and use in source and binary forms, with or without
+    modification, are permitted provided that the following conditions
+    are met:
+
+    * Redistributions of source code must retain the above copyright
+    notice, this list of conditions and the following disclaimer.
+
+    * Redistributions in binary form must reproduce the above
+    copyright notice, this list of conditions and the following
+    disclaimer in the documentation and/or other materials provided
+    with the distribution.
+
+    * Neither the name of CHAI3D nor the names of its contributors may
+    be used to endorse or promote products derived from this software
+    without specific prior written permission.
+
+    THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS
+    "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT
+    LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS
+    FOR A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE
+    COPYRIGHT OWNER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT,
+    INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING,
+    BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES;
+    LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER
+    CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT
+    LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN
+    ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+    POSSIBILITY OF SUCH DAMAGE. 
+
+    \author    <http://www.chai3d.org>
+    \version   3.2.0 $Rev: 2182 $
+*/
+//==============================================================================
+
+
+
+//------------------------------------------------------------------------------
+#ifndef CStateSnapshotH
+#define CStateSnapshotH
+//------------------------------------------------------------------------------
+#include <atomic>
+//------------------------------------------------------------------------------
+
+//------------------------------------------------------------------------------
+namespace chai3d {
+//------------------------------------------------------------------------------
+
+//==============================================================================
+/*!
+    \file       CStateSnapshot.h
+    \ingroup    system
+
+    \brief
+    Implements a lock-free snapshot of a state shared between two threads.
+*/
+//==============================================================================
+
+//==============================================================================
+/*!
+    \class      cStateSnapshot
+    \ingroup    system
+
+    \brief
+    This class passes the latest state of a thread to another thread without
+    locks.
+
+    \details
+    cStateSnapshot is a triple buffer with a single writer and a single 
+    reader. The writer fills a private buffer and publishes it; the reader
+    takes the most recently published buffer. The third buffer is exchanged 
+    atomically between the two, so that:\n
+
+    - the writer never waits for the reader, which is what a haptic loop 
+      needs when the reader is a graphics loop that may block.\n
+    - the reader always sees a complete state written by a single publish(),
+      never a mix of two updates.\n
+    - intermediate states are dropped when the writer is faster than the 
+      reader.\n
+
+    Unlike a seqlock, the reader never retries, and __T__ may be any 
+    copyable type, including types that allocate memory such as 
+    __std::vector__.\n
+
+    The writer either publishes a copy of a state with publish(value), or
+    writes in place into edit() and then calls publish(). The buffer 
+    returned by edit() holds an older state, so in-place writers must 
+    update every field. The reader calls update() and then get(), or 
+    read().\n
+
+    Only one thread may write and only one thread may read.
+*/
+//==============================================================================
+template <typename T>
+class cStateSnapshot
+{
+    //--------------------------------------------------------------------------
+    // CONSTRUCTOR & DESTRUCTOR:
+    //--------------------------------------------------------------------------
+
+public:
+
+    //! Constructor of cStateSnapshot.
+    cStateSnapshot() { reset(T()); }
+
+    //! Constructor of cStateSnapshot with an initial state.
+    cStateSnapshot(const T& a_state) { reset(a_state); }
+
+    //! Destructor of cStateSnapshot.
+    virtual ~cStateSnapshot() {}
+
+
+    //--------------------------------------------------------------------------
+    // PUBLIC METHODS - WRITER:
+    //--------------------------------------------------------------------------
+
+public:
+
+    //! This method returns the buffer of the writer. It holds an older state until all its fields are updated.
+    T& edit() { return (m_buffers[m_write]); }
+
+    //! This method publishes the buffer of the writer.
+    void publish() { m_write = m_middle.exchange(m_write | C_FRESH, std::memory_order_acq_rel) & C_INDEX; }
+
+    //! This method publishes a copy of a state.
+    void publish(const T& a_state) { m_buffers[m_write] = a_state; publish(); }
+
+
+    //--------------------------------------------------------------------------
+    // PUBLIC METHODS - READER:
+    //--------------------------------------------------------------------------
+
+public:
+
+    //! This method takes the latest published state, if any. Returns __true__ if a new state was taken.
+    bool update()
+    {
+        if (!(m_middle.load(std::memory_order_acquire) & C_FRESH)) { return (false); }
+        m_read = m_middle.exchange(m_read, std::memory_order_acq_rel) & C_INDEX;
+        return (true);
+    }
+
+    //! This method returns the state taken by the last update().
+    const T& get() const { return (m_buffers[m_read]); }
+
+    //! This method copies the latest published state. Returns __true__ if the state is new.
+    bool read(T& a_state) { bool result = update(); a_state = m_buffers[m_read]; return (result); }
+
+
+    //--------------------------------------------------------------------------
+    // PUBLIC METHODS - SETUP:
+    //--------------------------------------------------------------------------
+
+public:
+
+    //! This method sets all buffers to a state. It must not be called while either thread uses the snapshot.
+    void reset(const T& a_state)
+    {
+        for (int i=0; i<3; i++) { m_buffers[i] = a_state; }
+        m_write = 0;
+        m_read = 1;
+        m_middle.store(2, std::memory_order_release);
+    }
+
+
+    //--------------------------------------------------------------------------
+    // PROTECTED MEMBERS:
+    //--------------------------------------------------------------------------
+
+protected:
+
+    //! Mask of the buffer index in __m_middle__.
+    static const int C_INDEX = 3;
+
+    //! Flag set in __m_middle__ when the middle buffer holds a state not yet taken by the reader.
+    static const int C_FRESH = 4;
+
+    //! Buffers.
+    T m_buffers[3];
+
+    //! Buffer of the writer.
+    int m_write;
+
+    //! Buffer of the reader.
+    int m_read;
+
+    //! Buffer exchanged between the threads, and fresh flag.
+    std::atomic<int> m_middle;
+};
+
+//------------------------------------------------------------------------------
+} // namespace chai3d
+//------------------------------------------------------------------------------
+
+//------------------------------------------------------------------------------
+#endif
+//------------------------------------------------------------------------------
@@ -0,0 +1,296 @@
+//==============================================================================
+/*
+    Software License Agreement (BSD License)
+    Copyright (c) 2003-2016, CHAI3D.
+    (www.chai3d.org)
+
+    All rights reserved.
+
+    Redistribution and use in source and binary forms, with or without
+    modification, are permitted provided that the following conditions
+    are met:
+
+    * Redistributions of source code must retain the above copyright
+    notice, this list of conditions and the following disclaimer.
+
+    * Redistributions in binary form must reproduce the above
+    copyright notice, this list of conditions and the following
+    disclaimer in the documentation and/or other materials provided
+    with the distribution.
+
+    * Neither the name of CHAI3D nor the names of its contributors may
+    be used to endorse or promote products derived from this software
+    without specific prior written permission.
+
+    THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS
+    "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT
+    LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS
+    FOR A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE
+    COPYRIGHT OWNER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT,
+    INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING,
+    BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES;
+    LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER
+    CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT
+    LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN
+    ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+    POSSIBILITY OF SUCH DAMAGE. 
+
+    \author    <http://www.chai3d.org>
+    \version   3.2.0 $Rev: 2182 $
+*/
+//==============================================================================
+
+
+//------------------------------------------------------------------------------
+#include "timers/CPhaseProfiler.h"
+#include "system/CString.h"
+#include <fstream>
+//------------------------------------------------------------------------------
+
+//------------------------------------------------------------------------------
+namespace chai3d {
+//------------------------------------------------------------------------------
+
+//==============================================================================
+/*!
+    Constructor of cPhaseProfiler.
+*/
+//==============================================================================
+cPhaseProfiler::cPhaseProfiler()
+{
+    for (int i=0; i<C_PROFILER_MAX_PHASES; i++)
+    {
+        m_phases[i].m_count = 0;
+        m_phases[i].m_sum = 0;
+        m_phases[i].m_max = 0;
+        for (int j=0; j<C_PROFILER_BINS; j++)
+        {
+            m_phases[i].m_bins[j] = 0;
+        }
+    }
+    m_numPhases = 0;
+
+    // calibrate the cycle counter before the real-time loops start
+    getCycleDuration();
+}
+
+
+//==============================================================================
+/*!
+    This method names a phase. Phases are numbered from 0, typically with an
+    enumeration defined by the application.
+
+    \param  a_phase  Phase number (smaller than __C_PROFILER_MAX_PHASES__).
+    \param  a_name   Name of the phase.
+*/
+//==============================================================================
+void cPhaseProfiler::setPhaseName(const int a_phase, const std::string& a_name)
+{
+    if ((a_phase < 0) || (a_phase >= C_PROFILER_MAX_PHASES))
+    {
+        return;
+    }
+
+    m_names[a_phase] = a_name;
+    if (a_phase >= m_numPhases)
+    {
+        m_numPhases = a_phase + 1;
+    }
+}
+
+
+//==============================================================================
+/*!
+    This method copies the statistics of all named phases. Samples recorded
+    while the snapshot is taken may be partially included.
+
+    \param  a_statistics  Statistics, one entry per phase.
+*/
+//==============================================================================
+void cPhaseProfiler::getSnapshot(std::vector<cPhaseStatistics>& a_statistics) const
+{
+    double cycle = getCycleDuration();
+
+    a_statistics.resize(m_numPhases);
+    for (int i=0; i<m_numPhases; i++)
+    {
+        const Phase& phase = m_phases[i];
+        cPhaseStatistics& statistics = a_statistics[i];
+
+        statistics.m_name = m_names[i];
+        statistics.m_count = phase.m_count.load(std::memory_order_acquire);
+        statistics.m_max = cycle * phase.m_max.load(std::memory_order_relaxed);
+        statistics.m_mean = 0.0;
+        statistics.m_p50 = 0.0;
+        statistics.m_p99 = 0.0;
+        if (statistics.m_count == 0)
+        {
+            continue;
+        }
+        statistics.m_mean = cycle * phase.m_sum.load(std::memory_order_relaxed) / statistics.m_count;
+
+        unsigned int bins[C_PROFILER_BINS];
+        double total = 0.0;
+        for (int j=0; j<C_PROFILER_BINS; j++)
+        {
+            bins[j] = phase.m_bins[j].load(std::memory_order_relaxed);
+            total += bins[j];
+        }
+
+        double count = 0.0;
+        bool median = false;
+        for (int j=0; j<C_PROFILER_BINS; j++)
+        {
+            count += bins[j];
+            if (!median && (count >= 0.5 * total))
+            {
+                statistics.m_p50 = cycle * getBinCenter(j);
+                median = true;
+            }
+            if (count >= 0.99 * total)
+            {
+                statistics.m_p99 = cycle * getBinCenter(j);
+                break;
+            }
+        }
+    }
+}
+
+
+//==============================================================================
+/*!
+    This method returns one line of text per phase with its median, 99th 
+    percentile and largest latencies in microseconds, for display in a 
+    __cLabel__.
+
+    \return Summary text.
+*/
+//==============================================================================
+std::string cPhaseProfiler::getSummary() const
+{
+    std::vector<cPhaseStatistics> statistics;
+    getSnapshot(statistics);
+
+    std::string text;
+    for (unsigned int i=0; i<statistics.size(); i++)
+    {
+        if (statistics[i].m_count == 0)
+        {
+            continue;
+        }
+        text += statistics[i].m_name + 
+                "  p50 " + cStr(1e6 * statistics[i].m_p50, 1) +
+                "  p99 " + cStr(1e6 * statistics[i].m_p99, 1) +
+                "  max " + cStr(1e6 * statistics[i].m_max, 1) + " us\n";
+    }
+
+    return (text);
+}
+
+
+//==============================================================================
+/*!
+    This method writes the statistics of all phases to a CSV file, one row 
+    per phase, followed by the histogram counts of each phase. Latencies are
+    in microseconds.
+
+    \param  a_filename  Name of the file.
+
+    \return __true__ if the file was written, __false__ otherwise.
+*/
+//==============================================================================
+bool cPhaseProfiler::saveCSV(const std::string& a_filename) const
+{
+    std::ofstream file(a_filename.c_str());
+    if (!file)
+    {
+        return (false);
+    }
+
+    std::vector<cPhaseStatistics> statistics;
+    getSnapshot(statistics);
+
+    file << "phase,count,mean_us,p50_us,p99_us,max_us\n";
+    for (unsigned int i=0; i<statistics.size(); i++)
+    {
+        file << statistics[i].m_name << "," << statistics[i].m_count << "," << 
+                1e6 * statistics[i].m_mean << "," << 1e6 * statistics[i].m_p50 << "," <<
+                1e6 * statistics[i].m_p99 << "," << 1e6 * statistics[i].m_max << "\n";
+    }
+
+    // histograms: one row per non-empty bin
+    double cycle = getCycleDuration();
+    file << "\nphase,bin_center_us,count\n";
+    for (int i=0; i<m_numPhases; i++)
+    {
+        for (int j=0; j<C_PROFILER_BINS; j++)
+        {
+            unsigned int count = m_phases[i].m_bins[j].load(std::memory_order_relaxed);
+            if (count > 0)
+            {
+                file << m_names[i] << "," << 1e6 * cycle * getBinCenter(j) << "," << count << "\n";
+            }
+        }
+    }
+
+    return (file.good());
+}
+
+
+//==============================================================================
+/*!
+    This method returns the duration of a CPU cycle, as counted by 
+    readCycles(). The time stamp counter is calibrated against 
+    __cPrecisionClock__ on the first call, which takes 10 ms.
+
+    \return Duration of a cycle in seconds.
+*/
+//==============================================================================
+double cPhaseProfiler::getCycleDuration()
+{
+    static double duration = 0.0;
+
+    if (duration == 0.0)
+    {
+#if defined(_MSC_VER) || defined(__i386__) || defined(__x86_64__)
+        double startTime = cPrecisionClock::getCPUTimeSeconds();
+        unsigned long long startCycles = readCycles();
+        double time;
+        while ((time = cPrecisionClock::getCPUTimeSeconds()) - startTime < 0.01) {}
+        unsigned long long cycles = readCycles() - startCycles;
+        duration = (time - startTime) / (double)cycles;
+#else
+        duration = 1e-9;
+#endif
+    }
+
+    return (duration);
+}
+
+
+//==============================================================================
+/*!
+    This method returns the center of a histogram bin.
+
+    \param  a_bin  Histogram bin.
+
+    \return Center of the bin in CPU cycles.
+*/
+//==============================================================================
+double cPhaseProfiler::getBinCenter(const int a_bin)
+{
+    if (a_bin < 8)
+    {
+        return ((double)a_bin);
+    }
+
+    // bins above 8 cycles span 1/8 of an octave
+    int msb = a_bin / 8 + 2;
+    int sub = a_bin % 8;
+    return ((8.0 + sub + 0.5) * (double)(1ULL << (msb - 3)));
+}
+
+
+//------------------------------------------------------------------------------
+} // namespace chai3d
+//------------------------------------------------------------------------------
@@ -0,0 +1,346 @@
+//==============================================================================
+/*
+    Software License Agreement (BSD License)
+    Copyright (c) 2003-2016, CHAI3D.
+    (www.chai3d.org)
+
+    All rights reserved.
+
+    Redistribution and use in source and binary forms, with or without
+    modification, are permitted provided that the following conditions
+    are met:
+
+    * Redistributions of source code must retain the above copyright
+    notice, this list of conditions and the following disclaimer.
+
+    * Redistributions in binary form must reproduce the above
+    copyright notice, this list of conditions and the following
+    disclaimer in the documentation and/or other materials provided
+    with the distribution.
+
+    * Neither the name of CHAI3D nor the names of its contributors may
+    be used to endorse or promote products derived from this software
+    without specific prior written permission.
+
+    THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS
+    "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT
+    LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS
+    FOR A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE
+    COPYRIGHT OWNER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT,
+    INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING,
+    BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES;
+    LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER
+    CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT
+    LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN
+    ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+    POSSIBILITY OF SUCH DAMAGE. 
+
+    \author    <http://www.chai3d.org>
+    \version   3.2.0 $Rev: 2182 $
+*/
+//==============================================================================
+
+
+//------------------------------------------------------------------------------
+#ifndef CPhaseProfilerH
+#define CPhaseProfilerH
+//------------------------------------------------------------------------------
+#include "timers/CPrecisionClock.h"
+#include <atomic>
+#include <string>
+#include <vector>
+#if defined(_MSC_VER)
+#include <intrin.h>
+#elif defined(__i386__) || defined(__x86_64__)
+#include <x86intrin.h>
+#endif
+//------------------------------------------------------------------------------
+
+//------------------------------------------------------------------------------
+namespace chai3d {
+//------------------------------------------------------------------------------
+
+//==============================================================================
+/*!
+    \file       CPhaseProfiler.h
+    \ingroup    timers
+
+    \brief
+    Implements a low overhead profiler for the phases of a real-time loop.
+*/
+//==============================================================================
+
+//------------------------------------------------------------------------------
+//! Maximum number of phases of a profiler.
+const int C_PROFILER_MAX_PHASES = 16;
+
+//! Number of histogram bins per phase (8 bins per octave of CPU cycles).
+const int C_PROFILER_BINS = 320;
+//------------------------------------------------------------------------------
+
+
+//------------------------------------------------------------------------------
+/*!
+    \struct     cPhaseStatistics
+    \ingroup    timers
+
+    \brief
+    This structure holds the latency statistics of a profiled phase.
+*/
+//------------------------------------------------------------------------------
+struct cPhaseStatistics
+{
+    //! Name of the phase.
+    std::string m_name;
+
+    //! Number of samples.
+    unsigned int m_count;
+
+    //! Mean latency in seconds.
+    double m_mean;
+
+    //! Median latency in seconds.
+    double m_p50;
+
+    //! 99th percentile latency in seconds.
+    double m_p99;
+
+    //! Largest latency in seconds.
+    double m_max;
+};
+
+
+//==============================================================================
+/*!
+    \class      cPhaseProfiler
+    \ingroup    timers
+
+    \brief
+    This class records the latency of the phases of a real-time loop.
+
+    \details
+    __cPhaseProfiler__ keeps one latency histogram per phase. Latencies are
+    measured in CPU time stamp counter cycles and binned logarithmically with
+    8 bins per octave, so that recording a sample costs a few instructions 
+    and never allocates memory.\n
+
+    A profiler is written by a single thread (each real-time loop owns its 
+    own profiler) and may be read at any time by another thread, typically 
+    the graphics thread, through getSnapshot(), getSummary() or saveCSV().\n
+
+    Phases are timed with __cPhaseTimer__ through the macros 
+    __C_PROFILE_SCOPE__, __C_PROFILE_START__, __C_PROFILE_LAP__ and 
+    __C_PROFILE_RESTART__. The macros compile to nothing unless 
+    __C_ENABLE_PROFILER__ is defined.
+*/
+//==============================================================================
+
+class cPhaseProfiler
+{
+    //--------------------------------------------------------------------------
+    // CONSTRUCTOR & DESTRUCTOR:
+    //--------------------------------------------------------------------------
+
+public:
+
+    //! Constructor of cPhaseProfiler.
+    cPhaseProfiler();
+
+    //! Destructor of cPhaseProfiler.
+    virtual ~cPhaseProfiler() {};
+
+
+    //--------------------------------------------------------------------------
+    // PUBLIC METHODS:
+    //--------------------------------------------------------------------------
+
+public:
+
+    //! This method names a phase. It must be called before the phase is recorded.
+    void setPhaseName(const int a_phase, const std::string& a_name);
+
+    //! This method returns the number of named phases.
+    int getNumPhases() const { return (m_numPhases); }
+
+    //! This method records a latency in CPU cycles for a phase.
+    inline void record(const int a_phase, const unsigned long long a_cycles)
+    {
+        Phase& phase = m_phases[a_phase];
+        int bin = getBin(a_cycles);
+        phase.m_bins[bin].store(phase.m_bins[bin].load(std::memory_order_relaxed) + 1, std::memory_order_relaxed);
+        phase.m_sum.store(phase.m_sum.load(std::memory_order_relaxed) + a_cycles, std::memory_order_relaxed);
+        if (a_cycles > phase.m_max.load(std::memory_order_relaxed))
+        {
+            phase.m_max.store(a_cycles, std::memory_order_relaxed);
+        }
+        phase.m_count.store(phase.m_count.load(std::memory_order_relaxed) + 1, std::memory_order_release);
+    }
+
+    //! This method copies the statistics of all named phases.
+    void getSnapshot(std::vector<cPhaseStatistics>& a_statistics) const;
+
+    //! This method returns one line of text per phase with its p50, p99 and max latencies.
+    std::string getSummary() const;
+
+    //! This method writes the statistics and histograms of all phases to a CSV file.
+    bool saveCSV(const std::string& a_filename) const;
+
+    //! This method returns the CPU time stamp counter.
+    static inline unsigned long long readCycles()
+    {
+#if defined(_MSC_VER) || defined(__i386__) || defined(__x86_64__)
+        return (__rdtsc());
+#else
+        return ((unsigned long long)(cPrecisionClock::getCPUTimeSeconds() * 1e9));
+#endif
+    }
+
+    //! This method returns the duration of a CPU cycle in seconds.
+    static double getCycleDuration();
+
+
+    //--------------------------------------------------------------------------
+    // PROTECTED METHODS:
+    //--------------------------------------------------------------------------
+
+protected:
+
+    //! This method returns the histogram bin of a latency in CPU cycles.
+    static inline int getBin(const unsigned long long a_cycles)
+    {
+        if (a_cycles < 8)
+        {
+            return ((int)a_cycles);
+        }
+
+        // position of the most significant bit, followed by the next 3 bits
+        unsigned long long value = a_cycles;
+        int msb = 0;
+        if (value >> 32) { value >>= 32; msb += 32; }
+        if (value >> 16) { value >>= 16; msb += 16; }
+        if (value >> 8)  { value >>= 8;  msb += 8; }
+        if (value >> 4)  { value >>= 4;  msb += 4; }
+        if (value >> 2)  { value >>= 2;  msb += 2; }
+        if (value >> 1)  { msb += 1; }
+        int bin = (msb - 2) * 8 + (int)((a_cycles >> (msb - 3)) & 7);
+
+        return (bin < C_PROFILER_BINS ? bin : C_PROFILER_BINS - 1);
+    }
+
+    //! This method returns the center of a histogram bin in CPU cycles.
+    static double getBinCenter(const int a_bin);
+
+
+    //--------------------------------------------------------------------------
+    // PROTECTED MEMBERS:
+    //--------------------------------------------------------------------------
+
+protected:
+
+    //! Histogram and totals of a phase.
+    struct Phase
+    {
+        std::atomic<unsigned int> m_count;
+        std::atomic<unsigned long long> m_sum;
+        std::atomic<unsigned long long> m_max;
+        std::atomic<unsigned int> m_bins[C_PROFILER_BINS];
+    };
+
+    //! Phases.
+    Phase m_phases[C_PROFILER_MAX_PHASES];
+
+    //! Names of the phases.
+    std::string m_names[C_PROFILER_MAX_PHASES];
+
+    //! Number of named phases.
+    int m_numPhases;
+};
+
+
+//==============================================================================
+/*!
+    \class      cPhaseTimer
+    \ingroup    timers
+
+    \brief
+    This class times phases of a real-time loop for a cPhaseProfiler.
+
+    \details
+    A timer constructed with a phase records the time until it goes out of 
+    scope. A timer constructed without a phase times a sequence of phases: 
+    each call to lap() records the time since the previous lap.
+*/
+//==============================================================================
+
+class cPhaseTimer
+{
+public:
+
+    //! Constructor of cPhaseTimer.
+    cPhaseTimer(cPhaseProfiler& a_profiler, const int a_phase = -1) : 
+        m_profiler(a_profiler), m_phase(a_phase), m_start(cPhaseProfiler::readCycles()) {}
+
+    //! Destructor of cPhaseTimer.
+    ~cPhaseTimer()
+    {
+        if (m_phase >= 0)
+        {
+            m_profiler.record(m_phase, cPhaseProfiler::readCycles() - m_start);
+        }
+    }
+
+    //! This method records the time since the previous lap for a phase.
+    inline void lap(const int a_phase)
+    {
+        unsigned long long now = cPhaseProfiler::readCycles();
+        m_profiler.record(a_phase, now - m_start);
+        m_start = now;
+    }
+
+    //! This method starts a new lap without recording the current one.
+    inline void restart() { m_start = cPhaseProfiler::readCycles(); }
+
+protected:
+
+    //! Profiler the phases are recorded in.
+    cPhaseProfiler& m_profiler;
+
+    //! Phase recorded at destruction (-1 for none).
+    int m_phase;
+
+    //! Time stamp counter at the start of the current lap.
+    unsigned long long m_start;
+};
+
+
+//------------------------------------------------------------------------------
+#define C_PROFILE_CONCAT_(a, b) a##b
+#define C_PROFILE_CONCAT(a, b) C_PROFILE_CONCAT_(a, b)
+
+#if defined(C_ENABLE_PROFILER)
+    //! Times the enclosing scope as a phase.
+    #define C_PROFILE_SCOPE(profiler, phase) chai3d::cPhaseTimer C_PROFILE_CONCAT(cPhaseTimer_, __LINE__)(profiler, phase)
+
+    //! Declares a timer for a sequence of phases.
+    #define C_PROFILE_START(timer, profiler) chai3d::cPhaseTimer timer(profiler)
+
+    //! Records the time since the previous lap of a timer as a phase.
+    #define C_PROFILE_LAP(timer, phase) timer.lap(phase)
+
+    //! Starts a new lap of a timer without recording the current one.
+    #define C_PROFILE_RESTART(timer) timer.restart()
+#else
+    #define C_PROFILE_SCOPE(profiler, phase)
+    #define C_PROFILE_START(timer, profiler)
+    #define C_PROFILE_LAP(timer, phase)
+    #define C_PROFILE_RESTART(timer)
+#endif
+//------------------------------------------------------------------------------
+
+//------------------------------------------------------------------------------
+} // namespace chai3d
+//------------------------------------------------------------------------------
+
+//------------------------------------------------------------------------------
+#endif
+//------------------------------------------------------------------------------
@@ -67,6 +67,9 @@ cGenericTool::cGenericTool(cWorld* a_parentWorld)
     // no device is currently connected to this tool
     m_hapticDevice = cGenericHapticDevicePtr();
 
+    // haptic points are computed one at a time
+    m_useBatchedCollisionQueries = false;
+
     // tool is not yet enabled
     m_enabled = false;
 
@@ -848,22 +851,60 @@ void cGenericTool::computeInteractionForces()
     torque.zero();
 
     int numContactPoint = (int)(m_hapticPoints.size());
-    for (int i=0; i<numContactPoint; i++)
+    if (!m_useBatchedCollisionQueries)
+    {
+        for (int i=0; i<numContactPoint; i++)
+        {
+            // get next haptic point
+            cHapticPoint* nextContactPoint = m_hapticPoints[i];
+
+            // compute force at haptic point as well as new proxy position
+            cVector3d t_force = nextContactPoint->computeInteractionForces(m_deviceGlobalPos, 
+                                                                           m_deviceGlobalRot, 
+                                                                           m_deviceGlobalLinVel, 
+                                                                           m_deviceGlobalAngVel);
+
+            cVector3d t_pos = nextContactPoint->getGlobalPosProxy();
+
+            // combine force contributions together
+            force.add(t_force);
+            torque.add(cCross(t_pos, t_force));
+        }
+    }
+    else
     {
-        // get next haptic point
-        cHapticPoint* nextContactPoint = m_hapticPoints[i];
+        // haptic points are computed in packets so that their collision queries 
+        // traverse the collision trees of the world together
+        for (int first=0; first<numContactPoint; first+=C_COLLISION_PACKET_SIZE)
+        {
+            int numPoints = cMin(C_COLLISION_PACKET_SIZE, numContactPoint - first);
+
+            // compute force at haptic points as well as new proxy positions
+            cVector3d positions[C_COLLISION_PACKET_SIZE];
+            cVector3d velocities[C_COLLISION_PACKET_SIZE];
+            cVector3d forces[C_COLLISION_PACKET_SIZE];
+            for (int i=0; i<numPoints; i++)
+            {
+                positions[i] = m_deviceGlobalPos;
+                velocities[i] = m_deviceGlobalLinVel;
+            }
 
-        // compute force at haptic point as well as new proxy position
-        cVector3d t_force = nextContactPoint->computeInteractionForces(m_deviceGlobalPos, 
-                                                                       m_deviceGlobalRot, 
-                                                                       m_deviceGlobalLinVel, 
-                                                                       m_deviceGlobalAngVel);
+            cHapticPoint::computeInteractionForces(numPoints,
+                                                   &m_hapticPoints[first],
+                                                   positions,
+                                                   velocities,
+                                                   forces);
 
-        cVector3d t_pos = nextContactPoint->getGlobalPosProxy();
+            for (int i=0; i<numPoints; i++)
+            {
+                cVector3d t_force = forces[i];
+                cVector3d t_pos = m_hapticPoints[first + i]->getGlobalPosProxy();
 
-        // combine force contributions together
-        force.add(t_force);
-        torque.add(cCross(t_pos, t_force));
+                // combine force contributions together
+                force.add(t_force);
+                torque.add(cCross(t_pos, t_force));
+            }
+        }
     }
 
     // update global forces
@@ -456,6 +456,12 @@ public:
                                       bool a_showGoal = false, 
                                       cColorf a_colorLine = cColorf(0.5, 0.5, 0.5));
 
+    //! This method enables or disables computing the collision queries of the haptic points together in packets.
+    void setUseBatchedCollisionQueries(const bool a_useBatchedCollisionQueries) { m_useBatchedCollisionQueries = a_useBatchedCollisionQueries; }
+
+    //! This method returns __true__ if the collision queries of the haptic points are computed together in packets, __false__ otherwise.
+    bool getUseBatchedCollisionQueries() const { return (m_useBatchedCollisionQueries); }
+
 
     //--------------------------------------------------------------------------
     // PUBLIC METHODS - WORLD
@@ -512,6 +518,9 @@ protected:
     //! Haptic points that describe the tool.
     std::vector <cHapticPoint*> m_hapticPoints;
 
+    //! If __true__, the collision queries of the haptic points traverse the collision trees of the world together in packets.
+    bool m_useBatchedCollisionQueries;
+
 
     //--------------------------------------------------------------------------
     // PROTECTED MEMBERS - HAPTIC DEVICE
@@ -46,6 +46,7 @@
 //------------------------------------------------------------------------------
 #include "tools/CGenericTool.h"
 #include "world/CMultiMesh.h"
+#include "system/CAllocationCounter.h"
 //------------------------------------------------------------------------------
 
 //------------------------------------------------------------------------------
@@ -411,10 +412,87 @@ cVector3d cHapticPoint::computeInteractionForces(cVector3d& a_globalPos,
                                                  cVector3d& a_globalLinVel,
                                                  cVector3d& a_globalAngVel)
 {
+    // if allocations are counted, check that the haptic loop does not allocate memory
+    C_ASSERT_NO_ALLOCATION;
+
     ///////////////////////////////////////////////////////////////////////////
     // ALGORITHM FINGER PROXY
     ///////////////////////////////////////////////////////////////////////////
 
+    clearProxyContacts();
+
+    // we now update the new position of a goal point and update the proxy position.
+    // As a result, the force contribution from the proxy is now calculated.
+    cVector3d force0 = m_algorithmFingerProxy->computeForces(a_globalPos, a_globalLinVel);
+
+    // compute remaining interactions
+    return (updateInteractionForces(force0, a_globalPos, a_globalLinVel));
+}
+
+
+//==============================================================================
+/*!
+    This method computes all interaction forces between several haptic points
+    and the virtual environment. The result is identical to calling 
+    \ref computeInteractionForces() on each haptic point, but the first 
+    collision queries of their finger-proxy algorithms are tested in a single 
+    batch, so that collision trees are traversed once for all haptic points.
+
+    \param  a_numPoints     Number of haptic points.
+    \param  a_points        Array of haptic points.
+    \param  a_globalPos     New desired goal position of each haptic point.
+    \param  a_globalLinVel  Linear velocity of tool of each haptic point.
+    \param  a_forces        Returned interaction force of each haptic point in world coordinates.
+*/
+//==============================================================================
+void cHapticPoint::computeInteractionForces(const int a_numPoints,
+                                            cHapticPoint** a_points,
+                                            cVector3d* a_globalPos,
+                                            cVector3d* a_globalLinVel,
+                                            cVector3d* a_forces)
+{
+    // if allocations are counted, check that the haptic loop does not allocate memory
+    C_ASSERT_NO_ALLOCATION;
+
+    for (int first=0; first<a_numPoints; first+=C_COLLISION_PACKET_SIZE)
+    {
+        int numPoints = cMin(C_COLLISION_PACKET_SIZE, a_numPoints - first);
+
+        // compute finger-proxy forces of all haptic points together
+        cAlgorithmFingerProxy* proxies[C_COLLISION_PACKET_SIZE];
+        cVector3d forces[C_COLLISION_PACKET_SIZE];
+        for (int i=0; i<numPoints; i++)
+        {
+            proxies[i] = a_points[first + i]->m_algorithmFingerProxy;
+        }
+
+        cAlgorithmFingerProxy::computeForces(numPoints,
+                                             proxies,
+                                             &a_globalPos[first],
+                                             &a_globalLinVel[first],
+                                             forces);
+
+        // compute remaining interactions. contacts are updated in the same 
+        // order as if each haptic point were computed on its own.
+        for (int i=0; i<numPoints; i++)
+        {
+            a_points[first + i]->clearProxyContacts();
+            a_forces[first + i] = a_points[first + i]->updateInteractionForces(forces[i],
+                                                                               a_globalPos[first + i],
+                                                                               a_globalLinVel[first + i]);
+        }
+    }
+}
+
+
+//==============================================================================
+/*!
+    This method marks the objects the proxy was in contact with as no longer 
+    being in contact.
+*/
+//==============================================================================
+void cHapticPoint::clearProxyContacts()
+{
     // we first consider all object the proxy may have been in contact with and
     // mark their interaction as no longer active. 
 
@@ -433,10 +511,28 @@ cVector3d cHapticPoint::computeInteractionForces(cVector3d& a_globalPos,
             m_meshProxyContacts[i] = NULL;
         }
     }
+}
 
-    // we now update the new position of a goal point and update the proxy position.
-    // As a result, the force contribution from the proxy is now calculated.
-    cVector3d force0 = m_algorithmFingerProxy->computeForces(a_globalPos, a_globalLinVel);
+
+//==============================================================================
+/*!
+    This method completes the computation of the interaction forces once the 
+    finger-proxy algorithm has been updated. Objects in contact with the 
+    proxy are flagged, forces of the potential field algorithm are added and 
+    audio sources are updated.
+
+    \param  a_forceProxy    Force computed by the finger-proxy algorithm.
+    \param  a_globalPos     New desired goal position.
+    \param  a_globalLinVel  Linear velocity of tool.
+
+    \return Computed interaction force in world coordinates.
+*/
+//==============================================================================
+cVector3d cHapticPoint::updateInteractionForces(const cVector3d& a_forceProxy,
+                                                cVector3d& a_globalPos,
+                                                cVector3d& a_globalLinVel)
+{
+    cVector3d force0 = a_forceProxy;
 
     // we now flag each mesh for which the proxy may be interacting with. This information is 
     // necessary for haptic effects that may be associated with these mesh objects.
@@ -209,6 +209,13 @@ public:
                                        cVector3d& a_globalLinVel,
                                        cVector3d& a_globalAngVel);
 
+    //! This method computes all interaction forces between several haptic points and the virtual environment, testing their first collision queries together.
+    static void computeInteractionForces(const int a_numPoints,
+                                         cHapticPoint** a_points,
+                                         cVector3d* a_globalPos,
+                                         cVector3d* a_globalLinVel,
+                                         cVector3d* a_forces);
+
     //! This method returns the last computed force in global world coordinates.
     cVector3d getLastComputedForce() { return (m_lastComputedGlobalForce); }
 
@@ -264,6 +271,14 @@ protected:
     //! This method updates the position of the spheres (__proxy__ and __goal__) in local tool coordinates
     void updateSpherePositions();
 
+    //! This method marks the objects the proxy was in contact with as no longer being in contact.
+    void clearProxyContacts();
+
+    //! This method completes the computation of the interaction forces from the force of the finger-proxy algorithm.
+    cVector3d updateInteractionForces(const cVector3d& a_forceProxy,
+                                      cVector3d& a_globalPos,
+                                      cVector3d& a_globalLinVel);
+
 
     //--------------------------------------------------------------------------
     // PROTECTED MEMBERS
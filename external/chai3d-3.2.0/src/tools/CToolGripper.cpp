@@ -140,15 +140,32 @@ void cToolGripper::computeInteractionForces()
     }
 
     // compute forces
-    cVector3d forceThumb = m_hapticPointThumb->computeInteractionForces(posThumb, 
-                                                                        m_deviceGlobalRot, 
-                                                                        m_deviceGlobalLinVel, 
-                                                                        m_deviceGlobalAngVel);
-
-    cVector3d forceFinger = m_hapticPointFinger->computeInteractionForces(posFinger, 
-                                                                          m_deviceGlobalRot, 
-                                                                          m_deviceGlobalLinVel, 
-                                                                          m_deviceGlobalAngVel);
+    cVector3d forceThumb, forceFinger;
+    if (!m_useBatchedCollisionQueries)
+    {
+        forceThumb = m_hapticPointThumb->computeInteractionForces(posThumb, 
+                                                                  m_deviceGlobalRot, 
+                                                                  m_deviceGlobalLinVel, 
+                                                                  m_deviceGlobalAngVel);
+
+        forceFinger = m_hapticPointFinger->computeInteractionForces(posFinger, 
+                                                                    m_deviceGlobalRot, 
+                                                                    m_deviceGlobalLinVel, 
+                                                                    m_deviceGlobalAngVel);
+    }
+    else
+    {
+        // both haptic points are computed together so that their collision 
+        // queries traverse the collision trees of the world together.
+        cHapticPoint* points[2] = { m_hapticPointThumb, m_hapticPointFinger };
+        cVector3d positions[2] = { posThumb, posFinger };
+        cVector3d velocities[2] = { m_deviceGlobalLinVel, m_deviceGlobalLinVel };
+        cVector3d forces[2];
+        cHapticPoint::computeInteractionForces(2, points, positions, velocities, forces);
+
+        forceThumb = forces[0];
+        forceFinger = forces[1];
+    }
 
     // compute torques
     double scl = 0.0;
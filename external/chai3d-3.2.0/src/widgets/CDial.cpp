@@ -424,6 +424,8 @@ void cDial::updateBoundaryBox()
     double s = 0.5 * m_width;
     m_boundaryBoxMin.set(-s, -s, 0.0);
     m_boundaryBoxMax.set( s,  s, 0.0);
+
+    m_boundaryBoxEmpty = false;
 }
 
 
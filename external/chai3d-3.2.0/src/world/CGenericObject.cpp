@@ -137,6 +137,9 @@ cGenericObject::cGenericObject()
     // no parent defined
     m_parent = NULL;
 
+    // list of children has not been modified
+    m_childrenVersion = 0;
+
     // object is not interacting with any tool
     m_interactionInside = false;
     m_interactionPoint.zero();
@@ -1706,6 +1709,153 @@ bool cGenericObject::computeCollisionDetection(const cVector3d& a_segmentPointA,
 }
 
 
+//==============================================================================
+/*!
+    This method determines whether a batch of segments intersects this object 
+    or any of its descendants. \n
+    Each query reports its collision events in its own recorder according to 
+    its own settings, exactly as if its segment were passed to 
+    \ref computeCollisionDetection(const cVector3d&, const cVector3d&, cCollisionRecorder&, cCollisionSettings&).
+    The flag \ref cCollisionQuery::m_hit of each query is set when a 
+    collision is detected. \n
+    Queries are processed in packets of \ref C_COLLISION_PACKET_SIZE, which 
+    collision detectors test in a single pass.
+
+    \param  a_queries     Array of queries, expressed in the frame of the parent object.
+    \param  a_numQueries  Number of queries.
+
+    \return __true__ if one or more collisions have occurred, __false__ otherwise.
+*/
+//==============================================================================
+bool cGenericObject::computeCollisionDetection(cCollisionQuery* a_queries,
+                                               const int a_numQueries)
+{
+    ///////////////////////////////////////////////////////////////////////////
+    // INITIALIZATION
+    ///////////////////////////////////////////////////////////////////////////
+
+    // check if node is a ghost. If yes, then ignore call
+    if (m_ghostEnabled) { return (false); }
+
+    // split large batches into packets
+    if (a_numQueries > C_COLLISION_PACKET_SIZE)
+    {
+        bool hit = false;
+        for (int i=0; i<a_numQueries; i+=C_COLLISION_PACKET_SIZE)
+        {
+            hit = hit | computeCollisionDetection(&a_queries[i], cMin(C_COLLISION_PACKET_SIZE, a_numQueries - i));
+        }
+        return (hit);
+    }
+
+    // temp variable
+    bool hit = false;
+
+    // get the transpose of the local rotation matrix
+    cMatrix3d transLocalRot;
+    m_localRot.transr(transLocalRot);
+
+    // convert segments into local coordinate frame
+    cCollisionQuery localQueries[C_COLLISION_PACKET_SIZE];
+    for (int i=0; i<a_numQueries; i++)
+    {
+        localQueries[i] = a_queries[i];
+        localQueries[i].m_hit = false;
+        localQueries[i].m_segmentPointA.sub(m_localPos);
+        transLocalRot.mul(localQueries[i].m_segmentPointA);
+        localQueries[i].m_segmentPointB.sub(m_localPos);
+        transLocalRot.mul(localQueries[i].m_segmentPointB);
+    }
+
+
+    ///////////////////////////////////////////////////////////////////////////
+    // CHECK COLLISIONS
+    ///////////////////////////////////////////////////////////////////////////
+
+    // select segments for which this object is checked, and adjust their first
+    // endpoint so that it is in the same position relative to the moving 
+    // object as it was at the previous haptic iteration
+    cCollisionQuery activeQueries[C_COLLISION_PACKET_SIZE];
+    int activeIndices[C_COLLISION_PACKET_SIZE];
+    int numActiveQueries = 0;
+    if (m_enabled)
+    {
+        for (int i=0; i<a_numQueries; i++)
+        {
+            const cCollisionSettings& settings = *localQueries[i].m_settings;
+            if ((settings.m_checkVisibleObjects && m_showEnabled) ||
+                (settings.m_checkHapticObjects && m_hapticEnabled))
+            {
+                cCollisionQuery& query = activeQueries[numActiveQueries];
+                query = localQueries[i];
+                if (settings.m_adjustObjectMotion)
+                {
+                    adjustCollisionSegment(localQueries[i].m_segmentPointA, query.m_segmentPointA);
+                }
+                activeIndices[numActiveQueries] = i;
+                numActiveQueries++;
+            }
+        }
+    }
+
+    if (numActiveQueries > 0)
+    {
+        // call the collision detector's collision detection function
+        if (m_collisionDetector != NULL)
+        {
+            m_collisionDetector->computeCollisions(this, activeQueries, numActiveQueries);
+        }
+
+        // compute any other collisions.
+        for (int i=0; i<numActiveQueries; i++)
+        {
+            cCollisionQuery& query = activeQueries[i];
+            if (computeOtherCollisionDetection(query.m_segmentPointA,
+                                               query.m_segmentPointB,
+                                               *query.m_recorder,
+                                               *query.m_settings))
+            {
+                query.m_hit = true;
+            }
+
+            if (query.m_hit)
+            {
+                a_queries[activeIndices[i]].m_hit = true;
+                hit = true;
+            }
+        }
+    }
+
+
+    ///////////////////////////////////////////////////////////////////////////
+    // CHECK CHILDREN
+    ///////////////////////////////////////////////////////////////////////////
+
+    // check for collisions with all children of this object
+    for (unsigned int i=0; i<m_children.size(); i++)
+    {
+        m_children[i]->computeCollisionDetection(localQueries, a_numQueries);
+    }
+
+    for (int i=0; i<a_numQueries; i++)
+    {
+        if (localQueries[i].m_hit)
+        {
+            a_queries[i].m_hit = true;
+            hit = true;
+        }
+    }
+
+
+    ///////////////////////////////////////////////////////////////////////////
+    // FINALIZE
+    ///////////////////////////////////////////////////////////////////////////
+
+    // return whether there was a collision between the segments and this object
+    return (hit);
+}
+
+
 //==============================================================================
 /*!
     This method enables or disables graphic representation of the collision 
@@ -1773,6 +1923,60 @@ void cGenericObject::setCollisionDetectorProperties(unsigned int a_displayDepth,
 }
 
 
+//==============================================================================
+/*!
+    This method returns the boundary box, expressed in the local coordinates of 
+    this object, that encloses every element tested by its collision detector 
+    and by computeOtherCollisionDetection(). Children are not included. \n
+
+    The box is the union of the boundary box of the collision detector and of 
+    the boundary box of the object. If the collision detector cannot bound its 
+    elements and the object has no boundary box, the elements are considered 
+    unbounded. If the object contains nothing to collide with, \p a_min is set 
+    larger than \p a_max.
+
+    \param  a_min  Returned lower corner of the boundary box.
+    \param  a_max  Returned upper corner of the boundary box.
+
+    \return __true__ if the elements are bounded, __false__ otherwise.
+*/
+//==============================================================================
+bool cGenericObject::getCollisionBoundaryBox(cVector3d& a_min, cVector3d& a_max)
+{
+    // start from an empty box
+    a_min.set( C_LARGE, C_LARGE, C_LARGE);
+    a_max.set(-C_LARGE,-C_LARGE,-C_LARGE);
+
+    // enclose the elements of the collision detector
+    if (m_collisionDetector != NULL)
+    {
+        cVector3d min, max;
+        if (m_collisionDetector->getBoundaryBox(min, max))
+        {
+            a_min = min;
+            a_max = max;
+        }
+        else if (m_boundaryBoxEmpty)
+        {
+            return (false);
+        }
+    }
+
+    // enclose the boundary box of the object
+    if (!m_boundaryBoxEmpty)
+    {
+        a_min(0) = cMin(a_min(0), m_boundaryBoxMin(0));
+        a_min(1) = cMin(a_min(1), m_boundaryBoxMin(1));
+        a_min(2) = cMin(a_min(2), m_boundaryBoxMin(2));
+        a_max(0) = cMax(a_max(0), m_boundaryBoxMax(0));
+        a_max(1) = cMax(a_max(1), m_boundaryBoxMax(1));
+        a_max(2) = cMax(a_max(2), m_boundaryBoxMax(2));
+    }
+
+    return (true);
+}
+
+
 //==============================================================================
 /*!
     This method adds an object to the scene graph below this object. \n
@@ -1794,6 +1998,7 @@ bool cGenericObject::addChild(cGenericObject* a_object)
     if (a_object->m_parent == NULL)
     {
         m_children.push_back(a_object);
+        m_childrenVersion++;
         a_object->m_parent = this;
         return (true);
     }
@@ -1803,6 +2008,7 @@ bool cGenericObject::addChild(cGenericObject* a_object)
     else if (m_ghostEnabled)
     {
         m_children.push_back(a_object);
+        m_childrenVersion++;
         return (true);
     }
 
@@ -1842,6 +2048,7 @@ bool cGenericObject::removeChild(cGenericObject* a_object)
 
             // remove this object from my list of children
             m_children.erase(it);
+            m_childrenVersion++;
 
             // return success
             return (true);
@@ -1920,6 +2127,7 @@ void cGenericObject::clearAllChildren()
 
     // clear children list
     m_children.clear();
+    m_childrenVersion++;
 }
 
 
@@ -1940,6 +2148,7 @@ void cGenericObject::deleteAllChildren()
 
     // clear my list of children
     m_children.clear();
+    m_childrenVersion++;
 }
 
 
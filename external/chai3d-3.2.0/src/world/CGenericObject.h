@@ -186,6 +186,9 @@ public:
     //! This method returns the global position of this object.
     inline cVector3d getGlobalPos() const { return (m_globalPos); }
 
+    //! This method returns the global position of this object at the previous call to computeGlobalPositions().
+    inline cVector3d getPrevGlobalPos() const { return (m_prevGlobalPos); }
+
     //! This method sets the local rotation matrix for this object.
     virtual void setLocalRot(const cMatrix3d& a_localRot)
     {
@@ -208,6 +211,9 @@ public:
     //! This method returns the global rotation matrix of this object.
     inline cMatrix3d getGlobalRot() const { return (m_globalRot); }
 
+    //! This method returns the global rotation matrix of this object at the previous call to computeGlobalPositions().
+    inline cMatrix3d getPrevGlobalRot() const { return (m_prevGlobalRot); }
+
     //! This method returns the local position and rotation matrix by passing a transformation matrix.
     inline void setLocalTransform(const cTransform& a_transform) 
     {
@@ -600,6 +606,10 @@ public:
         cCollisionRecorder& a_recorder,
         cCollisionSettings& a_settings);
 
+    //! This method computes any collision between a batch of segments and this object.
+    virtual bool computeCollisionDetection(cCollisionQuery* a_queries,
+        const int a_numQueries);
+
     //! This method enables or disables the display of the collision detector, optionally propagating the change to its children.
     virtual void setShowCollisionDetector(const bool a_showCollisionDetector, const bool a_affectChildren = false);
 
@@ -611,6 +621,9 @@ public:
         cColorf& a_color, 
         const bool a_affectChildren = false);
 
+    //! This method returns the local boundary box of the elements this object can collide with, or __false__ if they cannot be bounded.
+    virtual bool getCollisionBoundaryBox(cVector3d& a_min, cVector3d& a_max);
+
 
     //-----------------------------------------------------------------------
     // PUBLIC METHODS - SCENE GRAPH:
@@ -633,6 +646,9 @@ public:
     //! This method returns a selected child from the list of children.
     inline cGenericObject* getChild(const unsigned int a_index) const { return (m_children[a_index]); }
 
+    //! This method returns a counter which is incremented each time the list of children is modified.
+    inline unsigned int getChildrenVersion() const { return (m_childrenVersion); }
+
     //! This method add an object to the list of children.
     bool addChild(cGenericObject* a_object);
 
@@ -738,6 +754,9 @@ protected:
     //! List of children.
     std::vector<cGenericObject*> m_children;
 
+    //! Counter incremented each time the list of children is modified.
+    unsigned int m_childrenVersion;
+
 
     //-----------------------------------------------------------------------
     // PROTECTED MEMBERS - POSITION & ORIENTATION:
@@ -49,6 +49,7 @@
 #include "collisions/CGenericCollision.h"
 #include "collisions/CCollisionBrute.h"
 #include "collisions/CCollisionAABB.h"
+#include "collisions/CCollisionSDF.h"
 #include "files/CFileModel3DS.h"
 #include "files/CFileModelOBJ.h"
 #include "shaders/CShaderProgram.h"
@@ -208,11 +209,18 @@ void cMesh::copyMeshProperties(cMesh* a_obj,
         if (a_buildCollisionDetector)
         {
             double radius = 0.0;
+            cCollisionAABBBuildMethod buildMethod = C_AABB_BUILD_MIDPOINT;
             if (m_collisionDetector)
             {
                 radius = m_collisionDetector->getBoundaryRadius();
+
+                cCollisionAABB* collisionAABB = dynamic_cast<cCollisionAABB*>(m_collisionDetector);
+                if (collisionAABB != NULL)
+                {
+                    buildMethod = collisionAABB->getBuildMethod();
+                }
             }
-            a_obj->createAABBCollisionDetector(radius);
+            a_obj->createAABBCollisionDetector(radius, buildMethod);
         }
     }
     else
@@ -701,7 +709,7 @@ void cMesh::offsetVertices(const cVector3d& a_offset,
     // update collision detector if requested
     if (a_updateCollisionDetector && m_collisionDetector)
     {
-        m_collisionDetector->update();
+        m_collisionDetector->refit();
     }
 
     // mark for update
@@ -1011,10 +1019,12 @@ void cMesh::createBruteForceCollisionDetector()
 /*!
     This method builds an AABB collision detector for this mesh.
 
-    \param  a_radius  Bounding radius.
+    \param  a_radius       Bounding radius.
+    \param  a_buildMethod  Algorithm used to build the collision tree.
 */
 //==============================================================================
-void cMesh::createAABBCollisionDetector(const double a_radius)
+void cMesh::createAABBCollisionDetector(const double a_radius,
+                                        const cCollisionAABBBuildMethod a_buildMethod)
 {
     // delete previous collision detector
     if (m_collisionDetector != NULL)
@@ -1025,7 +1035,44 @@ void cMesh::createAABBCollisionDetector(const double a_radius)
 
     // create AABB and initialize collision detector 
     cCollisionAABB* collisionDetector = new cCollisionAABB();
-    collisionDetector->initialize(m_triangles, a_radius);
+    collisionDetector->initialize(m_triangles, a_radius, a_buildMethod);
+
+    // assign new collision detector
+    m_collisionDetector = collisionDetector;
+}
+
+
+//==============================================================================
+/*!
+    This method builds a signed distance field collision detector for this 
+    mesh. The mesh must be closed and should not be deformed afterwards, as 
+    the field is only baked again when the collision detector is updated. \n\n
+
+    The field renders the mesh in constant time with any tool, such as 
+    cToolCursor, once a surface effect is created by calling 
+    createEffectSurface(). The finger-proxy algorithm then also traces its 
+    segments through the field, unless segment queries are disabled on the 
+    collision detector with cCollisionSDF::setSegmentQueriesEnabled().
+
+    \param  a_voxelSize  Size of a cell of the distance field.
+    \param  a_bandWidth  Distance from the surface up to which distances are stored.
+    \param  a_filename   Name of the cache file, or an empty string to disable caching.
+*/
+//==============================================================================
+void cMesh::createSDFCollisionDetector(const double a_voxelSize,
+                                       const double a_bandWidth,
+                                       const std::string& a_filename)
+{
+    // delete previous collision detector
+    if (m_collisionDetector != NULL)
+    {
+        delete m_collisionDetector;
+        m_collisionDetector = NULL;
+    }
+
+    // create distance field from cache or bake it
+    cCollisionSDF* collisionDetector = new cCollisionSDF();
+    collisionDetector->initialize(m_triangles, a_voxelSize, a_bandWidth, a_filename);
 
     // assign new collision detector
     m_collisionDetector = collisionDetector;
@@ -1042,7 +1089,12 @@ void cMesh::createAABBCollisionDetector(const double a_radius)
     when computing the finger-proxy model. More information can be found in 
     file cToolCursor.cpp under method \ref cToolCursor::computeInteractionForces()
     Both variables m_interactionProjectedPoint and m_interactionInside are
-    assigned values based on the objects encountered by the proxy.
+    assigned values based on the objects encountered by the proxy. \n\n
+
+    If the collision detector supports distance queries (see 
+    \ref createSDFCollisionDetector()), the nearest surface point is looked 
+    up instead. When the tool penetrates deeper than the band of the distance 
+    field, the last surface point is kept.
 
     \param  a_toolPos  Position of the tool.
     \param  a_toolVel  Velocity of the tool.
@@ -1053,8 +1105,20 @@ void cMesh::computeLocalInteraction(const cVector3d& a_toolPos,
                                     const cVector3d& a_toolVel,
                                     const unsigned int a_IDN)
 {
-    // m_interactionProjectedPoint
-    // m_interactionInside
+    if (m_collisionDetector == NULL) { return; }
+
+    double distance = C_LARGE;
+    cVector3d normal;
+    if (m_collisionDetector->computeDistance(a_toolPos, distance, normal))
+    {
+        m_interactionNormal = normal;
+        a_toolPos.subr(cMul(distance, normal), m_interactionPoint);
+        m_interactionInside = (distance < 0.0);
+    }
+    else if (distance > 0.0)
+    {
+        m_interactionInside = false;
+    }
 }
 
 
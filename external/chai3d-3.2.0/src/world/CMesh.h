@@ -52,6 +52,7 @@
 #define CMeshH
 //------------------------------------------------------------------------------
 #include "world/CGenericObject.h"
+#include "collisions/CCollisionAABB.h"
 #include "materials/CMaterial.h"
 #include "materials/CTexture2d.h"
 #include "graphics/CColor.h"
@@ -297,7 +298,13 @@ public:
     virtual void createBruteForceCollisionDetector();
 
     //! This method builds an AABB collision detector for this mesh.
-    virtual void createAABBCollisionDetector(const double a_radius);
+    virtual void createAABBCollisionDetector(const double a_radius,
+                                             const cCollisionAABBBuildMethod a_buildMethod = C_AABB_BUILD_MIDPOINT);
+
+    //! This method builds a signed distance field collision detector for this mesh.
+    virtual void createSDFCollisionDetector(const double a_voxelSize,
+                                            const double a_bandWidth,
+                                            const std::string& a_filename = "");
 
 
     //--------------------------------------------------------------------------
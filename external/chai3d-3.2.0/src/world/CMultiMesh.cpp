@@ -965,6 +965,215 @@ bool cMultiMesh::computeCollisionDetection(const cVector3d& a_segmentPointA,
 }
 
 
+//==============================================================================
+/*!
+    This method determines whether a batch of segments intersects this object,
+    its meshes or any of its descendants. \n
+    Each query reports its collision events in its own recorder according to 
+    its own settings, exactly as if its segment were passed to 
+    \ref computeCollisionDetection(const cVector3d&, const cVector3d&, cCollisionRecorder&, cCollisionSettings&).
+    The flag \ref cCollisionQuery::m_hit of each query is set when a 
+    collision is detected.
+
+    \param  a_queries     Array of queries, expressed in the frame of the parent object.
+    \param  a_numQueries  Number of queries.
+
+    \return __true__ if one or more collisions have occurred, __false__ otherwise.
+*/
+//==============================================================================
+bool cMultiMesh::computeCollisionDetection(cCollisionQuery* a_queries,
+                                           const int a_numQueries)
+{
+    ///////////////////////////////////////////////////////////////////////////
+    // INITIALIZATION
+    ///////////////////////////////////////////////////////////////////////////
+
+    // check if node is a ghost. If yes, then ignore call
+    if (m_ghostEnabled) { return (false); }
+
+    // split large batches into packets
+    if (a_numQueries > C_COLLISION_PACKET_SIZE)
+    {
+        bool hit = false;
+        for (int i=0; i<a_numQueries; i+=C_COLLISION_PACKET_SIZE)
+        {
+            hit = hit | computeCollisionDetection(&a_queries[i], cMin(C_COLLISION_PACKET_SIZE, a_numQueries - i));
+        }
+        return (hit);
+    }
+
+    // temp variable
+    bool hit = false;
+
+    // get the transpose of the local rotation matrix
+    cMatrix3d transLocalRot;
+    m_localRot.transr(transLocalRot);
+
+    // convert segments into local coordinate frame
+    cCollisionQuery localQueries[C_COLLISION_PACKET_SIZE];
+    for (int i=0; i<a_numQueries; i++)
+    {
+        localQueries[i] = a_queries[i];
+        localQueries[i].m_hit = false;
+        localQueries[i].m_segmentPointA.sub(m_localPos);
+        transLocalRot.mul(localQueries[i].m_segmentPointA);
+        localQueries[i].m_segmentPointB.sub(m_localPos);
+        transLocalRot.mul(localQueries[i].m_segmentPointB);
+    }
+
+
+    ///////////////////////////////////////////////////////////////////////////
+    // CHECK COLLISIONS
+    ///////////////////////////////////////////////////////////////////////////
+
+    // select segments for which this object is checked, and adjust their first
+    // endpoint so that it is in the same position relative to the moving 
+    // object as it was at the previous haptic iteration
+    cCollisionQuery activeQueries[C_COLLISION_PACKET_SIZE];
+    int activeIndices[C_COLLISION_PACKET_SIZE];
+    int numActiveQueries = 0;
+    if (m_enabled)
+    {
+        for (int i=0; i<a_numQueries; i++)
+        {
+            const cCollisionSettings& settings = *localQueries[i].m_settings;
+            if ((settings.m_checkVisibleObjects && m_showEnabled) ||
+                (settings.m_checkHapticObjects && m_hapticEnabled))
+            {
+                cCollisionQuery& query = activeQueries[numActiveQueries];
+                query = localQueries[i];
+                if (settings.m_adjustObjectMotion)
+                {
+                    adjustCollisionSegment(localQueries[i].m_segmentPointA, query.m_segmentPointA);
+                }
+                activeIndices[numActiveQueries] = i;
+                numActiveQueries++;
+            }
+        }
+    }
+
+    if (numActiveQueries > 0)
+    {
+        // call the collision detector's collision detection function
+        if (m_collisionDetector != NULL)
+        {
+            m_collisionDetector->computeCollisions(this, activeQueries, numActiveQueries);
+        }
+
+        // compute any other collisions for segments which did not hit the 
+        // collision detector.
+        for (int i=0; i<numActiveQueries; i++)
+        {
+            cCollisionQuery& query = activeQueries[i];
+            if (!query.m_hit)
+            {
+                query.m_hit = computeOtherCollisionDetection(query.m_segmentPointA,
+                                                             query.m_segmentPointB,
+                                                             *query.m_recorder,
+                                                             *query.m_settings);
+            }
+
+            if (query.m_hit)
+            {
+                a_queries[activeIndices[i]].m_hit = true;
+                hit = true;
+            }
+        }
+    }
+
+
+    ///////////////////////////////////////////////////////////////////////////
+    // CHECK MESHES AND CHILDREN
+    ///////////////////////////////////////////////////////////////////////////
+
+    // check for collisions with all meshes of this object
+    for (unsigned int i=0; i<m_meshes->size(); i++)
+    {
+        m_meshes->at(i)->computeCollisionDetection(localQueries, a_numQueries);
+    }
+
+    // check for collisions with all children of this object
+    for (unsigned int i=0; i<m_children.size(); i++)
+    {
+        m_children[i]->computeCollisionDetection(localQueries, a_numQueries);
+    }
+
+    for (int i=0; i<a_numQueries; i++)
+    {
+        if (localQueries[i].m_hit)
+        {
+            a_queries[i].m_hit = true;
+            hit = true;
+        }
+    }
+
+
+    ///////////////////////////////////////////////////////////////////////////
+    // FINALIZE
+    ///////////////////////////////////////////////////////////////////////////
+
+    // return whether there was a collision between the segments and this object
+    return (hit);
+}
+
+
+//==============================================================================
+/*!
+    This method returns the boundary box, expressed in the local coordinates of 
+    this multi-mesh, that encloses every element tested by its own collision 
+    detector and by the collision detectors of its meshes. Children are not 
+    included.
+
+    \param  a_min  Returned lower corner of the boundary box.
+    \param  a_max  Returned upper corner of the boundary box.
+
+    \return __true__ if the elements are bounded, __false__ otherwise.
+*/
+//==============================================================================
+bool cMultiMesh::getCollisionBoundaryBox(cVector3d& a_min, cVector3d& a_max)
+{
+    // elements of the multi-mesh itself
+    if (!cGenericObject::getCollisionBoundaryBox(a_min, a_max))
+    {
+        return (false);
+    }
+
+    // elements of each mesh
+    vector<cMesh*>::iterator it;
+    for (it = m_meshes->begin(); it < m_meshes->end(); it++)
+    {
+        cMesh* mesh = (*it);
+
+        cVector3d min, max;
+        if (!mesh->getCollisionBoundaryBox(min, max))
+        {
+            return (false);
+        }
+
+        // skip meshes with nothing to collide with
+        if ((min(0) > max(0)) || (min(1) > max(1)) || (min(2) > max(2)))
+        {
+            continue;
+        }
+
+        // express the box of the mesh in the frame of the multi-mesh
+        cVector3d center = mesh->getLocalPos() + mesh->getLocalRot() * (0.5 * (min + max));
+        cVector3d extent = 0.5 * (max - min);
+        cMatrix3d rot = mesh->getLocalRot();
+        for (int i=0; i<3; i++)
+        {
+            double e = fabs(rot(i,0)) * extent(0) +
+                       fabs(rot(i,1)) * extent(1) +
+                       fabs(rot(i,2)) * extent(2);
+            a_min(i) = cMin(a_min(i), center(i) - e);
+            a_max(i) = cMax(a_max(i), center(i) + e);
+        }
+    }
+
+    return (true);
+}
+
+
 //==============================================================================
 /*!
     This method enables or disables graphic representation of the collision 
@@ -1927,15 +2136,50 @@ void cMultiMesh::createBruteForceCollisionDetector()
 /*!
     This method builds an AABB collision detector for this mesh.
 
-    \param  a_radius  Bounding radius.
+    \param  a_radius       Bounding radius.
+    \param  a_buildMethod  Algorithm used to build the collision tree.
 */
 //==============================================================================
-void cMultiMesh::createAABBCollisionDetector(const double a_radius)
+void cMultiMesh::createAABBCollisionDetector(const double a_radius,
+                                             const cCollisionAABBBuildMethod a_buildMethod)
 {
     vector<cMesh*>::iterator it;
     for (it = m_meshes->begin(); it < m_meshes->end(); it++)
     {
-        (*it)->createAABBCollisionDetector(a_radius);
+        (*it)->createAABBCollisionDetector(a_radius, a_buildMethod);
+    }
+}
+
+
+//==============================================================================
+/*!
+    This method builds a signed distance field collision detector for each 
+    mesh. When several meshes are cached, the index of each mesh is appended 
+    to the name of its cache file. To render the meshes with the distance 
+    field only, create a surface effect on each mesh (see 
+    cMesh::createSDFCollisionDetector()).
+
+    \param  a_voxelSize  Size of a cell of the distance fields.
+    \param  a_bandWidth  Distance from the surface up to which distances are stored.
+    \param  a_filename   Name of the cache file, or an empty string to disable caching.
+*/
+//==============================================================================
+void cMultiMesh::createSDFCollisionDetector(const double a_voxelSize,
+                                            const double a_bandWidth,
+                                            const std::string& a_filename)
+{
+    string extension = cGetFileExtension(a_filename, true);
+    string base = a_filename.substr(0, a_filename.length() - extension.length());
+
+    int numMeshes = (int)(m_meshes->size());
+    for (int i=0; i<numMeshes; i++)
+    {
+        string filename = a_filename;
+        if ((a_filename != "") && (numMeshes > 1))
+        {
+            filename = base + "-" + cStr(i) + extension;
+        }
+        m_meshes->at(i)->createSDFCollisionDetector(a_voxelSize, a_bandWidth, filename);
     }
 }
 
@@ -239,6 +239,10 @@ public:
                                            cCollisionRecorder& a_recorder,
                                            cCollisionSettings& a_settings);
 
+    //! This method computes any collision between a batch of segments and this object.
+    virtual bool computeCollisionDetection(cCollisionQuery* a_queries,
+                                           const int a_numQueries);
+
     //! This method enables or disables the display of the collision detector, optionally propagating the change to its children.
     virtual void setShowCollisionDetector(const bool a_showCollisionDetector, 
                                           const bool a_affectChildren = false);
@@ -248,11 +252,20 @@ public:
                                                 cColorf& a_color, 
                                                 const bool a_affectChildren = false);
 
+    //! This method returns the local boundary box of the elements this multi-mesh and its meshes can collide with.
+    virtual bool getCollisionBoundaryBox(cVector3d& a_min, cVector3d& a_max);
+
     //! Set up a brute force collision detector for this mesh and (optionally) for its children.
     virtual void createBruteForceCollisionDetector();
 
     //! Set up an AABB collision detector for this mesh.
-    virtual void createAABBCollisionDetector(const double a_radius);
+    virtual void createAABBCollisionDetector(const double a_radius,
+                                             const cCollisionAABBBuildMethod a_buildMethod = C_AABB_BUILD_MIDPOINT);
+
+    //! Set up a signed distance field collision detector for each mesh.
+    virtual void createSDFCollisionDetector(const double a_voxelSize,
+                                            const double a_bandWidth,
+                                            const std::string& a_filename = "");
 
 
     //-----------------------------------------------------------------------
@@ -174,11 +174,18 @@ void cMultiPoint::copyMultiPointProperties(cMultiPoint* a_obj,
         if (a_buildCollisionDetector)
         {
             double radius = 0.0;
+            cCollisionAABBBuildMethod buildMethod = C_AABB_BUILD_MIDPOINT;
             if (m_collisionDetector)
             {
                 radius = m_collisionDetector->getBoundaryRadius();
+
+                cCollisionAABB* collisionAABB = dynamic_cast<cCollisionAABB*>(m_collisionDetector);
+                if (collisionAABB != NULL)
+                {
+                    buildMethod = collisionAABB->getBuildMethod();
+                }
             }
-            a_obj->createAABBCollisionDetector(radius);
+            a_obj->createAABBCollisionDetector(radius, buildMethod);
         }
     }
     else
@@ -517,7 +524,7 @@ void cMultiPoint::offsetVertices(const cVector3d& a_offset,
     // update collision detector if requested
     if (a_updateCollisionDetector && m_collisionDetector)
     {
-        m_collisionDetector->update();
+        m_collisionDetector->refit();
     }
 }
 
@@ -603,10 +610,12 @@ void cMultiPoint::createBruteForceCollisionDetector()
 /*!
     This method builds an AABB collision detector for this point cloud.
 
-    \param  a_radius  Bounding radius.
+    \param  a_radius       Bounding radius.
+    \param  a_buildMethod  Algorithm used to build the collision tree.
 */
 //==============================================================================
-void cMultiPoint::createAABBCollisionDetector(const double a_radius)
+void cMultiPoint::createAABBCollisionDetector(const double a_radius,
+                                              const cCollisionAABBBuildMethod a_buildMethod)
 {
     // delete previous collision detector
     if (m_collisionDetector != NULL)
@@ -617,7 +626,7 @@ void cMultiPoint::createAABBCollisionDetector(const double a_radius)
 
     // create AABB collision detector
     cCollisionAABB* collisionDetector = new cCollisionAABB();
-    collisionDetector->initialize(m_points, a_radius);
+    collisionDetector->initialize(m_points, a_radius, a_buildMethod);
 
     // assign new collision detector
     m_collisionDetector = collisionDetector;
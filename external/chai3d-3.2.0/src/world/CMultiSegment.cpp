@@ -177,11 +177,18 @@ void cMultiSegment::copyMultiSegmentProperties(cMultiSegment* a_obj,
         if (a_buildCollisionDetector)
         {
             double radius = 0.0;
+            cCollisionAABBBuildMethod buildMethod = C_AABB_BUILD_MIDPOINT;
             if (m_collisionDetector)
             {
                 radius = m_collisionDetector->getBoundaryRadius();
+
+                cCollisionAABB* collisionAABB = dynamic_cast<cCollisionAABB*>(m_collisionDetector);
+                if (collisionAABB != NULL)
+                {
+                    buildMethod = collisionAABB->getBuildMethod();
+                }
             }
-            a_obj->createAABBCollisionDetector(radius);
+            a_obj->createAABBCollisionDetector(radius, buildMethod);
         }
     }
     else
@@ -531,7 +538,7 @@ void cMultiSegment::offsetVertices(const cVector3d& a_offset,
     // update collision detector if requested
     if (a_updateCollisionDetector && m_collisionDetector)
     {
-        m_collisionDetector->update();
+        m_collisionDetector->refit();
     }
 }
 
@@ -627,10 +634,12 @@ void cMultiSegment::createBruteForceCollisionDetector()
     This method builds an AABB collision detector for this multi-segment 
     object.
 
-    \param  a_radius  Bounding radius.
+    \param  a_radius       Bounding radius.
+    \param  a_buildMethod  Algorithm used to build the collision tree.
 */
 //==============================================================================
-void cMultiSegment::createAABBCollisionDetector(const double a_radius)
+void cMultiSegment::createAABBCollisionDetector(const double a_radius,
+                                                const cCollisionAABBBuildMethod a_buildMethod)
 {
     // delete previous collision detector
     if (m_collisionDetector != NULL)
@@ -641,7 +650,7 @@ void cMultiSegment::createAABBCollisionDetector(const double a_radius)
 
     // create AABB collision detector
     cCollisionAABB* collisionDetector = new cCollisionAABB();
-    collisionDetector->initialize(m_segments, a_radius);
+    collisionDetector->initialize(m_segments, a_radius, a_buildMethod);
 
     // assign new collision detector
     m_collisionDetector = collisionDetector;
@@ -345,6 +345,8 @@ void cShapeCylinder::updateBoundaryBox()
 
     m_boundaryBoxMin.set(-rad, -rad, 0.0);
     m_boundaryBoxMax.set( rad,  rad, m_height);
+
+    m_boundaryBoxEmpty = false;
 }
 
 
@@ -79,6 +79,9 @@ cShapeEllipsoid::cShapeEllipsoid(const double& a_radiusX,
     m_radiusY = fabs(a_radiusY);
     m_radiusZ = fabs(a_radiusZ);
 
+    // update bounding box
+    updateBoundaryBox();
+
     // set material properties
     if (a_material == nullptr)
     {
@@ -408,6 +411,8 @@ void cShapeEllipsoid::updateBoundaryBox()
 {
     m_boundaryBoxMin.set(-m_radiusX, -m_radiusY, -m_radiusZ);
     m_boundaryBoxMax.set( m_radiusX,  m_radiusY,  m_radiusZ);
+
+    m_boundaryBoxEmpty = false;
 }
 
 
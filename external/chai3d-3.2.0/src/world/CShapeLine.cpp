@@ -368,6 +368,8 @@ void cShapeLine::updateBoundaryBox()
     m_boundaryBoxMax.set(cMax(m_linePointA(0) , m_linePointB(0) ),
                          cMax(m_linePointA(1) , m_linePointB(1) ),
                          cMax(m_linePointA(2) , m_linePointB(2) ));
+
+    m_boundaryBoxEmpty = false;
 }
 
 
@@ -73,6 +73,9 @@ cShapeSphere::cShapeSphere(const double& a_radius,
     // initialize radius of sphere
     m_radius = fabs(a_radius);
 
+    // update bounding box
+    updateBoundaryBox();
+
     // set material properties
     if (a_material == nullptr)
     {
@@ -317,6 +320,8 @@ void cShapeSphere::updateBoundaryBox()
 {
     m_boundaryBoxMin.set(-m_radius, -m_radius, -m_radius);
     m_boundaryBoxMax.set( m_radius,  m_radius,  m_radius);
+
+    m_boundaryBoxEmpty = false;
 }
 
 
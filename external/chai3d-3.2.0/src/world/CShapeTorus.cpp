@@ -331,6 +331,8 @@ void cShapeTorus::updateBoundaryBox()
     double width = m_outerRadius + m_innerRadius;
     m_boundaryBoxMin.set(-width, -width,-m_innerRadius);
     m_boundaryBoxMax.set( width,  width, m_innerRadius);
+
+    m_boundaryBoxEmpty = false;
 }
 
 
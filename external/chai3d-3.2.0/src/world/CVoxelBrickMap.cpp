@@ -0,0 +1,795 @@
+//==============================================================================
+/*
+    Software License Agreement (BSD License)
+    Copyright (c) 2003-2016, CHAI3D.
+    (www.chai3d.org)
+
+    All rights reserved.
+
+    Redistribution and use in source and binary forms, with or without
+    modification, are permitted provided that the following conditions
+    are met:
+
+    * Redistributions of source code must retain the above copyright
+    notice, this list of conditions and the following disclaimer.
+
+    * Redistributions in binary form must reproduce the above
+    copyright notice, this list of conditions and the following
+    disclaimer in the documentation and/or other materials provided
+    with the distribution.
+
+    * Neither the name of CHAI3D nor the names of its contributors may
+    be used to endorse or promote products derived from this software
+    without specific prior written permission.
+
+    THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS
+    "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT
+    LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS
+    FOR A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE
+    COPYRIGHT OWNER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT,
+    INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING,
+    BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES;
+    LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER
+    CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT
+    LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN
+    ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+    POSSIBILITY OF SUCH DAMAGE. 
+
+    \author    <http://www.chai3d.org>
+    \version   3.2.0 $Rev: 2183 $
+*/
+//==============================================================================
+
+//------------------------------------------------------------------------------
+#include "world/CVoxelBrickMap.h"
+//------------------------------------------------------------------------------
+#include "graphics/CMultiImage.h"
+#include "math/CConstants.h"
+//------------------------------------------------------------------------------
+using namespace std;
+//------------------------------------------------------------------------------
+
+//------------------------------------------------------------------------------
+namespace chai3d {
+//------------------------------------------------------------------------------
+
+//==============================================================================
+/*!
+    \struct     cVoxelBrickReader
+    \ingroup    world
+
+    \brief
+    This structure reads the occupancy of the voxels of an image.
+
+    \details
+    Voxels of 8-bit RGBA and luminance volumes are read directly from the 
+    image array. Other images are read through cImage::getVoxelColor().
+*/
+//==============================================================================
+struct cVoxelBrickReader
+{
+    //! Constructor of cVoxelBrickReader.
+    cVoxelBrickReader(cImage* a_image, const int a_alphaThreshold)
+    {
+        m_image = a_image;
+        m_data = NULL;
+        m_bytesPerPixel = 0;
+        m_alphaOffset = 0;
+        m_alphaThreshold = a_alphaThreshold;
+        m_width = a_image->getWidth();
+        m_height = a_image->getHeight();
+
+        cMultiImage* image = dynamic_cast<cMultiImage*>(a_image);
+        if ((image != NULL) && (image->getType() == GL_UNSIGNED_BYTE))
+        {
+            if (image->getFormat() == GL_RGBA)
+            {
+                m_data = image->getArray();
+                m_bytesPerPixel = 4;
+                m_alphaOffset = 3;
+            }
+            else if (image->getFormat() == GL_LUMINANCE)
+            {
+                m_data = image->getArray();
+                m_bytesPerPixel = 1;
+                m_alphaOffset = 0;
+            }
+        }
+    }
+
+    //! This method returns __true__ if a voxel of the image is occupied.
+    inline bool read(const int a_x, const int a_y, const int a_z) const
+    {
+        if (m_data != NULL)
+        {
+            size_t index = ((size_t)a_z * m_height + a_y) * m_width + a_x;
+            return (m_data[m_bytesPerPixel * index + m_alphaOffset] >= m_alphaThreshold);
+        }
+
+        cColorb color;
+        if (!m_image->getVoxelColor(a_x, a_y, a_z, color)) { return (false); }
+        return (color.getA() >= m_alphaThreshold);
+    }
+
+    //! Image.
+    cImage* m_image;
+
+    //! Array of 8-bit voxels, or __NULL__ if the image is read through cImage::getVoxelColor().
+    const unsigned char* m_data;
+
+    //! Number of bytes per voxel.
+    int m_bytesPerPixel;
+
+    //! Offset of the alpha value in each voxel.
+    int m_alphaOffset;
+
+    //! Alpha value from which a voxel is occupied.
+    int m_alphaThreshold;
+
+    //! Width of the image.
+    size_t m_width;
+
+    //! Height of the image.
+    size_t m_height;
+};
+
+
+//==============================================================================
+/*!
+    Constructor of cVoxelBrickMap.
+*/
+//==============================================================================
+cVoxelBrickMap::cVoxelBrickMap()
+{
+    clear();
+}
+
+
+//==============================================================================
+/*!
+    This method clears the map.
+*/
+//==============================================================================
+void cVoxelBrickMap::clear()
+{
+    m_image = NULL;
+    for (int i=0; i<3; i++)
+    {
+        m_size[i] = 0;
+        m_numBricks[i] = 0;
+    }
+    m_alphaThreshold = 256;
+    m_threshold = -1.0f;
+    m_numVoxels = 0;
+    m_brickIndices.clear();
+    m_bricks.clear();
+    m_nodes.clear();
+}
+
+
+//==============================================================================
+/*!
+    This method builds the map from the voxels of an image whose alpha value 
+    is greater or equal to a threshold. The alpha value of a voxel is 
+    converted to the range [0.0, 1.0] before being compared to the threshold.
+
+    \param  a_image      Image.
+    \param  a_threshold  Threshold.
+
+    \return __true__ if the operation succeeds, __false__ otherwise.
+*/
+//==============================================================================
+bool cVoxelBrickMap::build(cImage* a_image, const float a_threshold)
+{
+    clear();
+
+    // sanity check
+    if (a_image == NULL) { return (false); }
+
+    m_size[0] = (int)a_image->getWidth();
+    m_size[1] = (int)a_image->getHeight();
+    m_size[2] = (int)a_image->getImageCount();
+    if ((m_size[0] <= 0) || (m_size[1] <= 0) || (m_size[2] <= 0))
+    {
+        clear();
+        return (false);
+    }
+
+    m_image = a_image;
+    m_threshold = a_threshold;
+
+    // find the smallest alpha value which passes the threshold
+    const float CONVERSION_FACTOR = (1.0f / 255.0f);
+    m_alphaThreshold = 0;
+    while ((m_alphaThreshold < 256) && ((CONVERSION_FACTOR * (float)m_alphaThreshold) < a_threshold))
+    {
+        m_alphaThreshold++;
+    }
+
+    // allocate bricks and octree levels
+    for (int i=0; i<3; i++)
+    {
+        m_numBricks[i] = (m_size[i] + C_VOXEL_BRICK_SIZE - 1) / C_VOXEL_BRICK_SIZE;
+    }
+    m_brickIndices.assign((size_t)m_numBricks[0] * m_numBricks[1] * m_numBricks[2], -1);
+
+    int level = 1;
+    while ((((m_numBricks[0] - 1) >> (level - 1)) > 0) || 
+           (((m_numBricks[1] - 1) >> (level - 1)) > 0) || 
+           (((m_numBricks[2] - 1) >> (level - 1)) > 0))
+    {
+        size_t numNodes = 1;
+        for (int i=0; i<3; i++)
+        {
+            numNodes *= (size_t)(((m_numBricks[i] - 1) >> level) + 1);
+        }
+        m_nodes.push_back(vector<int>(numNodes, 0));
+        level++;
+    }
+
+    // read voxels brick by brick
+    cVoxelBrickReader reader(a_image, m_alphaThreshold);
+    for (int bz=0; bz<m_numBricks[2]; bz++)
+    {
+        for (int by=0; by<m_numBricks[1]; by++)
+        {
+            for (int bx=0; bx<m_numBricks[0]; bx++)
+            {
+                cVoxelBrick brick;
+                brick.m_numVoxels = 0;
+
+                int numX = cMin(C_VOXEL_BRICK_SIZE, m_size[0] - bx * C_VOXEL_BRICK_SIZE);
+                int numY = cMin(C_VOXEL_BRICK_SIZE, m_size[1] - by * C_VOXEL_BRICK_SIZE);
+                int numZ = cMin(C_VOXEL_BRICK_SIZE, m_size[2] - bz * C_VOXEL_BRICK_SIZE);
+                for (int z=0; z<C_VOXEL_BRICK_SIZE; z++)
+                {
+                    brick.m_mask[z] = 0;
+                    if (z >= numZ) { continue; }
+
+                    for (int y=0; y<numY; y++)
+                    {
+                        for (int x=0; x<numX; x++)
+                        {
+                            if (reader.read(bx * C_VOXEL_BRICK_SIZE + x, by * C_VOXEL_BRICK_SIZE + y, bz * C_VOXEL_BRICK_SIZE + z))
+                            {
+                                brick.m_mask[z] |= 1ull << (y * C_VOXEL_BRICK_SIZE + x);
+                                brick.m_numVoxels++;
+                            }
+                        }
+                    }
+                }
+
+                if (brick.m_numVoxels > 0)
+                {
+                    size_t index = ((size_t)bz * m_numBricks[1] + by) * m_numBricks[0] + bx;
+                    m_brickIndices[index] = (int)m_bricks.size();
+                    m_bricks.push_back(brick);
+                    m_numVoxels += brick.m_numVoxels;
+
+                    for (int l=1; l<=(int)m_nodes.size(); l++)
+                    {
+                        size_t node = ((size_t)(bz >> l) * (((m_numBricks[1] - 1) >> l) + 1) + (by >> l)) * (((m_numBricks[0] - 1) >> l) + 1) + (bx >> l);
+                        m_nodes[l - 1][node]++;
+                    }
+                }
+            }
+        }
+    }
+
+    return (true);
+}
+
+
+//==============================================================================
+/*!
+    This method updates the map from the voxels of an image located in a 
+    region. The image must have the size of the image from which the map 
+    was built.
+
+    \param  a_image  Image.
+    \param  a_minX   Lowest voxel index along __x__.
+    \param  a_minY   Lowest voxel index along __y__.
+    \param  a_minZ   Lowest voxel index along __z__.
+    \param  a_maxX   Highest voxel index along __x__.
+    \param  a_maxY   Highest voxel index along __y__.
+    \param  a_maxZ   Highest voxel index along __z__.
+*/
+//==============================================================================
+void cVoxelBrickMap::update(cImage* a_image, int a_minX, int a_minY, int a_minZ, int a_maxX, int a_maxY, int a_maxZ)
+{
+    // sanity check
+    if ((a_image == NULL) || (m_brickIndices.size() == 0)) { return; }
+
+    a_minX = cMax(a_minX, 0);
+    a_minY = cMax(a_minY, 0);
+    a_minZ = cMax(a_minZ, 0);
+    a_maxX = cMin(a_maxX, m_size[0] - 1);
+    a_maxY = cMin(a_maxY, m_size[1] - 1);
+    a_maxZ = cMin(a_maxZ, m_size[2] - 1);
+
+    cVoxelBrickReader reader(a_image, m_alphaThreshold);
+    for (int z=a_minZ; z<=a_maxZ; z++)
+    {
+        for (int y=a_minY; y<=a_maxY; y++)
+        {
+            for (int x=a_minX; x<=a_maxX; x++)
+            {
+                setVoxel(x, y, z, reader.read(x, y, z));
+            }
+        }
+    }
+}
+
+
+//==============================================================================
+/*!
+    This method returns __true__ if the map was built from an image and with 
+    a threshold, and if the size of the image has not changed since.
+
+    \param  a_image      Image.
+    \param  a_threshold  Threshold.
+
+    \return __true__ if the map is up to date, __false__ otherwise.
+*/
+//==============================================================================
+bool cVoxelBrickMap::isBuilt(const cImage* a_image, const float a_threshold) const
+{
+    return ((a_image != NULL) &&
+            (a_image == m_image) &&
+            (a_threshold == m_threshold) &&
+            ((int)a_image->getWidth() == m_size[0]) &&
+            ((int)a_image->getHeight() == m_size[1]) &&
+            ((int)a_image->getImageCount() == m_size[2]));
+}
+
+
+//==============================================================================
+/*!
+    This method sets the occupancy of a voxel. Voxels located outside of the 
+    volume are ignored.
+
+    \param  a_x         Voxel index along __x__.
+    \param  a_y         Voxel index along __y__.
+    \param  a_z         Voxel index along __z__.
+    \param  a_occupied  Occupancy of the voxel.
+*/
+//==============================================================================
+void cVoxelBrickMap::setVoxel(const int a_x, const int a_y, const int a_z, const bool a_occupied)
+{
+    if ((a_x < 0) || (a_y < 0) || (a_z < 0) || (a_x >= m_size[0]) || (a_y >= m_size[1]) || (a_z >= m_size[2])) { return; }
+
+    int bx = a_x / C_VOXEL_BRICK_SIZE;
+    int by = a_y / C_VOXEL_BRICK_SIZE;
+    int bz = a_z / C_VOXEL_BRICK_SIZE;
+    size_t brickIndex = ((size_t)bz * m_numBricks[1] + by) * m_numBricks[0] + bx;
+
+    // allocate brick
+    int index = m_brickIndices[brickIndex];
+    if (index < 0)
+    {
+        if (!a_occupied) { return; }
+
+        cVoxelBrick brick;
+        for (int i=0; i<C_VOXEL_BRICK_SIZE; i++)
+        {
+            brick.m_mask[i] = 0;
+        }
+        brick.m_numVoxels = 0;
+
+        index = (int)m_bricks.size();
+        m_brickIndices[brickIndex] = index;
+        m_bricks.push_back(brick);
+    }
+
+    // update voxel
+    cVoxelBrick& brick = m_bricks[index];
+    unsigned long long bit = 1ull << ((a_y % C_VOXEL_BRICK_SIZE) * C_VOXEL_BRICK_SIZE + (a_x % C_VOXEL_BRICK_SIZE));
+    unsigned long long& mask = brick.m_mask[a_z % C_VOXEL_BRICK_SIZE];
+    if (((mask & bit) != 0) == a_occupied) { return; }
+
+    int delta = 0;
+    if (a_occupied)
+    {
+        mask |= bit;
+        brick.m_numVoxels++;
+        m_numVoxels++;
+        if (brick.m_numVoxels == 1) { delta = 1; }
+    }
+    else
+    {
+        mask &= ~bit;
+        brick.m_numVoxels--;
+        m_numVoxels--;
+        if (brick.m_numVoxels == 0) { delta = -1; }
+    }
+
+    // update nodes of the octree if the brick became empty or occupied
+    if (delta != 0)
+    {
+        for (int l=1; l<=(int)m_nodes.size(); l++)
+        {
+            size_t node = ((size_t)(bz >> l) * (((m_numBricks[1] - 1) >> l) + 1) + (by >> l)) * (((m_numBricks[0] - 1) >> l) + 1) + (bx >> l);
+            m_nodes[l - 1][node] += delta;
+        }
+    }
+}
+
+
+//==============================================================================
+/*!
+    This method returns __true__ if a voxel is occupied.
+
+    \param  a_x  Voxel index along __x__.
+    \param  a_y  Voxel index along __y__.
+    \param  a_z  Voxel index along __z__.
+
+    \return __true__ if the voxel is occupied, __false__ otherwise.
+*/
+//==============================================================================
+bool cVoxelBrickMap::getVoxel(const int a_x, const int a_y, const int a_z) const
+{
+    if ((a_x < 0) || (a_y < 0) || (a_z < 0) || (a_x >= m_size[0]) || (a_y >= m_size[1]) || (a_z >= m_size[2])) { return (false); }
+
+    size_t brickIndex = ((size_t)(a_z / C_VOXEL_BRICK_SIZE) * m_numBricks[1] + (a_y / C_VOXEL_BRICK_SIZE)) * m_numBricks[0] + (a_x / C_VOXEL_BRICK_SIZE);
+    int index = m_brickIndices[brickIndex];
+    if (index < 0) { return (false); }
+
+    unsigned long long bit = 1ull << ((a_y % C_VOXEL_BRICK_SIZE) * C_VOXEL_BRICK_SIZE + (a_x % C_VOXEL_BRICK_SIZE));
+    return ((m_bricks[index].m_mask[a_z % C_VOXEL_BRICK_SIZE] & bit) != 0);
+}
+
+
+//==============================================================================
+/*!
+    This method returns the number of occupied voxels located in a region. 
+    Bricks which are empty or entirely covered by the region are counted 
+    without reading their voxels.
+
+    \param  a_minX  Lowest voxel index along __x__.
+    \param  a_minY  Lowest voxel index along __y__.
+    \param  a_minZ  Lowest voxel index along __z__.
+    \param  a_maxX  Highest voxel index along __x__.
+    \param  a_maxY  Highest voxel index along __y__.
+    \param  a_maxZ  Highest voxel index along __z__.
+
+    \return Number of occupied voxels located in the region.
+*/
+//==============================================================================
+long long cVoxelBrickMap::countVoxels(int a_minX, int a_minY, int a_minZ, int a_maxX, int a_maxY, int a_maxZ) const
+{
+    // clamp region to the volume
+    int vmin[3] = { cMax(a_minX, 0), cMax(a_minY, 0), cMax(a_minZ, 0) };
+    int vmax[3] = { cMin(a_maxX, m_size[0] - 1), cMin(a_maxY, m_size[1] - 1), cMin(a_maxZ, m_size[2] - 1) };
+    if ((vmin[0] > vmax[0]) || (vmin[1] > vmax[1]) || (vmin[2] > vmax[2]))
+    {
+        return (0);
+    }
+
+    long long result = 0;
+    for (int bz = vmin[2] / C_VOXEL_BRICK_SIZE; bz <= vmax[2] / C_VOXEL_BRICK_SIZE; bz++)
+    {
+        for (int by = vmin[1] / C_VOXEL_BRICK_SIZE; by <= vmax[1] / C_VOXEL_BRICK_SIZE; by++)
+        {
+            for (int bx = vmin[0] / C_VOXEL_BRICK_SIZE; bx <= vmax[0] / C_VOXEL_BRICK_SIZE; bx++)
+            {
+                int index = m_brickIndices[((size_t)bz * m_numBricks[1] + by) * m_numBricks[0] + bx];
+                if ((index < 0) || (m_bricks[index].m_numVoxels == 0)) { continue; }
+
+                // range of voxels of the brick located in the region
+                int b[3] = { bx, by, bz };
+                int lmin[3], lmax[3];
+                bool covered = true;
+                for (int i=0; i<3; i++)
+                {
+                    lmin[i] = cMax(vmin[i] - b[i] * C_VOXEL_BRICK_SIZE, 0);
+                    lmax[i] = cMin(vmax[i] - b[i] * C_VOXEL_BRICK_SIZE, C_VOXEL_BRICK_SIZE - 1);
+                    if ((lmin[i] > 0) || (lmax[i] < C_VOXEL_BRICK_SIZE - 1)) { covered = false; }
+                }
+
+                // brick is entirely located in the region
+                const cVoxelBrick& brick = m_bricks[index];
+                if (covered)
+                {
+                    result += brick.m_numVoxels;
+                    continue;
+                }
+
+                // mask of the voxels of a slice located in the region
+                unsigned long long row = ((1ull << (lmax[0] + 1)) - 1) & ~((1ull << lmin[0]) - 1);
+                unsigned long long mask = 0;
+                for (int y = lmin[1]; y <= lmax[1]; y++)
+                {
+                    mask |= row << (y * C_VOXEL_BRICK_SIZE);
+                }
+
+                // count voxels slice by slice
+                for (int z = lmin[2]; z <= lmax[2]; z++)
+                {
+                    unsigned long long bits = brick.m_mask[z] & mask;
+                    while (bits != 0)
+                    {
+                        bits &= bits - 1;
+                        result++;
+                    }
+                }
+            }
+        }
+    }
+
+    return (result);
+}
+
+
+//==============================================================================
+/*!
+    This method returns the number of bricks which contain occupied voxels.
+
+    \return Number of occupied bricks.
+*/
+//==============================================================================
+int cVoxelBrickMap::getNumOccupiedBricks() const
+{
+    int result = 0;
+    for (unsigned int i=0; i<m_bricks.size(); i++)
+    {
+        if (m_bricks[i].m_numVoxels > 0) { result++; }
+    }
+    return (result);
+}
+
+
+//==============================================================================
+/*!
+    This method returns the number of bytes used by the map.
+
+    \return Size of the map in bytes.
+*/
+//==============================================================================
+size_t cVoxelBrickMap::getMemorySize() const
+{
+    size_t result = m_brickIndices.capacity() * sizeof(int) + m_bricks.capacity() * sizeof(cVoxelBrick);
+    for (unsigned int i=0; i<m_nodes.size(); i++)
+    {
+        result += m_nodes[i].capacity() * sizeof(int);
+    }
+    return (result);
+}
+
+
+//==============================================================================
+/*!
+    This method visits the occupied voxels located close to a segment, from 
+    front to back.\n\n
+
+    The visitor is called for each occupied voxel whose box, enlarged by 
+    \p a_padding, is crossed by the segment. It returns the position along 
+    the segment, between 0.0 (point A) and 1.0 (point B), at which the 
+    segment hits the voxel, or a larger value if the segment misses the 
+    voxel. Hits must be located inside the enlarged box of the voxel. Nodes 
+    which the segment enters after the nearest hit found so far are not 
+    visited.
+
+    \param  a_segmentPointA  Start point of segment in voxel coordinates.
+    \param  a_segmentPointB  End point of segment in voxel coordinates.
+    \param  a_padding        Distance by which the voxel boxes are enlarged along each axis.
+    \param  a_visitor        Function called for each occupied voxel.
+
+    \return Smallest value returned by the visitor, or __C_LARGE__ if no voxel was visited.
+*/
+//==============================================================================
+double cVoxelBrickMap::computeSegmentTraversal(const cVector3d& a_segmentPointA,
+                                               const cVector3d& a_segmentPointB,
+                                               const cVector3d& a_padding,
+                                               const std::function<double(int, int, int)>& a_visitor) const
+{
+    double nearest = C_LARGE;
+    if (m_numVoxels == 0) { return (nearest); }
+
+    cVoxelBrickTraversal traversal;
+    traversal.m_pointA = a_segmentPointA;
+    traversal.m_dir = a_segmentPointB - a_segmentPointA;
+    traversal.m_padding = a_padding;
+    traversal.m_visitor = &a_visitor;
+
+    // start from the smallest node which contains the padded segment. the 
+    // root node covers the entire volume.
+    int rootLevel = 3 + (int)m_nodes.size();
+    int lo[3], hi[3];
+    for (int i=0; i<3; i++)
+    {
+        double a = cMin(a_segmentPointA(i), a_segmentPointB(i)) - a_padding(i);
+        double b = cMax(a_segmentPointA(i), a_segmentPointB(i)) + a_padding(i);
+        if ((b < 0.0) || (a > (double)m_size[i])) { return (nearest); }
+
+        lo[i] = (int)floor(cClamp(a, 0.0, (double)(m_size[i] - 1)));
+        hi[i] = (int)floor(cClamp(b, 0.0, (double)(m_size[i] - 1)));
+    }
+
+    int level = 0;
+    while ((level < rootLevel) && 
+           (((lo[0] >> level) != (hi[0] >> level)) || 
+            ((lo[1] >> level) != (hi[1] >> level)) || 
+            ((lo[2] >> level) != (hi[2] >> level))))
+    {
+        level++;
+    }
+
+    int x = lo[0] >> level;
+    int y = lo[1] >> level;
+    int z = lo[2] >> level;
+    double enter;
+    if (isNodeOccupied(level, x, y, z) && intersectNode(traversal, level, x, y, z, enter))
+    {
+        traverseNode(traversal, level, x, y, z, nearest);
+    }
+
+    return (nearest);
+}
+
+
+//==============================================================================
+/*!
+    This method returns __true__ if a node contains occupied voxels. A node of 
+    level l covers 2^l voxels along each axis, so nodes of level 3 are bricks.
+
+    \param  a_level  Level of the node.
+    \param  a_x      Index of the node along __x__.
+    \param  a_y      Index of the node along __y__.
+    \param  a_z      Index of the node along __z__.
+
+    \return __true__ if the node contains occupied voxels, __false__ otherwise.
+*/
+//==============================================================================
+bool cVoxelBrickMap::isNodeOccupied(const int a_level, const int a_x, const int a_y, const int a_z) const
+{
+    // node of the octree
+    if (a_level > 3)
+    {
+        int l = a_level - 3;
+        size_t node = ((size_t)a_z * (((m_numBricks[1] - 1) >> l) + 1) + a_y) * (((m_numBricks[0] - 1) >> l) + 1) + a_x;
+        return (m_nodes[l - 1][node] > 0);
+    }
+
+    // brick
+    int shift = 3 - a_level;
+    size_t brickIndex = ((size_t)(a_z >> shift) * m_numBricks[1] + (a_y >> shift)) * m_numBricks[0] + (a_x >> shift);
+    int index = m_brickIndices[brickIndex];
+    if (index < 0) { return (false); }
+
+    const cVoxelBrick& brick = m_bricks[index];
+    if (a_level == 3) { return (brick.m_numVoxels > 0); }
+
+    // block of voxels inside a brick
+    int size = 1 << a_level;
+    int x = (a_x << a_level) % C_VOXEL_BRICK_SIZE;
+    int y = (a_y << a_level) % C_VOXEL_BRICK_SIZE;
+    int z = (a_z << a_level) % C_VOXEL_BRICK_SIZE;
+
+    unsigned long long row = ((1ull << size) - 1) << x;
+    unsigned long long block = 0;
+    for (int j=0; j<size; j++)
+    {
+        block |= row << ((y + j) * C_VOXEL_BRICK_SIZE);
+    }
+
+    for (int k=0; k<size; k++)
+    {
+        if ((brick.m_mask[z + k] & block) != 0) { return (true); }
+    }
+    return (false);
+}
+
+
+//==============================================================================
+/*!
+    This method computes the position along the segment at which the segment 
+    enters the padded box of a node.
+
+    \param  a_traversal  Segment being traversed.
+    \param  a_level      Level of the node.
+    \param  a_x          Index of the node along __x__.
+    \param  a_y          Index of the node along __y__.
+    \param  a_z          Index of the node along __z__.
+    \param  a_enter      Returned position along the segment, between 0.0 and 1.0.
+
+    \return __true__ if the segment crosses the box, __false__ otherwise.
+*/
+//==============================================================================
+bool cVoxelBrickMap::intersectNode(const cVoxelBrickTraversal& a_traversal, const int a_level, const int a_x, const int a_y, const int a_z, double& a_enter) const
+{
+    int index[3] = { a_x, a_y, a_z };
+    double tmin = 0.0;
+    double tmax = 1.0;
+    for (int i=0; i<3; i++)
+    {
+        double lo = (double)(index[i] << a_level) - a_traversal.m_padding(i);
+        double hi = (double)cMin((index[i] + 1) << a_level, m_size[i]) + a_traversal.m_padding(i);
+        double a = a_traversal.m_pointA(i);
+        double d = a_traversal.m_dir(i);
+
+        if (fabs(d) < C_SMALL)
+        {
+            if ((a < lo) || (a > hi)) { return (false); }
+        }
+        else
+        {
+            double t0 = (lo - a) / d;
+            double t1 = (hi - a) / d;
+            if (t0 > t1) { double t = t0; t0 = t1; t1 = t; }
+            tmin = cMax(tmin, t0);
+            tmax = cMin(tmax, t1);
+            if (tmin > tmax) { return (false); }
+        }
+    }
+
+    a_enter = tmin;
+    return (true);
+}
+
+
+//==============================================================================
+/*!
+    This method visits the occupied children of a node which are crossed by 
+    the segment, in the order in which the segment enters them.
+
+    \param  a_traversal  Segment being traversed.
+    \param  a_level      Level of the node.
+    \param  a_x          Index of the node along __x__.
+    \param  a_y          Index of the node along __y__.
+    \param  a_z          Index of the node along __z__.
+    \param  a_nearest    Nearest hit found so far.
+*/
+//==============================================================================
+void cVoxelBrickMap::traverseNode(const cVoxelBrickTraversal& a_traversal, const int a_level, const int a_x, const int a_y, const int a_z, double& a_nearest) const
+{
+    // voxel
+    if (a_level == 0)
+    {
+        double t = (*a_traversal.m_visitor)(a_x, a_y, a_z);
+        if (t < a_nearest) { a_nearest = t; }
+        return;
+    }
+
+    // sort occupied children by entry position
+    int level = a_level - 1;
+    double enter[8];
+    int children[8];
+    int numChildren = 0;
+    for (int i=0; i<8; i++)
+    {
+        int x = 2 * a_x + (i & 1);
+        int y = 2 * a_y + ((i >> 1) & 1);
+        int z = 2 * a_z + (i >> 2);
+        if (((x << level) >= m_size[0]) || ((y << level) >= m_size[1]) || ((z << level) >= m_size[2])) { continue; }
+        if (!isNodeOccupied(level, x, y, z)) { continue; }
+
+        double t;
+        if (!intersectNode(a_traversal, level, x, y, z, t)) { continue; }
+        if (t > a_nearest) { continue; }
+
+        int j = numChildren;
+        while ((j > 0) && (enter[j - 1] > t))
+        {
+            enter[j] = enter[j - 1];
+            children[j] = children[j - 1];
+            j--;
+        }
+        enter[j] = t;
+        children[j] = i;
+        numChildren++;
+    }
+
+    // visit children
+    for (int j=0; j<numChildren; j++)
+    {
+        if (enter[j] > a_nearest) { return; }
+
+        int i = children[j];
+        traverseNode(a_traversal, level, 2 * a_x + (i & 1), 2 * a_y + ((i >> 1) & 1), 2 * a_z + (i >> 2), a_nearest);
+    }
+}
+
+
+//------------------------------------------------------------------------------
+} // namespace chai3d
+//------------------------------------------------------------------------------
@@ -0,0 +1,260 @@
+//==============================================================================
+/*
+    Software License Agreement (BSD License)
+    Copyright (c) 2003-2016, CHAI3D.
+    (www.chai3d.org)
+
+    All rights reserved.
+
+    Redistribution and use in source and binary forms, with or without
+    modification, are permitted provided that the following conditions
+    are met:
+
+    * Redistributions of source code must retain the above copyright
+    notice, this list of conditions and the following disclaimer.
+
+    * Redistributions in binary form must reproduce the above
+    copyright notice, this list of conditions and the following
+    disclaimer in the documentation and/or other materials provided
+    with the distribution.
+
+    * Neither the name of CHAI3D nor the names of its contributors may
+    be used to endorse or promote products derived from this software
+    without specific prior written permission.
+
+    THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS
+    "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT
+    LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS
+    FOR A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE
+    COPYRIGHT OWNER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT,
+    INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING,
+    BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES;
+    LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER
+    CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT
+    LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN
+    ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+    POSSIBILITY OF SUCH DAMAGE. 
+
+    \author    <http://www.chai3d.org>
+    \version   3.2.0 $Rev: 2183 $
+*/
+//==============================================================================
+
+//------------------------------------------------------------------------------
+#ifndef CVoxelBrickMapH
+#define CVoxelBrickMapH
+//------------------------------------------------------------------------------
+#include "math/CVector3d.h"
+//------------------------------------------------------------------------------
+#include <functional>
+#include <vector>
+//------------------------------------------------------------------------------
+
+//------------------------------------------------------------------------------
+namespace chai3d {
+//------------------------------------------------------------------------------
+
+//==============================================================================
+/*!
+    \file       CVoxelBrickMap.h
+
+    \brief
+    Implements a sparse occupancy map of the voxels of a volume.
+*/
+//==============================================================================
+
+//------------------------------------------------------------------------------
+class cImage;
+//------------------------------------------------------------------------------
+
+//! Number of voxels along each side of a brick. Each z-slice of a brick is stored in one 64-bit word.
+const int C_VOXEL_BRICK_SIZE = 8;
+
+
+//==============================================================================
+/*!
+    \struct     cVoxelBrick
+    \ingroup    world
+
+    \brief
+    This structure stores the occupancy of the voxels of a brick.
+*/
+//==============================================================================
+struct cVoxelBrick
+{
+    //! Occupancy bits. Bit (y * 8 + x) of word z is set if voxel (x, y, z) of the brick is occupied.
+    unsigned long long m_mask[C_VOXEL_BRICK_SIZE];
+
+    //! Number of occupied voxels in the brick.
+    int m_numVoxels;
+};
+
+
+//------------------------------------------------------------------------------
+#ifndef DOXYGEN_SHOULD_SKIP_THIS
+//------------------------------------------------------------------------------
+
+//! Describes a segment being traversed by a brick map.
+struct cVoxelBrickTraversal
+{
+    //! Start point of the segment.
+    cVector3d m_pointA;
+
+    //! Vector from the start point to the end point of the segment.
+    cVector3d m_dir;
+
+    //! Distance by which the boxes of the nodes are enlarged along each axis.
+    cVector3d m_padding;
+
+    //! Function called for each occupied voxel.
+    const std::function<double(int, int, int)>* m_visitor;
+};
+
+//------------------------------------------------------------------------------
+#endif  // DOXYGEN_SHOULD_SKIP_THIS
+//------------------------------------------------------------------------------
+
+
+//==============================================================================
+/*!
+    \class      cVoxelBrickMap
+    \ingroup    world
+
+    \brief
+    This class implements a sparse occupancy map of the voxels of a volume.
+
+    \details
+    cVoxelBrickMap splits a volume into bricks of 8x8x8 voxels and stores, 
+    for every brick which contains at least one occupied voxel, one bit per 
+    voxel. Empty bricks use no memory besides their index. The bricks are 
+    grouped into an octree whose nodes count the occupied bricks they 
+    contain.\n\n
+
+    computeSegmentTraversal() visits the occupied voxels located close to a 
+    segment from front to back. Empty nodes of the octree, empty bricks and 
+    empty blocks of voxels inside a brick are skipped as a whole, so the 
+    cost of a query grows with the amount of occupied space along the 
+    segment rather than with the size of the volume.\n\n
+
+    Voxels can be edited individually with setVoxel(). Only the brick of the 
+    voxel and its parent nodes are updated.\n\n
+
+    All coordinates are expressed in voxels. Voxel (x, y, z) covers the box 
+    [x, x+1] x [y, y+1] x [z, z+1].
+*/
+//==============================================================================
+class cVoxelBrickMap
+{
+    //--------------------------------------------------------------------------
+    // CONSTRUCTOR & DESTRUCTOR:
+    //--------------------------------------------------------------------------
+
+public:
+
+    //! Constructor of cVoxelBrickMap.
+    cVoxelBrickMap();
+
+    //! Destructor of cVoxelBrickMap.
+    virtual ~cVoxelBrickMap() {}
+
+
+    //--------------------------------------------------------------------------
+    // PUBLIC METHODS:
+    //--------------------------------------------------------------------------
+
+public:
+
+    //! This method clears the map.
+    void clear();
+
+    //! This method builds the map from the voxels of an image whose alpha value is greater or equal to a threshold.
+    bool build(cImage* a_image, const float a_threshold);
+
+    //! This method updates the map from the voxels of an image located in a region.
+    void update(cImage* a_image, int a_minX, int a_minY, int a_minZ, int a_maxX, int a_maxY, int a_maxZ);
+
+    //! This method returns __true__ if the map was built from an image of this size and with this threshold.
+    bool isBuilt(const cImage* a_image, const float a_threshold) const;
+
+    //! This method sets the occupancy of a voxel.
+    void setVoxel(const int a_x, const int a_y, const int a_z, const bool a_occupied);
+
+    //! This method returns __true__ if a voxel is occupied.
+    bool getVoxel(const int a_x, const int a_y, const int a_z) const;
+
+    //! This method returns the number of occupied voxels located in a region.
+    long long countVoxels(int a_minX, int a_minY, int a_minZ, int a_maxX, int a_maxY, int a_maxZ) const;
+
+    //! This method returns the number of occupied voxels.
+    long long getNumVoxels() const { return (m_numVoxels); }
+
+    //! This method returns the number of bricks which contain occupied voxels.
+    int getNumOccupiedBricks() const;
+
+    //! This method returns the number of bytes used by the map.
+    size_t getMemorySize() const;
+
+    //! This method visits the occupied voxels located close to a segment from front to back.
+    double computeSegmentTraversal(const cVector3d& a_segmentPointA,
+                                   const cVector3d& a_segmentPointB,
+                                   const cVector3d& a_padding,
+                                   const std::function<double(int, int, int)>& a_visitor) const;
+
+
+    //--------------------------------------------------------------------------
+    // PROTECTED METHODS:
+    //--------------------------------------------------------------------------
+
+protected:
+
+    //! This method returns __true__ if a node contains occupied voxels. A node of level l covers 2^l voxels along each axis, so nodes of level 3 are bricks.
+    bool isNodeOccupied(const int a_level, const int a_x, const int a_y, const int a_z) const;
+
+    //! This method computes the parameter at which a segment enters the padded box of a node.
+    bool intersectNode(const cVoxelBrickTraversal& a_traversal, const int a_level, const int a_x, const int a_y, const int a_z, double& a_enter) const;
+
+    //! This method visits the children of a node from front to back.
+    void traverseNode(const cVoxelBrickTraversal& a_traversal, const int a_level, const int a_x, const int a_y, const int a_z, double& a_nearest) const;
+
+
+    //--------------------------------------------------------------------------
+    // PROTECTED MEMBERS:
+    //--------------------------------------------------------------------------
+
+protected:
+
+    //! Image from which the map was built.
+    const cImage* m_image;
+
+    //! Size of the volume in voxels.
+    int m_size[3];
+
+    //! Number of bricks along each axis.
+    int m_numBricks[3];
+
+    //! Alpha value from which a voxel is occupied.
+    int m_alphaThreshold;
+
+    //! Isosurface value from which the map was built.
+    float m_threshold;
+
+    //! Index of each brick in \ref m_bricks, or -1 if the brick has never contained any occupied voxel.
+    std::vector<int> m_brickIndices;
+
+    //! Bricks which contain or have contained occupied voxels.
+    std::vector<cVoxelBrick> m_bricks;
+
+    //! Number of occupied bricks in the nodes of each level of the octree above the bricks. A node of level l covers 2^(l+1) bricks along each axis and the last level contains a single node.
+    std::vector<std::vector<int> > m_nodes;
+
+    //! Total number of occupied voxels.
+    long long m_numVoxels;
+};
+
+//------------------------------------------------------------------------------
+} // namespace chai3d
+//------------------------------------------------------------------------------
+
+//------------------------------------------------------------------------------
+#endif
+//------------------------------------------------------------------------------
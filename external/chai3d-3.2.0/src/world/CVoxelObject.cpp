@@ -59,7 +59,10 @@
 #include "resources/CShaderIsosurface-RGBA8.h"
 #include "resources/CShaderDVR-LUT8.h"
 //------------------------------------------------------------------------------
+#include <atomic>
+#include <functional>
 #include <iostream>
+#include <thread>
 using namespace std;
 //------------------------------------------------------------------------------
 const int C_RENDERING_MODE_BASIC                        = 0;
@@ -76,6 +79,281 @@ const int C_RENDERING_MODE_CUSTOM                       = 9;
 namespace chai3d {
 //------------------------------------------------------------------------------
 
+//==============================================================================
+/*!
+    \struct     cVoxelPolygonizationBlock
+    \ingroup    world
+
+    \brief
+    This structure stores the triangles of a block of the polygonization 
+    grid before they are added to the mesh.
+*/
+//==============================================================================
+struct cVoxelPolygonizationBlock
+{
+    //! Position of each vertex.
+    vector<cVector3d> m_positions;
+
+    //! Normal of each vertex.
+    vector<cVector3d> m_normals;
+
+    //! Key of the grid edge of each vertex if it is shared with other blocks, -1 otherwise.
+    vector<long long> m_keys;
+
+    //! Vertex indices of the triangles.
+    vector<int> m_triangles;
+};
+
+
+//------------------------------------------------------------------------------
+
+//! Offset of each corner of a cell, in the order used by cPolygonize().
+static const int C_VOXEL_CELL_CORNERS[8][3] = 
+{
+    {0, 0, 0}, {0, 1, 0}, {1, 1, 0}, {1, 0, 0},
+    {0, 0, 1}, {0, 1, 1}, {1, 1, 1}, {1, 0, 1}
+};
+
+//! Offset of the lowest corner of each edge of a cell, followed by the axis of the edge, in the order used by cPolygonize().
+static const int C_VOXEL_CELL_EDGES[12][4] = 
+{
+    {0, 0, 0, 1}, {0, 1, 0, 0}, {1, 0, 0, 1}, {0, 0, 0, 0},
+    {0, 0, 1, 1}, {0, 1, 1, 0}, {1, 0, 1, 1}, {0, 0, 1, 0},
+    {0, 0, 0, 2}, {0, 1, 0, 2}, {1, 1, 0, 2}, {1, 0, 0, 2}
+};
+
+//------------------------------------------------------------------------------
+
+
+//==============================================================================
+/*!
+    This function calls a function for each index of a range on all cores. 
+    Indices are distributed dynamically between threads.
+
+    \param  a_count     Number of indices.
+    \param  a_function  Function called for each index.
+*/
+//==============================================================================
+static void cVoxelParallelFor(const int a_count, const function<void(int)>& a_function)
+{
+    atomic<int> next(0);
+    auto worker = [&]()
+    {
+        for (int i = next++; i < a_count; i = next++)
+        {
+            a_function(i);
+        }
+    };
+
+    unsigned int numThreads = cMin(cMax(1u, std::thread::hardware_concurrency()), (unsigned int)cMax(1, a_count));
+    vector<thread> threads;
+    for (unsigned int i=1; i<numThreads; i++)
+    {
+        threads.push_back(thread(worker));
+    }
+    worker();
+    for (unsigned int i=0; i<threads.size(); i++)
+    {
+        threads[i].join();
+    }
+}
+
+
+//==============================================================================
+/*!
+    This function computes the triangles of a block of the polygonization 
+    grid. Vertices located on the same grid edge are shared by the triangles 
+    of the block, and vertices located on the faces of the block are tagged 
+    with the key of their edge so that they can be shared with the 
+    neighbouring blocks. The normal of each vertex is interpolated from the 
+    gradient of the voxel values at the ends of its edge.
+
+    \param  a_image          Image of the voxels.
+    \param  a_map            Occupancy map of the image built with the isosurface value.
+    \param  a_state          Polygonization grid.
+    \param  a_isolevel       Isosurface value.
+    \param  a_block          Index of the block.
+    \param  a_result         Returned triangles.
+*/
+//==============================================================================
+static void cVoxelPolygonizeBlock(const cImage* a_image,
+                                  const cVoxelBrickMap& a_map,
+                                  const cVoxelPolygonization& a_state,
+                                  const float a_isolevel,
+                                  const int a_block,
+                                  cVoxelPolygonizationBlock& a_result)
+{
+    const int size = C_VOXEL_POLYGONIZATION_BLOCK_SIZE;
+
+    // compute range of cells of the block
+    int block[3];
+    block[0] = a_block % a_state.m_numBlocks[0];
+    block[1] = (a_block / a_state.m_numBlocks[0]) % a_state.m_numBlocks[1];
+    block[2] = a_block / (a_state.m_numBlocks[0] * a_state.m_numBlocks[1]);
+
+    int imageSize[3];
+    imageSize[0] = (int)a_image->getWidth();
+    imageSize[1] = (int)a_image->getHeight();
+    imageSize[2] = (int)a_image->getImageCount();
+
+    int first[3], num[3], voxelMin[3], voxelMax[3];
+    bool inside = true;
+    for (int i=0; i<3; i++)
+    {
+        first[i] = block[i] * size;
+        num[i] = cMin(size, a_state.m_numCells[i] - first[i]);
+
+        // range of voxels sampled by the corners of the cells
+        int v0 = a_state.m_voxelIndices[i][first[i] + 1];
+        int v1 = a_state.m_voxelIndices[i][first[i] + num[i] + 1];
+        voxelMin[i] = cMin(v0, v1);
+        voxelMax[i] = cMax(v0, v1);
+        if ((voxelMin[i] < 0) || (voxelMax[i] >= imageSize[i]))
+        {
+            inside = false;
+        }
+    }
+
+    // blocks whose voxels are all empty or all occupied contain no triangles.
+    // voxels located outside of the image are empty.
+    long long count = a_map.countVoxels(voxelMin[0], voxelMin[1], voxelMin[2], voxelMax[0], voxelMax[1], voxelMax[2]);
+    if (count == 0)
+    {
+        return;
+    }
+    if (inside && (count == (long long)(voxelMax[0] - voxelMin[0] + 1) * (voxelMax[1] - voxelMin[1] + 1) * (voxelMax[2] - voxelMin[2] + 1)))
+    {
+        return;
+    }
+
+    // sample voxel values at the grid points of the block and at their 
+    // neighbours, which are needed to compute gradients
+    const int n0 = num[0] + 3;
+    const int n1 = num[1] + 3;
+    const int n2 = num[2] + 3;
+    vector<float> values(n0 * n1 * n2);
+    for (int k=0; k<n2; k++)
+    {
+        int z = a_state.m_voxelIndices[2][first[2] + k];
+        for (int j=0; j<n1; j++)
+        {
+            int y = a_state.m_voxelIndices[1][first[1] + j];
+            for (int i=0; i<n0; i++)
+            {
+                int x = a_state.m_voxelIndices[0][first[0] + i];
+                float value = 0.0f;
+                if ((x >= 0) && (y >= 0) && (z >= 0) && (x < imageSize[0]) && (y < imageSize[1]) && (z < imageSize[2]))
+                {
+                    cColorb color;
+                    if (a_image->getVoxelColor(x, y, z, color))
+                    {
+                        value = cColorBtoF(color.getA());
+                    }
+                }
+                values[(k * n1 + j) * n0 + i] = value;
+            }
+        }
+    }
+
+    // value and gradient at a grid point of the block
+    auto getValue = [&](const int a_x, const int a_y, const int a_z)
+    {
+        return ((double)values[((a_z + 1) * n1 + (a_y + 1)) * n0 + (a_x + 1)]);
+    };
+
+    auto getGradient = [&](const int a_x, const int a_y, const int a_z)
+    {
+        return (cVector3d((getValue(a_x + 1, a_y, a_z) - getValue(a_x - 1, a_y, a_z)) / (2.0 * a_state.m_gridSize[0]),
+                          (getValue(a_x, a_y + 1, a_z) - getValue(a_x, a_y - 1, a_z)) / (2.0 * a_state.m_gridSize[1]),
+                          (getValue(a_x, a_y, a_z + 1) - getValue(a_x, a_y, a_z - 1)) / (2.0 * a_state.m_gridSize[2])));
+    };
+
+    // vertex of each grid edge of the block
+    const int p0 = num[0] + 1;
+    const int p1 = num[1] + 1;
+    const int p2 = num[2] + 1;
+    vector<int> edgeVertices(p0 * p1 * p2 * 3, -1);
+
+    // polygonize cells
+    double cellValues[8];
+    int edges[15];
+    for (int cz=0; cz<num[2]; cz++)
+    {
+        for (int cy=0; cy<num[1]; cy++)
+        {
+            for (int cx=0; cx<num[0]; cx++)
+            {
+                for (int i=0; i<8; i++)
+                {
+                    cellValues[i] = getValue(cx + C_VOXEL_CELL_CORNERS[i][0], cy + C_VOXEL_CELL_CORNERS[i][1], cz + C_VOXEL_CELL_CORNERS[i][2]);
+                }
+
+                int numTriangles = cPolygonizeEdges(cellValues, a_isolevel, edges);
+                for (int i=0; i<3*numTriangles; i++)
+                {
+                    // retrieve grid edge
+                    const int* edge = C_VOXEL_CELL_EDGES[edges[i]];
+                    int l[3] = { cx + edge[0], cy + edge[1], cz + edge[2] };
+                    int axis = edge[3];
+
+                    int& vertex = edgeVertices[((l[2] * p1 + l[1]) * p0 + l[0]) * 3 + axis];
+                    if (vertex < 0)
+                    {
+                        int u[3] = { l[0], l[1], l[2] };
+                        u[axis]++;
+
+                        // interpolate position along the edge
+                        double v1 = getValue(l[0], l[1], l[2]);
+                        double v2 = getValue(u[0], u[1], u[2]);
+                        double mu = 0.0;
+                        if (cAbs(a_isolevel - v1) < 0.00001)
+                            mu = 0.0;
+                        else if (cAbs(a_isolevel - v2) < 0.00001)
+                            mu = 1.0;
+                        else if (cAbs(v1 - v2) >= 0.00001)
+                            mu = (a_isolevel - v1) / (v2 - v1);
+
+                        int g[3];
+                        cVector3d pos;
+                        for (int j=0; j<3; j++)
+                        {
+                            g[j] = first[j] + l[j];
+                            pos(j) = a_state.m_origin(j) + ((double)g[j] + ((j == axis) ? mu : 0.0)) * a_state.m_gridSize[j];
+                        }
+
+                        // interpolate normal from the gradients at both ends of the edge. 
+                        // the normal points towards decreasing values.
+                        cVector3d normal = -((1.0 - mu) * getGradient(l[0], l[1], l[2]) + mu * getGradient(u[0], u[1], u[2]));
+                        if (normal.length() < C_SMALL)
+                        {
+                            normal.zero();
+                            normal(axis) = (v2 < v1) ? 1.0 : -1.0;
+                        }
+                        normal.normalize();
+
+                        // edges located on the faces of the block are shared with neighbouring blocks
+                        long long key = -1;
+                        if (((axis != 0) && (g[0] % size == 0)) ||
+                            ((axis != 1) && (g[1] % size == 0)) ||
+                            ((axis != 2) && (g[2] % size == 0)))
+                        {
+                            key = (((long long)g[2] * (a_state.m_numCells[1] + 1) + g[1]) * (a_state.m_numCells[0] + 1) + g[0]) * 3 + axis;
+                        }
+
+                        vertex = (int)a_result.m_positions.size();
+                        a_result.m_positions.push_back(pos);
+                        a_result.m_normals.push_back(normal);
+                        a_result.m_keys.push_back(key);
+                    }
+
+                    a_result.m_triangles.push_back(vertex);
+                }
+            }
+        }
+    }
+}
+
+
 //==============================================================================
 /*!
     Constructor of cVoxelObject.
@@ -119,6 +397,13 @@ cVoxelObject::cVoxelObject()
     // isosurface value
     m_isosurfaceValue = 0.1f;
 
+    // no occupancy map is published yet
+    m_voxelMapFront = 0;
+    m_voxelMapReaders[0] = 0;
+    m_voxelMapReaders[1] = 0;
+    m_voxelMapOutdated[0] = false;
+    m_voxelMapOutdated[1] = false;
+
     // voxel opacity value
     m_voxelOpacity = 1.0f;
 
@@ -418,6 +703,13 @@ void cVoxelObject::update(cRenderOptions& a_options)
         return;
     }
 
+    // build occupancy map if the image was replaced without calling 
+    // updateVoxels(), so that collision queries never have to build it.
+    {
+        lock_guard<mutex> lock(m_voxelMapLock);
+        buildVoxelMap(true);
+    }
+
     // compute center of model
     cVector3d centerLocal = 0.5 * (m_maxCorner + m_minCorner);
     cVector3d centerGlobal = getGlobalPos() + getGlobalRot() * centerLocal;
@@ -963,6 +1255,442 @@ void cVoxelObject::loadRenderingShaders()
 }
 
 
+//==============================================================================
+/*!
+    This method returns the boundary box, expressed in the local coordinates of
+    this object, of the volume tested by the collision detection. The box 
+    encloses the minimum and maximum corners of the volume.
+
+    \param  a_min  Returned lower corner of the boundary box.
+    \param  a_max  Returned upper corner of the boundary box.
+
+    \return __true__ if the elements are bounded, __false__ otherwise.
+*/
+//==============================================================================
+bool cVoxelObject::getCollisionBoundaryBox(cVector3d& a_min, cVector3d& a_max)
+{
+    if (!cGenericObject::getCollisionBoundaryBox(a_min, a_max))
+    {
+        return (false);
+    }
+
+    for (int i=0; i<3; i++)
+    {
+        a_min(i) = cMin(a_min(i), cMin(m_minCorner(i), m_maxCorner(i)));
+        a_max(i) = cMax(a_max(i), cMax(m_minCorner(i), m_maxCorner(i)));
+    }
+
+    return (true);
+}
+
+
+//==============================================================================
+/*!
+    This method sets the isosurface value. If the value changes, the 
+    occupancy map used for collision detection is built again by the 
+    calling thread, which takes about a second on large volumes. Collision 
+    queries use the previous map until the new one is built.
+
+    \param  a_isosurfaceValue  Isosurface value between 0.0 and 1.0.
+*/
+//==============================================================================
+void cVoxelObject::setIsosurfaceValue(const float a_isosurfaceValue)
+{
+    float value = cClamp(a_isosurfaceValue, 0.0f, 1.0f);
+    if (value == m_isosurfaceValue)
+    {
+        return;
+    }
+
+    lock_guard<mutex> lock(m_voxelMapLock);
+    m_isosurfaceValue = value;
+
+    // build occupancy map
+    if ((m_texture != nullptr) && (m_texture->m_image != nullptr))
+    {
+        buildVoxelMap(false);
+    }
+}
+
+
+//==============================================================================
+/*!
+    This method sets the color of a voxel of the image and updates the 
+    occupancy map and the graphic texture accordingly.
+
+    \param  a_x      X coordinate of the voxel.
+    \param  a_y      Y coordinate of the voxel.
+    \param  a_z      Z coordinate of the voxel.
+    \param  a_color  New color of the voxel.
+*/
+//==============================================================================
+void cVoxelObject::setVoxelColor(const unsigned int a_x, const unsigned int a_y, const unsigned int a_z, const cColorb& a_color)
+{
+    // sanity check
+    if ((m_texture == nullptr) || (m_texture->m_image == nullptr))
+    {
+        return;
+    }
+
+    // set voxel color
+    m_texture->m_image->setVoxelColor(a_x, a_y, a_z, a_color);
+
+    // update models
+    updateVoxels(a_x, a_y, a_z, a_x, a_y, a_z);
+}
+
+
+//==============================================================================
+/*!
+    This method clears all voxels whose center is located inside a sphere, 
+    by setting their color to transparent black. This method is typically 
+    used to drill or carve the volume with a tool.
+
+    \param  a_localPos  Center of the sphere in local coordinates.
+    \param  a_radius    Radius of the sphere.
+
+    \return Number of occupied voxels which were removed.
+*/
+//==============================================================================
+int cVoxelObject::clearVoxelsInSphere(const cVector3d& a_localPos, const double a_radius)
+{
+    // sanity check
+    if ((m_texture == nullptr) || (m_texture->m_image == nullptr))
+    {
+        return (0);
+    }
+
+    cImage* image = m_texture->m_image.get();
+
+    // compute transformation from local coordinates to voxel coordinates
+    cVector3d scale, offset;
+    if (!computeVoxelTransform(scale, offset))
+    {
+        return (0);
+    }
+
+    // compute range of voxels covered by the sphere
+    int texSize[3];
+    texSize[0] = (int)image->getWidth();
+    texSize[1] = (int)image->getHeight();
+    texSize[2] = (int)image->getImageCount();
+
+    int tmin[3], tmax[3];
+    for (int i=0; i<3; i++)
+    {
+        double v0 = scale(i) * (a_localPos(i) - a_radius) + offset(i);
+        double v1 = scale(i) * (a_localPos(i) + a_radius) + offset(i);
+        tmin[i] = cMax(0, (int)floor(cMin(v0, v1)));
+        tmax[i] = cMin(texSize[i] - 1, (int)floor(cMax(v0, v1)));
+        if (tmin[i] > tmax[i])
+        {
+            return (0);
+        }
+    }
+
+    // clear voxels. the published occupancy map is read to count them, 
+    // and released before it is updated.
+    int map = acquireVoxelMap();
+    int counter = 0;
+    double radiusSq = cSqr(a_radius);
+    cColorb color(0x00, 0x00, 0x00, 0x00);
+    for (int t2=tmin[2]; t2<=tmax[2]; t2++)
+    {
+        for (int t1=tmin[1]; t1<=tmax[1]; t1++)
+        {
+            for (int t0=tmin[0]; t0<=tmax[0]; t0++)
+            {
+                // compute center of voxel in local space
+                cVector3d pos(((double)t0 + 0.5 - offset(0)) / scale(0),
+                              ((double)t1 + 0.5 - offset(1)) / scale(1),
+                              ((double)t2 + 0.5 - offset(2)) / scale(2));
+
+                if (cDistanceSq(pos, a_localPos) > radiusSq)
+                {
+                    continue;
+                }
+
+                if (m_voxelMaps[map].getVoxel(t0, t1, t2))
+                {
+                    counter++;
+                }
+
+                image->setVoxelColor(t0, t1, t2, color);
+            }
+        }
+    }
+    releaseVoxelMap(map);
+
+    // update models
+    updateVoxels(tmin[0], tmin[1], tmin[2], tmax[0], tmax[1], tmax[2]);
+
+    return (counter);
+}
+
+
+//==============================================================================
+/*!
+    This method updates the occupancy map used for collision detection and 
+    the graphic texture after the voxels of a region of the image have been 
+    modified. Only the modified region is uploaded to the GPU. If updates of 
+    the polygonized mesh are enabled, the blocks of the mesh affected by the 
+    region are polygonized again by the next call to updatePolygonization().
+
+    \param  a_minX  Lowest voxel index along __x__.
+    \param  a_minY  Lowest voxel index along __y__.
+    \param  a_minZ  Lowest voxel index along __z__.
+    \param  a_maxX  Highest voxel index along __x__.
+    \param  a_maxY  Highest voxel index along __y__.
+    \param  a_maxZ  Highest voxel index along __z__.
+*/
+//==============================================================================
+void cVoxelObject::updateVoxels(const int a_minX, const int a_minY, const int a_minZ, const int a_maxX, const int a_maxY, const int a_maxZ)
+{
+    // sanity check
+    if ((m_texture == nullptr) || (m_texture->m_image == nullptr))
+    {
+        return;
+    }
+
+    // update occupancy maps. if the published map is out of date, it is 
+    // built again by updateVoxels() or by the next render.
+    {
+        lock_guard<mutex> lock(m_voxelMapLock);
+        cImage* image = m_texture->m_image.get();
+        int front = m_voxelMapFront;
+        if (m_voxelMaps[front].isBuilt(image, m_isosurfaceValue))
+        {
+            // update the map which is not read by collision queries and publish it
+            int back = acquireBackVoxelMap();
+            if (m_voxelMapOutdated[back])
+            {
+                m_voxelMaps[back] = m_voxelMaps[front];
+                m_voxelMapOutdated[back] = false;
+            }
+            m_voxelMaps[back].update(image, a_minX, a_minY, a_minZ, a_maxX, a_maxY, a_maxZ);
+            m_voxelMapFront = back;
+
+            // update the previous map once the queries reading it are completed
+            front = acquireBackVoxelMap();
+            m_voxelMaps[front].update(image, a_minX, a_minY, a_minZ, a_maxX, a_maxY, a_maxZ);
+        }
+    }
+
+    // upload modified region to the GPU
+    cTexture3dPtr texture = std::dynamic_pointer_cast<cTexture3d>(m_texture);
+    if (texture != nullptr)
+    {
+        texture->markForPartialUpdate(cVector3d(a_minX, a_minY, a_minZ), cVector3d(a_maxX, a_maxY, a_maxZ));
+    }
+    else
+    {
+        m_texture->markForUpdate();
+    }
+
+    // mark blocks of the polygonized mesh whose grid points sample the region.
+    // cells located within two cells of these grid points are affected, 
+    // since normals are computed from the values of neighbouring grid points.
+    cVoxelPolygonization& state = m_polygonization;
+    if (state.m_mesh != NULL)
+    {
+        int regionMin[3] = { a_minX, a_minY, a_minZ };
+        int regionMax[3] = { a_maxX, a_maxY, a_maxZ };
+        int blockMin[3], blockMax[3];
+        for (int i=0; i<3; i++)
+        {
+            int pointMin = INT_MAX;
+            int pointMax = INT_MIN;
+            for (int j=0; j<(int)state.m_voxelIndices[i].size(); j++)
+            {
+                int voxel = state.m_voxelIndices[i][j];
+                if ((voxel >= regionMin[i]) && (voxel <= regionMax[i]))
+                {
+                    pointMin = cMin(pointMin, j - 1);
+                    pointMax = cMax(pointMax, j - 1);
+                }
+            }
+            if (pointMin > pointMax)
+            {
+                return;
+            }
+
+            int cellMin = cMax(0, pointMin - 2);
+            int cellMax = cMin(state.m_numCells[i] - 1, pointMax + 1);
+            if (cellMin > cellMax)
+            {
+                return;
+            }
+            blockMin[i] = cellMin / C_VOXEL_POLYGONIZATION_BLOCK_SIZE;
+            blockMax[i] = cellMax / C_VOXEL_POLYGONIZATION_BLOCK_SIZE;
+        }
+
+        for (int bz=blockMin[2]; bz<=blockMax[2]; bz++)
+        {
+            for (int by=blockMin[1]; by<=blockMax[1]; by++)
+            {
+                for (int bx=blockMin[0]; bx<=blockMax[0]; bx++)
+                {
+                    state.m_dirtyBlocks[(bz * state.m_numBlocks[1] + by) * state.m_numBlocks[0] + bx] = true;
+                }
+            }
+        }
+    }
+}
+
+
+//==============================================================================
+/*!
+    This method builds the occupancy map used for collision detection again 
+    and marks the graphic texture for update. It should be called after the 
+    image has been modified or replaced. The map is built by the calling 
+    thread while collision queries use the previous map. If updates of the polygonized mesh are enabled, the whole mesh is 
+    polygonized again by the next call to updatePolygonization().
+*/
+//==============================================================================
+void cVoxelObject::updateVoxels()
+{
+    // sanity check
+    if ((m_texture == nullptr) || (m_texture->m_image == nullptr))
+    {
+        return;
+    }
+
+    // build occupancy map
+    {
+        lock_guard<mutex> lock(m_voxelMapLock);
+        buildVoxelMap(false);
+    }
+
+    // upload image to the GPU
+    m_texture->markForUpdate();
+
+    // mark all blocks of the polygonized mesh
+    m_polygonization.m_dirtyBlocks.assign(m_polygonization.m_dirtyBlocks.size(), true);
+}
+
+
+//==============================================================================
+/*!
+    This method builds the occupancy map which is not read by collision 
+    queries from the image and the isosurface value, and publishes it. The 
+    previous map is marked as outdated, so that it is copied from the new 
+    one before it is updated again. \ref m_voxelMapLock must be held by the 
+    caller and the image must exist.
+
+    \param  a_onlyIfOutdated  If __true__, the map is only built if the 
+                              published map was built from another image or 
+                              isosurface value.
+*/
+//==============================================================================
+void cVoxelObject::buildVoxelMap(const bool a_onlyIfOutdated)
+{
+    cImage* image = m_texture->m_image.get();
+    int front = m_voxelMapFront;
+    if (a_onlyIfOutdated && m_voxelMaps[front].isBuilt(image, m_isosurfaceValue))
+    {
+        return;
+    }
+
+    int back = acquireBackVoxelMap();
+    m_voxelMaps[back].build(image, m_isosurfaceValue);
+    m_voxelMapOutdated[back] = false;
+    m_voxelMapOutdated[front] = true;
+    m_voxelMapFront = back;
+}
+
+
+//==============================================================================
+/*!
+    This method waits until no collision query reads the occupancy map 
+    which is not published, so that it can be modified. Queries only hold 
+    a map for the duration of a segment traversal. \ref m_voxelMapLock 
+    must be held by the caller.
+
+    \return Index of the map which is not published.
+*/
+//==============================================================================
+int cVoxelObject::acquireBackVoxelMap()
+{
+    int back = 1 - m_voxelMapFront;
+    while (m_voxelMapReaders[back] != 0)
+    {
+        this_thread::yield();
+    }
+    return (back);
+}
+
+
+//==============================================================================
+/*!
+    This method returns the index of the published occupancy map and 
+    prevents it from being modified until releaseVoxelMap() is called. This 
+    method does not block and does not allocate memory, so it can be called 
+    from the haptic thread.
+
+    \return Index of the published map.
+*/
+//==============================================================================
+int cVoxelObject::acquireVoxelMap()
+{
+    while (true)
+    {
+        // a writer which has published the other map in the meantime may 
+        // already modify this one, in which case the new map is acquired.
+        int front = m_voxelMapFront;
+        m_voxelMapReaders[front]++;
+        if (m_voxelMapFront == front)
+        {
+            return (front);
+        }
+        m_voxelMapReaders[front]--;
+    }
+}
+
+
+//==============================================================================
+/*!
+    This method computes the transformation from local coordinates to voxel 
+    coordinates. Voxel (x, y, z) of the image covers the box 
+    [x, x+1] x [y, y+1] x [z, z+1] in voxel coordinates, and a point 
+    __p__ of local coordinates maps to (scale * p + offset) along each axis.
+
+    \param  a_scale   Returned scale factor along each axis.
+    \param  a_offset  Returned offset along each axis.
+
+    \return __true__ if the operation succeeds, __false__ otherwise.
+*/
+//==============================================================================
+bool cVoxelObject::computeVoxelTransform(cVector3d& a_scale, cVector3d& a_offset)
+{
+    // sanity check
+    if ((m_texture == nullptr) || (m_texture->m_image == nullptr))
+    {
+        return (false);
+    }
+
+    // get size of 3d texture in pixels
+    double texSize[3];
+    texSize[0] = (double)(m_texture->m_image->getWidth());
+    texSize[1] = (double)(m_texture->m_image->getHeight());
+    texSize[2] = (double)(m_texture->m_image->getImageCount());
+
+    for (int i=0; i<3; i++)
+    {
+        double objectRange = m_maxCorner(i) - m_minCorner(i);
+        double texRange = m_maxTextureCoord(i) - m_minTextureCoord(i);
+        if ((objectRange == 0.0) || (texRange == 0.0) || (texSize[i] == 0.0))
+        {
+            return (false);
+        }
+
+        a_scale(i) = texSize[i] * texRange / objectRange;
+        a_offset(i) = texSize[i] * m_minTextureCoord(i) - a_scale(i) * m_minCorner(i);
+    }
+
+    return (true);
+}
+
+
 //==============================================================================
 /*!
     This method determines whether a given segment intersects this object or any
@@ -1020,7 +1748,6 @@ bool cVoxelObject::computeOtherCollisionDetection(cVector3d& a_segmentPointA,
 
     // compute smallest voxel size
     double voxelSmallestSize = cMin(voxelSize[0], cMin(voxelSize[1], voxelSize[2]));
-    double voxelLargestSize = cMax(voxelSize[0], cMax(voxelSize[1], voxelSize[2]));
 
     // sanity check
     if (voxelSmallestSize < C_SMALL)
@@ -1058,29 +1785,36 @@ bool cVoxelObject::computeOtherCollisionDetection(cVector3d& a_segmentPointA,
         return (C_ERROR);
     }
 
-    // compute half volume covered by collision sphere in texture space
-    int texRadius[3];
-    texRadius[0] = (int)ceil(collisionRadius / voxelSize[0]);
-    texRadius[1] = (int)ceil(collisionRadius / voxelSize[1]);
-    texRadius[2] = (int)ceil(collisionRadius / voxelSize[2]);
-
-    // compute normalized vector from A to B
+    // make sure that the segment is not degenerate
     cVector3d dir = a_segmentPointB - a_segmentPointA;
     if (dir.length() == 0.0)
     {
         return (C_ERROR);
     }
-    dir.normalize();
 
 
     ////////////////////////////////////////////////////////////////////////////
     // COMPUTE COLLISIONS
     ////////////////////////////////////////////////////////////////////////////
-    int counter = 0;
 
-    // compute collision radius; this also handle the case when the tool has radius 0.
-    double r = cMax(collisionRadius + 0.9 * voxelLargestSize, 0.9 * voxelLargestSize);
-    double r2 = cSqr(r);
+    // compute transformation from local coordinates to voxel coordinates
+    cVector3d scale, offset;
+    if (!computeVoxelTransform(scale, offset))
+    {
+        return (C_ERROR);
+    }
+
+    // express segment in voxel coordinates
+    cVector3d voxelPointA, voxelPointB, voxelPadding;
+    for (int i=0; i<3; i++)
+    {
+        voxelPointA(i) = scale(i) * a_segmentPointA(i) + offset(i);
+        voxelPointB(i) = scale(i) * a_segmentPointB(i) + offset(i);
+
+        // the ellipsoids that are used to render the voxels extend beyond 
+        // the voxel boxes by 0.2 voxel plus the collision radius
+        voxelPadding(i) = (collisionRadius + 0.25 * voxelSize[i]) * fabs(scale(i));
+    }
 
     // compute range of object
     cVector3d objectRange = m_maxCorner - m_minCorner;
@@ -1102,154 +1836,77 @@ bool cVoxelObject::computeOtherCollisionDetection(cVector3d& a_segmentPointA,
     // compute distance between both point composing segment
     double distanceAB = cDistance(a_segmentPointB, a_segmentPointA);
 
-    // distance counter
-    double distance = 0.0;
-
-    // search for collision
-    while ((!hit) && (distance < distanceAB))
+    // test each occupied voxel located close to the segment, from front to back
+    auto testVoxel = [&](int t0, int t1, int t2) -> double
     {
-        // increment step
-        distance = cMin((distance + voxelSmallestSize), distanceAB);
+        // compute position of texel in local space
+        double tpos[3];
+        tpos[0] = m_minCorner(0) + ((((double)t0 / texSize[0]) - m_minTextureCoord(0)) / (texRange(0))) * (objectRange(0));
+        tpos[1] = m_minCorner(1) + ((((double)t1 / texSize[1]) - m_minTextureCoord(1)) / (texRange(1))) * (objectRange(1));
+        tpos[2] = m_minCorner(2) + ((((double)t2 / texSize[2]) - m_minTextureCoord(2)) / (texRange(2))) * (objectRange(2));
 
-        // compute next point
-        cVector3d pointB = a_segmentPointA + distance * dir;
+        // check intersection with segment and voxel (approximated by sphere)
+        cVector3d t_collisionPoint, t_collisionNormal;
+        bool t_hit = false;
 
-        // compute position of point in texture coordinates
-        cVector3d texCoord;
-        texCoord(0) = m_minTextureCoord(0) + ((pointB(0) - m_minCorner(0)) / (objectRange(0)) * (texRange(0)));
-        texCoord(1) = m_minTextureCoord(1) + ((pointB(1) - m_minCorner(1)) / (objectRange(1)) * (texRange(1)));
-        texCoord(2) = m_minTextureCoord(2) + ((pointB(2) - m_minCorner(2)) / (objectRange(2)) * (texRange(2)));
+        if (a_settings.m_collisionRadius == 0)
+        {
+            t_hit = (cIntersectionSegmentBox(a_segmentPointA,
+                a_segmentPointB,
+                cVector3d(tpos[0] - (0.0 * voxelSize[0] + collisionRadius), tpos[1] - (0.0 * voxelSize[1] + collisionRadius), tpos[2] - (0.0 * voxelSize[2] + collisionRadius)),
+                cVector3d(tpos[0] + (1.0 * voxelSize[0] + collisionRadius), tpos[1] + (1.0 * voxelSize[1] + collisionRadius), tpos[2] + (1.0 * voxelSize[2] + collisionRadius)),
+                t_collisionPoint,
+                t_collisionNormal) > 0);
+        }
+        else
+        {
+            cVector3d p, n;
+
+            t_hit = (cIntersectionSegmentEllipsoid(a_segmentPointA,
+                a_segmentPointB,
+                cVector3d(tpos[0] + 0.5 * voxelSize[0], tpos[1] + 0.5 * voxelSize[1], tpos[2] + 0.5 * voxelSize[2]),
+                0.7*voxelSize[0] + collisionRadius,
+                0.7*voxelSize[1] + collisionRadius,
+                0.7*voxelSize[2] + collisionRadius,
+                t_collisionPoint,
+                t_collisionNormal,
+                p,
+                n) > 0);
+        }
 
-        // get voxel indices
-        int texel[3];
-        m_texture->m_image->getVoxelLocation(texCoord, texel[0], texel[1], texel[2], true);
+        if (!t_hit)
+        {
+            return (C_LARGE);
+        }
 
-        // check the area covered by the radius
-        int tmin[3];
-        tmin[0] = texel[0] - texRadius[0] - 1;
-        tmin[1] = texel[1] - texRadius[1] - 1;
-        tmin[2] = texel[2] - texRadius[2] - 1;
+        // intersection occurred
+        hit = true;
 
-        int tmax[3];
-        tmax[0] = texel[0] + texRadius[0] + 1;
-        tmax[1] = texel[1] + texRadius[1] + 1;
-        tmax[2] = texel[2] + texRadius[2] + 1;
+        // compute distance from collision point
+        double t_collisionDistanceSq = cDistanceSq(a_segmentPointA, t_collisionPoint);
 
-        // check all voxels 
-        for (int t2=tmin[2]; t2<=tmax[2]; t2++)
+        // if nearest, then select and store data.
+        if (t_collisionDistanceSq <= collisionDistanceSq)
         {
-            for (int t1=tmin[1]; t1<=tmax[1]; t1++)
-            {
-                for (int t0=tmin[0]; t0<=tmax[0]; t0++)
-                {
-                    {
-                        // get voxel color
-                        cColorb color;
-                        bool result = false;
-                        
-                        if ((t0 >= 0) && (t1 >= 0) && (t2 >= 0))
-                        {                            
-                            result = m_texture->m_image->getVoxelColor(t0, t1, t2, color);
-                        }
-
-                        if (result)
-                        {
-                            const float CONVERSION_FACTOR = (1.0f / 255.0f);
-                            float level = CONVERSION_FACTOR * (float)(color.getA());
-
-                            if (level >= m_isosurfaceValue)
-                            {
-                                // compute position of texel in local space
-                                double tpos[3];
-                                tpos[0] = m_minCorner(0) + ((((double)t0 / texSize[0]) - m_minTextureCoord(0)) / (texRange(0))) * (objectRange(0));
-                                tpos[1] = m_minCorner(1) + ((((double)t1 / texSize[1]) - m_minTextureCoord(1)) / (texRange(1))) * (objectRange(1));
-                                tpos[2] = m_minCorner(2) + ((((double)t2 / texSize[2]) - m_minTextureCoord(2)) / (texRange(2))) * (objectRange(2));
-
-                                // check if point is located outside of object
-                                double distanceSq = cDistanceSq(cVector3d(tpos[0] + 0.5 * voxelSize[0], tpos[1] + 0.5 * voxelSize[1], tpos[2] + 0.5 * +voxelSize[2]), pointB);
-                                if (distanceSq < r2)
-                                {
-                                    // check intersection with segment and voxel (approximated by sphere)
-                                    cVector3d t_p, t_n;
-                                    cVector3d t_collisionPoint, t_collisionNormal;
-                                    double t_collisionDistanceSq;
-
-                                    if (a_settings.m_collisionRadius == 0)
-                                    {
-                                        if (cIntersectionSegmentBox(a_segmentPointA,
-                                            a_segmentPointB,
-                                            cVector3d(tpos[0] - (0.0 * voxelSize[0] + collisionRadius), tpos[1] - (0.0 * voxelSize[1] + collisionRadius), tpos[2] - (0.0 * voxelSize[2] + collisionRadius)),
-                                            cVector3d(tpos[0] + (1.0 * voxelSize[0] + collisionRadius), tpos[1] + (1.0 * voxelSize[1] + collisionRadius), tpos[2] + (1.0 * voxelSize[2] + collisionRadius)),
-                                            t_collisionPoint,
-                                            t_collisionNormal) > 0)
-                                        {
-                                            // intersection occurred
-                                            hit = true;
-
-                                            counter++;
-
-                                            // compute distance from collision point
-                                            t_collisionDistanceSq = cDistanceSq(a_segmentPointA, t_collisionPoint);
-
-                                            // if nearest, then select and store data.
-                                            if (t_collisionDistanceSq <= collisionDistanceSq)
-                                            {
-                                                collisionPoint = t_collisionPoint;
-                                                collisionNormal = t_collisionNormal;
-                                                collisionDistanceSq = t_collisionDistanceSq;
-                                                collisionPointV01 = 0.0;
-                                                collisionPointV02 = 0.0;
-                                                voxelIndexX = t0;
-                                                voxelIndexY = t1;
-                                                voxelIndexZ = t2;
-                                            }
-                                        }
-                                    }
-                                    else
-                                    {
-                                        cVector3d p, n;
-
-                                        if (cIntersectionSegmentEllipsoid(a_segmentPointA,
-                                            a_segmentPointB,
-                                            cVector3d(tpos[0] + 0.5 * voxelSize[0], tpos[1] + 0.5 * voxelSize[1], tpos[2] + 0.5 * voxelSize[2]),
-                                            0.7*voxelSize[0] + collisionRadius,
-                                            0.7*voxelSize[1] + collisionRadius,
-                                            0.7*voxelSize[2] + collisionRadius,
-                                            t_collisionPoint,
-                                            t_collisionNormal,
-                                            p,
-                                            n) > 0)
-                                        {
-                                            // intersection occurred
-                                            hit = true;
-
-                                            counter++;
-
-                                            // compute distance from collision point
-                                            t_collisionDistanceSq = cDistanceSq(a_segmentPointA, t_collisionPoint);
-
-                                            // if nearest, then select and store data.
-                                            if (t_collisionDistanceSq <= collisionDistanceSq)
-                                            {
-                                                collisionPoint = t_collisionPoint;
-                                                collisionNormal = t_collisionNormal;
-                                                collisionDistanceSq = t_collisionDistanceSq;
-                                                collisionPointV01 = 0.0;
-                                                collisionPointV02 = 0.0;
-                                                voxelIndexX = t0;
-                                                voxelIndexY = t1;
-                                                voxelIndexZ = t2;
-                                            }
-                                        }
-                                    }
-                                }
-                            }
-                        }
-                    }
-                }
-            }
+            collisionPoint = t_collisionPoint;
+            collisionNormal = t_collisionNormal;
+            collisionDistanceSq = t_collisionDistanceSq;
+            collisionPointV01 = 0.0;
+            collisionPointV02 = 0.0;
+            voxelIndexX = t0;
+            voxelIndexY = t1;
+            voxelIndexZ = t2;
         }
-    }
+
+        // return position of collision along the segment
+        return (sqrt(t_collisionDistanceSq) / distanceAB);
+    };
+
+    // the published occupancy map is read, which is never built here. the 
+    // visitor refers to the lambda, so that no memory is allocated.
+    int map = acquireVoxelMap();
+    m_voxelMaps[map].computeSegmentTraversal(voxelPointA, voxelPointB, voxelPadding, std::ref(testVoxel));
+    releaseVoxelMap(map);
 
     // here we finally report the new collision to the collision event handler.
     if (hit)
@@ -1334,15 +1991,16 @@ bool cVoxelObject::computeOtherCollisionDetection(cVector3d& a_segmentPointA,
 /*!
     This method converts this voxel object into a triangle multi-mesh.\n
 
-    \param  a_multiMesh  Multi-mesh.
-    \param  a_gridSizeX  Sampling grid size along __x__-axis
-    \param  a_gridSizeY  Sampling grid size along __y__-axis
-    \param  a_gridSizeZ  Sampling grid size along __z__-axis
+    \param  a_multiMesh      Multi-mesh.
+    \param  a_gridSizeX      Sampling grid size along __x__-axis
+    \param  a_gridSizeY      Sampling grid size along __y__-axis
+    \param  a_gridSizeZ      Sampling grid size along __z__-axis
+    \param  a_enableUpdates  If __true__, the new mesh is updated by updatePolygonization().
 
     \return __true__ of the operation succeeds, __false__otherwise.
 */
 //==============================================================================
-bool cVoxelObject::polygonize(cMultiMesh* a_multiMesh, double a_gridSizeX, double a_gridSizeY, double a_gridSizeZ)
+bool cVoxelObject::polygonize(cMultiMesh* a_multiMesh, double a_gridSizeX, double a_gridSizeY, double a_gridSizeZ, const bool a_enableUpdates)
 {
     // sanity check
     if (a_multiMesh == NULL)
@@ -1354,7 +2012,7 @@ bool cVoxelObject::polygonize(cMultiMesh* a_multiMesh, double a_gridSizeX, doubl
     cMesh* mesh = a_multiMesh->newMesh();
 
     // polygonize volume
-    bool result = polygonize(mesh, a_gridSizeX, a_gridSizeY, a_gridSizeZ);
+    bool result = polygonize(mesh, a_gridSizeX, a_gridSizeY, a_gridSizeZ, a_enableUpdates);
 
     // return
     return (result);
@@ -1363,31 +2021,41 @@ bool cVoxelObject::polygonize(cMultiMesh* a_multiMesh, double a_gridSizeX, doubl
 
 //==============================================================================
 /*!
-    This method converts this voxel object into a triangle mesh.\n
-
-    \param  a_mesh  Mesh object.
-    \param  a_gridSizeX  Sampling grid size along __x__-axis
-    \param  a_gridSizeY  Sampling grid size along __y__-axis
-    \param  a_gridSizeZ  Sampling grid size along __z__-axis
+    This method converts this voxel object into a triangle mesh.\n\n
+
+    The volume is sampled on a regular grid which is divided into blocks 
+    of \ref C_VOXEL_POLYGONIZATION_BLOCK_SIZE cells per side. Blocks are 
+    polygonized on all cores, and blocks whose voxels are all empty or all 
+    occupied are skipped by using the occupancy map of the object. Vertices 
+    located on the same grid edge are shared by all triangles that use them, 
+    and their normals are computed from the gradient of the voxel values, so 
+    the mesh can be passed directly to a collision detector such as 
+    cCollisionAABB.\n\n
+
+    If \p a_enableUpdates is __true__, the triangles of each block are 
+    recorded so that the blocks whose voxels are later modified through 
+    updateVoxels(), setVoxelColor() or clearVoxelsInSphere() can be 
+    polygonized again by calling updatePolygonization(). The mesh must then 
+    remain allocated until updates are disabled by calling 
+    disablePolygonizationUpdates() or by polygonizing another mesh.
+
+    \param  a_mesh           Mesh object.
+    \param  a_gridSizeX      Sampling grid size along __x__-axis
+    \param  a_gridSizeY      Sampling grid size along __y__-axis
+    \param  a_gridSizeZ      Sampling grid size along __z__-axis
+    \param  a_enableUpdates  If __true__, the mesh is updated by updatePolygonization().
 
     \return __true__ of the operation succeeds, __false__otherwise.
 */
 //==============================================================================
-bool cVoxelObject::polygonize(cMesh* a_mesh, double a_gridSizeX, double a_gridSizeY, double a_gridSizeZ)
+bool cVoxelObject::polygonize(cMesh* a_mesh, double a_gridSizeX, double a_gridSizeY, double a_gridSizeZ, const bool a_enableUpdates)
 {
     // sanity check
-    if (a_mesh == NULL)
+    if ((a_mesh == NULL) || (m_texture == nullptr) || (m_texture->m_image == nullptr))
     {
         return (C_ERROR);
     }
 
-    // backup border color
-    cColorb borderColor = m_texture->m_image->m_borderColor;
-
-    // assign new value to border color so that isovalue is zero when fetching
-    // voxel outside the boundaries of the 3D image
-    m_texture->m_image->m_borderColor.set(0.0, 0.0, 0.0, 0.0);
-
     // get size of 3d texture
     double texSize[3];
     texSize[0] = (double)(m_texture->m_image->getWidth());
@@ -1421,6 +2089,12 @@ bool cVoxelObject::polygonize(cMesh* a_mesh, double a_gridSizeX, double a_gridSi
     // compute range of texture
     cVector3d texRange = m_maxTextureCoord - m_minTextureCoord;
 
+    // sanity check
+    if ((objectRange(0) == 0.0) || (objectRange(1) == 0.0) || (objectRange(2) == 0.0))
+    {
+        return (false);
+    }
+
     // set grid size
     double gridSize[3];
     gridSize[0] = a_gridSizeX;
@@ -1429,126 +2103,268 @@ bool cVoxelObject::polygonize(cMesh* a_mesh, double a_gridSizeX, double a_gridSi
 
     for (int i = 0; i < 3; i++)
     {
-        if (gridSize[i] < 0.0)
+        if (gridSize[i] <= 0.0)
         {
             gridSize[i] = st[i];
         }
     }
 
-    // declared variables
-    cMarchingCubeGridCell gridCell;
-    cMarchingCubeTriangle triangles[16];
-    cVector3d p;
+    // sanity check
+    if ((gridSize[0] <= 0.0) || (gridSize[1] <= 0.0) || (gridSize[2] <= 0.0))
+    {
+        return (false);
+    }
 
-    // compute padding
-    double padding[3];
+    // stop updating the previous mesh
+    disablePolygonizationUpdates();
+
+    // setup grid. the grid covers the object with a padding of one cell, 
+    // so that the surface is closed where the volume touches its boundary.
+    cVoxelPolygonization& state = m_polygonization;
+    state.m_mesh = a_mesh;
+    int numBlocks = 1;
     for (int i = 0; i < 3; i++)
     {
-        padding[i] = cMax(st[i], gridSize[i]);
+        double padding = cMax(st[i], gridSize[i]);
+        double range = (m_maxCorner(i) + padding) - (m_minCorner(i) - padding);
+
+        state.m_origin(i) = m_minCorner(i) - padding;
+        state.m_gridSize[i] = gridSize[i];
+        state.m_numCells[i] = cMax(1, (int)ceil(range / gridSize[i]));
+        state.m_numBlocks[i] = (state.m_numCells[i] + C_VOXEL_POLYGONIZATION_BLOCK_SIZE - 1) / C_VOXEL_POLYGONIZATION_BLOCK_SIZE;
+        numBlocks *= state.m_numBlocks[i];
+
+        // compute voxel index of each grid point along this axis, including 
+        // the points located outside of the grid which are used to compute gradients
+        state.m_voxelIndices[i].resize(state.m_numCells[i] + 3);
+        for (int j = 0; j < state.m_numCells[i] + 3; j++)
+        {
+            double p = state.m_origin(i) + (double)(j - 1) * gridSize[i];
+
+            cVector3d texCoord(0.0, 0.0, 0.0);
+            texCoord(i) = m_minTextureCoord(i) + ((p - m_minCorner(i)) / (objectRange(i)) * (texRange(i)));
+
+            int voxel[3];
+            m_texture->m_image->getVoxelLocation(texCoord, voxel[0], voxel[1], voxel[2], false);
+            state.m_voxelIndices[i][j] = voxel[i];
+        }
+    }
+
+    state.m_blockTriangles.resize(numBlocks);
+    state.m_dirtyBlocks.assign(numBlocks, false);
+    state.m_vertexRefs.assign(a_mesh->getNumVertices(), 0);
+    state.m_vertexKeys.assign(a_mesh->getNumVertices(), -1);
+
+    // polygonize all blocks
+    vector<int> blocks(numBlocks);
+    for (int i = 0; i < numBlocks; i++)
+    {
+        blocks[i] = i;
+    }
+    polygonizeBlocks(blocks);
+
+    // release data used by updates
+    if (!a_enableUpdates)
+    {
+        disablePolygonizationUpdates();
+    }
+
+    // return success
+    return (C_SUCCESS);
+}
+
+
+//==============================================================================
+/*!
+    This method polygonizes again the blocks of the mesh last passed to 
+    polygonize() whose voxels have been modified since the last update. 
+    The triangles of these blocks are removed from the mesh and replaced by 
+    new ones, the other triangles of the mesh are left unchanged. If the mesh 
+    has a collision detector, it is updated too.\n\n
+
+    Updates must be enabled when calling polygonize(). This method must not 
+    be called while the mesh is rendered or queried by another thread.
+
+    \return __true__ if the mesh was modified, __false__ otherwise.
+*/
+//==============================================================================
+bool cVoxelObject::updatePolygonization()
+{
+    // sanity check
+    cVoxelPolygonization& state = m_polygonization;
+    if ((state.m_mesh == NULL) || (m_texture == nullptr) || (m_texture->m_image == nullptr))
+    {
+        return (false);
     }
 
-    // parse volume
-    p(2) = m_minCorner(2) - padding[2];
-    while (p(2) < (m_maxCorner(2) + padding[2]))
+    // remove triangles of modified blocks
+    cMesh* mesh = state.m_mesh;
+    vector<int> blocks;
+    for (int i = 0; i < (int)state.m_dirtyBlocks.size(); i++)
     {
-        p(1) = m_minCorner(1) - padding[1];
-        while (p(1) < (m_maxCorner(1) + padding[1]))
+        if (!state.m_dirtyBlocks[i])
+        {
+            continue;
+        }
+        state.m_dirtyBlocks[i] = false;
+        blocks.push_back(i);
+
+        vector<unsigned int>& triangles = state.m_blockTriangles[i];
+        for (unsigned int j = 0; j < triangles.size(); j++)
         {
-            p(0) = m_minCorner(0) - padding[0];
-            while (p(0) < (m_maxCorner(0) + padding[0]))
+            unsigned int vertices[3];
+            vertices[0] = mesh->m_triangles->getVertexIndex0(triangles[j]);
+            vertices[1] = mesh->m_triangles->getVertexIndex1(triangles[j]);
+            vertices[2] = mesh->m_triangles->getVertexIndex2(triangles[j]);
+            mesh->removeTriangle(triangles[j]);
+
+            // release vertices which are no longer used
+            for (int k = 0; k < 3; k++)
             {
-                // compute cell positions
-                gridCell.p[0] = p + cVector3d(0.0, 0.0, 0.0);
-                gridCell.p[1] = p + cVector3d(0.0, gridSize[1], 0.0);
-                gridCell.p[2] = p + cVector3d(gridSize[0], gridSize[1], 0.0);
-                gridCell.p[3] = p + cVector3d(gridSize[0], 0.0, 0.0);
-                gridCell.p[4] = p + cVector3d(0.0, 0.0, gridSize[2]);
-                gridCell.p[5] = p + cVector3d(0.0, gridSize[1], gridSize[2]);
-                gridCell.p[6] = p + cVector3d(gridSize[0], gridSize[1], gridSize[2]);
-                gridCell.p[7] = p + cVector3d(gridSize[0], 0.0, gridSize[2]);
-
-                // get cell value
-                for (int i = 0; i < 8; i++)
+                unsigned int vertex = vertices[k];
+                state.m_vertexRefs[vertex]--;
+                if (state.m_vertexRefs[vertex] == 0)
                 {
-                    // get voxel position
-                    cVector3d p = gridCell.p[i];
-
-                    // compute point in texels
-                    cVector3d texCoord;
-                    texCoord(0) = m_minTextureCoord(0) + ((p(0) - m_minCorner(0)) / (objectRange(0)) * (texRange(0)));
-                    texCoord(1) = m_minTextureCoord(1) + ((p(1) - m_minCorner(1)) / (objectRange(1)) * (texRange(1)));
-                    texCoord(2) = m_minTextureCoord(2) + ((p(2) - m_minCorner(2)) / (objectRange(2)) * (texRange(2)));
-
-                    // color variable
-                    cColorf color;
-
-                    // get voxel color given a texture coordinate
-#if 0
-                    // get voxel position
-                    double x, y, z;
-                    m_texture->m_image->getVoxelLocationInterpolated(texCoord, x, y, z, false);
-                  
-                    // get voxel color
-                    m_texture->m_image->getVoxelColorInterpolated(x, y, z, color);
-#else
-                    // get voxel position
-                    int x, y, z;
-                    m_texture->m_image->getVoxelLocation(texCoord, x, y, z, false);
-                  
-                    // get voxel color
-                    cColorb colorb;
-                    m_texture->m_image->getVoxelColor(x, y, z, colorb);
-                  
-                    // convert color to floating point format
-                    color = colorb.getColorf();
-#endif
-                  
-                    // convert color to isovalue by taking the luminance
-                    double isoValue = color.getA();
-                    gridCell.val[i] = isoValue;
+                    if (state.m_vertexKeys[vertex] >= 0)
+                    {
+                        state.m_sharedVertices.erase(state.m_vertexKeys[vertex]);
+                        state.m_vertexKeys[vertex] = -1;
+                    }
+                    state.m_freeVertices.push_back(vertex);
                 }
+            }
+        }
+        triangles.clear();
+    }
 
-                // polygonize model
-                int numTriangles = cPolygonize(gridCell, m_isosurfaceValue, triangles);
+    if (blocks.empty())
+    {
+        return (false);
+    }
 
-                // add triangles to mesh
-                for (int j = 0; j < numTriangles; j++)
-                {
-                    // compute surface normal (an interpolated normal would be better!)
-                    cVector3d normal = cComputeSurfaceNormal(triangles[j].p[0], triangles[j].p[1], triangles[j].p[2]);
-
-                    // create new triangle
-                    a_mesh->newTriangle(triangles[j].p[0],
-                                        triangles[j].p[1],
-                                        triangles[j].p[2],
-                                        normal, normal, normal);
-                }
+    // polygonize modified blocks
+    polygonizeBlocks(blocks);
 
-                // increment x
-                p(0) = p(0) + gridSize[0];
-            }
+    // update mesh and its collision detector
+    mesh->markForUpdate(false);
+    if (mesh->getCollisionDetector() != NULL)
+    {
+        mesh->getCollisionDetector()->update();
+    }
 
-            // increment y
-            p(1) = p(1) + gridSize[1];
-        }
+    return (true);
+}
+
+
+//==============================================================================
+/*!
+    This method stops updating the mesh last passed to polygonize() and 
+    releases the data used by updatePolygonization().
+*/
+//==============================================================================
+void cVoxelObject::disablePolygonizationUpdates()
+{
+    m_polygonization = cVoxelPolygonization();
+}
+
+
+//==============================================================================
+/*!
+    This method polygonizes a list of blocks of the polygonization grid on 
+    all cores, and adds their triangles to the mesh. Vertices of the mesh 
+    which are no longer used are reused, and vertices located on grid edges 
+    shared with blocks already polygonized are shared with their triangles.
 
-        // increment z
-        p(2) = p(2) + gridSize[2];
+    \param  a_blocks  Indices of the blocks.
+*/
+//==============================================================================
+void cVoxelObject::polygonizeBlocks(const std::vector<int>& a_blocks)
+{
+    cVoxelPolygonization& state = m_polygonization;
+    cMesh* mesh = state.m_mesh;
+    cImage* image = m_texture->m_image.get();
+    float isolevel = m_isosurfaceValue;
+
+    // build occupancy map if the image or the isosurface value have changed. 
+    // the lock prevents the published map from being modified while blocks 
+    // read it.
+    lock_guard<mutex> lock(m_voxelMapLock);
+    buildVoxelMap(true);
+    const cVoxelBrickMap& voxelMap = m_voxelMaps[m_voxelMapFront];
+
+    // blocks are processed in batches, so that only the triangles of one 
+    // batch are stored before they are added to the mesh
+    const int batchSize = 1024;
+    vector<cVoxelPolygonizationBlock> results;
+    for (int first = 0; first < (int)a_blocks.size(); first += batchSize)
+    {
+        int count = cMin(batchSize, (int)a_blocks.size() - first);
 
-        // verbose progress
-        if (true)
+        // polygonize blocks in parallel
+        results.assign(count, cVoxelPolygonizationBlock());
+        cVoxelParallelFor(count, [&](int i)
         {
-            double range = (m_maxCorner(2) + padding[2]) - (m_minCorner(2) - padding[2]);
-            int progress = 100 * ((p(2) - (m_minCorner(2) - padding[2])) / range);
-            cout << "polygonization: "+cStr(progress) + "%                                                       \r";
-        }
-    }
+            cVoxelPolygonizeBlock(image, voxelMap, state, isolevel, a_blocks[first + i], results[i]);
+        });
 
-    // restore border color
-    m_texture->m_image->m_borderColor = borderColor;
+        // add vertices and triangles to mesh in block order
+        for (int i = 0; i < count; i++)
+        {
+            const cVoxelPolygonizationBlock& result = results[i];
+            vector<unsigned int> vertices(result.m_positions.size());
+            for (unsigned int j = 0; j < result.m_positions.size(); j++)
+            {
+                // search for a vertex created by a neighbouring block
+                long long key = result.m_keys[j];
+                if (key >= 0)
+                {
+                    unordered_map<long long, unsigned int>::const_iterator it = state.m_sharedVertices.find(key);
+                    if (it != state.m_sharedVertices.end())
+                    {
+                        vertices[j] = it->second;
+                        continue;
+                    }
+                }
 
-    // return success
-    return (C_SUCCESS);
+                // create new vertex or reuse a free one
+                unsigned int index;
+                if (!state.m_freeVertices.empty())
+                {
+                    index = state.m_freeVertices.back();
+                    state.m_freeVertices.pop_back();
+                    mesh->m_vertices->setLocalPos(index, result.m_positions[j]);
+                    mesh->m_vertices->setNormal(index, result.m_normals[j]);
+                }
+                else
+                {
+                    index = mesh->newVertex(result.m_positions[j], result.m_normals[j]);
+                    state.m_vertexRefs.resize(index + 1, 0);
+                    state.m_vertexKeys.resize(index + 1, -1);
+                }
+
+                state.m_vertexKeys[index] = key;
+                if (key >= 0)
+                {
+                    state.m_sharedVertices[key] = index;
+                }
+                vertices[j] = index;
+            }
+
+            // create triangles
+            vector<unsigned int>& triangles = state.m_blockTriangles[a_blocks[first + i]];
+            for (unsigned int j = 0; j < result.m_triangles.size(); j += 3)
+            {
+                unsigned int vertex0 = vertices[result.m_triangles[j]];
+                unsigned int vertex1 = vertices[result.m_triangles[j + 1]];
+                unsigned int vertex2 = vertices[result.m_triangles[j + 2]];
+                triangles.push_back(mesh->newTriangle(vertex0, vertex1, vertex2));
+
+                state.m_vertexRefs[vertex0]++;
+                state.m_vertexRefs[vertex1]++;
+                state.m_vertexRefs[vertex2]++;
+            }
+        }
+    }
 }
 
 
@@ -48,12 +48,20 @@
 //------------------------------------------------------------------------------
 #include "world/CMesh.h"
 #include "world/CMultiMesh.h"
+#include "world/CVoxelBrickMap.h"
+//------------------------------------------------------------------------------
+#include <atomic>
+#include <mutex>
+#include <unordered_map>
 //------------------------------------------------------------------------------
 
 //------------------------------------------------------------------------------
 namespace chai3d {
 //------------------------------------------------------------------------------
 const int C_NUM_VOXEL_RENDERING_MODES = 9;
+
+//! Number of cells along each side of the blocks in which the polygonization grid is divided.
+const int C_VOXEL_POLYGONIZATION_BLOCK_SIZE = 8;
 //------------------------------------------------------------------------------
 
 //==============================================================================
@@ -87,6 +95,46 @@ struct cVoxelCoordList
     std::vector<cVoxelCoord> m_coords;
 };
 
+//! Describes the polygonization of a voxel object into a mesh.
+struct cVoxelPolygonization
+{
+    //! Mesh which contains the triangles, or __NULL__ if the mesh is not updated.
+    cMesh* m_mesh = NULL;
+
+    //! Position of the first grid point.
+    cVector3d m_origin = cVector3d(0.0, 0.0, 0.0);
+
+    //! Size of the grid cells along each axis.
+    double m_gridSize[3] = { 0.0, 0.0, 0.0 };
+
+    //! Number of grid cells along each axis.
+    int m_numCells[3] = { 0, 0, 0 };
+
+    //! Number of blocks along each axis.
+    int m_numBlocks[3] = { 0, 0, 0 };
+
+    //! Voxel index of the grid points along each axis. Grid point i is stored at index i+1.
+    std::vector<int> m_voxelIndices[3];
+
+    //! Triangles of each block.
+    std::vector<std::vector<unsigned int> > m_blockTriangles;
+
+    //! Flag of each block set when its voxels are modified.
+    std::vector<bool> m_dirtyBlocks;
+
+    //! Number of triangles which use each vertex of the mesh.
+    std::vector<int> m_vertexRefs;
+
+    //! Key of the grid edge of each vertex shared by several blocks, or -1.
+    std::vector<long long> m_vertexKeys;
+
+    //! Vertices of the mesh which are no longer used by any triangle.
+    std::vector<unsigned int> m_freeVertices;
+
+    //! Vertices shared by several blocks, indexed by the key of their grid edge.
+    std::unordered_map<long long, unsigned int> m_sharedVertices;
+};
+
 //------------------------------------------------------------------------------
 #endif  // DOXYGEN_SHOULD_SKIP_THIS
 //------------------------------------------------------------------------------
@@ -101,7 +149,30 @@ struct cVoxelCoordList
     This class implements a 3D volumetric object composed of voxels.
 
     \details
-    This class implements a 3D volumetric object composed of voxels.
+    This class implements a 3D volumetric object composed of voxels.\n\n
+
+    The voxels are stored in the 3D image of the texture of the object 
+    (\ref m_texture). Collision detection uses a sparse occupancy map of the 
+    voxels whose alpha value reaches the isosurface value (see 
+    cVoxelBrickMap), so segments only visit the occupied regions of the 
+    volume. The map is built by the thread which calls updateVoxels() or 
+    setIsosurfaceValue(), or by the next render if the image was replaced 
+    without calling updateVoxels(). Collision queries never build the map: 
+    two maps are kept, and queries read the last published one while the 
+    other one is built or updated, so the haptic thread does not wait for a 
+    build or race with it.\n\n
+
+    Voxels which are modified through setVoxelColor() or 
+    clearVoxelsInSphere() update the occupancy map and the graphic texture 
+    incrementally. If the image is modified directly, updateVoxels() must be 
+    called with the modified region.\n\n
+
+    The volume is converted into a triangle mesh by calling polygonize(). 
+    The grid is divided into blocks of \ref C_VOXEL_POLYGONIZATION_BLOCK_SIZE 
+    cells per side which are polygonized on all cores, and vertices located 
+    on the same grid edge are shared between triangles. If updates are 
+    enabled, the blocks modified by the voxel editing methods are 
+    polygonized again by calling updatePolygonization().
 */
 //==============================================================================
 class cVoxelObject : public cMesh
@@ -163,7 +234,7 @@ public:
     double getQuality() { return (m_quality); }
 
     //! This method sets the isosurface value. Used when isometric rendering is enabled.
-    void setIsosurfaceValue(const float a_isosurfaceValue) { m_isosurfaceValue = cClamp(a_isosurfaceValue, 0.0f, 1.0f); }
+    void setIsosurfaceValue(const float a_isosurfaceValue);
 
     //! This method returns the isosurface value. This setting is used when isometric rendering is enabled.
     float getIsosurfaceValue() { return (m_isosurfaceValue); }
@@ -199,6 +270,25 @@ public:
     bool getUseColorMap() const { return m_useColorMap; }
 
 
+    //--------------------------------------------------------------------------
+    // PUBLIC METHODS - VOXEL EDITING:
+    //--------------------------------------------------------------------------
+
+public:
+
+    //! This method sets the color of a voxel and updates the graphic and collision models.
+    void setVoxelColor(const unsigned int a_x, const unsigned int a_y, const unsigned int a_z, const cColorb& a_color);
+
+    //! This method clears all voxels whose center is located inside a sphere and returns the number of occupied voxels which were removed.
+    int clearVoxelsInSphere(const cVector3d& a_localPos, const double a_radius);
+
+    //! This method updates the graphic and collision models after the voxels of a region of the image have been modified.
+    void updateVoxels(const int a_minX, const int a_minY, const int a_minZ, const int a_maxX, const int a_maxY, const int a_maxZ);
+
+    //! This method updates the graphic and collision models after the image has been modified or replaced.
+    void updateVoxels();
+
+
     //--------------------------------------------------------------------------
     // PUBLIC METHODS - POLYGONIZATION:
     //--------------------------------------------------------------------------
@@ -206,10 +296,26 @@ public:
 public:
 
     //! This method converts this voxel object into a triangle mesh.
-    bool polygonize(cMesh* a_mesh, double a_gridSizeX = -1.0, double a_gridSizeY = -1.0, double a_gridSizeZ = -1.0);
+    bool polygonize(cMesh* a_mesh, double a_gridSizeX = -1.0, double a_gridSizeY = -1.0, double a_gridSizeZ = -1.0, const bool a_enableUpdates = false);
 
     //! This method converts this voxel object into a triangle multi-mesh.
-    bool polygonize(cMultiMesh* a_multiMesh, double a_gridSizeX = -1.0, double a_gridSizeY = -1.0, double a_gridSizeZ = -1.0);
+    bool polygonize(cMultiMesh* a_multiMesh, double a_gridSizeX = -1.0, double a_gridSizeY = -1.0, double a_gridSizeZ = -1.0, const bool a_enableUpdates = false);
+
+    //! This method polygonizes again the blocks of the last polygonized mesh whose voxels have been modified.
+    bool updatePolygonization();
+
+    //! This method stops updating the last polygonized mesh.
+    void disablePolygonizationUpdates();
+
+
+    //--------------------------------------------------------------------------
+    // PUBLIC METHODS - COLLISION DETECTION:
+    //--------------------------------------------------------------------------
+
+public:
+
+    //! This method returns the local boundary box of the volume this object can collide with.
+    virtual bool getCollisionBoundaryBox(cVector3d& a_min, cVector3d& a_max);
 
 
     //--------------------------------------------------------------------------
@@ -243,6 +349,24 @@ protected:
     //! This method loads all rendering shaders.
     void loadRenderingShaders();
 
+    //! This method computes the transformation from local coordinates to voxel coordinates.
+    bool computeVoxelTransform(cVector3d& a_scale, cVector3d& a_offset);
+
+    //! This method builds the occupancy map which is not read by collision queries and publishes it. \ref m_voxelMapLock must be held.
+    void buildVoxelMap(const bool a_onlyIfOutdated);
+
+    //! This method waits until no collision query reads the occupancy map which is not published and returns its index. \ref m_voxelMapLock must be held.
+    int acquireBackVoxelMap();
+
+    //! This method returns the index of the published occupancy map and prevents it from being modified until releaseVoxelMap() is called.
+    int acquireVoxelMap();
+
+    //! This method releases an occupancy map acquired by acquireVoxelMap().
+    void releaseVoxelMap(const int a_index) { m_voxelMapReaders[a_index]--; }
+
+    //! This method polygonizes a list of blocks of the polygonization grid and adds their triangles to the mesh.
+    void polygonizeBlocks(const std::vector<int>& a_blocks);
+
     //! This method updates the mesh model.
     void update(cRenderOptions& a_options);
 
@@ -292,6 +416,24 @@ protected:
     //! List of points.
     std::vector<cVoxelCoordList> m_voxelCoordList;
 
+    //! Sparse occupancy maps of the voxels used for collision detection. One map is read by collision queries while the other one is built or updated.
+    cVoxelBrickMap m_voxelMaps[2];
+
+    //! Index of the occupancy map read by collision queries.
+    std::atomic<int> m_voxelMapFront;
+
+    //! Number of collision queries reading each occupancy map.
+    std::atomic<int> m_voxelMapReaders[2];
+
+    //! Flag of each occupancy map set when it no longer matches the other map and must be copied before it is updated.
+    bool m_voxelMapOutdated[2];
+
+    //! Mutex which serializes the threads that build or update the occupancy maps.
+    std::mutex m_voxelMapLock;
+
+    //! Polygonization of the object which is updated when voxels are modified.
+    cVoxelPolygonization m_polygonization;
+
 
     //--------------------------------------------------------------------------
     // PROTECTED MEMBERS - SHADERS:
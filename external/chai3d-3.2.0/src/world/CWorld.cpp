@@ -73,6 +73,10 @@ cWorld::cWorld()
     // use shadow maps
     m_useShadowCasting = true;
 
+    // collision queries visit all children
+    m_useBroadphase = false;
+    m_broadphaseChildrenVersion = m_childrenVersion;
+
     // initialize matrix
     memset(m_worldModelView, 0, sizeof(m_worldModelView));
 }
@@ -414,6 +418,27 @@ bool cWorld::computeCollisionDetection(const cVector3d& a_segmentPointA,
     // temp variable
     bool hit = false;
 
+    // if the broadphase is up to date, only check children whose boundary 
+    // boxes are crossed by the segment
+    if (m_useBroadphase && (m_broadphaseChildrenVersion == m_childrenVersion))
+    {
+        m_broadphase.computeCandidates(a_segmentPointA,
+                                       a_segmentPointB,
+                                       a_settings,
+                                       m_broadphaseCandidates);
+
+        unsigned int nCandidates = (unsigned int)(m_broadphaseCandidates.size());
+        for (unsigned int i=0; i<nCandidates; i++)
+        {
+            hit = hit | m_children[m_broadphaseCandidates[i]]->computeCollisionDetection(a_segmentPointA,
+                                                                                         a_segmentPointB,
+                                                                                         a_recorder,
+                                                                                         a_settings);
+        }
+
+        return (hit);
+    }
+
     // check for collisions with all children of this world
     unsigned int nChildren = (int)(m_children.size());
     for (unsigned int i=0; i<nChildren; i++)
@@ -429,6 +454,201 @@ bool cWorld::computeCollisionDetection(const cVector3d& a_segmentPointA,
 }
 
 
+//==============================================================================
+/*!
+    This method determines whether a batch of segments intersects any object 
+    in this world. \n
+    Each query reports its collision events in its own recorder according to 
+    its own settings, exactly as if its segment were passed to 
+    \ref computeCollisionDetection(const cVector3d&, const cVector3d&, cCollisionRecorder&, cCollisionSettings&).
+    The flag \ref cCollisionQuery::m_hit of each query is set when a 
+    collision is detected. \n
+    Segments are tested in packets of \ref C_COLLISION_PACKET_SIZE, so that 
+    the collision tree of each object is traversed once per packet. If the 
+    broadphase is enabled, each child is only tested with the segments that 
+    cross its boundary box.
+
+    \param  a_queries     Array of queries, expressed in world coordinates.
+    \param  a_numQueries  Number of queries.
+
+    \return __true__ if a collision has occurred, __false__ otherwise.
+*/
+//==============================================================================
+bool cWorld::computeCollisionDetection(cCollisionQuery* a_queries,
+                                       const int a_numQueries)
+{
+    // temp variable
+    bool hit = false;
+
+    // split large batches into packets
+    if (a_numQueries > C_COLLISION_PACKET_SIZE)
+    {
+        for (int i=0; i<a_numQueries; i+=C_COLLISION_PACKET_SIZE)
+        {
+            hit = hit | computeCollisionDetection(&a_queries[i], cMin(C_COLLISION_PACKET_SIZE, a_numQueries - i));
+        }
+        return (hit);
+    }
+
+    // if the broadphase is up to date, test each candidate child with the 
+    // segments for which it has been returned
+    if (m_useBroadphase && (m_broadphaseChildrenVersion == m_childrenVersion))
+    {
+        int cursors[C_COLLISION_PACKET_SIZE];
+        for (int i=0; i<a_numQueries; i++)
+        {
+            m_broadphase.computeCandidates(a_queries[i].m_segmentPointA,
+                                           a_queries[i].m_segmentPointB,
+                                           *a_queries[i].m_settings,
+                                           m_broadphasePacketCandidates[i]);
+            cursors[i] = 0;
+        }
+
+        // candidates are sorted; children are visited in increasing order
+        cCollisionQuery childQueries[C_COLLISION_PACKET_SIZE];
+        int childIndices[C_COLLISION_PACKET_SIZE];
+        while (true)
+        {
+            // find next candidate child
+            int child = -1;
+            for (int i=0; i<a_numQueries; i++)
+            {
+                if (cursors[i] < (int)(m_broadphasePacketCandidates[i].size()))
+                {
+                    int candidate = m_broadphasePacketCandidates[i][cursors[i]];
+                    if ((child == -1) || (candidate < child))
+                    {
+                        child = candidate;
+                    }
+                }
+            }
+            if (child == -1) { break; }
+
+            // gather segments for which the child is a candidate
+            int numChildQueries = 0;
+            for (int i=0; i<a_numQueries; i++)
+            {
+                if ((cursors[i] < (int)(m_broadphasePacketCandidates[i].size())) &&
+                    (m_broadphasePacketCandidates[i][cursors[i]] == child))
+                {
+                    childQueries[numChildQueries] = a_queries[i];
+                    childQueries[numChildQueries].m_hit = false;
+                    childIndices[numChildQueries] = i;
+                    numChildQueries++;
+                    cursors[i]++;
+                }
+            }
+
+            // test child
+            if (m_children[child]->computeCollisionDetection(childQueries, numChildQueries))
+            {
+                for (int i=0; i<numChildQueries; i++)
+                {
+                    if (childQueries[i].m_hit)
+                    {
+                        a_queries[childIndices[i]].m_hit = true;
+                    }
+                }
+                hit = true;
+            }
+        }
+
+        return (hit);
+    }
+
+    // check for collisions with all children of this world
+    unsigned int nChildren = (int)(m_children.size());
+    for (unsigned int i=0; i<nChildren; i++)
+    {
+        hit = hit | m_children[i]->computeCollisionDetection(a_queries, a_numQueries);
+    }
+
+    // return whether there was a collision between the segments and this world
+    return (hit);
+}
+
+
+//==============================================================================
+/*!
+    This method computes the global position and rotation of this world and of
+    all its descendants. If the broadphase is enabled, it is then updated from
+    the new positions.
+
+    \param  a_frameOnly  If __true__ then only the global frame is computed.
+    \param  a_globalPos  Global position of parent object.
+    \param  a_globalRot  Global rotation matrix of parent object.
+*/
+//==============================================================================
+void cWorld::computeGlobalPositions(const bool a_frameOnly,
+                                    const cVector3d& a_globalPos,
+                                    const cMatrix3d& a_globalRot)
+{
+    cGenericObject::computeGlobalPositions(a_frameOnly, a_globalPos, a_globalRot);
+
+    if (m_useBroadphase)
+    {
+        updateBroadphase();
+    }
+}
+
+
+//==============================================================================
+/*!
+    This method enables or disables the broadphase. When enabled, collision 
+    queries only descend into the children of the world whose boundary boxes,
+    maintained in a dynamic AABB tree, are crossed by the segment. \n
+
+    The broadphase is updated by \ref computeGlobalPositions() or 
+    \ref updateBroadphase(), which must be called, from the thread that 
+    performs the collision queries, after children are added, removed or 
+    modified. Queries fall back on checking all children if the list of 
+    children has been modified since the last update.
+
+    \param  a_useBroadphase  If __true__ then the broadphase is enabled.
+*/
+//==============================================================================
+void cWorld::setUseBroadphase(const bool a_useBroadphase)
+{
+    m_useBroadphase = a_useBroadphase;
+
+    if (m_useBroadphase)
+    {
+        updateBroadphase();
+    }
+    else
+    {
+        m_broadphase.clear();
+    }
+}
+
+
+//==============================================================================
+/*!
+    This method updates the broadphase from the current positions and boundary
+    boxes of the children of this world. Children whose boundary box has not 
+    left the enlarged box stored in the tree are left untouched.
+*/
+//==============================================================================
+void cWorld::updateBroadphase()
+{
+    m_broadphase.update(m_children);
+    m_broadphaseChildrenVersion = m_childrenVersion;
+
+    // make sure queries do not allocate memory
+    if (m_broadphaseCandidates.capacity() < m_children.size())
+    {
+        m_broadphaseCandidates.reserve(m_children.size());
+    }
+    for (int i=0; i<C_COLLISION_PACKET_SIZE; i++)
+    {
+        if (m_broadphasePacketCandidates[i].capacity() < m_children.size())
+        {
+            m_broadphasePacketCandidates[i].reserve(m_children.size());
+        }
+    }
+}
+
+
 //==============================================================================
 /*!
     This method update interaction information between a tool and this world.
@@ -45,6 +45,7 @@
 #ifndef CWorldH
 #define CWorldH
 //------------------------------------------------------------------------------
+#include "collisions/CCollisionBroadphase.h"
 #include "display/CCamera.h"
 #include "graphics/CColor.h"
 #include "graphics/CTriangleArray.h"
@@ -86,7 +87,12 @@ class cShadowMap;
 
     \details
     cWorld defines the root of node the CHAI3D scene graph. It stores 
-    lights, cameras, tools, and objects.
+    lights, cameras, tools, and objects.\n\n
+
+    When the broadphase is enabled (see \ref setUseBroadphase()), a dynamic 
+    AABB tree over the boundary boxes of the children of the world is updated
+    by each call to \ref computeGlobalPositions(), and collision queries only 
+    descend into the children whose boxes are crossed by the segment.
 */
 //==============================================================================
 class cWorld : public cGenericObject
@@ -149,11 +155,39 @@ public:
                                            cCollisionRecorder& a_recorder,
                                            cCollisionSettings& a_settings);
 
+    //! This method computes any collision between a batch of segments and all objects in this world.
+    virtual bool computeCollisionDetection(cCollisionQuery* a_queries,
+                                           const int a_numQueries);
+
     //! This method updates the geometric relationship between the tool and this world.
     virtual void computeLocalInteraction(const cVector3d& a_toolPos,
                                          const cVector3d& a_toolVel,
                                          const unsigned int a_IDN);
 
+    //! This method computes the global position and rotation of this world and its children, and updates the broadphase.
+    virtual void computeGlobalPositions(const bool a_frameOnly = true,
+                                        const cVector3d& a_globalPos = cVector3d(0.0, 0.0, 0.0),
+                                        const cMatrix3d& a_globalRot = cIdentity3d());
+
+
+    //-----------------------------------------------------------------------
+    // PUBLIC METHODS - BROADPHASE:
+    //-----------------------------------------------------------------------
+
+public:
+
+    //! This method enables or disables the broadphase used to cull the children of this world during collision detection.
+    void setUseBroadphase(const bool a_useBroadphase);
+
+    //! This method returns __true__ if the broadphase is enabled, __false__ otherwise.
+    bool getUseBroadphase() const { return (m_useBroadphase); }
+
+    //! This method updates the broadphase from the current positions and boundary boxes of the children of this world.
+    void updateBroadphase();
+
+    //! This method returns a pointer to the broadphase of this world.
+    cCollisionBroadphase* getBroadphase() { return (&m_broadphase); }
+
 
     //-----------------------------------------------------------------------
     // PUBLIC METHODS - SHADOW CASTING:
@@ -240,6 +274,21 @@ protected:
 
     //! If __true__ then shadow maps are used.
     bool m_useShadowCasting;
+
+    //! If __true__ then collision queries are culled by the broadphase.
+    bool m_useBroadphase;
+
+    //! Dynamic AABB tree over the boundary boxes of the children of this world.
+    cCollisionBroadphase m_broadphase;
+
+    //! Version of the list of children from which the broadphase was last updated.
+    unsigned int m_broadphaseChildrenVersion;
+
+    //! Indices of the children returned by the last broadphase query.
+    std::vector<int> m_broadphaseCandidates;
+
+    //! Indices of the children returned by the broadphase for each segment of the last batch of queries.
+    std::vector<int> m_broadphasePacketCandidates[C_COLLISION_PACKET_SIZE];
 };
 
 //------------------------------------------------------------------------------
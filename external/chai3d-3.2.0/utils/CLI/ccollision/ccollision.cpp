@@ -0,0 +1,1128 @@
+//===========================================================================
+/*
+    Software License Agreement (BSD License)
+    Copyright (c) 2003-2016, CHAI3D.
+    (www.chai3d.org)
+
+    All rights reserved.
+
+    Redistribution and use in source and binary forms, with or without
+    modification, are permitted provided that the following conditions
+    are met:
+
+    * Redistributions of source code must retain the above copyright
+    notice, this list of conditions and the following disclaimer.
+
+    * Redistributions in binary form must reproduce the above
+    copyright notice, this list of conditions and the following
+    disclaimer in the documentation and/or other materials provided
+    with the distribution.
+
+    * Neither the name of CHAI3D nor the names of its contributors may
+    be used to endorse or promote products derived from this software
+    without specific prior written permission.
+
+    THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS
+    "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT
+    LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS
+    FOR A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE
+    COPYRIGHT OWNER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT,
+    INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING,
+    BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES;
+    LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER
+    CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT
+    LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN
+    ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+    POSSIBILITY OF SUCH DAMAGE.
+
+    \author    <http://www.chai3d.org>
+    \author    Sebastien Grange
+    \version   3.2.0 $Rev: 2177 $
+*/
+//===========================================================================
+
+//---------------------------------------------------------------------------
+#include <iostream>
+#include <iomanip>
+#include <ostream>
+#include <string>
+#include <random>
+#include <cmath>
+#include <cstdlib>
+#include <vector>
+#include <algorithm>
+#include <thread>
+using namespace std;
+//---------------------------------------------------------------------------
+#include "chai3d.h"
+using namespace chai3d;
+//---------------------------------------------------------------------------
+
+//---------------------------------------------------------------------------
+// DECLARED TYPES
+//---------------------------------------------------------------------------
+
+// random number generator whose sequence does not depend on the platform
+struct Random
+{
+    Random(unsigned int seed) : m_gen(seed) {}
+    double uniform(double a, double b) { return (a + (b - a) * (double)m_gen() / 4294967296.0); }
+    cVector3d direction()
+    {
+        cVector3d v;
+        do { v.set(uniform(-1,1), uniform(-1,1), uniform(-1,1)); } while ((v.lengthsq() < 1e-6) || (v.lengthsq() > 1.0));
+        v.normalize();
+        return v;
+    }
+    mt19937 m_gen;
+};
+
+
+//---------------------------------------------------------------------------
+// DECLARED FUNCTIONS
+//---------------------------------------------------------------------------
+
+// compare two collision events
+bool sameEvent(const cCollisionEvent &a, const cCollisionEvent &b)
+{
+    return ((a.m_type           == b.m_type) &&
+            (a.m_object         == b.m_object) &&
+            (a.m_index          == b.m_index) &&
+            a.m_localPos.equals(b.m_localPos) &&
+            a.m_localNormal.equals(b.m_localNormal) &&
+            (a.m_squareDistance == b.m_squareDistance));
+}
+
+
+// compare two collision records
+bool sameRecord(const cCollisionRecorder &a, const cCollisionRecorder &b)
+{
+    if (a.m_collisions.size() != b.m_collisions.size()) return false;
+    for (unsigned int i=0; i<a.m_collisions.size(); i++)
+    {
+        if (!sameEvent(a.m_collisions[i], b.m_collisions[i])) return false;
+    }
+    return sameEvent(a.m_nearestCollision, b.m_nearestCollision);
+}
+
+
+// build a world containing a few meshes with AABB collision trees
+cWorld* createScene(double radius)
+{
+    cWorld* world = new cWorld();
+
+    cMesh* sphere = new cMesh();
+    cCreateSphere(sphere, 0.05, 64, 64);
+    world->addChild(sphere);
+
+    cMesh* box = new cMesh();
+    cCreateBox(box, 0.06, 0.08, 0.04);
+    box->setLocalPos(0.15, 0.0, 0.0);
+    world->addChild(box);
+
+    cMesh* cylinder = new cMesh();
+    cCreateCylinder(cylinder, 0.08, 0.03, 48, 8);
+    cylinder->setLocalPos(-0.15, 0.0, -0.04);
+    world->addChild(cylinder);
+
+    for (unsigned int i=0; i<world->getNumChildren(); i++)
+    {
+        cMesh* mesh = (cMesh*)world->getChild(i);
+        mesh->createAABBCollisionDetector(radius);
+    }
+    world->computeGlobalPositions(false);
+
+    return world;
+}
+
+
+// deform the sphere of a scene and update its collision tree
+void deformScene(cWorld* world, int step, bool rebuild)
+{
+    cMesh* sphere = (cMesh*)world->getChild(0);
+    int numVertices = sphere->getNumVertices();
+    for (int i=0; i<numVertices; i++)
+    {
+        cVector3d pos = sphere->m_vertices->getLocalPos(i);
+        pos.mul(1.0 + 0.02 * sin(0.001 * step + i));
+        sphere->m_vertices->setLocalPos(i, pos);
+    }
+
+    if (rebuild)
+    {
+        sphere->getCollisionDetector()->update();
+    }
+    else
+    {
+        sphere->getCollisionDetector()->refit();
+    }
+}
+
+
+// cached and uncached queries must report the same contacts
+int testCache(int steps, unsigned int seed)
+{
+    int errors = 0;
+
+    cout << "cache: cached vs. uncached queries" << endl;
+    cout << "  radius   nearest   queries   contacts   hits     misses   mismatches   uncached (us)   cached (us)" << endl;
+
+    for (int r=0; r<2; r++)
+    {
+        for (int n=0; n<2; n++)
+        {
+            double radius  = (r == 0) ? 0.0 : 0.002;
+            bool   nearest = (n == 0);
+            cWorld* world = createScene(radius);
+            cCollisionAABBCache cache;
+            Random random(seed);
+
+            cCollisionSettings settings;
+            settings.m_checkForNearestCollisionOnly = nearest;
+            settings.m_collisionRadius = radius;
+
+            cCollisionSettings cachedSettings = settings;
+            cachedSettings.m_contactCache = &cache;
+
+            cCollisionRecorder recorder;
+            cCollisionRecorder cachedRecorder;
+
+            cPrecisionClock clock;
+            double timeUncached = 0.0;
+            double timeCached = 0.0;
+            int contacts = 0;
+            int mismatches = 0;
+
+            // trajectories oscillate across the surface of each object in turn,
+            // with a jump between objects every few hundred steps
+            cVector3d dir = random.direction();
+            cVector3d prev = world->getChild(0)->getLocalPos() + 0.05 * dir;
+            for (int k=0; k<steps; k++)
+            {
+                int object = (k / 500) % world->getNumChildren();
+                cVector3d center = world->getChild(object)->getLocalPos();
+                dir = dir + 0.02 * random.direction();
+                dir.normalize();
+                cVector3d pos = center + (0.05 * (1.0 + 0.3 * sin(0.02 * k)) + random.uniform(-0.002, 0.002)) * dir;
+
+                // deform the sphere regularly, alternating refits and rebuilds
+                if ((k % 2000) == 1999)
+                {
+                    deformScene(world, k, (k % 4000) == 3999);
+                }
+
+                recorder.clear();
+                clock.start(true);
+                world->computeCollisionDetection(prev, pos, recorder, settings);
+                timeUncached += clock.stop();
+
+                cachedRecorder.clear();
+                clock.start(true);
+                world->computeCollisionDetection(prev, pos, cachedRecorder, cachedSettings);
+                timeCached += clock.stop();
+
+                if (recorder.m_nearestCollision.m_object != NULL) contacts++;
+                if (!sameRecord(recorder, cachedRecorder))
+                {
+                    mismatches++;
+                }
+
+                prev = pos;
+            }
+
+            cout << "  " << setw(6) << radius
+                 << "   " << setw(7) << (nearest ? "yes" : "no")
+                 << "   " << setw(7) << steps
+                 << "   " << setw(8) << contacts
+                 << "   " << setw(6) << cache.getNumHits()
+                 << "   " << setw(6) << cache.getNumMisses()
+                 << "   " << setw(10) << mismatches
+                 << "   " << setw(13) << fixed << setprecision(3) << 1e6 * timeUncached / steps
+                 << "   " << setw(11) << 1e6 * timeCached / steps << endl;
+            cout.unsetf(ios::floatfield);
+
+            // the cache must be exercised and must not change any result
+            if ((mismatches > 0) || (contacts == 0) || (cache.getNumHits() == 0))
+            {
+                errors++;
+            }
+
+            delete world;
+        }
+    }
+
+    cout << "cache: " << ((errors == 0) ? "passed" : "FAILED") << endl << endl;
+
+    return errors;
+}
+
+
+// mesh whose elements cannot be bounded, always reported by the broadphase
+class cUnboundedMesh : public cMesh
+{
+public:
+    virtual bool getCollisionBoundaryBox(cVector3d& a_min, cVector3d& a_max) { return (false); }
+};
+
+
+// compare the contacts reported by two collision detectors of the same mesh,
+// which may visit the elements in a different order
+bool sameContacts(const cCollisionRecorder &a, const cCollisionRecorder &b)
+{
+    if (a.m_collisions.size() != b.m_collisions.size()) return false;
+
+    vector<pair<int,double> > contactsA, contactsB;
+    for (unsigned int i=0; i<a.m_collisions.size(); i++)
+    {
+        contactsA.push_back(make_pair(a.m_collisions[i].m_index, a.m_collisions[i].m_squareDistance));
+        contactsB.push_back(make_pair(b.m_collisions[i].m_index, b.m_collisions[i].m_squareDistance));
+    }
+    sort(contactsA.begin(), contactsA.end());
+    sort(contactsB.begin(), contactsB.end());
+    if (contactsA != contactsB) return false;
+
+    // elements sharing an edge or a vertex may both be nearest, compare distances only
+    if ((a.m_nearestCollision.m_object == NULL) != (b.m_nearestCollision.m_object == NULL)) return false;
+    return (a.m_nearestCollision.m_squareDistance == b.m_nearestCollision.m_squareDistance);
+}
+
+
+// check whether a segment enlarged by a radius crosses a box
+bool segmentCrossesBox(const cVector3d &a, const cVector3d &b, const cVector3d &min, const cVector3d &max, double radius)
+{
+    double t0 = 0.0;
+    double t1 = 1.0;
+    for (int i=0; i<3; i++)
+    {
+        double lo = min(i) - radius;
+        double hi = max(i) + radius;
+        double d = b(i) - a(i);
+        if (d == 0.0)
+        {
+            if ((a(i) < lo) || (a(i) > hi)) return false;
+            continue;
+        }
+        double ta = (lo - a(i)) / d;
+        double tb = (hi - a(i)) / d;
+        t0 = cMax(t0, cMin(ta, tb));
+        t1 = cMin(t1, cMax(ta, tb));
+        if (t0 > t1) return false;
+    }
+    return true;
+}
+
+
+// enclose an object and its descendants in a box of world coordinates, 
+// from the corners of their collision boundary boxes
+bool encloseInWorld(cGenericObject* object, cVector3d &min, cVector3d &max)
+{
+    if (object->getGhostEnabled()) return true;
+
+    cVector3d boxMin, boxMax;
+    if (!object->getCollisionBoundaryBox(boxMin, boxMax)) return false;
+
+    if ((boxMin(0) <= boxMax(0)) && (boxMin(1) <= boxMax(1)) && (boxMin(2) <= boxMax(2)))
+    {
+        for (int c=0; c<8; c++)
+        {
+            cVector3d corner((c & 1) ? boxMax(0) : boxMin(0),
+                             (c & 2) ? boxMax(1) : boxMin(1),
+                             (c & 4) ? boxMax(2) : boxMin(2));
+            cVector3d p = object->getGlobalPos() + object->getGlobalRot() * corner;
+            for (int i=0; i<3; i++)
+            {
+                min(i) = cMin(min(i), p(i));
+                max(i) = cMax(max(i), p(i));
+            }
+        }
+    }
+
+    for (unsigned int i=0; i<object->getNumChildren(); i++)
+    {
+        if (!encloseInWorld(object->getChild(i), min, max)) return false;
+    }
+    return true;
+}
+
+
+// create a small mesh at a random pose, some with a child mesh and some unbounded
+cGenericObject* createObject(Random &random, double radius)
+{
+    bool unbounded = (random.uniform(0, 1) < 0.01);
+    cMesh* mesh = unbounded ? new cUnboundedMesh() : new cMesh();
+
+    double size = random.uniform(0.01, 0.03);
+    int kind = (int)(random.uniform(0, 3));
+    if (kind == 0)      cCreateSphere(mesh, size, 12, 12);
+    else if (kind == 1) cCreateBox(mesh, 2 * size, size, 1.5 * size);
+    else                cCreateCylinder(mesh, 2 * size, 0.5 * size, 12, 1);
+
+    if (unbounded) mesh->createBruteForceCollisionDetector();
+    else           mesh->createAABBCollisionDetector(radius);
+
+    if (!unbounded && (random.uniform(0, 1) < 0.15))
+    {
+        cMesh* child = new cMesh();
+        cCreateBox(child, size, size, size);
+        child->setLocalPos(2.5 * size, 0.0, 0.0);
+        child->createAABBCollisionDetector(radius);
+        mesh->addChild(child);
+    }
+
+    cMatrix3d rot;
+    rot.setAxisAngleRotationRad(random.direction(), random.uniform(0, C_TWO_PI));
+    mesh->setLocalPos(random.uniform(-0.5, 0.5), random.uniform(-0.5, 0.5), random.uniform(-0.5, 0.5));
+    mesh->setLocalRot(rot);
+
+    return mesh;
+}
+
+
+// create a segment close to the surface of a random object, or across the scene
+void createSegment(Random &random, cWorld* world, cVector3d &a, cVector3d &b)
+{
+    if (random.uniform(0, 1) < 0.1)
+    {
+        a.set(random.uniform(-0.6, 0.6), random.uniform(-0.6, 0.6), random.uniform(-0.6, 0.6));
+        b.set(random.uniform(-0.6, 0.6), random.uniform(-0.6, 0.6), random.uniform(-0.6, 0.6));
+        return;
+    }
+
+    int object = (int)(random.uniform(0, world->getNumChildren()));
+    a = world->getChild(object)->getGlobalPos() + random.uniform(0.0, 0.04) * random.direction();
+    b = a + 0.01 * random.direction();
+}
+
+
+// broadphase queries must report the same contacts as queries testing every
+// child of the world, and its candidates must contain every child whose box
+// is crossed by the segment
+int testBroadphase(int steps, unsigned int seed)
+{
+    int errors = 0;
+    const int numObjects = 200;
+    const double buildRadius = 0.005;
+
+    cout << "broadphase: broadphase vs. brute force (" << numObjects << " objects)" << endl;
+    cout << "  radius   nearest   adjust   queries   contacts   crossed   candidates   mismatches   brute (us)   broadphase (us)   packet brute (us)   packet broadphase (us)   update (us)" << endl;
+
+    // radius, nearest only, adjust object motion
+    const double configs[4][3] = { {0.0, 1, 1}, {0.0, 0, 0}, {0.005, 1, 0}, {0.005, 0, 1} };
+
+    for (int c=0; c<4; c++)
+    {
+        Random random(seed);
+        cWorld* world = new cWorld();
+        for (int i=0; i<numObjects; i++)
+        {
+            world->addChild(createObject(random, buildRadius));
+        }
+        world->computeGlobalPositions(false);
+        world->setUseBroadphase(true);
+
+        cCollisionSettings settings;
+        settings.m_collisionRadius = configs[c][0];
+        settings.m_checkForNearestCollisionOnly = (configs[c][1] != 0);
+        settings.m_adjustObjectMotion = (configs[c][2] != 0);
+
+        cCollisionRecorder recorder;
+        cCollisionRecorder bruteRecorder;
+        cCollisionRecorder packetRecorders[C_COLLISION_PACKET_SIZE];
+        cCollisionRecorder brutePacketRecorders[C_COLLISION_PACKET_SIZE];
+        cCollisionQuery queries[C_COLLISION_PACKET_SIZE];
+        for (int i=0; i<C_COLLISION_PACKET_SIZE; i++)
+        {
+            queries[i].m_recorder = &packetRecorders[i];
+            queries[i].m_settings = &settings;
+        }
+
+        vector<cVector3d> boxMin, boxMax;
+        vector<bool> bounded, moved;
+        vector<int> candidates;
+
+        cPrecisionClock clock;
+        double timeBrute = 0.0;
+        double timeBroadphase = 0.0;
+        double timePacketBrute = 0.0;
+        double timePacketBroadphase = 0.0;
+        double timeUpdate = 0.0;
+        long long numCrossed = 0;
+        long long numCandidates = 0;
+        int queriesDone = 0;
+        int contacts = 0;
+        int mismatches = 0;
+
+        for (int k=0; k<steps; k++)
+        {
+            int numChildren = world->getNumChildren();
+
+            // replace an object from time to time
+            if ((k % 1000) == 999)
+            {
+                cGenericObject* object = world->getChild((int)(random.uniform(0, numChildren)));
+                world->removeChild(object);
+                delete object;
+                world->addChild(createObject(random, buildRadius));
+            }
+
+            // move a few objects
+            moved.assign(numChildren, false);
+            for (int i=0; i<numChildren / 20; i++)
+            {
+                int index = (int)(random.uniform(0, numChildren));
+                cGenericObject* object = world->getChild(index);
+                object->setLocalPos(object->getLocalPos() + random.uniform(0.0, 0.01) * random.direction());
+                if (random.uniform(0, 1) < 0.3)
+                {
+                    cMatrix3d rot;
+                    rot.setAxisAngleRotationRad(random.direction(), random.uniform(-0.1, 0.1));
+                    object->setLocalRot(cMul(rot, object->getLocalRot()));
+                }
+                moved[index] = true;
+            }
+
+            clock.start(true);
+            world->computeGlobalPositions(true);
+            timeUpdate += clock.stop();
+
+            // boundary boxes of the children, computed independently of the broadphase
+            boxMin.assign(numChildren, cVector3d( C_LARGE, C_LARGE, C_LARGE));
+            boxMax.assign(numChildren, cVector3d(-C_LARGE,-C_LARGE,-C_LARGE));
+            bounded.assign(numChildren, true);
+            for (int i=0; i<numChildren; i++)
+            {
+                bounded[i] = encloseInWorld(world->getChild(i), boxMin[i], boxMax[i]);
+            }
+
+            // single query
+            cVector3d a, b;
+            createSegment(random, world, a, b);
+
+            recorder.clear();
+            clock.start(true);
+            world->computeCollisionDetection(a, b, recorder, settings);
+            timeBroadphase += clock.stop();
+
+            bruteRecorder.clear();
+            clock.start(true);
+            for (int i=0; i<numChildren; i++)
+            {
+                world->getChild(i)->computeCollisionDetection(a, b, bruteRecorder, settings);
+            }
+            timeBrute += clock.stop();
+
+            if (bruteRecorder.m_nearestCollision.m_object != NULL) contacts++;
+            if (!sameRecord(recorder, bruteRecorder)) mismatches++;
+
+            world->getBroadphase()->computeCandidates(a, b, settings, candidates);
+            numCandidates += candidates.size();
+            for (int i=0; i<numChildren; i++)
+            {
+                bool crossed = !bounded[i] ||
+                               segmentCrossesBox(a, b, boxMin[i], boxMax[i], settings.m_collisionRadius) ||
+                               (settings.m_adjustObjectMotion && moved[i]);
+                if (!crossed) continue;
+                numCrossed++;
+                if (!binary_search(candidates.begin(), candidates.end(), i)) mismatches++;
+            }
+            queriesDone++;
+
+            // packet of queries
+            for (int i=0; i<C_COLLISION_PACKET_SIZE; i++)
+            {
+                createSegment(random, world, queries[i].m_segmentPointA, queries[i].m_segmentPointB);
+                packetRecorders[i].clear();
+                brutePacketRecorders[i].clear();
+                queries[i].m_hit = false;
+            }
+
+            clock.start(true);
+            world->computeCollisionDetection(queries, C_COLLISION_PACKET_SIZE);
+            timePacketBroadphase += clock.stop();
+
+            clock.start(true);
+            for (int j=0; j<C_COLLISION_PACKET_SIZE; j++)
+            {
+                for (int i=0; i<numChildren; i++)
+                {
+                    world->getChild(i)->computeCollisionDetection(queries[j].m_segmentPointA, queries[j].m_segmentPointB, brutePacketRecorders[j], settings);
+                }
+            }
+            timePacketBrute += clock.stop();
+
+            for (int i=0; i<C_COLLISION_PACKET_SIZE; i++)
+            {
+                if (brutePacketRecorders[i].m_nearestCollision.m_object != NULL) contacts++;
+                if (!sameRecord(packetRecorders[i], brutePacketRecorders[i])) mismatches++;
+            }
+            queriesDone += C_COLLISION_PACKET_SIZE;
+        }
+
+        cout << "  " << setw(6) << settings.m_collisionRadius
+             << "   " << setw(7) << (settings.m_checkForNearestCollisionOnly ? "yes" : "no")
+             << "   " << setw(6) << (settings.m_adjustObjectMotion ? "yes" : "no")
+             << "   " << setw(7) << queriesDone
+             << "   " << setw(8) << contacts
+             << "   " << fixed << setprecision(2) << setw(7) << (double)numCrossed / steps
+             << "   " << setw(10) << (double)numCandidates / steps
+             << "   " << setw(10) << mismatches
+             << "   " << setprecision(3) << setw(10) << 1e6 * timeBrute / steps
+             << "   " << setw(15) << 1e6 * timeBroadphase / steps
+             << "   " << setw(17) << 1e6 * timePacketBrute / (steps * C_COLLISION_PACKET_SIZE)
+             << "   " << setw(22) << 1e6 * timePacketBroadphase / (steps * C_COLLISION_PACKET_SIZE)
+             << "   " << setw(11) << 1e6 * timeUpdate / steps << endl;
+        cout.unsetf(ios::floatfield);
+
+        if ((mismatches > 0) || (contacts == 0))
+        {
+            errors++;
+        }
+
+        delete world;
+    }
+
+    cout << "broadphase: " << ((errors == 0) ? "passed" : "FAILED") << endl << endl;
+
+    return errors;
+}
+
+
+// create a mesh with a dense noisy sphere, a sparse plane and a thin cylinder
+cMesh* createIrregularMesh(unsigned int seed, int resolution = 48)
+{
+    Random random(seed);
+    cMesh* mesh = new cMesh();
+    cCreateSphere(mesh, 0.05, resolution, resolution);
+    int numVertices = mesh->getNumVertices();
+    for (int i=0; i<numVertices; i++)
+    {
+        cVector3d pos = mesh->m_vertices->getLocalPos(i);
+        pos.mul(1.0 + random.uniform(-0.02, 0.02));
+        mesh->m_vertices->setLocalPos(i, pos);
+    }
+    cCreatePlane(mesh, 0.4, 0.4, cVector3d(0.0, 0.0, -0.06));
+    cCreateCylinder(mesh, 0.2, 0.005, 32, 16, 1, true, true, cVector3d(0.12, 0.0, 0.0));
+    return mesh;
+}
+
+
+// AABB trees built by both methods must report the same contacts as a 
+// brute force test of every triangle
+int testTree(int steps, unsigned int seed)
+{
+    int errors = 0;
+    const double buildRadius = 0.002;
+
+    cout << "tree: AABB trees vs. brute force" << endl;
+
+    cMesh* brute = createIrregularMesh(seed);
+    brute->createBruteForceCollisionDetector();
+    brute->computeGlobalPositions(false);
+
+    cPrecisionClock clock;
+    cMesh* midpoint = createIrregularMesh(seed);
+    clock.start(true);
+    midpoint->createAABBCollisionDetector(buildRadius, C_AABB_BUILD_MIDPOINT);
+    double timeBuildMidpoint = clock.stop();
+    midpoint->computeGlobalPositions(false);
+
+    cMesh* sah = createIrregularMesh(seed);
+    clock.start(true);
+    sah->createAABBCollisionDetector(buildRadius, C_AABB_BUILD_SAH);
+    double timeBuildSAH = clock.stop();
+    sah->computeGlobalPositions(false);
+
+    cout << "  triangles: " << brute->getNumTriangles()
+         << "   build midpoint (ms): " << fixed << setprecision(3) << 1e3 * timeBuildMidpoint
+         << "   build SAH (ms): " << 1e3 * timeBuildSAH << endl;
+    cout.unsetf(ios::floatfield);
+    cout << "  radius   nearest   queries   contacts   mismatches   brute (us)   midpoint (us)   SAH (us)" << endl;
+
+    for (int r=0; r<2; r++)
+    {
+        for (int n=0; n<2; n++)
+        {
+            Random random(seed);
+
+            cCollisionSettings settings;
+            settings.m_collisionRadius = (r == 0) ? 0.0 : buildRadius;
+            settings.m_checkForNearestCollisionOnly = (n == 0);
+
+            cCollisionRecorder bruteRecorder, midpointRecorder, sahRecorder;
+            double timeBrute = 0.0;
+            double timeMidpoint = 0.0;
+            double timeSAH = 0.0;
+            int contacts = 0;
+            int mismatches = 0;
+
+            for (int k=0; k<steps; k++)
+            {
+                // short segments close to the surfaces, and a few across the mesh
+                cVector3d a, b;
+                if ((k % 10) == 0)
+                {
+                    a.set(random.uniform(-0.15, 0.2), random.uniform(-0.2, 0.2), random.uniform(-0.1, 0.1));
+                    b.set(random.uniform(-0.15, 0.2), random.uniform(-0.2, 0.2), random.uniform(-0.1, 0.1));
+                }
+                else
+                {
+                    bool cylinder = ((k % 3) == 0);
+                    cVector3d center = cylinder ? cVector3d(0.12, 0.0, random.uniform(-0.1, 0.1)) : cVector3d(0.0, 0.0, 0.0);
+                    a = center + (cylinder ? random.uniform(0.0, 0.01) : random.uniform(0.045, 0.055)) * random.direction();
+                    b = a + 0.005 * random.direction();
+                }
+
+                bruteRecorder.clear();
+                clock.start(true);
+                brute->computeCollisionDetection(a, b, bruteRecorder, settings);
+                timeBrute += clock.stop();
+
+                midpointRecorder.clear();
+                clock.start(true);
+                midpoint->computeCollisionDetection(a, b, midpointRecorder, settings);
+                timeMidpoint += clock.stop();
+
+                sahRecorder.clear();
+                clock.start(true);
+                sah->computeCollisionDetection(a, b, sahRecorder, settings);
+                timeSAH += clock.stop();
+
+                if (bruteRecorder.m_nearestCollision.m_object != NULL) contacts++;
+                if (!sameContacts(bruteRecorder, midpointRecorder)) mismatches++;
+                if (!sameContacts(bruteRecorder, sahRecorder)) mismatches++;
+            }
+
+            cout << "  " << setw(6) << settings.m_collisionRadius
+                 << "   " << setw(7) << (settings.m_checkForNearestCollisionOnly ? "yes" : "no")
+                 << "   " << setw(7) << steps
+                 << "   " << setw(8) << contacts
+                 << "   " << setw(10) << mismatches
+                 << "   " << fixed << setprecision(3) << setw(10) << 1e6 * timeBrute / steps
+                 << "   " << setw(13) << 1e6 * timeMidpoint / steps
+                 << "   " << setw(8) << 1e6 * timeSAH / steps << endl;
+            cout.unsetf(ios::floatfield);
+
+            if ((mismatches > 0) || (contacts == 0))
+            {
+                errors++;
+            }
+        }
+    }
+
+    delete brute;
+    delete midpoint;
+    delete sah;
+
+    cout << "tree: " << ((errors == 0) ? "passed" : "FAILED") << endl << endl;
+
+    return errors;
+}
+
+
+// append the vertices and triangles of a mesh to another mesh
+void appendMesh(cMesh* mesh, cMesh* part)
+{
+    int vertexOffset = mesh->getNumVertices();
+    int numVertices = part->getNumVertices();
+    for (int i=0; i<numVertices; i++)
+    {
+        mesh->newVertex(part->m_vertices->getLocalPos(i));
+    }
+    int numTriangles = part->getNumTriangles();
+    for (int i=0; i<numTriangles; i++)
+    {
+        mesh->newTriangle(part->m_triangles->getVertexIndex0(i) + vertexOffset,
+                          part->m_triangles->getVertexIndex1(i) + vertexOffset,
+                          part->m_triangles->getVertexIndex2(i) + vertexOffset);
+    }
+}
+
+
+// build an AABB tree of a mesh on a given number of threads, and return the build time
+double buildTree(cCollisionAABB* tree, cMesh* mesh, double radius, cCollisionAABBBuildMethod method, unsigned int numThreads)
+{
+    cPrecisionClock clock;
+    tree->setNumBuildThreads(numThreads);
+    clock.start(true);
+    tree->initialize(mesh->m_triangles, radius, method);
+    return (clock.stop());
+}
+
+
+// SAH trees built on one and on several threads must be identical, and must 
+// report the same contacts as midpoint trees and a brute force test of every
+// triangle. Meshes large enough for subtrees to be built in parallel are 
+// generated, and the models given on the command line are merged into one
+// more mesh
+int testBuild(int steps, unsigned int seed, const vector<string> &models)
+{
+    int errors = 0;
+    const unsigned int numThreads = cMax(4u, std::thread::hardware_concurrency());
+
+    cout << "build: midpoint and SAH builds vs. brute force (SAH on 1 and " << numThreads << " threads)" << endl;
+
+    vector<string> names;
+    vector<cMesh*> meshes;
+    const int resolutions[3] = { 48, 96, 192 };
+    for (int i=0; i<3; i++)
+    {
+        names.push_back("sphere " + to_string(resolutions[i]));
+        meshes.push_back(createIrregularMesh(seed, resolutions[i]));
+    }
+    if (models.size() > 0)
+    {
+        cMesh* mesh = new cMesh();
+        for (unsigned int i=0; i<models.size(); i++)
+        {
+            cMultiMesh model;
+            cMesh part;
+            if (!model.loadFromFile(models[i]))
+            {
+                cout << "  error - cannot load " << models[i] << endl;
+                errors++;
+                continue;
+            }
+            model.convertToSingleMesh(&part);
+            appendMesh(mesh, &part);
+        }
+        names.push_back("models");
+        meshes.push_back(mesh);
+    }
+
+    // each brute force query tests every triangle, so fewer queries are run
+    const int queries = cMax(10, steps / 20);
+
+    cout << "  mesh         triangles   midpoint (ms)   SAH 1 (ms)   SAH " << setw(2) << numThreads << " (ms)   queries   contacts   mismatches   brute (us)   midpoint (us)   SAH (us)" << endl;
+
+    for (unsigned int m=0; m<meshes.size(); m++)
+    {
+        cMesh* mesh = meshes[m];
+        mesh->computeGlobalPositions(false);
+        mesh->computeBoundaryBox(true);
+        double size = cDistance(mesh->getBoundaryMin(), mesh->getBoundaryMax());
+        double buildRadius = 0.005 * size;
+
+        cCollisionBrute brute(mesh->m_triangles);
+        cCollisionAABB midpoint, serial, parallel;
+        double timeBuildMidpoint = buildTree(&midpoint, mesh, buildRadius, C_AABB_BUILD_MIDPOINT, 1);
+        double timeBuildSerial = buildTree(&serial, mesh, buildRadius, C_AABB_BUILD_SAH, 1);
+        double timeBuildParallel = buildTree(&parallel, mesh, buildRadius, C_AABB_BUILD_SAH, numThreads);
+
+        Random random(seed);
+        double timeBrute = 0.0;
+        double timeMidpoint = 0.0;
+        double timeSAH = 0.0;
+        int contacts = 0;
+        int mismatches = 0;
+        cPrecisionClock clock;
+
+        for (int k=0; k<queries; k++)
+        {
+            // short segments close to the surface
+            cCollisionSettings settings;
+            settings.m_collisionRadius = ((k % 2) == 0) ? 0.0 : buildRadius;
+            settings.m_checkForNearestCollisionOnly = ((k % 4) < 2);
+
+            cVector3d a = mesh->m_vertices->getLocalPos((int)random.uniform(0, mesh->getNumVertices())) + random.uniform(0.0, 0.01 * size) * random.direction();
+            cVector3d b = a + 0.01 * size * random.direction();
+
+            cCollisionRecorder bruteRecorder, midpointRecorder, serialRecorder, parallelRecorder;
+
+            clock.start(true);
+            brute.computeCollision(mesh, a, b, bruteRecorder, settings);
+            timeBrute += clock.stop();
+
+            clock.start(true);
+            midpoint.computeCollision(mesh, a, b, midpointRecorder, settings);
+            timeMidpoint += clock.stop();
+
+            clock.start(true);
+            serial.computeCollision(mesh, a, b, serialRecorder, settings);
+            timeSAH += clock.stop();
+
+            parallel.computeCollision(mesh, a, b, parallelRecorder, settings);
+
+            if (bruteRecorder.m_nearestCollision.m_object != NULL) contacts++;
+            if (!sameContacts(bruteRecorder, midpointRecorder)) mismatches++;
+            if (!sameContacts(bruteRecorder, serialRecorder)) mismatches++;
+            if (!sameRecord(serialRecorder, parallelRecorder)) mismatches++;
+        }
+
+        cout << "  " << left << setw(11) << names[m] << right
+             << "   " << setw(9) << mesh->getNumTriangles()
+             << "   " << fixed << setprecision(3) << setw(13) << 1e3 * timeBuildMidpoint
+             << "   " << setw(10) << 1e3 * timeBuildSerial
+             << "   " << setw(11) << 1e3 * timeBuildParallel
+             << "   " << setw(7) << queries
+             << "   " << setw(8) << contacts
+             << "   " << setw(10) << mismatches
+             << "   " << setw(10) << 1e6 * timeBrute / queries
+             << "   " << setw(13) << 1e6 * timeMidpoint / queries
+             << "   " << setw(8) << 1e6 * timeSAH / queries << endl;
+        cout.unsetf(ios::floatfield);
+
+        if ((mismatches > 0) || (contacts == 0))
+        {
+            errors++;
+        }
+
+        delete mesh;
+    }
+
+    cout << "build: " << ((errors == 0) ? "passed" : "FAILED") << endl << endl;
+
+    return errors;
+}
+
+
+// create a square grid of triangles in the XY plane
+cMesh* createGrid(int size, double spacing)
+{
+    cMesh* mesh = new cMesh();
+    for (int j=0; j<=size; j++)
+    {
+        for (int i=0; i<=size; i++)
+        {
+            mesh->newVertex(i * spacing, j * spacing, 0.0);
+        }
+    }
+    for (int j=0; j<size; j++)
+    {
+        for (int i=0; i<size; i++)
+        {
+            int a = j * (size + 1) + i;
+            mesh->newTriangle(a, a + 1, a + size + 2);
+            mesh->newTriangle(a, a + size + 2, a + size + 1);
+        }
+    }
+    return mesh;
+}
+
+
+// deform a grid created by createGrid() with a travelling wave, and swirl it
+// progressively around its center so that its collision tree degrades
+void deformGrid(cMesh* mesh, int size, double spacing, int frame, int numFrames)
+{
+    double half = 0.5 * size * spacing;
+    double twist = 4.0 * C_PI * (double)frame / (double)numFrames;
+    for (int j=0; j<=size; j++)
+    {
+        for (int i=0; i<=size; i++)
+        {
+            double x = i * spacing - half;
+            double y = j * spacing - half;
+            double angle = twist * sqrt(x * x + y * y) / half;
+            cVector3d pos(x * cos(angle) - y * sin(angle),
+                          x * sin(angle) + y * cos(angle),
+                          0.1 * spacing * sin(0.2 * frame + 20.0 * x));
+            mesh->m_vertices->setLocalPos(j * (size + 1) + i, pos);
+        }
+    }
+}
+
+
+// an AABB tree refitted to a deforming mesh, and replaced by trees rebuilt in
+// background when it degrades, must report the same contacts as a brute force
+// test of every triangle
+int testRefit(int steps, unsigned int seed)
+{
+    int errors = 0;
+    const int size = 100;
+    const double spacing = 0.001;
+    const double buildRadius = 0.0005;
+    const int numFrames = 200;
+
+    // each brute force query tests every triangle, so fewer queries are run
+    const int queriesPerFrame = cMax(1, steps / (10 * numFrames));
+
+    cout << "refit: refitted AABB tree vs. brute force" << endl;
+
+    cMesh* brute = createGrid(size, spacing);
+    brute->createBruteForceCollisionDetector();
+    brute->computeGlobalPositions(false);
+
+    cMesh* mesh = createGrid(size, spacing);
+    mesh->createAABBCollisionDetector(buildRadius);
+    mesh->computeGlobalPositions(false);
+    cCollisionAABB* tree = (cCollisionAABB*)mesh->getCollisionDetector();
+
+    cout << "  triangles   frames   queries   contacts   mismatches   rebuilds   max cost   refit (us)   update (us)" << endl;
+
+    Random random(seed);
+    cPrecisionClock clock;
+    double timeRefit = 0.0;
+    double maxCost = 0.0;
+    int contacts = 0;
+    int mismatches = 0;
+    int rebuilds = 0;
+    int numVertices = mesh->getNumVertices();
+
+    for (int frame=1; frame<=numFrames; frame++)
+    {
+        deformGrid(brute, size, spacing, frame, numFrames);
+        deformGrid(mesh, size, spacing, frame, numFrames);
+
+        // a rebuilt tree replaces the current one at the next refit
+        bool rebuilding = tree->isRebuilding();
+        clock.start(true);
+        tree->refit();
+        timeRefit += clock.stop();
+        if (rebuilding && !tree->isRebuilding()) rebuilds++;
+        maxCost = cMax(maxCost, tree->getTreeCost());
+
+        for (int k=0; k<queriesPerFrame; k++)
+        {
+            // short segments close to the surface
+            cCollisionSettings settings;
+            settings.m_collisionRadius = ((k % 2) == 0) ? 0.0 : buildRadius;
+            settings.m_checkForNearestCollisionOnly = ((k % 4) < 2);
+
+            cVector3d a = mesh->m_vertices->getLocalPos((int)random.uniform(0, numVertices)) + random.uniform(0.0, 0.002) * random.direction();
+            cVector3d b = a + 0.002 * random.direction();
+
+            cCollisionRecorder bruteRecorder, treeRecorder;
+            brute->computeCollisionDetection(a, b, bruteRecorder, settings);
+            mesh->computeCollisionDetection(a, b, treeRecorder, settings);
+
+            if (bruteRecorder.m_nearestCollision.m_object != NULL) contacts++;
+            if (!sameContacts(bruteRecorder, treeRecorder)) mismatches++;
+        }
+    }
+
+    // full rebuild of the same tree for comparison
+    const int numUpdates = 10;
+    clock.start(true);
+    for (int i=0; i<numUpdates; i++)
+    {
+        tree->update();
+    }
+    double timeUpdate = clock.stop();
+
+    cout << "  " << setw(9) << mesh->getNumTriangles()
+         << "   " << setw(6) << numFrames
+         << "   " << setw(7) << numFrames * queriesPerFrame
+         << "   " << setw(8) << contacts
+         << "   " << setw(10) << mismatches
+         << "   " << setw(8) << rebuilds
+         << "   " << fixed << setprecision(3) << setw(8) << maxCost
+         << "   " << setw(10) << 1e6 * timeRefit / numFrames
+         << "   " << setw(11) << 1e6 * timeUpdate / numUpdates << endl;
+    cout.unsetf(ios::floatfield);
+
+    if ((mismatches > 0) || (contacts == 0) || (rebuilds == 0))
+    {
+        errors++;
+    }
+
+    delete brute;
+    delete mesh;
+
+    cout << "refit: " << ((errors == 0) ? "passed" : "FAILED") << endl << endl;
+
+    return errors;
+}
+
+
+// simple usage printer
+int usage()
+{
+    cout << endl << "ccollision [-t {cache|broadphase|tree|refit|build|all}] [-n steps] [-s seed] [-m model]..." << endl;
+    cout << "\t-t\tselect test (default: all)" << endl;
+    cout << "\t-n\tnumber of queries or steps per configuration (default: 20000)" << endl;
+    cout << "\t-s\tseed of the random scenes and trajectories (default: 1)" << endl;
+    cout << "\t-m\tmodel merged into the mesh of the build test, for example" << endl;
+    cout << "\t\tmodules/BULLET/external/bullet/data/l_finger.stl (repeatable)" << endl;
+    cout << "\t-h\tdisplay this message" << endl << endl;
+
+    return -1;
+}
+
+
+//===========================================================================
+/*
+    UTILITY:    ccollision.cpp
+
+    This utility verifies the accelerated collision queries of CHAI3D 
+    against their reference implementation on reproducible scenes, and 
+    reports the average cost of each. It returns a non-zero value if any 
+    accelerated query differs from its reference.
+ */
+//===========================================================================
+
+int main(int argc, char* argv[])
+{
+    string test = "all";
+    int steps = 20000;
+    unsigned int seed = 1;
+    vector<string> models;
+
+    // process arguments
+    for (int i=1; i<argc; i++)
+    {
+        if (argv[i][0] != '-') return usage();
+        switch (argv[i][1]) {
+            case 'h':
+                return usage ();
+            case 't':
+                if (i+1 < argc) test = string(argv[++i]);
+                else return usage ();
+                break;
+            case 'n':
+                if (i+1 < argc) steps = atoi(argv[++i]);
+                else return usage ();
+                break;
+            case 's':
+                if (i+1 < argc) seed = (unsigned int)atoi(argv[++i]);
+                else return usage ();
+                break;
+            case 'm':
+                if (i+1 < argc) models.push_back(string(argv[++i]));
+                else return usage ();
+                break;
+            default:
+                return usage ();
+        }
+    }
+    if ((test != "all") && (test != "cache") && (test != "broadphase") && (test != "tree") && (test != "refit") && (test != "build")) return usage();
+    if (steps <= 0) return usage();
+
+    // pretty message
+    cout << endl;
+    cout << "-----------------------------------" << endl;
+    cout << "CHAI3D" << endl;
+    cout << "Collision Tests" << endl;
+    cout << "Copyright 2003-2016" << endl;
+    cout << "-----------------------------------" << endl;
+    cout << endl;
+
+    int errors = 0;
+
+    if ((test == "all") || (test == "cache"))
+    {
+        errors += testCache(steps, seed);
+    }
+
+    if ((test == "all") || (test == "broadphase"))
+    {
+        errors += testBroadphase(steps, seed);
+    }
+
+    if ((test == "all") || (test == "tree"))
+    {
+        errors += testTree(steps, seed);
+    }
+
+    if ((test == "all") || (test == "refit"))
+    {
+        errors += testRefit(steps, seed);
+    }
+
+    if ((test == "all") || (test == "build"))
+    {
+        errors += testBuild(steps, seed, models);
+    }
+
+    return ((errors == 0) ? 0 : 1);
+}
+
+//---------------------------------------------------------------------------
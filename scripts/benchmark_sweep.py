@@ -0,0 +1,182 @@
+#!/usr/bin/env python3
+"""Headless benchmark sweep of the teleoperation system.
+
+Runs commChannel, HapticSlaver and HapticMaster headless for every combination
+of network delay, packet loss, deadband and control algorithm. Each process
+appends one summary row per run to its own CSV file (BenchmarkFile):
+
+    <out>/master.csv   haptic rate, jitter, RTT, packet rates, CPU, tracking errors
+    <out>/slave.csv    haptic and physics rate, jitter, delay, packet rates, CPU
+
+The parameters of a run are written to <out>/master-override.cfg and
+<out>/slave-override.cfg and passed to the applications through HAPTIC_CONFIG,
+so cfg/config.cfg stays untouched. The master is driven by its virtual device,
+no haptic device is needed.
+
+The delay and the packet loss are applied by the senders of the master and
+the slave, which are connected to each other on ports 888/889. commChannel is
+started as well when it is found, so that the process set matches the normal
+setup; pass --no-comm-channel to leave it out.
+
+Usage (from the repository root, after building the Release|x64 solution):
+
+    python scripts/benchmark_sweep.py --delay 0 20 50 --loss 0 0.05 \\
+        --deadband 0 0.1 --algorithm 0 1 4 --duration 30 --out results
+"""
+
+import argparse
+import itertools
+import os
+import subprocess
+import sys
+import time
+
+ROOT = os.path.dirname(os.path.dirname(os.path.abspath(__file__)))
+
+ALGORITHMS = {0: "none", 1: "TDPA", 2: "ISS", 3: "MMT", 4: "WAVE"}
+
+
+def parse_args():
+    parser = argparse.ArgumentParser(description="Headless benchmark sweep of master, commChannel and slave.")
+    parser.add_argument("--bin", default=os.path.join(ROOT, "bin", "win-x64"),
+                        help="directory of HapticMaster.exe and HapticSlaver.exe (default: bin/win-x64)")
+    parser.add_argument("--comm-channel", default=os.path.join(ROOT, "external", "libevent", "vs2015sln", "bin", "Release", "commChannel.exe"),
+                        help="path of commChannel.exe")
+    parser.add_argument("--no-comm-channel", action="store_true", help="do not start commChannel")
+    parser.add_argument("--delay", type=float, nargs="+", default=[0, 20, 50, 100],
+                        help="ms: one way delay of both channels (CommandDelay, ForceDelay)")
+    parser.add_argument("--dynamic-delay", type=int, nargs="+", default=[0],
+                        help="0: constant delay, 1: gamma distributed delay with the same mean")
+    parser.add_argument("--loss", type=float, nargs="+", default=[0, 0.01, 0.05],
+                        help="probability that a sender drops a message (PacketLossRate)")
+    parser.add_argument("--deadband", type=float, nargs="+", default=[0, 0.05, 0.1],
+                        help="deadband parameter applied to force, velocity and position")
+    parser.add_argument("--orientation-deadband", type=float, default=0.0,
+                        help="deg: deadband angle for orientation (OrientationDeadbandParameter)")
+    parser.add_argument("--algorithm", type=int, nargs="+", default=[0, 1, 2, 4],
+                        help="control algorithm, " + ", ".join("%d: %s" % a for a in sorted(ALGORITHMS.items())))
+    parser.add_argument("--duration", type=float, default=30.0, help="s: length of one run (HeadlessDuration)")
+    parser.add_argument("--repeat", type=int, default=1, help="number of runs per combination")
+    parser.add_argument("--motion", type=int, default=1,
+                        help="motion profile of the virtual device, 0: static, 1: sine, 2: circle, 3: square")
+    parser.add_argument("--trace", default="none", help="trace replayed by the virtual device instead of the motion profile")
+    parser.add_argument("--startup", type=float, default=2.0, help="s: wait between starting two processes")
+    parser.add_argument("--out", default=os.path.join(ROOT, "results"), help="directory of the CSV files and logs")
+    return parser.parse_args()
+
+
+def write_override(fileName, keys):
+    # same format as cfg/config.cfg, only the keys that are varied
+    with open(fileName, "w") as f:
+        for key, value in keys:
+            f.write("%s = %s;\n" % (key, value))
+
+
+def start(command, cwd, env, log):
+    return subprocess.Popen(command, cwd=cwd, env=env, stdout=log, stderr=subprocess.STDOUT)
+
+
+def stop(process):
+    if process.poll() is None:
+        process.terminate()
+        try:
+            process.wait(10)
+        except subprocess.TimeoutExpired:
+            process.kill()
+            process.wait()
+
+
+def run(args, index, keys, masterFile, slaveFile):
+    # each process writes its own columns, so each gets its own BenchmarkFile
+    masterConfig = os.path.join(args.out, "master-override.cfg")
+    slaveConfig = os.path.join(args.out, "slave-override.cfg")
+    write_override(masterConfig, keys + [("BenchmarkFile", masterFile)])
+    write_override(slaveConfig, keys + [("BenchmarkFile", slaveFile)])
+    masterEnv = dict(os.environ, HAPTIC_CONFIG=masterConfig)
+    slaveEnv = dict(os.environ, HAPTIC_CONFIG=slaveConfig)
+
+    # the applications read cfg/config.cfg relative to the working directory
+    logName = os.path.join(args.out, "logs", "run%04d" % index)
+    processes = []
+    with open(logName + "-comm.log", "w") as commLog, \
+         open(logName + "-slave.log", "w") as slaveLog, \
+         open(logName + "-master.log", "w") as masterLog:
+        try:
+            if not args.no_comm_channel and os.path.isfile(args.comm_channel):
+                processes.append(start([args.comm_channel], os.path.dirname(args.comm_channel), os.environ, commLog))
+                time.sleep(args.startup)
+
+            # the slave listens for the master, it has to be up first
+            slave = start([os.path.join(args.bin, "HapticSlaver.exe"), "--headless"],
+                          os.path.join(ROOT, "HapticSlaver"), slaveEnv, slaveLog)
+            processes.append(slave)
+            time.sleep(args.startup)
+
+            master = start([os.path.join(args.bin, "HapticMaster.exe"), "--headless"],
+                           os.path.join(ROOT, "HapticMaster"), masterEnv, masterLog)
+            processes.append(master)
+
+            # both stop by themselves after HeadlessDuration and write their summary
+            timeout = args.duration + 30
+            results = []
+            for process in (master, slave):
+                try:
+                    results.append(process.wait(timeout))
+                except subprocess.TimeoutExpired:
+                    results.append(None)
+            return all(result == 0 for result in results)
+        finally:
+            for process in reversed(processes):
+                stop(process)
+
+
+def main():
+    args = parse_args()
+    args.out = os.path.abspath(args.out)
+    masterFile = os.path.join(args.out, "master.csv")
+    slaveFile = os.path.join(args.out, "slave.csv")
+    if args.trace != "none":
+        args.trace = os.path.abspath(args.trace)
+    # config values are read up to the first blank
+    if " " in args.out or " " in args.trace:
+        print("error - the output directory and the trace path cannot contain spaces")
+        return 1
+    os.makedirs(os.path.join(args.out, "logs"), exist_ok=True)
+
+    combinations = list(itertools.product(args.delay, args.dynamic_delay, args.loss, args.deadband, args.algorithm))
+    total = len(combinations) * args.repeat
+    failed = 0
+    index = 0
+    for delay, dynamicDelay, loss, deadband, algorithm in combinations:
+        for repeat in range(args.repeat):
+            index += 1
+            print("[%d/%d] delay %g ms%s, loss %g, deadband %g, %s" % (
+                index, total, delay, " (gamma)" if dynamicDelay else "", loss, deadband,
+                ALGORITHMS.get(algorithm, str(algorithm))))
+            sys.stdout.flush()
+            keys = [
+                ("Headless", 1),
+                ("HeadlessDuration", args.duration),
+                ("VirtualDevice", 1),
+                ("VirtualDeviceTrace", args.trace),
+                ("VirtualDeviceMotion", args.motion),
+                ("CommandDelay", delay),
+                ("ForceDelay", delay),
+                ("DynamicDelay", dynamicDelay),
+                ("PacketLossRate", loss),
+                ("ForceDeadbandParameter", deadband),
+                ("VelocityDeadbandParameter", deadband),
+                ("PositionDeadbandParameter", deadband),
+                ("OrientationDeadbandParameter", args.orientation_deadband),
+                ("Algorithm", algorithm),
+            ]
+            if not run(args, index, keys, masterFile, slaveFile):
+                failed += 1
+                print("  error - run %d did not finish cleanly, see %s" % (index, os.path.join(args.out, "logs")))
+
+    print("%d run(s), %d failed, results in %s and %s" % (total, failed, masterFile, slaveFile))
+    return 1 if failed else 0
+
+
+if __name__ == "__main__":
+    sys.exit(main())